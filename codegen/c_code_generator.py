@@ -38,6 +38,14 @@ def sanitize_c_identifier(name: str, prefix: str = "s_") -> str:
         
     return sanitized
 
+def _id_storage_type(count: int) -> str:
+    """Smallest signed C type for IDs 0..count-1; signed because FSM_NO_EVENT is -1."""
+    if count <= 0x7F:
+        return "int8_t"
+    if count <= 0x7FFF:
+        return "int16_t"
+    return "int32_t"
+
 def generate_c_code_content(diagram_data: Dict, fsm_name: str, target_platform: str, options: Dict = None) -> Dict[str, str]:
     """Generates C code content based on a target platform and options."""
     if not diagram_data.get('states'):
@@ -204,8 +212,8 @@ def _prepare_template_context(diagram_data: Dict, fsm_name_c: str, target_platfo
         "condition_functions": list(condition_functions.values()),
         "action_prototypes": [sig + ";" for sig, _, _ in action_functions.values()],
         "condition_prototypes": [sig + ";" for sig, _, _ in condition_functions.values()],
-        "state_enum_type": "int8_t",
-        "event_enum_type": "int8_t",
+        "state_enum_type": _id_storage_type(len(diagram_data['states'])),
+        "event_enum_type": _id_storage_type(len(events_list)),
         "options": options,
         "code_to_c_stub": code_to_c_stub,
         "app_name": "BSM Designer", "app_version": "2.0.0", "timestamp": datetime.now().strftime("%Y-%m-%d %H:%M:%S")
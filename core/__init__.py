@@ -7,12 +7,15 @@ from .fsm_simulator import FSMSimulator, FSMError
 from .resource_estimator import ResourceEstimator
 from .fsm_ir import FsmModel, State, Transition, Comment, Action, Condition
 from .fsm_parser import parse_diagram_to_ir
-from .c_fsm_simulator import CFsmSimulator, CSimError
+from .c_fsm_simulator import CFsmSimulator, CFsmModel, CFsmTraceReader, CFsmDownsampler, CSimError
 
 __all__ = [
     "FSMSimulator",
     "FSMError",
     "CFsmSimulator",
+    "CFsmModel",
+    "CFsmTraceReader",
+    "CFsmDownsampler",
     "CSimError",
     "ResourceEstimator",
     "FsmModel",
@@ -5,13 +5,199 @@ import os
 import sys
 import json
 import logging
+from collections import deque
 from typing import Dict, List, Tuple, Optional
 
+try:
+    import numpy as np
+except ImportError:  # Installed alongside pyqtgraph; plain lists still work without it
+    np = None
+
 logger = logging.getLogger(__name__)
 
 class CSimError(Exception):
     pass
 
+class FsmRealtimeStatus(ctypes.Structure):
+    """Mirror of the FsmRealtimeStatus struct in fsm_core.h."""
+    _fields_ = [
+        ("running", ctypes.c_bool),
+        ("active_state_id", ctypes.c_int32),
+        ("tick", ctypes.c_uint64),
+        ("loop_ticks", ctypes.c_uint64),
+        ("overruns", ctypes.c_uint64),
+        ("dropped_events", ctypes.c_uint64),
+        ("max_lateness_ns", ctypes.c_int64),
+    ]
+
+# FsmVarType values from fsm_core.h
+FSM_VAR_BOOL, FSM_VAR_INT, FSM_VAR_REAL, FSM_VAR_OTHER = 1, 2, 3, 4
+
+# FsmStateFlags values from fsm_core.h
+FSM_STATE_INITIAL, FSM_STATE_FINAL = 1, 2
+
+# FsmRebindPolicy flags from fsm_core.h
+FSM_REBIND_BY_NAME, FSM_REBIND_BY_ID, FSM_REBIND_STRICT = 0, 1, 2
+
+# FsmCoverageKind values and FSM_RESIDENCY_BUCKETS from fsm_core.h
+FSM_COVERAGE_KINDS = {"state_visits": 0, "transition_fires": 1, "guard_true": 2, "guard_false": 3, "residency": 4}
+FSM_RESIDENCY_BUCKETS = 32
+
+class FsmVarValue(ctypes.Structure):
+    """Mirror of the FsmVarValue struct in fsm_core.h."""
+    _fields_ = [
+        ("slot", ctypes.c_int32),
+        ("type", ctypes.c_int32),
+        ("int_value", ctypes.c_int64),
+        ("real_value", ctypes.c_double),
+    ]
+
+    def to_python(self):
+        if self.type == FSM_VAR_BOOL:
+            return bool(self.int_value)
+        if self.type == FSM_VAR_INT:
+            return self.int_value
+        if self.type == FSM_VAR_REAL:
+            return self.real_value
+        return None
+
+class FsmTraceStats(ctypes.Structure):
+    """Mirror of the FsmTraceStats struct in fsm_core.h."""
+    _fields_ = [
+        ("records", ctypes.c_uint64),
+        ("bytes_written", ctypes.c_uint64),
+        ("bytes_pending", ctypes.c_uint64),
+        ("buffer_swaps", ctypes.c_uint64),
+        ("write_errors", ctypes.c_uint64),
+    ]
+
+class FsmTraceInfo(ctypes.Structure):
+    """Mirror of the FsmTraceInfo struct in fsm_core.h."""
+    _fields_ = [
+        ("step_count", ctypes.c_uint64),
+        ("last_tick", ctypes.c_uint64),
+        ("run_count", ctypes.c_uint32),
+        ("keyframe_count", ctypes.c_uint32),
+        ("indexed", ctypes.c_bool),
+    ]
+
+class FsmHistoryBucket(ctypes.Structure):
+    """Mirror of the FsmHistoryBucket struct in fsm_core.h."""
+    _fields_ = [
+        ("tick_first", ctypes.c_uint64),
+        ("tick_last", ctypes.c_uint64),
+        ("min", ctypes.c_double),
+        ("max", ctypes.c_double),
+        ("last", ctypes.c_double),
+        ("count", ctypes.c_uint32),
+    ]
+
+class FsmHistoryInfo(ctypes.Structure):
+    """Mirror of the FsmHistoryInfo struct in fsm_core.h."""
+    _fields_ = [
+        ("rows", ctypes.c_uint64),
+        ("first_tick", ctypes.c_uint64),
+        ("last_tick", ctypes.c_uint64),
+        ("bytes", ctypes.c_uint64),
+        ("chunks", ctypes.c_uint32),
+    ]
+
+class FsmModelInfo(ctypes.Structure):
+    """Mirror of the FsmModelInfo struct in fsm_core.h."""
+    _fields_ = [
+        ("state_count", ctypes.c_uint32),
+        ("transition_count", ctypes.c_uint32),
+        ("event_count", ctypes.c_uint32),
+        ("code_count", ctypes.c_uint32),
+        ("image_bytes", ctypes.c_uint64),
+        ("mapped", ctypes.c_bool),
+    ]
+
+class FsmModelCacheStats(ctypes.Structure):
+    """Mirror of the FsmModelCacheStats struct in fsm_core.h."""
+    _fields_ = [
+        ("entries", ctypes.c_uint32),
+        ("capacity", ctypes.c_uint32),
+        ("raw_hits", ctypes.c_uint64),
+        ("semantic_hits", ctypes.c_uint64),
+        ("disk_hits", ctypes.c_uint64),
+        ("compiles", ctypes.c_uint64),
+        ("disk_writes", ctypes.c_uint64),
+        ("disk_evictions", ctypes.c_uint64),
+    ]
+
+class FsmMemoryStats(ctypes.Structure):
+    """Mirror of the FsmMemoryStats struct in fsm_core.h."""
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        "model_bytes", "model_string_bytes", "model_table_bytes", "model_code_bytes", "editor_bytes",
+        "instance_bytes", "queue_bytes", "log_bytes", "history_bytes", "trace_bytes", "total_bytes",
+        "allocations", "deallocations", "allocated_bytes", "peak_bytes")]
+
+class FsmLatencyStats(ctypes.Structure):
+    """Mirror of the FsmLatencyStats struct in fsm_core.h."""
+    _fields_ = [(name, ctypes.c_uint64) for name in (
+        "count", "min_ns", "p50_ns", "p90_ns", "p99_ns", "p999_ns", "max_ns")] + [("mean_ns", ctypes.c_double)]
+
+# FsmLatencyKind values from fsm_core.h
+FSM_LATENCY_KINDS = {"step": 0, "guard": 1, "action": 2}
+
+# FsmDownsampleMode values from fsm_core.h
+FSM_DOWNSAMPLE_MINMAX = 0
+FSM_DOWNSAMPLE_LTTB = 1
+_DOWNSAMPLE_MODES = {"minmax": FSM_DOWNSAMPLE_MINMAX, "lttb": FSM_DOWNSAMPLE_LTTB}
+
+_c_double_p = ctypes.POINTER(ctypes.c_double)
+
+def _as_double_buffer(values):
+    """(owner, pointer) for a sequence of floats; float64 numpy arrays are passed without copying."""
+    if np is not None:
+        array = np.ascontiguousarray(values, dtype=np.float64)
+        return array, array.ctypes.data_as(_c_double_p)
+    array = (ctypes.c_double * len(values))(*values)
+    return array, array
+
+def _new_double_buffer(size: int):
+    if np is not None:
+        array = np.empty(size, dtype=np.float64)
+        return array, array.ctypes.data_as(_c_double_p)
+    array = (ctypes.c_double * size)()
+    return array, array
+
+def _load_error(lib) -> str:
+    """Message of the last failed JSON load on this thread, with the byte offset for malformed input."""
+    offset = ctypes.c_int64(-1)
+    ptr = lib.fsm_get_load_error(ctypes.byref(offset))
+    message = ctypes.string_at(ptr).decode('utf-8', 'replace') if ptr else ""
+    if ptr:
+        lib.free_string_memory(ptr)
+    return f"{message} (byte {offset.value})" if offset.value >= 0 else message
+
+def _utf8(text: Optional[str]):
+    return None if text is None else text.encode('utf-8')
+
+def _state_flags(is_initial: bool, is_final: bool) -> int:
+    return (FSM_STATE_INITIAL if is_initial else 0) | (FSM_STATE_FINAL if is_final else 0)
+
+def _trimmed(array, count: int):
+    """First `count` elements: a view for numpy arrays, a list otherwise."""
+    return array[:count] if np is not None else list(array[:count])
+
+# Native callback log entries kept between drains (the real-time loop never drains it by stepping)
+CALLBACK_LOG_LIMIT = 1000
+
+# Native callback signatures from fsm_core.h
+FSM_GUARD_FN = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.c_int32)
+FSM_ACTION_FN = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_int32, ctypes.c_int32)
+
+class FsmStateSnapshot(ctypes.Structure):
+    """Mirror of the FsmStateSnapshot struct in fsm_core.h."""
+    _fields_ = [
+        ("version", ctypes.c_uint64),
+        ("tick", ctypes.c_uint64),
+        ("active_state_id", ctypes.c_int32),
+        ("var_count", ctypes.c_uint32),
+    ]
+
 class CFsmSimulator:
     """A Python wrapper for the compiled C++ FSM core engine."""
 
@@ -28,9 +214,29 @@ class CFsmSimulator:
         self.current_tick = 0
         self.current_state_name = "Uninitialized"
 
+        # Reusable buffers for lock-free snapshot polling
+        self._snapshot_vars = (FsmVarValue * 0)()
+        self._name_cache: Dict[Tuple[str, int], str] = {}
+
+        # Change-version bookkeeping for delta-only retrieval
+        self._state_version = None
+        self._changed_vars_version = 0
+        self._changed_vars = (FsmVarValue * 0)()
+
+        # Native callback mode: the engine calls back into Python instead of suspending
+        self._guard_cb = None
+        self._action_cb = None
+        self._callback_log = deque(maxlen=CALLBACK_LOG_LIMIT)
+        self._realtime = False  # No step() runs to write action changes back while the loop owns the engine
+
+        # Code ID -> source, fetched once per load; snippets are compiled on first use
+        self._code_table: List[str] = []
+        self._code_objects: Dict[Tuple[int, str], any] = {}
+
     def __del__(self):
         if hasattr(self, 'lib') and self.lib and hasattr(self, 'handle') and self.handle:
             self.lib.destroy_fsm(self.handle)
+            self.handle = None
 
     def _load_library(self, library_path: str):
         """Loads the shared library."""
@@ -56,53 +262,365 @@ class CFsmSimulator:
         # Simulation
         self.lib.step.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
         self.lib.resolve_condition.argtypes = [ctypes.c_void_p, ctypes.c_bool]
+        self.lib.fsm_resolve_conditions.argtypes = [ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8), ctypes.c_size_t]
         self.lib.queue_internal_event.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
         
         # Data Retrieval
         self.lib.get_current_state_name.argtypes = [ctypes.c_void_p]
-        self.lib.get_current_state_name.restype = ctypes.c_char_p
+        self.lib.get_current_state_name.restype = ctypes.c_void_p
         self.lib.get_variables_json.argtypes = [ctypes.c_void_p]
-        self.lib.get_variables_json.restype = ctypes.c_char_p
+        self.lib.get_variables_json.restype = ctypes.c_void_p
         self.lib.get_and_clear_log_json.argtypes = [ctypes.c_void_p]
-        self.lib.get_and_clear_log_json.restype = ctypes.c_char_p
+        self.lib.get_and_clear_log_json.restype = ctypes.c_void_p
         self.lib.get_current_tick.argtypes = [ctypes.c_void_p]
         self.lib.get_current_tick.restype = ctypes.c_int
 
+        # Compiled Model Cache
+        self.lib.fsm_model_cache_configure.argtypes = [ctypes.c_uint32, ctypes.c_char_p]
+        self.lib.fsm_model_cache_clear.argtypes = []
+        self.lib.fsm_model_cache_stats.argtypes = [ctypes.POINTER(FsmModelCacheStats)]
+
+        # Load Errors
+        self.lib.fsm_get_load_error.argtypes = [ctypes.POINTER(ctypes.c_int64)]
+        self.lib.fsm_get_load_error.restype = ctypes.c_void_p
+
         # Memory Management
-        self.lib.free_string_memory.argtypes = [ctypes.c_char_p]
+        # String-returning functions use c_void_p restypes so the original
+        # pointer (not a Python copy of it) is handed back to be freed.
+        self.lib.free_string_memory.argtypes = [ctypes.c_void_p]
+
+        # Real-Time Engine Thread
+        self.lib.fsm_start_realtime.argtypes = [ctypes.c_void_p, ctypes.c_double]
+        self.lib.fsm_start_realtime.restype = ctypes.c_bool
+        self.lib.fsm_stop_realtime.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_is_realtime_running.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_is_realtime_running.restype = ctypes.c_bool
+        self.lib.fsm_post_event.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.fsm_post_event.restype = ctypes.c_bool
+        self.lib.fsm_get_realtime_status.argtypes = [ctypes.c_void_p, ctypes.POINTER(FsmRealtimeStatus)]
+        self.lib.fsm_get_state_name.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.fsm_get_state_name.restype = ctypes.c_void_p
+
+        # Published State Snapshot
+        self.lib.fsm_read_snapshot.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.POINTER(FsmStateSnapshot),
+                                               ctypes.POINTER(FsmVarValue), ctypes.c_uint32]
+        self.lib.fsm_read_snapshot.restype = ctypes.c_bool
+        self.lib.fsm_get_variable_name.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.fsm_get_variable_name.restype = ctypes.c_void_p
+
+        # Change Tracking
+        self.lib.fsm_get_change_version.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_get_change_version.restype = ctypes.c_uint64
+        self.lib.fsm_get_state_version.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_get_state_version.restype = ctypes.c_uint64
+        self.lib.fsm_get_variable_count.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_get_variable_count.restype = ctypes.c_uint32
+        self.lib.fsm_get_changed_vars.argtypes = [ctypes.c_void_p, ctypes.c_uint64, ctypes.POINTER(FsmVarValue), ctypes.c_uint32]
+        self.lib.fsm_get_changed_vars.restype = ctypes.c_uint32
+        self.lib.fsm_set_variable_json.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p]
+        self.lib.fsm_set_variable_json.restype = ctypes.c_bool
+        self.lib.fsm_get_variable_json.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.fsm_get_variable_json.restype = ctypes.c_void_p
+
+        # Native Callbacks
+        self.lib.fsm_set_callbacks.argtypes = [ctypes.c_void_p, FSM_GUARD_FN, FSM_ACTION_FN, ctypes.c_void_p]
+        self.lib.fsm_get_code_source.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.fsm_get_code_source.restype = ctypes.c_void_p
+
+        # Coverage Counters
+        self.lib.fsm_coverage_enable.argtypes = [ctypes.c_void_p, ctypes.c_bool]
+        self.lib.fsm_coverage_clear.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_coverage_read.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(ctypes.c_uint64),
+                                               ctypes.c_uint32]
+        self.lib.fsm_coverage_read.restype = ctypes.c_uint32
+
+        # Latency Histograms
+        self.lib.fsm_latency_enable.argtypes = [ctypes.c_void_p, ctypes.c_bool]
+        self.lib.fsm_latency_reset.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_latency_stats.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.POINTER(FsmLatencyStats)]
+
+        # Span Recording
+        self.lib.fsm_spans_enable.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.fsm_spans_clear.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_spans_dump.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.fsm_spans_dump.restype = ctypes.c_bool
+
+        # Flight Recorder
+        self.lib.fsm_flight_recorder_set_capacity.argtypes = [ctypes.c_void_p, ctypes.c_uint32]
+        self.lib.fsm_flight_recorder_set_dump_path.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.fsm_flight_recorder_json.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_flight_recorder_json.restype = ctypes.c_void_p
+        self.lib.fsm_flight_recorder_dump.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p]
+        self.lib.fsm_flight_recorder_dump.restype = ctypes.c_bool
+        self.lib.fsm_flight_recorder_trigger.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.fsm_flight_recorder_trigger.restype = ctypes.c_bool
+
+        # Memory Accounting
+        self.lib.fsm_memory_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FsmMemoryStats)]
+
+        # Binary Trace Recording
+        self.lib.fsm_trace_open.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.fsm_trace_open.restype = ctypes.c_bool
+        self.lib.fsm_trace_close.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_trace_close.restype = ctypes.c_bool
+        self.lib.fsm_trace_is_open.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_trace_is_open.restype = ctypes.c_bool
+        self.lib.fsm_get_trace_stats.argtypes = [ctypes.c_void_p, ctypes.POINTER(FsmTraceStats)]
+
+        # Variable History
+        self.lib.fsm_history_enable.argtypes = [ctypes.c_void_p, ctypes.c_bool]
+        self.lib.fsm_get_history_info.argtypes = [ctypes.c_void_p, ctypes.POINTER(FsmHistoryInfo)]
+        self.lib.fsm_history_query.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint64, ctypes.c_uint64,
+                                               ctypes.POINTER(FsmHistoryBucket), ctypes.c_uint32]
+        self.lib.fsm_history_query.restype = ctypes.c_uint32
+        self.lib.fsm_history_downsample.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint64, ctypes.c_uint64,
+                                                    ctypes.c_int32, ctypes.c_size_t, _c_double_p, _c_double_p]
+        self.lib.fsm_history_downsample.restype = ctypes.c_size_t
+
+        # Code Table
+        self.lib.fsm_get_code_table_json.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_get_code_table_json.restype = ctypes.c_void_p
+
+        # Compiled Models
+        self.lib.fsm_load_model.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+        self.lib.fsm_load_model.restype = ctypes.c_bool
+
+        # Hot Swap
+        self.lib.fsm_rebind.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int32]
+        self.lib.fsm_rebind.restype = ctypes.c_bool
+        self.lib.fsm_get_rebind_report.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_get_rebind_report.restype = ctypes.c_void_p
+
+        # Live Model Editing
+        self.lib.fsm_edit_add_state.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p,
+                                                ctypes.c_char_p, ctypes.c_uint32]
+        self.lib.fsm_edit_add_state.restype = ctypes.c_bool
+        self.lib.fsm_edit_remove_state.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        self.lib.fsm_edit_remove_state.restype = ctypes.c_bool
+        self.lib.fsm_edit_rename_state.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p]
+        self.lib.fsm_edit_rename_state.restype = ctypes.c_bool
+        self.lib.fsm_edit_set_state_code.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p,
+                                                     ctypes.c_char_p]
+        self.lib.fsm_edit_set_state_code.restype = ctypes.c_bool
+        self.lib.fsm_edit_set_state_flags.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_uint32]
+        self.lib.fsm_edit_set_state_flags.restype = ctypes.c_bool
+        self.lib.fsm_edit_add_transition.argtypes = [ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p,
+                                                     ctypes.c_char_p, ctypes.c_char_p]
+        self.lib.fsm_edit_add_transition.restype = ctypes.c_int32
+        self.lib.fsm_edit_remove_transition.argtypes = [ctypes.c_void_p, ctypes.c_int32]
+        self.lib.fsm_edit_remove_transition.restype = ctypes.c_bool
+        self.lib.fsm_edit_update_transition.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.c_char_p,
+                                                        ctypes.c_char_p, ctypes.c_char_p]
+        self.lib.fsm_edit_update_transition.restype = ctypes.c_bool
+        self.lib.fsm_edit_set_transition_code.argtypes = [ctypes.c_void_p, ctypes.c_int32, ctypes.c_char_p,
+                                                          ctypes.c_char_p]
+        self.lib.fsm_edit_set_transition_code.restype = ctypes.c_bool
 
     def _call_c_func_with_string_return(self, func, *args):
         """Helper to call a C function that returns a string and manage memory."""
         c_ptr = func(*args)
         if not c_ptr:
             return ""
-        py_str = c_ptr.decode('utf-8')
+        py_str = ctypes.string_at(c_ptr).decode('utf-8')
         self.lib.free_string_memory(c_ptr)
         return py_str
 
     def load_fsm(self, diagram_data: Dict):
         """Loads the FSM structure into the C++ engine."""
+        self._name_cache.clear()
         json_str = json.dumps(diagram_data)
         success = self.lib.load_fsm_from_json(self.handle, json_str.encode('utf-8'))
         if not success:
-            raise CSimError("Failed to load FSM data into C++ core.")
+            raise CSimError(f"Failed to load FSM data into C++ core: {_load_error(self.lib)}")
+        self._load_code_table()
+        self.reset()
+
+    def load_model(self, model: "CFsmModel"):
+        """Loads a compiled model (see CFsmModel); same effect as load_fsm() with its source diagram."""
+        self._name_cache.clear()
+        if not self.lib.fsm_load_model(self.handle, model.handle):
+            raise CSimError("Failed to load compiled model into C++ core.")
+        self._load_code_table()
         self.reset()
 
+    def rebind(self, model: "CFsmModel", by_id: bool = False, strict: bool = False) -> Dict[str, List[str]]:
+        """
+        Moves the running simulation onto another compiled model without a
+        reset, keeping the active state (matched by name, or by ID), variables
+        and queued events. Returns the unmapped elements as
+        {"states": [...], "events": [...]}; an unmapped active state halts the
+        machine unless strict, in which case CSimError is raised and nothing changes.
+        """
+        policy = (FSM_REBIND_BY_ID if by_id else FSM_REBIND_BY_NAME) | (FSM_REBIND_STRICT if strict else 0)
+        ok = self.lib.fsm_rebind(self.handle, model.handle, policy)
+        report = json.loads(self._call_c_func_with_string_return(self.lib.fsm_get_rebind_report, self.handle) or "{}")
+        if not ok:
+            raise CSimError(f"Failed to rebind the C++ core to the new model: {report}")
+        self._name_cache.clear()
+        self._load_code_table()
+        self._state_version = None
+        self._sync_state_from_c()
+        return report
+
+    def configure_model_cache(self, capacity: int = 8, directory: Optional[str] = None):
+        """
+        Sizes the process-wide compiled-model cache used by load_fsm(). With a
+        directory, compiled models also persist there across runs and processes.
+        """
+        self.lib.fsm_model_cache_configure(capacity, os.fsencode(directory) if directory else None)
+
+    def get_model_cache_stats(self) -> Dict[str, int]:
+        stats = FsmModelCacheStats()
+        self.lib.fsm_model_cache_stats(ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in FsmModelCacheStats._fields_}
+
+    # --- Live model editing ---
+    # Edits patch the loaded model while the simulation keeps running; only
+    # removing the active state halts it. Transition IDs are the positions in
+    # the loaded diagram's "transitions" list, then the IDs returned by
+    # edit_add_transition(). For optional arguments None keeps the current
+    # value and "" clears code.
+
+    def edit_add_state(self, name: str, entry_action: str = "", during_action: str = "", exit_action: str = "",
+                       is_initial: bool = False, is_final: bool = False):
+        self._edit(self.lib.fsm_edit_add_state(self.handle, _utf8(name), _utf8(entry_action), _utf8(during_action),
+                                               _utf8(exit_action), _state_flags(is_initial, is_final)),
+                   f"add state '{name}'")
+
+    def edit_remove_state(self, name: str):
+        """Removes a state together with the transitions into and out of it."""
+        self._edit(self.lib.fsm_edit_remove_state(self.handle, _utf8(name)), f"remove state '{name}'")
+
+    def edit_rename_state(self, name: str, new_name: str):
+        self._edit(self.lib.fsm_edit_rename_state(self.handle, _utf8(name), _utf8(new_name)),
+                   f"rename state '{name}' to '{new_name}'")
+
+    def edit_set_state_code(self, name: str, entry_action: Optional[str] = None, during_action: Optional[str] = None,
+                            exit_action: Optional[str] = None):
+        self._edit(self.lib.fsm_edit_set_state_code(self.handle, _utf8(name), _utf8(entry_action),
+                                                    _utf8(during_action), _utf8(exit_action)),
+                   f"set code of state '{name}'")
+
+    def edit_set_state_flags(self, name: str, is_initial: bool = False, is_final: bool = False):
+        self._edit(self.lib.fsm_edit_set_state_flags(self.handle, _utf8(name), _state_flags(is_initial, is_final)),
+                   f"set flags of state '{name}'")
+
+    def edit_add_transition(self, source: str, target: str, event: str = "", condition: str = "",
+                            action: str = "") -> int:
+        """Adds a transition after all existing ones and returns its ID."""
+        transition_id = self.lib.fsm_edit_add_transition(self.handle, _utf8(source), _utf8(target), _utf8(event),
+                                                         _utf8(condition), _utf8(action))
+        self._edit(transition_id >= 0, f"add transition '{source}' -> '{target}'")
+        return transition_id
+
+    def edit_remove_transition(self, transition_id: int):
+        self._edit(self.lib.fsm_edit_remove_transition(self.handle, transition_id),
+                   f"remove transition {transition_id}")
+
+    def edit_update_transition(self, transition_id: int, source: Optional[str] = None, target: Optional[str] = None,
+                               event: Optional[str] = None):
+        self._edit(self.lib.fsm_edit_update_transition(self.handle, transition_id, _utf8(source), _utf8(target),
+                                                       _utf8(event)),
+                   f"update transition {transition_id}")
+
+    def edit_set_transition_code(self, transition_id: int, condition: Optional[str] = None,
+                                 action: Optional[str] = None):
+        self._edit(self.lib.fsm_edit_set_transition_code(self.handle, transition_id, _utf8(condition), _utf8(action)),
+                   f"set code of transition {transition_id}")
+
+    def _edit(self, ok: bool, what: str):
+        if not ok:
+            raise CSimError(f"Cannot {what} in the C++ core.")
+        # Existing code IDs keep their source, so compiled snippets stay valid;
+        # new snippets are appended to the table.
+        table_json = self._call_c_func_with_string_return(self.lib.fsm_get_code_table_json, self.handle)
+        self._code_table = json.loads(table_json) if table_json else []
+        # A rename does not move the active state, so its name is refetched explicitly.
+        self._name_cache.clear()
+        self._state_version = None
+        self._sync_state_from_c()
+
+    def _load_code_table(self):
+        """Fetches the ID -> source table once and drops code objects compiled for the previous model."""
+        table_json = self._call_c_func_with_string_return(self.lib.fsm_get_code_table_json, self.handle)
+        self._code_table = json.loads(table_json) if table_json else []
+        self._code_objects.clear()
+
+    def _compiled(self, code_id: int, mode: str):
+        """Returns the code object for a snippet, compiling it only the first time it is used."""
+        key = (code_id, mode)
+        code_obj = self._code_objects.get(key)
+        if code_obj is None:
+            code_obj = compile(self._code_table[code_id], f"<fsm code {code_id}>", mode)
+            self._code_objects[key] = code_obj
+        return code_obj
+
     def set_initial_variables(self, initial_vars: Dict):
         """Sets the initial variables for the simulation."""
+        self._name_cache.clear()
         self._variables = initial_vars.copy()
         json_str = json.dumps(self._variables)
         self.lib.set_initial_variables_from_json(self.handle, json_str.encode('utf-8'))
 
     def reset(self):
         """Resets the C++ FSM to its initial state."""
+        variables_before = self._serialize_variables()
         self.lib.reset_fsm(self.handle)
+        self._name_cache.clear()
+        # The initial state's entry action is logged like any other; the next step would drop it
+        self._process_action_log([])
+        self._write_back_variables(variables_before)
         self._sync_state_from_c()
         
     def _sync_state_from_c(self):
-        """Updates Python-side state from the C++ core."""
+        """Updates Python-side state from the C++ core, fetching the state name only when it moved."""
         self.current_tick = self.lib.get_current_tick(self.handle)
-        self.current_state_name = self._call_c_func_with_string_return(self.lib.get_current_state_name, self.handle)
+        state_version = self.lib.fsm_get_state_version(self.handle)
+        if state_version != self._state_version:
+            self._state_version = state_version
+            self.current_state_name = self._call_c_func_with_string_return(self.lib.get_current_state_name, self.handle)
+
+    def _serialize_variables(self) -> Dict[str, Optional[str]]:
+        """JSON form of every variable, so values mutated in place (lists, dicts) still compare as changed."""
+        serialized = {}
+        for name, value in self._variables.items():
+            try:
+                serialized[name] = json.dumps(value)
+            except (TypeError, ValueError):
+                serialized[name] = None  # Not representable in the core (e.g. objects created by actions)
+        return serialized
+
+    def _write_back_variables(self, before: Dict[str, Optional[str]]):
+        """Pushes variables modified by Python action code back into the C++ core."""
+        for name, value_json in self._serialize_variables().items():
+            if value_json is None or before.get(name) == value_json:
+                continue
+            self.lib.fsm_set_variable_json(self.handle, name.encode('utf-8'), value_json.encode('utf-8'))
+
+    def get_changed_variables(self) -> Dict[str, any]:
+        """Returns only the variables modified since the previous call.
+
+        Empty while the engine thread runs (use read_snapshot then); the changes
+        are reported once it has stopped.
+        """
+        if self.lib.fsm_is_realtime_running(self.handle):
+            return {}
+        since = self._changed_vars_version
+        self._changed_vars_version = self.lib.fsm_get_change_version(self.handle)
+        count = self.lib.fsm_get_changed_vars(self.handle, since, self._changed_vars, len(self._changed_vars))
+        if count > len(self._changed_vars):
+            self._changed_vars = (FsmVarValue * count)()
+            count = self.lib.fsm_get_changed_vars(self.handle, since, self._changed_vars, count)
+
+        changed = {}
+        for v in self._changed_vars[:count]:
+            name = self._cached_name("var", self.lib.fsm_get_variable_name, v.slot)
+            if v.type == FSM_VAR_OTHER:
+                value_json = self._call_c_func_with_string_return(self.lib.fsm_get_variable_json, self.handle, v.slot)
+                changed[name] = json.loads(value_json) if value_json else None
+            else:
+                changed[name] = v.to_python()
+        return changed
 
     def send(self, event_name: str):
         """Allows action code to post an event for processing in the current step."""
@@ -113,12 +631,26 @@ class CFsmSimulator:
     def step(self, event_name: Optional[str]) -> Tuple[str, List[str]]:
         """Executes one step of the simulation, handling condition callbacks."""
         full_python_log = []
+        variables_before = self._serialize_variables()
         
         # 1. Tell C++ engine to perform a logic step
         event_bytes = event_name.encode('utf-8') if event_name else None
         self.lib.step(self.handle, event_bytes)
 
         # 2. Process action logs in a loop until C++ core has no more immediate actions
+        self._process_action_log(full_python_log)
+
+        # Entries produced by native callbacks during this step
+        if self._callback_log:
+            full_python_log = self.take_callback_log() + full_python_log
+
+        # 4. Final state synchronization after all actions are processed
+        self._write_back_variables(variables_before)
+        self._sync_state_from_c()
+        return self.current_state_name, full_python_log
+
+    def _process_action_log(self, full_python_log: List[str]):
+        """Runs the actions and answers the guards the C++ core has logged, until it has none left."""
         while True:
             log_json_str = self._call_c_func_with_string_return(self.lib.get_and_clear_log_json, self.handle)
             if not log_json_str or log_json_str == "[]":
@@ -127,32 +659,453 @@ class CFsmSimulator:
             action_log_c = json.loads(log_json_str)
 
             # 3. Process the action log in Python
-            for entry_str in action_log_c:
-                entry = json.loads(entry_str)
+            for entry in action_log_c:
                 action_type = entry['type']
-                code = entry['data']
+                code_id = entry.get('id', -1)
+                code = self._code_table[code_id] if code_id >= 0 else entry.get('data', '')
 
-                if action_type == "AWAIT_CONDITION":
-                    try:
-                        result = bool(eval(code, {"sm": self}, self._variables))
-                        full_python_log.append(f"[PY] Condition '{code}' -> {result}")
-                        # Tell C++ core the result so it can proceed or stop
-                        self.lib.resolve_condition(self.handle, result)
-                    except Exception as e:
-                        full_python_log.append(f"[PY ERROR] in condition '{code}': {e}")
-                        # Tell C++ core the condition failed due to an error
-                        self.lib.resolve_condition(self.handle, False)
+                if action_type == "AWAIT_CONDITIONS":
+                    # Answer the candidate guards in one call; the first true one wins,
+                    # so evaluation stops there and only the guards evaluated are reported.
+                    condition_ids = entry['ids']
+                    results = (ctypes.c_uint8 * len(condition_ids))()
+                    answered = len(condition_ids)
+                    for i, condition_id in enumerate(condition_ids):
+                        condition = self._code_table[condition_id]
+                        try:
+                            result = bool(eval(self._compiled(condition_id, "eval"), {"sm": self}, self._variables))
+                            full_python_log.append(f"[PY] Condition '{condition}' -> {result}")
+                        except Exception as e:
+                            full_python_log.append(f"[PY ERROR] in condition '{condition}': {e}")
+                            result = False  # A failing guard counts as false
+                        if result:
+                            results[i] = 1
+                            answered = i + 1
+                            break
+                    self.lib.fsm_resolve_conditions(self.handle, results, answered)
                 
                 elif action_type in ["ENTRY_STATE", "EXIT_STATE", "TRANSITION_ACTION", "DURING_ACTION"]:
                     full_python_log.append(f"[PY] Executing: {code}")
                     try:
-                        exec(code, {"sm": self, "current_tick": self.current_tick}, self._variables)
+                        exec(self._compiled(code_id, "exec"), {"sm": self, "current_tick": self.current_tick}, self._variables)
                     except Exception as e:
                         full_python_log.append(f"[PY ERROR] in action '{code}': {e}")
 
                 elif action_type == "INFO":
                      full_python_log.append(f"[C CORE] {code}")
 
-        # 4. Final state synchronization after all actions are processed
+    # --- Real-time engine thread ---
+
+    def start_realtime(self, tick_rate_hz: float) -> bool:
+        """Hands the engine to its own fixed-rate thread. Guards evaluate as false in this mode."""
+        if not self.lib.fsm_start_realtime(self.handle, tick_rate_hz):
+            return False
+        self._realtime = True
+        return True
+
+    def stop_realtime(self):
+        """Stops the engine thread and re-syncs the Python-side state."""
+        self.lib.fsm_stop_realtime(self.handle)
+        self._realtime = False
         self._sync_state_from_c()
-        return self.current_state_name, full_python_log
\ No newline at end of file
+
+    def is_realtime_running(self) -> bool:
+        return self.lib.fsm_is_realtime_running(self.handle)
+
+    def post_event(self, event_name: str) -> bool:
+        """Queues an event for the engine thread. Safe to call from any thread."""
+        return self.lib.fsm_post_event(self.handle, event_name.encode('utf-8'))
+
+    def get_realtime_status(self) -> Dict[str, any]:
+        """Returns the state published by the engine thread, without blocking it."""
+        status = FsmRealtimeStatus()
+        self.lib.fsm_get_realtime_status(self.handle, ctypes.byref(status))
+        state_name = "Halted"
+        if status.active_state_id >= 0:
+            state_name = self._call_c_func_with_string_return(self.lib.fsm_get_state_name, self.handle, status.active_state_id)
+        return {
+            "running": status.running,
+            "tick": status.tick,
+            "state": state_name,
+            "loop_ticks": status.loop_ticks,
+            "overruns": status.overruns,
+            "dropped_events": status.dropped_events,
+            "max_lateness_ns": status.max_lateness_ns,
+        }
+
+    # --- Published state snapshot ---
+
+    def _cached_name(self, kind: str, func, index: int) -> str:
+        key = (kind, index)
+        name = self._name_cache.get(key)
+        if name is None:
+            name = self._call_c_func_with_string_return(func, self.handle, index)
+            self._name_cache[key] = name
+        return name
+
+    def read_snapshot(self, last_version: int = 0) -> Optional[Dict[str, any]]:
+        """
+        Copies the engine's published state without blocking the stepping thread.
+        Returns None when nothing changed since `last_version`, so pollers can skip work.
+        """
+        header = FsmStateSnapshot()
+        changed = self.lib.fsm_read_snapshot(self.handle, last_version, ctypes.byref(header),
+                                             self._snapshot_vars, len(self._snapshot_vars))
+        if not changed:
+            return None
+        if header.var_count > len(self._snapshot_vars):
+            # Grow the buffer once, then re-read so the copy is complete.
+            self._snapshot_vars = (FsmVarValue * header.var_count)()
+            self.lib.fsm_read_snapshot(self.handle, 0, ctypes.byref(header),
+                                       self._snapshot_vars, len(self._snapshot_vars))
+
+        count = min(header.var_count, len(self._snapshot_vars))
+        variables = {
+            self._cached_name("var", self.lib.fsm_get_variable_name, v.slot): v.to_python()
+            for v in self._snapshot_vars[:count]
+            if v.type != FSM_VAR_OTHER
+        }
+        state = "Halted"
+        if header.active_state_id >= 0:
+            state = self._cached_name("state", self.lib.fsm_get_state_name, header.active_state_id)
+        return {"version": header.version, "tick": header.tick, "state": state, "variables": variables}
+
+    # --- Native callbacks ---
+
+    def enable_native_callbacks(self):
+        """
+        Registers ctypes callbacks so guards and actions run synchronously inside
+        `step`, letting a whole step complete in a single FFI call.
+        """
+        self._guard_cb = FSM_GUARD_FN(self._on_guard)
+        self._action_cb = FSM_ACTION_FN(self._on_action)
+        self.lib.fsm_set_callbacks(self.handle, self._guard_cb, self._action_cb, None)
+
+    def disable_native_callbacks(self):
+        """Returns to the log-and-poll protocol."""
+        self.lib.fsm_set_callbacks(self.handle, FSM_GUARD_FN(), FSM_ACTION_FN(), None)
+        self._guard_cb = None
+        self._action_cb = None
+
+    def take_callback_log(self) -> List[str]:
+        """Returns and clears the native callback log (the newest CALLBACK_LOG_LIMIT entries)."""
+        entries = list(self._callback_log)
+        self._callback_log.clear()
+        return entries
+
+    def _on_guard(self, _user_data, condition_id: int) -> bool:
+        code = self._code_table[condition_id]
+        try:
+            result = bool(eval(self._compiled(condition_id, "eval"), {"sm": self}, self._variables))
+            self._callback_log.append(f"[PY] Condition '{code}' -> {result}")
+            return result
+        except Exception as e:
+            self._callback_log.append(f"[PY ERROR] in condition '{code}': {e}")
+            return False
+
+    def _on_action(self, _user_data, _action_kind: int, action_id: int):
+        code = self._code_table[action_id]
+        self._callback_log.append(f"[PY] Executing: {code}")
+        variables_before = self._serialize_variables() if self._realtime else None
+        try:
+            exec(self._compiled(action_id, "exec"), {"sm": self, "current_tick": self.lib.get_current_tick(self.handle)}, self._variables)
+        except Exception as e:
+            self._callback_log.append(f"[PY ERROR] in action '{code}': {e}")
+        if variables_before is not None:
+            self._write_back_variables(variables_before)
+
+    # --- Coverage counters ---
+
+    def enable_coverage(self, enable: bool = True):
+        """Turns the native visit/fire/guard counters and residency histograms on or off (on by default)."""
+        self.lib.fsm_coverage_enable(self.handle, enable)
+
+    def clear_coverage(self):
+        self.lib.fsm_coverage_clear(self.handle)
+
+    def get_coverage(self) -> Dict[str, List]:
+        """Coverage arrays indexed by state ID (state_visits, residency) or transition ID (the rest).
+
+        residency holds one list of FSM_RESIDENCY_BUCKETS counts per state: bucket 0 is zero ticks,
+        bucket b is [2^(b-1), 2^b) ticks.
+        """
+        coverage = {}
+        for name, kind in FSM_COVERAGE_KINDS.items():
+            size = self.lib.fsm_coverage_read(self.handle, kind, None, 0)
+            values = (ctypes.c_uint64 * size)()
+            size = min(size, self.lib.fsm_coverage_read(self.handle, kind, values, size))
+            coverage[name] = list(values[:size])
+        residency = coverage["residency"]
+        coverage["residency"] = [residency[i:i + FSM_RESIDENCY_BUCKETS]
+                                 for i in range(0, len(residency), FSM_RESIDENCY_BUCKETS)]
+        return coverage
+
+    # --- Latency histograms ---
+
+    def enable_latency(self, enable: bool = True):
+        """Turns wall-clock timing of steps and native guard/action callbacks on or off (off by default)."""
+        self.lib.fsm_latency_enable(self.handle, enable)
+
+    def reset_latency(self):
+        self.lib.fsm_latency_reset(self.handle)
+
+    def get_latency_stats(self) -> Dict[str, Dict[str, float]]:
+        """Count, min, p50/p90/p99/p99.9, max and mean in nanoseconds for step, guard and action.
+
+        Safe to poll from another thread, also while the real-time loop runs.
+        """
+        latency = {}
+        for name, kind in FSM_LATENCY_KINDS.items():
+            stats = FsmLatencyStats()
+            self.lib.fsm_latency_stats(self.handle, kind, ctypes.byref(stats))
+            latency[name] = {field: getattr(stats, field) for field, _ in FsmLatencyStats._fields_}
+        return latency
+
+    # --- Span recording ---
+
+    def start_spans(self, capacity: int = 65536):
+        """Records the last `capacity` engine spans (steps, transitions, guard/action callbacks); 0 stops."""
+        self.lib.fsm_spans_enable(self.handle, capacity)
+
+    def stop_spans(self):
+        self.lib.fsm_spans_enable(self.handle, 0)
+
+    def clear_spans(self):
+        self.lib.fsm_spans_clear(self.handle)
+
+    def dump_spans(self, path: str) -> bool:
+        """Writes the recorded spans as Chrome trace-event JSON (open in chrome://tracing or Perfetto)."""
+        return self.lib.fsm_spans_dump(self.handle, os.fsencode(path))
+
+    # --- Flight recorder ---
+
+    def configure_flight_recorder(self, steps: int = 256, dump_path: Optional[str] = None):
+        """Keeps the last `steps` step records (0 turns it off); with dump_path, load errors and
+        trigger_flight_dump() write them there. Ignored while the real-time loop runs."""
+        self.lib.fsm_flight_recorder_set_capacity(self.handle, steps)
+        self.lib.fsm_flight_recorder_set_dump_path(self.handle, os.fsencode(dump_path) if dump_path else None)
+
+    def get_flight_record(self) -> Dict[str, any]:
+        """The recorded steps, oldest first. Safe from any thread while the real-time loop runs;
+        otherwise call it from the thread that steps the simulator."""
+        return json.loads(self._call_c_func_with_string_return(self.lib.fsm_flight_recorder_json, self.handle))
+
+    def dump_flight_recorder(self, path: str, reason: str = "request") -> bool:
+        return self.lib.fsm_flight_recorder_dump(self.handle, os.fsencode(path), _utf8(reason))
+
+    def trigger_flight_dump(self, reason: str) -> bool:
+        """Reports a breakpoint hit or invariant violation; writes the flight record to the dump path, if set."""
+        return self.lib.fsm_flight_recorder_trigger(self.handle, _utf8(reason))
+
+    # --- Memory accounting ---
+
+    def get_memory_stats(self) -> Dict[str, int]:
+        """Bytes held by the model, instance state, queues, log, history and trace, plus step-time allocation counts."""
+        stats = FsmMemoryStats()
+        self.lib.fsm_memory_stats(self.handle, ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in FsmMemoryStats._fields_}
+
+    # --- Binary trace recording ---
+
+    def start_trace(self, path: str) -> bool:
+        """Starts streaming every completed step to a binary trace file."""
+        return self.lib.fsm_trace_open(self.handle, os.fsencode(path))
+
+    def stop_trace(self) -> bool:
+        """Flushes and closes the trace file (blocks until it is on disk). False if a write failed."""
+        return self.lib.fsm_trace_close(self.handle)
+
+    def get_trace_stats(self) -> Dict[str, int]:
+        stats = FsmTraceStats()
+        self.lib.fsm_get_trace_stats(self.handle, ctypes.byref(stats))
+        return {name: getattr(stats, name) for name, _ in FsmTraceStats._fields_}
+
+    # --- Variable history ---
+
+    def enable_history(self, enable: bool = True):
+        """Starts (clearing any previous data) or stops the native per-step variable history."""
+        self.lib.fsm_history_enable(self.handle, enable)
+
+    def get_history_info(self) -> Dict[str, int]:
+        info = FsmHistoryInfo()
+        self.lib.fsm_get_history_info(self.handle, ctypes.byref(info))
+        return {name: getattr(info, name) for name, _ in FsmHistoryInfo._fields_}
+
+    def get_history_buckets(self, var_name: str, tick_from: int, tick_to: int, bucket_count: int) -> List[Dict[str, float]]:
+        """
+        Min/max/last of a numeric variable over [tick_from, tick_to], aggregated
+        into at most `bucket_count` equal-width buckets (empty ones are omitted).
+        Pass the plot width in pixels to fetch only what can be drawn.
+        """
+        buckets = (FsmHistoryBucket * bucket_count)()
+        count = self.lib.fsm_history_query(self.handle, var_name.encode('utf-8'), tick_from, tick_to, buckets, bucket_count)
+        return [{name: getattr(b, name) for name, _ in FsmHistoryBucket._fields_} for b in buckets[:count]]
+
+    def downsample_history(self, var_name: str, tick_from: int, tick_to: int, max_points: int, mode: str = "minmax"):
+        """
+        Recorded samples of a numeric variable reduced natively to at most
+        `max_points` ("minmax" or "lttb"). Returns (ticks, values), as numpy
+        arrays when numpy is available - ready for pyqtgraph's setData().
+        """
+        out_x, x_ptr = _new_double_buffer(max_points)
+        out_y, y_ptr = _new_double_buffer(max_points)
+        count = self.lib.fsm_history_downsample(self.handle, var_name.encode('utf-8'), tick_from, tick_to,
+                                                _DOWNSAMPLE_MODES[mode], max_points, x_ptr, y_ptr)
+        return _trimmed(out_x, count), _trimmed(out_y, count)
+
+
+class CFsmTraceReader:
+    """Random-access reader for binary trace files recorded by the C++ core (memory-mapped)."""
+
+    def __init__(self, library_path: str, trace_path: str):
+        if not os.path.exists(library_path):
+            raise FileNotFoundError(f"C++ FSM library not found at: {library_path}. Please compile the core_engine.")
+        self.lib = ctypes.CDLL(library_path)
+        self.lib.fsm_trace_reader_open.argtypes = [ctypes.c_char_p]
+        self.lib.fsm_trace_reader_open.restype = ctypes.c_void_p
+        self.lib.fsm_trace_reader_close.argtypes = [ctypes.c_void_p]
+        self.lib.fsm_trace_reader_info.argtypes = [ctypes.c_void_p, ctypes.POINTER(FsmTraceInfo)]
+        self.lib.fsm_trace_query_variable.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_uint64, ctypes.c_uint64,
+                                                      ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_double), ctypes.c_size_t]
+        self.lib.fsm_trace_query_variable.restype = ctypes.c_size_t
+        self.lib.fsm_trace_query_state_entries.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_uint64, ctypes.c_uint64,
+                                                           ctypes.POINTER(ctypes.c_uint64), ctypes.c_size_t]
+        self.lib.fsm_trace_query_state_entries.restype = ctypes.c_size_t
+
+        self.handle = self.lib.fsm_trace_reader_open(os.fsencode(trace_path))
+        if not self.handle:
+            raise CSimError(f"Failed to open trace file: {trace_path}")
+
+    def close(self):
+        if getattr(self, 'handle', None):
+            self.lib.fsm_trace_reader_close(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+    def info(self) -> Dict[str, any]:
+        info = FsmTraceInfo()
+        self.lib.fsm_trace_reader_info(self.handle, ctypes.byref(info))
+        return {name: getattr(info, name) for name, _ in FsmTraceInfo._fields_}
+
+    def variable_range(self, var_name: str, tick_from: int, tick_to: int, run: int = -1) -> List[Tuple[int, float]]:
+        """Value at `tick_from` followed by every change up to `tick_to`, as (tick, value) pairs."""
+        name = var_name.encode('utf-8')
+        count = self.lib.fsm_trace_query_variable(self.handle, run, name, tick_from, tick_to, None, None, 0)
+        ticks = (ctypes.c_uint64 * count)()
+        values = (ctypes.c_double * count)()
+        count = self.lib.fsm_trace_query_variable(self.handle, run, name, tick_from, tick_to, ticks, values, count)
+        return list(zip(ticks[:count], values[:count]))
+
+    def state_entries(self, state_name: str, tick_from: int, tick_to: int, run: int = -1) -> List[int]:
+        """Ticks at which `state_name` was entered within the range."""
+        name = state_name.encode('utf-8')
+        count = self.lib.fsm_trace_query_state_entries(self.handle, run, name, tick_from, tick_to, None, 0)
+        ticks = (ctypes.c_uint64 * count)()
+        count = self.lib.fsm_trace_query_state_entries(self.handle, run, name, tick_from, tick_to, ticks, count)
+        return list(ticks[:count])
+
+
+class CFsmModel:
+    """
+    Immutable compiled model (.fsmb). Compile a diagram once and save it;
+    opening the file later maps it in place instead of parsing JSON.
+    """
+
+    def __init__(self, library_path: str, handle):
+        self.lib = self._load(library_path)
+        self.handle = handle
+
+    @staticmethod
+    def _load(library_path: str):
+        if not os.path.exists(library_path):
+            raise FileNotFoundError(f"C++ FSM library not found at: {library_path}. Please compile the core_engine.")
+        lib = ctypes.CDLL(library_path)
+        lib.fsm_model_compile_json.argtypes = [ctypes.c_char_p]
+        lib.fsm_model_compile_json.restype = ctypes.c_void_p
+        lib.fsm_model_compile_file.argtypes = [ctypes.c_char_p]
+        lib.fsm_model_compile_file.restype = ctypes.c_void_p
+        lib.fsm_get_load_error.argtypes = [ctypes.POINTER(ctypes.c_int64)]
+        lib.fsm_get_load_error.restype = ctypes.c_void_p
+        lib.free_string_memory.argtypes = [ctypes.c_void_p]
+        lib.fsm_model_open.argtypes = [ctypes.c_char_p]
+        lib.fsm_model_open.restype = ctypes.c_void_p
+        lib.fsm_model_save.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+        lib.fsm_model_save.restype = ctypes.c_bool
+        lib.fsm_model_release.argtypes = [ctypes.c_void_p]
+        lib.fsm_model_info.argtypes = [ctypes.c_void_p, ctypes.POINTER(FsmModelInfo)]
+        return lib
+
+    @classmethod
+    def compile(cls, library_path: str, diagram_data: Dict) -> "CFsmModel":
+        lib = cls._load(library_path)
+        handle = lib.fsm_model_compile_json(json.dumps(diagram_data).encode('utf-8'))
+        if not handle:
+            raise CSimError(f"Failed to compile FSM data: {_load_error(lib)}")
+        return cls(library_path, handle)
+
+    @classmethod
+    def compile_file(cls, library_path: str, diagram_path: str) -> "CFsmModel":
+        """Compiles a .bsm file streamed from disk, without building it in Python first."""
+        lib = cls._load(library_path)
+        handle = lib.fsm_model_compile_file(os.fsencode(diagram_path))
+        if not handle:
+            raise CSimError(f"Failed to compile {diagram_path}: {_load_error(lib)}")
+        return cls(library_path, handle)
+
+    @classmethod
+    def open(cls, library_path: str, model_path: str) -> "CFsmModel":
+        lib = cls._load(library_path)
+        handle = lib.fsm_model_open(os.fsencode(model_path))
+        if not handle:
+            raise CSimError(f"Failed to open compiled model: {model_path}")
+        return cls(library_path, handle)
+
+    def save(self, model_path: str):
+        if not self.lib.fsm_model_save(self.handle, os.fsencode(model_path)):
+            raise CSimError(f"Failed to write compiled model: {model_path}")
+
+    def info(self) -> Dict[str, any]:
+        info = FsmModelInfo()
+        self.lib.fsm_model_info(self.handle, ctypes.byref(info))
+        return {name: getattr(info, name) for name, _ in FsmModelInfo._fields_}
+
+    def close(self):
+        if getattr(self, 'handle', None):
+            self.lib.fsm_model_release(self.handle)
+            self.handle = None
+
+    def __del__(self):
+        self.close()
+
+
+class CFsmDownsampler:
+    """Native min-max and LTTB downsampling of (x, y) series for plotting."""
+
+    def __init__(self, library_path: str):
+        if not os.path.exists(library_path):
+            raise FileNotFoundError(f"C++ FSM library not found at: {library_path}. Please compile the core_engine.")
+        self.lib = ctypes.CDLL(library_path)
+        for func in (self.lib.fsm_downsample_minmax, self.lib.fsm_downsample_lttb):
+            func.argtypes = [_c_double_p, _c_double_p, ctypes.c_size_t, ctypes.c_size_t, _c_double_p, _c_double_p]
+            func.restype = ctypes.c_size_t
+
+    def _run(self, func, x, y, target: int, capacity: int):
+        n = min(len(x), len(y))
+        x_owner, x_ptr = _as_double_buffer(x)
+        y_owner, y_ptr = _as_double_buffer(y)
+        out_x, out_x_ptr = _new_double_buffer(capacity)
+        out_y, out_y_ptr = _new_double_buffer(capacity)
+        count = func(x_ptr, y_ptr, n, target, out_x_ptr, out_y_ptr)
+        return _trimmed(out_x, count), _trimmed(out_y, count)
+
+    def min_max(self, x, y, buckets: int):
+        """Min and max of each bucket, in x order (at most 2 * buckets points)."""
+        n = min(len(x), len(y))
+        return self._run(self.lib.fsm_downsample_minmax, x, y, buckets, n if buckets == 0 or n <= 2 * buckets else 2 * buckets)
+
+    def lttb(self, x, y, threshold: int):
+        """Largest-Triangle-Three-Buckets reduction to `threshold` points."""
+        n = min(len(x), len(y))
+        return self._run(self.lib.fsm_downsample_lttb, x, y, threshold, n if threshold == 0 or n <= threshold else threshold)
@@ -0,0 +1,344 @@
+
+// Micro-benchmark of the FSM core engine through its public C API.
+//
+// Generates a synthetic model, then measures compile/save/open/attach time,
+// single-instance step and guard throughput, memory per instance, and the
+// aggregate throughput of a batch of instances sharing one compiled model
+// (one thread per hardware core). Results are printed as one JSON document
+// so runs can be archived and compared across engine versions.
+//
+//   fsm_core_bench [--states N] [--transitions M] [--events E]
+//                  [--guard-density D] [--action-size BYTES] [--steps S]
+//                  [--batch B] [--repeat R] [--seed X] [--bare] [--out FILE]
+//
+// Timed figures are the median of --repeat runs.
+
+#include "fsm_core.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Config
+    {
+        uint32_t states = 1000;
+        uint32_t transitions = 4000;
+        uint32_t events = 16;
+        double guard_density = 0.25; // Fraction of transitions with a condition
+        uint32_t action_size = 32;   // Bytes of source per entry/transition action
+        uint64_t steps = 200000;
+        uint32_t batch = 8;
+        uint32_t repeat = 5;
+        uint32_t seed = 1;
+        bool bare = false; // Coverage counters and flight recorder off
+        std::string out;
+    };
+
+    // Counted by the native callbacks; guards alternate true/false.
+    struct CallbackCounters
+    {
+        uint64_t guards = 0;
+        uint64_t actions = 0;
+    };
+
+    bool countGuard(void *user_data, int32_t)
+    {
+        auto *counters = static_cast<CallbackCounters *>(user_data);
+        return (++counters->guards & 1) != 0;
+    }
+
+    void countAction(void *user_data, int32_t, int32_t)
+    {
+        ++static_cast<CallbackCounters *>(user_data)->actions;
+    }
+
+    double secondsSince(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        size_t n = values.size();
+        return n == 0 ? 0.0 : n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    }
+
+    std::string padded(std::string text, uint32_t size)
+    {
+        if (text.size() < size)
+            text.append(size - text.size(), ' ');
+        return text;
+    }
+
+    // A ring S0 -> S1 -> ... keeps every state reachable and every state with
+    // an exit; the remaining transitions connect random pairs.
+    json generateModel(const Config &config)
+    {
+        std::mt19937 rng(config.seed);
+        std::uniform_int_distribution<uint32_t> any_state(0, config.states - 1);
+        std::uniform_int_distribution<uint32_t> any_event(0, config.events - 1);
+        std::bernoulli_distribution guarded(config.guard_density);
+
+        json states = json::array();
+        for (uint32_t i = 0; i < config.states; ++i)
+        {
+            states.push_back({{"name", "S" + std::to_string(i)},
+                              {"entry_action", padded("entered_" + std::to_string(i) + " = 1", config.action_size)},
+                              {"is_initial", i == 0}});
+        }
+        json transitions = json::array();
+        for (uint32_t i = 0; i < config.transitions; ++i)
+        {
+            uint32_t source = i < config.states ? i : any_state(rng);
+            uint32_t target = i < config.states ? (i + 1) % config.states : any_state(rng);
+            json t = {{"source", "S" + std::to_string(source)},
+                      {"target", "S" + std::to_string(target)},
+                      {"event", "e" + std::to_string(i < config.states ? 0 : any_event(rng))},
+                      {"action", padded("fired_" + std::to_string(i) + " += 1", config.action_size)}};
+            if (guarded(rng))
+                t["condition"] = "guard_" + std::to_string(i) + "()";
+            transitions.push_back(std::move(t));
+        }
+        return {{"states", std::move(states)}, {"transitions", std::move(transitions)}};
+    }
+
+    std::vector<std::string> generateEvents(const Config &config)
+    {
+        std::mt19937 rng(config.seed + 1);
+        std::uniform_int_distribution<uint32_t> any_event(0, config.events - 1);
+        std::vector<std::string> script(4096);
+        for (std::string &event : script)
+            event = "e" + std::to_string(any_event(rng));
+        return script;
+    }
+
+    FSM_HANDLE newInstance(FSM_MODEL model, const Config &config, CallbackCounters *counters)
+    {
+        FSM_HANDLE handle = create_fsm();
+        fsm_load_model(handle, model);
+        fsm_set_callbacks(handle, countGuard, countAction, counters);
+        if (config.bare)
+        {
+            fsm_coverage_enable(handle, false);
+            fsm_flight_recorder_set_capacity(handle, 0);
+        }
+        reset_fsm(handle);
+        return handle;
+    }
+
+    void runSteps(FSM_HANDLE handle, const std::vector<std::string> &script, uint64_t steps)
+    {
+        for (uint64_t i = 0; i < steps; ++i)
+            step(handle, script[i % script.size()].c_str());
+    }
+
+    bool parseArgs(int argc, char **argv, Config *config)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&]() -> const char *
+            { return i + 1 < argc ? argv[++i] : nullptr; };
+            const char *v = nullptr;
+            if (arg == "--bare")
+                config->bare = true;
+            else if (arg == "--states" && (v = value()))
+                config->states = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--transitions" && (v = value()))
+                config->transitions = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--events" && (v = value()))
+                config->events = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--guard-density" && (v = value()))
+                config->guard_density = std::strtod(v, nullptr);
+            else if (arg == "--action-size" && (v = value()))
+                config->action_size = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--steps" && (v = value()))
+                config->steps = std::strtoull(v, nullptr, 10);
+            else if (arg == "--batch" && (v = value()))
+                config->batch = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--repeat" && (v = value()))
+                config->repeat = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--seed" && (v = value()))
+                config->seed = static_cast<uint32_t>(std::strtoul(v, nullptr, 10));
+            else if (arg == "--out" && (v = value()))
+                config->out = v;
+            else
+                return false;
+        }
+        config->guard_density = std::min(1.0, std::max(0.0, config->guard_density));
+        return config->states > 0 && config->events > 0 && config->steps > 0 && config->batch > 0 &&
+               config->repeat > 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Config config;
+    if (!parseArgs(argc, argv, &config))
+    {
+        std::cerr << "usage: fsm_core_bench [--states N] [--transitions M] [--events E] [--guard-density D]\n"
+                     "                      [--action-size BYTES] [--steps S] [--batch B] [--repeat R]\n"
+                     "                      [--seed X] [--bare] [--out FILE]\n";
+        return 2;
+    }
+    config.transitions = std::max(config.transitions, config.states);
+
+    std::string source = generateModel(config).dump();
+    std::vector<std::string> script = generateEvents(config);
+    std::string image_path = (std::filesystem::temp_directory_path() /
+                              ("fsm_core_bench_" + std::to_string(config.seed) + ".fsmb"))
+                                 .string();
+    fsm_model_cache_configure(0, nullptr); // Every compile is a real one
+
+    // --- Load ---
+    std::vector<double> compile_s, save_s, open_s, attach_s;
+    FSM_MODEL model = nullptr;
+    for (uint32_t r = 0; r < config.repeat; ++r)
+    {
+        if (model)
+            fsm_model_release(model);
+        Clock::time_point start = Clock::now();
+        model = fsm_model_compile_json(source.c_str());
+        compile_s.push_back(secondsSince(start));
+        if (!model)
+        {
+            std::cerr << "fsm_core_bench: generated model failed to compile\n";
+            return 1;
+        }
+
+        start = Clock::now();
+        bool saved = fsm_model_save(model, image_path.c_str());
+        save_s.push_back(secondsSince(start));
+        if (saved)
+        {
+            start = Clock::now();
+            FSM_MODEL mapped = fsm_model_open(image_path.c_str());
+            open_s.push_back(secondsSince(start));
+            if (mapped)
+                fsm_model_release(mapped);
+        }
+
+        FSM_HANDLE handle = create_fsm();
+        start = Clock::now();
+        fsm_load_model(handle, model);
+        reset_fsm(handle);
+        attach_s.push_back(secondsSince(start));
+        destroy_fsm(handle);
+    }
+    std::remove(image_path.c_str());
+    FsmModelInfo info;
+    fsm_model_info(model, &info);
+
+    // --- Single instance ---
+    std::vector<double> steps_per_s, guards_per_s, actions_per_s;
+    FsmMemoryStats memory{};
+    for (uint32_t r = 0; r < config.repeat; ++r)
+    {
+        CallbackCounters counters;
+        FSM_HANDLE handle = newInstance(model, config, &counters);
+        counters = CallbackCounters{};
+        Clock::time_point start = Clock::now();
+        runSteps(handle, script, config.steps);
+        double seconds = secondsSince(start);
+        steps_per_s.push_back(config.steps / seconds);
+        guards_per_s.push_back(counters.guards / seconds);
+        actions_per_s.push_back(counters.actions / seconds);
+        fsm_memory_stats(handle, &memory);
+        destroy_fsm(handle);
+    }
+
+    // --- Batch: instances sharing the model, one thread per core ---
+    uint32_t threads = std::max(1u, std::min(config.batch, std::thread::hardware_concurrency()));
+    std::vector<double> batch_steps_per_s;
+    for (uint32_t r = 0; r < config.repeat; ++r)
+    {
+        std::vector<CallbackCounters> counters(config.batch);
+        std::vector<FSM_HANDLE> handles;
+        for (uint32_t i = 0; i < config.batch; ++i)
+            handles.push_back(newInstance(model, config, &counters[i]));
+
+        std::atomic<bool> go{false};
+        std::vector<std::thread> workers;
+        for (uint32_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+                                 {
+                                     while (!go.load(std::memory_order_acquire))
+                                         std::this_thread::yield();
+                                     for (uint32_t i = t; i < config.batch; i += threads)
+                                         runSteps(handles[i], script, config.steps);
+                                 });
+        }
+        Clock::time_point start = Clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread &worker : workers)
+            worker.join();
+        batch_steps_per_s.push_back(static_cast<double>(config.steps) * config.batch / secondsSince(start));
+        for (FSM_HANDLE handle : handles)
+            destroy_fsm(handle);
+    }
+    fsm_model_release(model);
+
+    uint64_t per_instance = memory.total_bytes - memory.model_bytes;
+    json report = {
+        {"benchmark", "fsm_core_bench"},
+        {"format_version", 1},
+        {"config",
+         {{"states", config.states},
+          {"transitions", config.transitions},
+          {"events", config.events},
+          {"guard_density", config.guard_density},
+          {"action_size", config.action_size},
+          {"steps", config.steps},
+          {"batch", config.batch},
+          {"threads", threads},
+          {"repeat", config.repeat},
+          {"seed", config.seed},
+          {"bare", config.bare}}},
+        {"model",
+         {{"state_count", info.state_count},
+          {"transition_count", info.transition_count},
+          {"event_count", info.event_count},
+          {"code_count", info.code_count},
+          {"image_bytes", info.image_bytes},
+          {"json_bytes", source.size()}}},
+        {"load",
+         {{"compile_ms", median(compile_s) * 1e3},
+          {"save_ms", median(save_s) * 1e3},
+          {"open_ms", median(open_s) * 1e3},
+          {"attach_ms", median(attach_s) * 1e3}}},
+        {"step",
+         {{"steps_per_sec", median(steps_per_s)},
+          {"ns_per_step", 1e9 / median(steps_per_s)},
+          {"guard_evals_per_sec", median(guards_per_s)},
+          {"actions_per_sec", median(actions_per_s)}}},
+        {"memory",
+         {{"model_bytes", memory.model_bytes},
+          {"instance_bytes", per_instance},
+          {"step_allocations", memory.allocations}}},
+        {"batch", {{"instances", config.batch}, {"threads", threads}, {"steps_per_sec", median(batch_steps_per_s)}}}};
+
+    std::string text = report.dump(2);
+    if (config.out.empty())
+    {
+        std::cout << text << "\n";
+        return 0;
+    }
+    std::ofstream out(config.out);
+    out << text << "\n";
+    return out ? 0 : 1;
+}
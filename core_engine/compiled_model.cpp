@@ -0,0 +1,451 @@
+
+#include "compiled_model.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    bool hostIsLittleEndian()
+    {
+        const uint16_t probe = 1;
+        uint8_t first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    template <typename T>
+    void appendSection(std::vector<uint8_t> &image, uint32_t *offset, const std::vector<T> &items)
+    {
+        *offset = static_cast<uint32_t>(image.size());
+        const uint8_t *bytes = reinterpret_cast<const uint8_t *>(items.data());
+        image.insert(image.end(), bytes, bytes + items.size() * sizeof(T));
+    }
+}
+
+constexpr char CompiledModel::kMagic[8];
+
+// --- Builder ---
+
+namespace
+{
+    // First arena block; later ones grow geometrically.
+    constexpr size_t kArenaInitialBytes = 64 * 1024;
+}
+
+CompiledModel::Builder::Builder()
+    : arena_(kArenaInitialBytes), string_ids_(&arena_), event_ids_(&arena_), code_ids_(&arena_)
+{
+}
+
+std::string_view CompiledModel::Builder::store(std::string_view s)
+{
+    if (s.empty())
+        return std::string_view();
+    char *copy = static_cast<char *>(arena_.allocate(s.size(), 1));
+    std::memcpy(copy, s.data(), s.size());
+    return std::string_view(copy, s.size());
+}
+
+uint32_t CompiledModel::Builder::internString(std::string_view s)
+{
+    auto it = string_ids_.find(s);
+    if (it != string_ids_.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(strings_.size());
+    std::string_view stored = store(s);
+    strings_.push_back(stored);
+    string_bytes_ += s.size() + 1;
+    string_ids_.emplace(stored, id);
+    return id;
+}
+
+uint32_t CompiledModel::Builder::internEvent(std::string_view name)
+{
+    auto it = event_ids_.find(name);
+    if (it != event_ids_.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(events_.size());
+    uint32_t string_id = internString(name);
+    events_.push_back(string_id);
+    event_ids_.emplace(strings_[string_id], id);
+    return id;
+}
+
+// Deduplicates action/condition source so identical snippets share an ID.
+uint32_t CompiledModel::Builder::internCode(std::string_view code)
+{
+    if (code.empty())
+        return kNone;
+    auto it = code_ids_.find(code);
+    if (it != code_ids_.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(code_.size());
+    uint32_t string_id = internString(code);
+    code_.push_back(string_id);
+    code_ids_.emplace(strings_[string_id], id);
+    return id;
+}
+
+void CompiledModel::Builder::addState(std::string_view name, std::string_view entry, std::string_view during,
+                                      std::string_view exit, bool is_initial, bool is_final)
+{
+    StateRecord record;
+    record.name = internString(name);
+    record.entry_code = internCode(entry);
+    record.during_code = internCode(during);
+    record.exit_code = internCode(exit);
+    record.flags = 0;
+    if (is_initial)
+        record.flags |= STATE_INITIAL;
+    if (is_final)
+        record.flags |= STATE_FINAL;
+    states_.push_back(record);
+}
+
+// Source and target are usually state names already interned, so they are
+// looked up rather than copied again.
+void CompiledModel::Builder::addTransition(std::string_view source, std::string_view target, std::string_view event,
+                                           std::string_view condition, std::string_view action)
+{
+    auto keep = [&](std::string_view s)
+    {
+        auto it = string_ids_.find(s);
+        return it != string_ids_.end() ? it->first : store(s);
+    };
+    transitions_.push_back(PendingTransition{keep(source), keep(target), keep(event), keep(condition), keep(action)});
+}
+
+std::shared_ptr<const CompiledModel> CompiledModel::Builder::build()
+{
+    // Names resolve to the last state declared with them.
+    IdMap state_ids(&arena_);
+    state_ids.reserve(states_.size());
+    for (size_t i = 0; i < states_.size(); ++i)
+        state_ids[strings_[states_[i].name]] = static_cast<uint32_t>(i);
+    auto resolve = [&](std::string_view name)
+    {
+        auto it = state_ids.find(name);
+        return it == state_ids.end() ? kNone : it->second;
+    };
+
+    Tables t;
+    uint32_t state_count = static_cast<uint32_t>(states_.size());
+    t.transitions.reserve(transitions_.size());
+    for (const PendingTransition &pending : transitions_)
+    {
+        uint32_t event = internEvent(pending.event);
+        uint32_t condition_code = internCode(pending.condition);
+        uint32_t action_code = internCode(pending.action);
+        t.transitions.push_back(TransitionRecord{resolve(pending.source), resolve(pending.target), event,
+                                                 condition_code, action_code});
+    }
+
+    // CSR adjacency: count, prefix-sum, then fill in declaration order.
+    t.edge_offsets.assign(state_count + 1, 0);
+    for (const TransitionRecord &transition : t.transitions)
+    {
+        if (transition.source != kNone)
+            ++t.edge_offsets[transition.source + 1];
+    }
+    for (uint32_t s = 0; s < state_count; ++s)
+        t.edge_offsets[s + 1] += t.edge_offsets[s];
+    t.edges.resize(t.edge_offsets[state_count]);
+    std::vector<uint32_t> fill(t.edge_offsets.begin(), t.edge_offsets.end() - 1);
+    for (uint32_t id = 0; id < t.transitions.size(); ++id)
+    {
+        if (t.transitions[id].source != kNone)
+            t.edges[fill[t.transitions[id].source]++] = id;
+    }
+
+    t.state_index.resize(state_count);
+    for (uint32_t i = 0; i < state_count; ++i)
+        t.state_index[i] = i;
+    std::stable_sort(t.state_index.begin(), t.state_index.end(), [&](uint32_t a, uint32_t b)
+                     { return strings_[states_[a].name] < strings_[states_[b].name]; });
+    t.event_index.resize(events_.size());
+    for (uint32_t i = 0; i < t.event_index.size(); ++i)
+        t.event_index[i] = i;
+    std::sort(t.event_index.begin(), t.event_index.end(), [&](uint32_t a, uint32_t b)
+              { return strings_[events_[a]] < strings_[events_[b]]; });
+
+    t.string_offsets.reserve(strings_.size() + 1);
+    t.string_pool.reserve(string_bytes_);
+    for (std::string_view s : strings_)
+    {
+        t.string_offsets.push_back(static_cast<uint32_t>(t.string_pool.size()));
+        t.string_pool.insert(t.string_pool.end(), s.begin(), s.end());
+        t.string_pool.push_back('\0');
+    }
+    t.string_offsets.push_back(static_cast<uint32_t>(t.string_pool.size()));
+
+    t.states = std::move(states_);
+    t.events = std::move(events_);
+    t.code = std::move(code_);
+    t.initial_state = t.firstInitialState();
+    return fromTables(t);
+}
+
+// --- Tables ---
+
+// First live state flagged initial, else the first live state.
+uint32_t CompiledModel::Tables::firstInitialState() const
+{
+    uint32_t first_live = kNone;
+    for (uint32_t i = 0; i < states.size(); ++i)
+    {
+        if (states[i].flags & STATE_REMOVED)
+            continue;
+        if (states[i].flags & STATE_INITIAL)
+            return i;
+        if (first_live == kNone)
+            first_live = i;
+    }
+    return first_live;
+}
+
+CompiledModel::Tables CompiledModel::tables() const
+{
+    const Header *h = header();
+    Tables t;
+    t.states.assign(states_, states_ + h->state_count);
+    t.transitions.assign(transitions_, transitions_ + h->transition_count);
+    t.edge_offsets.assign(edge_offsets_, edge_offsets_ + h->state_count + 1);
+    t.edges.assign(edges_, edges_ + h->edge_count);
+    t.events.assign(events_, events_ + h->event_count);
+    t.code.assign(code_, code_ + h->code_count);
+    t.state_index.assign(state_index_, state_index_ + h->state_count);
+    t.event_index.assign(event_index_, event_index_ + h->event_count);
+    t.string_offsets.assign(string_offsets_, string_offsets_ + h->string_count + 1);
+    t.string_pool.assign(string_pool_, string_pool_ + h->string_pool_size);
+    t.initial_state = h->initial_state;
+    return t;
+}
+
+std::shared_ptr<const CompiledModel> CompiledModel::fromTables(const Tables &t)
+{
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.header_size = sizeof(Header);
+    h.state_count = static_cast<uint32_t>(t.states.size());
+    h.transition_count = static_cast<uint32_t>(t.transitions.size());
+    h.edge_count = static_cast<uint32_t>(t.edges.size());
+    h.event_count = static_cast<uint32_t>(t.events.size());
+    h.code_count = static_cast<uint32_t>(t.code.size());
+    h.string_count = static_cast<uint32_t>(t.string_offsets.size() - 1);
+    h.initial_state = t.initial_state;
+
+    std::vector<uint8_t> image;
+    image.reserve(sizeof(Header) + t.states.size() * sizeof(StateRecord) +
+                  t.transitions.size() * sizeof(TransitionRecord) +
+                  (t.edge_offsets.size() + t.edges.size() + 2 * t.events.size() + t.code.size() +
+                   t.state_index.size() + t.string_offsets.size()) * sizeof(uint32_t) +
+                  t.string_pool.size());
+    image.resize(sizeof(Header));
+    appendSection(image, &h.states_offset, t.states);
+    appendSection(image, &h.transitions_offset, t.transitions);
+    appendSection(image, &h.edge_offsets_offset, t.edge_offsets);
+    appendSection(image, &h.edges_offset, t.edges);
+    appendSection(image, &h.events_offset, t.events);
+    appendSection(image, &h.code_offset, t.code);
+    appendSection(image, &h.state_index_offset, t.state_index);
+    appendSection(image, &h.event_index_offset, t.event_index);
+    appendSection(image, &h.string_offsets_offset, t.string_offsets);
+    appendSection(image, &h.string_pool_offset, t.string_pool);
+    h.string_pool_size = static_cast<uint32_t>(t.string_pool.size());
+    std::memcpy(image.data(), &h, sizeof(h));
+
+    return fromImage(std::move(image));
+}
+
+// --- Loading ---
+
+std::shared_ptr<const CompiledModel> CompiledModel::fromImage(std::vector<uint8_t> image)
+{
+    std::shared_ptr<CompiledModel> model(new CompiledModel());
+    model->owned_ = std::move(image);
+    if (!model->attach(model->owned_.data(), model->owned_.size()))
+        return nullptr;
+    return model;
+}
+
+std::shared_ptr<const CompiledModel> CompiledModel::openFile(const std::string &path)
+{
+    std::shared_ptr<CompiledModel> model(new CompiledModel());
+    model->mapped_.reset(new MappedFile());
+    if (!model->mapped_->open(path) || !model->attach(model->mapped_->data(), model->mapped_->size()))
+        return nullptr;
+    return model;
+}
+
+bool CompiledModel::save(const std::string &path) const
+{
+    std::FILE *file = nullptr;
+#ifdef _WIN32
+    if (fopen_s(&file, path.c_str(), "wb") != 0)
+        file = nullptr;
+#else
+    file = std::fopen(path.c_str(), "wb");
+#endif
+    if (!file)
+        return false;
+    bool ok = std::fwrite(data_, 1, size_, file) == size_;
+    return std::fclose(file) == 0 && ok;
+}
+
+// Checks that every section lies inside the buffer and every stored ID is in
+// range, so the accessors can index without further checks.
+bool CompiledModel::attach(const uint8_t *data, size_t size)
+{
+    if (!hostIsLittleEndian() || size < sizeof(Header) || reinterpret_cast<uintptr_t>(data) % alignof(uint32_t))
+        return false;
+    const Header *h = reinterpret_cast<const Header *>(data);
+    if (std::memcmp(h->magic, kMagic, sizeof(kMagic)) != 0 || h->version != kVersion ||
+        h->header_size != sizeof(Header))
+        return false;
+
+    auto section = [&](uint32_t offset, uint64_t count, size_t elem_size) -> const uint8_t *
+    {
+        if (offset % alignof(uint32_t) || offset < sizeof(Header) || offset + count * elem_size > size)
+            return nullptr;
+        return data + offset;
+    };
+    const uint8_t *states = section(h->states_offset, h->state_count, sizeof(StateRecord));
+    const uint8_t *transitions = section(h->transitions_offset, h->transition_count, sizeof(TransitionRecord));
+    const uint8_t *edge_offsets = section(h->edge_offsets_offset, uint64_t(h->state_count) + 1, sizeof(uint32_t));
+    const uint8_t *edges = section(h->edges_offset, h->edge_count, sizeof(uint32_t));
+    const uint8_t *events = section(h->events_offset, h->event_count, sizeof(uint32_t));
+    const uint8_t *code = section(h->code_offset, h->code_count, sizeof(uint32_t));
+    const uint8_t *state_index = section(h->state_index_offset, h->state_count, sizeof(uint32_t));
+    const uint8_t *event_index = section(h->event_index_offset, h->event_count, sizeof(uint32_t));
+    const uint8_t *string_offsets = section(h->string_offsets_offset, uint64_t(h->string_count) + 1, sizeof(uint32_t));
+    const uint8_t *pool = h->string_pool_offset >= sizeof(Header) &&
+                                  uint64_t(h->string_pool_offset) + h->string_pool_size <= size
+                              ? data + h->string_pool_offset
+                              : nullptr;
+    if (!states || !transitions || !edge_offsets || !edges || !events || !code || !state_index || !event_index ||
+        !string_offsets || !pool)
+        return false;
+
+    states_ = reinterpret_cast<const StateRecord *>(states);
+    transitions_ = reinterpret_cast<const TransitionRecord *>(transitions);
+    edge_offsets_ = reinterpret_cast<const uint32_t *>(edge_offsets);
+    edges_ = reinterpret_cast<const uint32_t *>(edges);
+    events_ = reinterpret_cast<const uint32_t *>(events);
+    code_ = reinterpret_cast<const uint32_t *>(code);
+    state_index_ = reinterpret_cast<const uint32_t *>(state_index);
+    event_index_ = reinterpret_cast<const uint32_t *>(event_index);
+    string_offsets_ = reinterpret_cast<const uint32_t *>(string_offsets);
+    string_pool_ = reinterpret_cast<const char *>(pool);
+
+    auto inRange = [](uint32_t id, uint32_t count, bool optional)
+    { return id < count || (optional && id == kNone); };
+
+    // Strings: increasing offsets, each string NUL-terminated inside the pool.
+    if (string_offsets_[0] != 0 || string_offsets_[h->string_count] != h->string_pool_size)
+        return false;
+    for (uint32_t i = 0; i < h->string_count; ++i)
+    {
+        if (string_offsets_[i + 1] <= string_offsets_[i] || string_offsets_[i + 1] > h->string_pool_size ||
+            string_pool_[string_offsets_[i + 1] - 1] != '\0')
+            return false;
+    }
+    for (uint32_t i = 0; i < h->state_count; ++i)
+    {
+        const StateRecord &s = states_[i];
+        if (!inRange(s.name, h->string_count, false) || !inRange(s.entry_code, h->code_count, true) ||
+            !inRange(s.during_code, h->code_count, true) || !inRange(s.exit_code, h->code_count, true) ||
+            !inRange(state_index_[i], h->state_count, false))
+            return false;
+    }
+    for (uint32_t i = 0; i < h->transition_count; ++i)
+    {
+        const TransitionRecord &t = transitions_[i];
+        if (!inRange(t.source, h->state_count, true) || !inRange(t.target, h->state_count, true) ||
+            !inRange(t.event, h->event_count, false) || !inRange(t.condition_code, h->code_count, true) ||
+            !inRange(t.action_code, h->code_count, true))
+            return false;
+    }
+    if (edge_offsets_[0] != 0 || edge_offsets_[h->state_count] != h->edge_count)
+        return false;
+    for (uint32_t i = 0; i < h->state_count; ++i)
+    {
+        if (edge_offsets_[i + 1] < edge_offsets_[i])
+            return false;
+    }
+    for (uint32_t i = 0; i < h->edge_count; ++i)
+    {
+        if (!inRange(edges_[i], h->transition_count, false))
+            return false;
+    }
+    for (uint32_t i = 0; i < h->event_count; ++i)
+    {
+        if (!inRange(events_[i], h->string_count, false) || !inRange(event_index_[i], h->event_count, false))
+            return false;
+    }
+    for (uint32_t i = 0; i < h->code_count; ++i)
+    {
+        if (!inRange(code_[i], h->string_count, false))
+            return false;
+    }
+    if (!inRange(h->initial_state, h->state_count, true))
+        return false;
+
+    data_ = data;
+    size_ = size;
+    return true;
+}
+
+// --- Lookup ---
+
+CompiledModel::Footprint CompiledModel::footprint() const
+{
+    const Header *h = header();
+    Footprint f{};
+    for (uint32_t id = 0; id < h->code_count; ++id)
+        f.code += sizeof(uint32_t) + string(code_[id]).size() + 1 + sizeof(uint32_t); // Entry, text, offset
+    f.strings = (size_t(h->string_count) + 1) * sizeof(uint32_t) + h->string_pool_size -
+                (f.code - size_t(h->code_count) * sizeof(uint32_t));
+    f.tables = size_ - f.strings - f.code;
+    return f;
+}
+
+std::string_view CompiledModel::string(uint32_t id) const
+{
+    uint32_t begin = string_offsets_[id];
+    return std::string_view(string_pool_ + begin, string_offsets_[id + 1] - begin - 1);
+}
+
+// Last entry of the sorted index whose name equals `name`.
+uint32_t CompiledModel::findIn(const uint32_t *index, uint32_t count, std::string_view name,
+                               std::string_view (CompiledModel::*name_of)(uint32_t) const) const
+{
+    const uint32_t *end = index + count;
+    const uint32_t *it = std::upper_bound(index, end, name, [&](std::string_view key, uint32_t id)
+                                          { return key < (this->*name_of)(id); });
+    if (it == index || (this->*name_of)(*(it - 1)) != name)
+        return kNone;
+    return *(it - 1);
+}
+
+// Removed states stay in the index under their last name (IDs are stable);
+// the last live state with the name wins.
+uint32_t CompiledModel::findState(std::string_view name) const
+{
+    const uint32_t *end = state_index_ + stateCount();
+    const uint32_t *it = std::upper_bound(state_index_, end, name, [&](std::string_view key, uint32_t id)
+                                          { return key < stateName(id); });
+    for (; it != state_index_ && stateName(*(it - 1)) == name; --it)
+    {
+        if (!(states_[*(it - 1)].flags & STATE_REMOVED))
+            return *(it - 1);
+    }
+    return kNone;
+}
+
+uint32_t CompiledModel::findEvent(std::string_view name) const
+{
+    return findIn(event_index_, eventCount(), name, &CompiledModel::eventName);
+}
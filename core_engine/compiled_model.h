@@ -0,0 +1,239 @@
+
+#ifndef FSM_COMPILED_MODEL_H
+#define FSM_COMPILED_MODEL_H
+
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Flat, position-independent image of a state machine (.fsmb).
+//
+// Everything the engine needs at run time lives in fixed-width little-endian
+// u32 arrays inside one contiguous buffer, so an image read from disk is used
+// in place: opening a model maps the file and validates the section bounds in
+// one linear pass, without parsing or allocating per element. Read-only
+// mappings of the same file share physical pages across processes.
+//
+//   Header            magic "FSMMODEL", version, counts, section offsets
+//   states            n x StateRecord
+//   transitions       m x TransitionRecord, in declaration order (ID = index)
+//   edge_offsets      (n + 1) x u32   CSR: outgoing transitions of state s are
+//   edges             m' x u32        edges[edge_offsets[s] .. edge_offsets[s+1])
+//   events            e x u32         String ID of each interned event name
+//   code              c x u32         String ID of each action/condition snippet
+//   state_index       n x u32         State IDs sorted by name (binary search)
+//   event_index       e x u32         Event IDs sorted by name
+//   string_offsets    (k + 1) x u32   Start of each string in the pool
+//   string_pool       UTF-8 bytes, each string followed by a NUL
+//
+// Layout-only diagram fields (positions, fonts, colors) never make it into
+// the image. Action and condition code is interned into the code table; the
+// host compiles each snippet once and dispatches by code ID.
+class CompiledModel
+{
+public:
+    static constexpr uint32_t kNone = 0xffffffffu;
+    static constexpr uint16_t kVersion = 1; // Image layout; images of other versions are rejected
+
+    enum StateFlags : uint32_t
+    {
+        STATE_INITIAL = 1,
+        STATE_FINAL = 2,
+        STATE_REMOVED = 4 // Deleted by a live edit; the ID stays reserved
+    };
+
+    struct StateRecord
+    {
+        uint32_t name; // String ID
+        uint32_t entry_code; // Code IDs, kNone when empty
+        uint32_t during_code;
+        uint32_t exit_code;
+        uint32_t flags;
+    };
+
+    struct TransitionRecord
+    {
+        uint32_t source; // State IDs, kNone if the name did not resolve or the
+                         // transition was removed by a live edit
+        uint32_t target;
+        uint32_t event; // Event ID
+        uint32_t condition_code;
+        uint32_t action_code;
+    };
+
+    // Decoded sections, in the same order and with the same meaning as in the
+    // image. This is what the builder and the live editor produce.
+    struct Tables
+    {
+        std::vector<StateRecord> states;
+        std::vector<TransitionRecord> transitions;
+        std::vector<uint32_t> edge_offsets;
+        std::vector<uint32_t> edges;
+        std::vector<uint32_t> events;
+        std::vector<uint32_t> code;
+        std::vector<uint32_t> state_index;
+        std::vector<uint32_t> event_index;
+        std::vector<uint32_t> string_offsets;
+        std::vector<char> string_pool;
+        uint32_t initial_state = kNone;
+
+        uint32_t firstInitialState() const;
+    };
+
+    // Builds an owned image from a JSON-style description. States and
+    // transitions keep their declaration order; code IDs are assigned in
+    // order of first appearance (state entry/during/exit, then transition
+    // condition/action), whichever order the two lists are added in.
+    //
+    // Every string and lookup node the builder keeps lives in one monotonic
+    // arena: text is copied in once, deduplicated, and only referenced by
+    // view afterwards, so adding an element allocates nothing of its own and
+    // the whole working set is released in one go with the builder.
+    class Builder
+    {
+    public:
+        Builder();
+        void addState(std::string_view name, std::string_view entry, std::string_view during,
+                      std::string_view exit, bool is_initial, bool is_final);
+        void addTransition(std::string_view source, std::string_view target, std::string_view event,
+                           std::string_view condition, std::string_view action);
+        std::shared_ptr<const CompiledModel> build();
+
+    private:
+        struct PendingTransition // Views into the arena
+        {
+            std::string_view source;
+            std::string_view target;
+            std::string_view event;
+            std::string_view condition;
+            std::string_view action;
+        };
+
+        using IdMap = std::pmr::unordered_map<std::string_view, uint32_t>;
+
+        std::string_view store(std::string_view s);
+        uint32_t internString(std::string_view s);
+        uint32_t internEvent(std::string_view name);
+        uint32_t internCode(std::string_view code);
+
+        std::pmr::monotonic_buffer_resource arena_;
+        std::vector<StateRecord> states_;
+        std::vector<PendingTransition> transitions_;
+        std::vector<uint32_t> events_;
+        std::vector<uint32_t> code_;
+        std::vector<std::string_view> strings_; // By string ID, interned text
+        size_t string_bytes_ = 0;               // Pool size including NULs
+        IdMap string_ids_;
+        IdMap event_ids_;
+        IdMap code_ids_;
+    };
+
+    // Takes ownership of an image (e.g. one read from a file or a socket).
+    static std::shared_ptr<const CompiledModel> fromImage(std::vector<uint8_t> image);
+    // Maps a .fsmb file read-only and uses it in place.
+    static std::shared_ptr<const CompiledModel> openFile(const std::string &path);
+    // Lays out tables as an owned image.
+    static std::shared_ptr<const CompiledModel> fromTables(const Tables &tables);
+
+    Tables tables() const;
+
+    bool save(const std::string &path) const;
+
+    const uint8_t *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isMapped() const { return mapped_ != nullptr; }
+
+    uint32_t stateCount() const { return header()->state_count; }
+    uint32_t transitionCount() const { return header()->transition_count; }
+    uint32_t eventCount() const { return header()->event_count; }
+    uint32_t codeCount() const { return header()->code_count; }
+    uint32_t initialState() const { return header()->initial_state; } // kNone when no state is live
+
+    // Bytes of the image by what they hold; the three add up to size().
+    struct Footprint
+    {
+        size_t strings; // Names in the string pool and their offsets
+        size_t tables;  // Header, state/transition records, CSR edges, name indexes
+        size_t code;    // Code table plus the snippet text in the pool
+    };
+    Footprint footprint() const;
+
+    const StateRecord &state(uint32_t id) const { return states_[id]; }
+    const TransitionRecord &transition(uint32_t id) const { return transitions_[id]; }
+
+    // Outgoing transition IDs of a state, in declaration order.
+    const uint32_t *edgesBegin(uint32_t state) const { return edges_ + edge_offsets_[state]; }
+    const uint32_t *edgesEnd(uint32_t state) const { return edges_ + edge_offsets_[state + 1]; }
+
+    std::string_view string(uint32_t id) const;
+    std::string_view stateName(uint32_t id) const { return string(states_[id].name); }
+    std::string_view eventName(uint32_t id) const { return string(events_[id]); }
+    std::string_view code(uint32_t id) const { return string(code_[id]); }
+
+    // Binary search over the sorted name indexes; kNone if absent. With
+    // duplicate state names the last declared state wins; removed states are
+    // never found.
+    uint32_t findState(std::string_view name) const;
+    uint32_t findEvent(std::string_view name) const;
+
+private:
+    struct Header
+    {
+        char magic[8];
+        uint16_t version;
+        uint16_t flags;
+        uint32_t header_size;
+        uint32_t state_count;
+        uint32_t transition_count;
+        uint32_t edge_count;
+        uint32_t event_count;
+        uint32_t code_count;
+        uint32_t string_count;
+        uint32_t initial_state;
+        uint32_t states_offset;
+        uint32_t transitions_offset;
+        uint32_t edge_offsets_offset;
+        uint32_t edges_offset;
+        uint32_t events_offset;
+        uint32_t code_offset;
+        uint32_t state_index_offset;
+        uint32_t event_index_offset;
+        uint32_t string_offsets_offset;
+        uint32_t string_pool_offset;
+        uint32_t string_pool_size;
+        uint32_t reserved;
+    };
+
+    static constexpr char kMagic[8] = {'F', 'S', 'M', 'M', 'O', 'D', 'E', 'L'};
+
+    CompiledModel() = default;
+    bool attach(const uint8_t *data, size_t size);
+    const Header *header() const { return reinterpret_cast<const Header *>(data_); }
+    uint32_t findIn(const uint32_t *index, uint32_t count, std::string_view name,
+                    std::string_view (CompiledModel::*name_of)(uint32_t) const) const;
+
+    std::vector<uint8_t> owned_;
+    std::unique_ptr<MappedFile> mapped_;
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+
+    // Section pointers into data_
+    const StateRecord *states_ = nullptr;
+    const TransitionRecord *transitions_ = nullptr;
+    const uint32_t *edge_offsets_ = nullptr;
+    const uint32_t *edges_ = nullptr;
+    const uint32_t *events_ = nullptr;
+    const uint32_t *code_ = nullptr;
+    const uint32_t *state_index_ = nullptr;
+    const uint32_t *event_index_ = nullptr;
+    const uint32_t *string_offsets_ = nullptr;
+    const char *string_pool_ = nullptr;
+};
+
+#endif // FSM_COMPILED_MODEL_H
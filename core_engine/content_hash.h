@@ -0,0 +1,77 @@
+
+#ifndef FSM_CONTENT_HASH_H
+#define FSM_CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Streaming 64-bit content hash used as a cache key (not cryptographic).
+// Consumes 8 bytes per round and finishes with the murmur3 avalanche step,
+// so hashing a large file costs little next to parsing it. The value depends
+// only on the sequence of calls and bytes fed in (on little-endian hosts,
+// like the model images).
+class ContentHash
+{
+public:
+    ContentHash() = default;
+    // Another seed gives an independent hash of the same input, used to
+    // confirm a match on the default one.
+    explicit ContentHash(uint64_t seed) : state_(seed) {}
+
+    void bytes(const void *data, size_t size)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        length_ += size;
+        for (; size >= 8; p += 8, size -= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            round(word);
+        }
+        if (size)
+            round(load(p, size));
+    }
+
+    void u64(uint64_t value) { bytes(&value, sizeof(value)); }
+
+    // Length-prefixed, so ("ab", "c") and ("a", "bc") differ.
+    void string(std::string_view s)
+    {
+        u64(s.size());
+        bytes(s.data(), s.size());
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t h = state_ ^ length_;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+private:
+    // Little-endian load of up to 8 bytes (zero padded).
+    static uint64_t load(const uint8_t *p, size_t n)
+    {
+        uint64_t word = 0;
+        for (size_t i = 0; i < n; ++i)
+            word |= static_cast<uint64_t>(p[i]) << (8 * i);
+        return word;
+    }
+
+    void round(uint64_t word)
+    {
+        state_ ^= word * 0x9e3779b97f4a7c15ull;
+        state_ = ((state_ << 31) | (state_ >> 33)) * 0x87c37b91114253d5ull;
+    }
+
+    uint64_t state_ = 0x2545f4914f6cdd1dull;
+    uint64_t length_ = 0;
+};
+
+#endif // FSM_CONTENT_HASH_H
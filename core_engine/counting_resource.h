@@ -0,0 +1,67 @@
+
+#ifndef FSM_COUNTING_RESOURCE_H
+#define FSM_COUNTING_RESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+// Memory resource that forwards to an upstream resource (the global heap by
+// default) and counts what passes through it. A simulator routes the
+// containers that grow while stepping through one of these, so footprint
+// regressions show up as counts instead of guesswork. Not thread-safe: it
+// belongs to whichever thread owns the containers.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    struct Counters
+    {
+        uint64_t allocations = 0;
+        uint64_t deallocations = 0;
+        uint64_t bytes_allocated = 0; // Cumulative
+        uint64_t bytes_in_use = 0;
+        uint64_t peak_bytes_in_use = 0;
+    };
+
+    explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+        : upstream_(upstream)
+    {
+    }
+
+    const Counters &counters() const { return counters_; }
+
+    // Starts a new counting period; bytes still in use stay accounted for.
+    void resetCounters()
+    {
+        uint64_t in_use = counters_.bytes_in_use;
+        counters_ = Counters{};
+        counters_.bytes_in_use = in_use;
+        counters_.peak_bytes_in_use = in_use;
+    }
+
+private:
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        void *p = upstream_->allocate(bytes, alignment);
+        ++counters_.allocations;
+        counters_.bytes_allocated += bytes;
+        counters_.bytes_in_use += bytes;
+        if (counters_.bytes_in_use > counters_.peak_bytes_in_use)
+            counters_.peak_bytes_in_use = counters_.bytes_in_use;
+        return p;
+    }
+
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        upstream_->deallocate(p, bytes, alignment);
+        ++counters_.deallocations;
+        counters_.bytes_in_use -= bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource *upstream_;
+    Counters counters_;
+};
+
+#endif // FSM_COUNTING_RESOURCE_H
@@ -0,0 +1,87 @@
+
+#include "coverage_counters.h"
+#include <algorithm>
+
+void CoverageCounters::clear()
+{
+    state_visits_.clear();
+    transition_fires_.clear();
+    guard_true_.clear();
+    guard_false_.clear();
+    residency_rows_.clear();
+    residency_.clear();
+}
+
+void CoverageCounters::resize(uint32_t state_count, uint32_t transition_count)
+{
+    state_visits_.resize(state_count, 0);
+    residency_rows_.resize(state_count, kNoRow);
+    transition_fires_.resize(transition_count, 0);
+    guard_true_.resize(transition_count, 0);
+    guard_false_.resize(transition_count, 0);
+}
+
+void CoverageCounters::stateLeft(uint32_t state, uint64_t ticks)
+{
+    uint32_t &row = residency_rows_[state];
+    if (row == kNoRow)
+    {
+        row = static_cast<uint32_t>(residency_.size());
+        residency_.resize(residency_.size() + kResidencyBuckets, 0);
+    }
+    ++residency_[row + residencyBucket(ticks)];
+}
+
+uint32_t CoverageCounters::residencyBucket(uint64_t ticks)
+{
+    uint32_t bucket = 0;
+    for (; ticks != 0 && bucket < kResidencyBuckets - 1; ticks >>= 1)
+        ++bucket;
+    return bucket;
+}
+
+uint32_t CoverageCounters::read(int32_t kind, uint64_t *out, uint32_t capacity) const
+{
+    const std::vector<uint64_t> *counts = nullptr;
+    switch (kind)
+    {
+    case FSM_COVERAGE_STATE_VISITS:
+        counts = &state_visits_;
+        break;
+    case FSM_COVERAGE_TRANSITION_FIRES:
+        counts = &transition_fires_;
+        break;
+    case FSM_COVERAGE_GUARD_TRUE:
+        counts = &guard_true_;
+        break;
+    case FSM_COVERAGE_GUARD_FALSE:
+        counts = &guard_false_;
+        break;
+    case FSM_COVERAGE_RESIDENCY:
+    {
+        // Expanded to a dense row per state; cold states read as zeros.
+        uint32_t total = static_cast<uint32_t>(residency_rows_.size()) * kResidencyBuckets;
+        uint32_t copied = out ? std::min(total, capacity) : 0;
+        for (uint32_t i = 0; i < copied; ++i)
+        {
+            uint32_t row = residency_rows_[i / kResidencyBuckets];
+            out[i] = row == kNoRow ? 0 : residency_[row + i % kResidencyBuckets];
+        }
+        return total;
+    }
+    default:
+        return 0;
+    }
+    uint32_t total = static_cast<uint32_t>(counts->size());
+    if (out)
+        std::copy_n(counts->begin(), std::min(total, capacity), out);
+    return total;
+}
+
+size_t CoverageCounters::memoryBytes() const
+{
+    return (state_visits_.capacity() + transition_fires_.capacity() + guard_true_.capacity() +
+            guard_false_.capacity() + residency_.capacity()) *
+               sizeof(uint64_t) +
+           residency_rows_.capacity() * sizeof(uint32_t);
+}
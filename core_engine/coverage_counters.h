@@ -0,0 +1,53 @@
+
+#ifndef FSM_COVERAGE_COUNTERS_H
+#define FSM_COVERAGE_COUNTERS_H
+
+#include "fsm_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-ID execution counters of one simulator: state visits, transition
+// fires, guard outcomes and a log2 histogram of ticks spent in each state.
+//
+// Counters are flat arrays indexed by state or transition ID, so recording is
+// one increment on the step path. Residency histograms are only allocated for
+// states that have been left at least once: a large model mostly stays cold,
+// and a dense states x buckets table would dwarf the compiled image.
+class CoverageCounters
+{
+public:
+    static constexpr uint32_t kResidencyBuckets = FSM_RESIDENCY_BUCKETS;
+
+    void clear();
+    // Sizes the arrays for a model; existing counts are kept (IDs are stable
+    // across live edits).
+    void resize(uint32_t state_count, uint32_t transition_count);
+
+    void stateVisited(uint32_t state) { ++state_visits_[state]; }
+    void transitionFired(uint32_t transition) { ++transition_fires_[transition]; }
+    void guardEvaluated(uint32_t transition, bool result) { ++(result ? guard_true_ : guard_false_)[transition]; }
+    void stateLeft(uint32_t state, uint64_t ticks);
+
+    // Bucket 0 holds zero ticks, bucket b > 0 holds [2^(b-1), 2^b); the last
+    // bucket also takes everything above.
+    static uint32_t residencyBucket(uint64_t ticks);
+
+    // Copies one FsmCoverageKind array (up to capacity values) and returns
+    // its full length; 0 for an unknown kind.
+    uint32_t read(int32_t kind, uint64_t *out, uint32_t capacity) const;
+
+    size_t memoryBytes() const;
+
+private:
+    static constexpr uint32_t kNoRow = 0xffffffffu;
+
+    std::vector<uint64_t> state_visits_;
+    std::vector<uint64_t> transition_fires_;
+    std::vector<uint64_t> guard_true_;
+    std::vector<uint64_t> guard_false_;
+    std::vector<uint32_t> residency_rows_; // Per state: first bucket in residency_, or kNoRow
+    std::vector<uint64_t> residency_;
+};
+
+#endif // FSM_COVERAGE_COUNTERS_H
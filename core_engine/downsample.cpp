@@ -0,0 +1,133 @@
+
+#include "downsample.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    size_t copyAll(const double *x, const double *y, size_t n, double *out_x, double *out_y)
+    {
+        if (n == 0)
+            return 0;
+        std::memcpy(out_x, x, n * sizeof(double));
+        std::memcpy(out_y, y, n * sizeof(double));
+        return n;
+    }
+
+    // First index in [begin, end) holding value, or begin if none does (NaN).
+    size_t indexOf(const double *y, size_t begin, size_t end, double value)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (y[i] == value)
+                return i;
+        }
+        return begin;
+    }
+}
+
+namespace downsample
+{
+    size_t minMax(const double *x, const double *y, size_t n, size_t buckets, double *out_x, double *out_y)
+    {
+        if (buckets == 0 || n <= 2 * buckets)
+            return copyAll(x, y, n, out_x, out_y);
+
+        size_t count = 0;
+        for (size_t b = 0; b < buckets; ++b)
+        {
+            size_t begin = b * n / buckets;
+            size_t end = (b + 1) * n / buckets;
+
+            double lo = y[begin];
+            double hi = y[begin];
+            for (size_t i = begin + 1; i < end; ++i)
+            {
+                lo = y[i] < lo ? y[i] : lo;
+                hi = y[i] > hi ? y[i] : hi;
+            }
+
+            size_t lo_index = indexOf(y, begin, end, lo);
+            size_t hi_index = indexOf(y, begin, end, hi);
+            size_t first = std::min(lo_index, hi_index);
+            size_t second = std::max(lo_index, hi_index);
+
+            out_x[count] = x[first];
+            out_y[count++] = y[first];
+            if (second != first)
+            {
+                out_x[count] = x[second];
+                out_y[count++] = y[second];
+            }
+        }
+        return count;
+    }
+
+    size_t lttb(const double *x, const double *y, size_t n, size_t threshold, double *out_x, double *out_y)
+    {
+        if (threshold == 0 || threshold >= n)
+            return copyAll(x, y, n, out_x, out_y);
+        if (threshold < 3)
+        {
+            out_x[0] = x[0];
+            out_y[0] = y[0];
+            if (threshold == 2)
+            {
+                out_x[1] = x[n - 1];
+                out_y[1] = y[n - 1];
+            }
+            return threshold;
+        }
+
+        // Interior points are split into threshold - 2 buckets; from each we
+        // keep the point forming the largest triangle with the previously kept
+        // point and the average of the next bucket.
+        double every = static_cast<double>(n - 2) / static_cast<double>(threshold - 2);
+        size_t count = 0;
+        size_t a = 0;
+        out_x[count] = x[0];
+        out_y[count++] = y[0];
+
+        for (size_t i = 0; i < threshold - 2; ++i)
+        {
+            size_t avg_begin = static_cast<size_t>((i + 1) * every) + 1;
+            size_t avg_end = std::min(static_cast<size_t>((i + 2) * every) + 1, n);
+            double avg_x = 0.0;
+            double avg_y = 0.0;
+            for (size_t j = avg_begin; j < avg_end; ++j)
+            {
+                avg_x += x[j];
+                avg_y += y[j];
+            }
+            double avg_count = static_cast<double>(avg_end - avg_begin);
+            avg_x /= avg_count;
+            avg_y /= avg_count;
+
+            size_t begin = static_cast<size_t>(i * every) + 1;
+            size_t end = static_cast<size_t>((i + 1) * every) + 1;
+            double ax = x[a];
+            double ay = y[a];
+            double best_area = -1.0;
+            size_t best = begin;
+            for (size_t j = begin; j < end; ++j)
+            {
+                // Twice the triangle area; the factor does not change the winner.
+                double area = std::fabs((ax - avg_x) * (y[j] - ay) - (ax - x[j]) * (avg_y - ay));
+                if (area > best_area)
+                {
+                    best_area = area;
+                    best = j;
+                }
+            }
+
+            out_x[count] = x[best];
+            out_y[count++] = y[best];
+            a = best;
+        }
+
+        out_x[count] = x[n - 1];
+        out_y[count++] = y[n - 1];
+        return count;
+    }
+}
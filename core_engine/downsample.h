@@ -0,0 +1,24 @@
+
+#ifndef FSM_DOWNSAMPLE_H
+#define FSM_DOWNSAMPLE_H
+
+#include <cstddef>
+
+// Reduces an (x, y) series to screen resolution before it is handed to a
+// plot. Both kernels return the number of points written to out_x/out_y;
+// inputs that already fit are copied unchanged. x is expected to be sorted.
+//
+// The per-bucket min/max and mean passes are branch-free loops over
+// contiguous double arrays so the compiler can vectorize them.
+namespace downsample
+{
+    // Min and max of each of `buckets` equal-count buckets, in x order: at
+    // most 2 * buckets points. Keeps every spike, which is what a scope needs.
+    size_t minMax(const double *x, const double *y, size_t n, size_t buckets, double *out_x, double *out_y);
+
+    // Largest-Triangle-Three-Buckets: `threshold` points, including the first
+    // and last, chosen to preserve the visual shape of the line.
+    size_t lttb(const double *x, const double *y, size_t n, size_t threshold, double *out_x, double *out_y);
+}
+
+#endif // FSM_DOWNSAMPLE_H
@@ -0,0 +1,137 @@
+
+#ifndef FSM_FLIGHT_RECORDER_H
+#define FSM_FLIGHT_RECORDER_H
+
+#include "trace_codec.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Fixed-size ring of the last N completed steps, kept for post-mortems.
+//
+// Each slot is kSlotWords atomic words guarded by its own sequence counter,
+// the same scheme as SeqlockSnapshot: one writer (the thread that steps)
+// never waits, and readers on any thread copy slots out without a lock,
+// skipping a slot the writer is rewriting or has lapped. A record keeps up to
+// kMaxVars changed variables inline; var_count says how many changed in all.
+class FlightRecorder
+{
+public:
+    static constexpr uint32_t kNone = 0xffffffffu;
+    static constexpr size_t kMaxVars = 6;
+
+    struct Record
+    {
+        uint64_t tick = 0;
+        uint32_t event = kNone;      // Model event ID
+        uint32_t transition = kNone; // Fired transition ID
+        uint32_t source = kNone;     // Active state before and after the step
+        uint32_t target = kNone;
+        uint32_t var_count = 0; // Variables changed by the step
+        trace::TraceVar vars[kMaxVars];
+
+        uint32_t storedVars() const { return var_count < kMaxVars ? var_count : static_cast<uint32_t>(kMaxVars); }
+    };
+
+    FlightRecorder() = default;
+    FlightRecorder(const FlightRecorder &) = delete;
+    FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+    // Writer side; 0 turns recording off. Frees the old slots, so no reader
+    // may run meanwhile (the simulator only resizes with its engine thread
+    // stopped, when readers are the owning thread).
+    void resize(size_t capacity)
+    {
+        slots_.reset(capacity ? new Slot[capacity] : nullptr);
+        capacity_ = capacity;
+        head_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return capacity_; }
+    bool isEnabled() const { return capacity_ != 0; }
+
+    // Writer side. Must only be called from one thread at a time.
+    void record(const Record &r)
+    {
+        uint64_t index = head_.load(std::memory_order_relaxed);
+        Slot &slot = slots_[index % capacity_];
+        uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.words[0].store(r.tick, std::memory_order_relaxed);
+        slot.words[1].store(pack(r.event, r.transition), std::memory_order_relaxed);
+        slot.words[2].store(pack(r.source, r.target), std::memory_order_relaxed);
+        slot.words[3].store(r.var_count, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < r.storedVars(); ++i)
+        {
+            slot.words[kFixedWords + 2 * i].store(pack(r.vars[i].slot, r.vars[i].type), std::memory_order_relaxed);
+            slot.words[kFixedWords + 2 * i + 1].store(r.vars[i].raw, std::memory_order_relaxed);
+        }
+
+        slot.seq.store(seq + 2, std::memory_order_release);
+        head_.store(index + 1, std::memory_order_release);
+    }
+
+    // Reader side, safe from any thread. Copies the records still in the
+    // ring, oldest first; returns how many steps were recorded in total.
+    uint64_t read(std::vector<Record> &out) const
+    {
+        out.clear();
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t first = head > capacity_ ? head - capacity_ : 0;
+        for (uint64_t index = first; index < head; ++index)
+        {
+            const Slot &slot = slots_[index % capacity_];
+            // Record `index` is the slot's (index / capacity + 1)-th write.
+            uint64_t expected = 2 * (index / capacity_ + 1);
+            if (slot.seq.load(std::memory_order_acquire) != expected)
+                continue; // Being rewritten, or already lapped
+
+            Record r;
+            r.tick = slot.words[0].load(std::memory_order_relaxed);
+            unpack(slot.words[1].load(std::memory_order_relaxed), &r.event, &r.transition);
+            unpack(slot.words[2].load(std::memory_order_relaxed), &r.source, &r.target);
+            r.var_count = static_cast<uint32_t>(slot.words[3].load(std::memory_order_relaxed));
+            for (uint32_t i = 0; i < r.storedVars(); ++i)
+            {
+                uint32_t type;
+                unpack(slot.words[kFixedWords + 2 * i].load(std::memory_order_relaxed), &r.vars[i].slot, &type);
+                r.vars[i].type = static_cast<uint8_t>(type);
+                r.vars[i].raw = slot.words[kFixedWords + 2 * i + 1].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == expected)
+                out.push_back(r);
+        }
+        return head;
+    }
+
+    size_t memoryBytes() const { return capacity_ * sizeof(Slot); }
+
+private:
+    static constexpr size_t kFixedWords = 4;
+    static constexpr size_t kSlotWords = kFixedWords + 2 * kMaxVars;
+
+    struct Slot
+    {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> words[kSlotWords] = {};
+    };
+
+    static uint64_t pack(uint32_t high, uint32_t low) { return (static_cast<uint64_t>(high) << 32) | low; }
+    static void unpack(uint64_t word, uint32_t *high, uint32_t *low)
+    {
+        *high = static_cast<uint32_t>(word >> 32);
+        *low = static_cast<uint32_t>(word);
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_ = 0;
+    std::atomic<uint64_t> head_{0};
+};
+
+#endif // FSM_FLIGHT_RECORDER_H
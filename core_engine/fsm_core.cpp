@@ -1,74 +1,370 @@
 
 #define FSM_CORE_BUILD_DLL
 #include "fsm_core.h"
+#include "compiled_model.h"
+#include "counting_resource.h"
+#include "coverage_counters.h"
+#include "downsample.h"
+#include "flight_recorder.h"
+#include "history_store.h"
+#include "latency_histogram.h"
+#include "model_cache.h"
+#include "model_editor.h"
+#include "model_json_loader.h"
+#include "mpsc_queue.h"
+#include "realtime_loop.h"
+#include "seqlock_snapshot.h"
+#include "span_recorder.h"
+#include "trace_reader.h"
+#include "trace_writer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
-struct State
+namespace
+{
+    // Shared by every simulator handle in the process.
+    ModelCache &modelCache()
+    {
+        static ModelCache cache;
+        return cache;
+    }
+}
+
+struct Variable
 {
     std::string name;
-    std::string entry_action;
-    std::string during_action;
-    std::string exit_action;
-    bool is_initial = false;
-    bool is_final = false;
+    int32_t type = FSM_VAR_OTHER;
+    int64_t int_value = 0;   // FSM_VAR_BOOL and FSM_VAR_INT
+    double real_value = 0.0; // FSM_VAR_REAL
+    std::string json_value;  // FSM_VAR_OTHER (strings, lists, ...)
+    uint64_t version = 0;    // Handle change version of the last modification
+
+    static Variable fromJson(const std::string &name, const json &value)
+    {
+        Variable v;
+        v.name = name;
+        if (value.is_boolean())
+        {
+            v.type = FSM_VAR_BOOL;
+            v.int_value = value.get<bool>() ? 1 : 0;
+        }
+        else if (value.is_number_integer())
+        {
+            v.type = FSM_VAR_INT;
+            v.int_value = value.get<int64_t>();
+        }
+        else if (value.is_number_float())
+        {
+            v.type = FSM_VAR_REAL;
+            v.real_value = value.get<double>();
+        }
+        else
+        {
+            v.type = FSM_VAR_OTHER;
+            v.json_value = value.dump();
+        }
+        return v;
+    }
+
+    bool sameValue(const Variable &other) const
+    {
+        return type == other.type && int_value == other.int_value &&
+               real_value == other.real_value && json_value == other.json_value;
+    }
+
+    json toJson() const
+    {
+        switch (type)
+        {
+        case FSM_VAR_BOOL:
+            return int_value != 0;
+        case FSM_VAR_INT:
+            return int_value;
+        case FSM_VAR_REAL:
+            return real_value;
+        default:
+            return json_value.empty() ? json() : json::parse(json_value);
+        }
+    }
 };
 
-struct Transition
+// One entry of the step log handed to hosts that do not use callbacks.
+// Action and condition entries carry only the code ID; the source is
+// available once per load from the code table. Allocator-aware, so the
+// entries' text and IDs come from the log's own (counted) memory resource.
+struct LogEntry
 {
-    std::string source;
-    std::string target;
-    std::string event;
-    std::string condition;
-    std::string action;
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    LogEntry(const char *type, int code_id, std::string_view message, const allocator_type &alloc = {})
+        : type(type), code_id(code_id), message(message, alloc), code_ids(alloc)
+    {
+    }
+    LogEntry(const LogEntry &other, const allocator_type &alloc)
+        : type(other.type), code_id(other.code_id), message(other.message, alloc), code_ids(other.code_ids, alloc)
+    {
+    }
+    LogEntry(LogEntry &&other, const allocator_type &alloc)
+        : type(other.type), code_id(other.code_id), message(std::move(other.message), alloc),
+          code_ids(std::move(other.code_ids), alloc)
+    {
+    }
+    LogEntry(const LogEntry &) = default;
+    LogEntry(LogEntry &&) = default;
+
+    const char *type;
+    int code_id;                    // -1 for INFO and AWAIT_CONDITIONS entries
+    std::pmr::string message;       // INFO entries only
+    std::pmr::vector<int> code_ids; // AWAIT_CONDITIONS entries only
 };
 
+namespace
+{
+    // Heap bytes owned by a string: none while it fits its inline buffer.
+    template <typename String>
+    size_t heapBytes(const String &s)
+    {
+        const char *self = reinterpret_cast<const char *>(&s);
+        bool in_place = !std::less<const char *>()(s.data(), self) && std::less<const char *>()(s.data(), self + sizeof(s));
+        return in_place ? 0 : s.capacity() + 1;
+    }
+
+    template <typename Vector>
+    size_t vectorBytes(const Vector &v)
+    {
+        return v.capacity() * sizeof(typename Vector::value_type);
+    }
+
+    // Tree nodes carry three links and a color word; hash nodes a link and
+    // the cached hash, plus the bucket array.
+    template <typename Map>
+    size_t mapNodeBytes(const Map &m)
+    {
+        return m.size() * (sizeof(typename Map::value_type) + 4 * sizeof(void *));
+    }
+
+    template <typename Map>
+    size_t hashNodeBytes(const Map &m)
+    {
+        return m.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void *)) + m.bucket_count() * sizeof(void *);
+    }
+
+    // Records the wall-clock time of a scope; no histogram, no clock reads.
+    class ScopedLatency
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit ScopedLatency(LatencyHistogram *histogram)
+            : histogram_(histogram), start_(histogram ? Clock::now() : Clock::time_point())
+        {
+        }
+        ~ScopedLatency()
+        {
+            if (histogram_)
+                histogram_->record(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count()));
+        }
+        ScopedLatency(const ScopedLatency &) = delete;
+        ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+    private:
+        LatencyHistogram *histogram_;
+        Clock::time_point start_;
+    };
+
+    bool writeTextFile(const std::string &path, const std::string &text)
+    {
+        std::FILE *file = nullptr;
+#ifdef _WIN32
+        if (fopen_s(&file, path.c_str(), "wb") != 0)
+            file = nullptr;
+#else
+        file = std::fopen(path.c_str(), "wb");
+#endif
+        if (!file)
+            return false;
+        bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    // Records a scope as a span when the recorder is on.
+    class ScopedSpan
+    {
+    public:
+        ScopedSpan(SpanRecorder &recorder, SpanRecorder::Kind kind, uint32_t id, int32_t arg)
+            : recorder_(recorder.isEnabled() ? &recorder : nullptr), kind_(kind), id_(id), arg_(arg),
+              start_(recorder_ ? recorder.now() : SpanRecorder::Clock::time_point())
+        {
+        }
+        ~ScopedSpan()
+        {
+            if (recorder_)
+                recorder_->record(kind_, start_, id_, arg_);
+        }
+        ScopedSpan(const ScopedSpan &) = delete;
+        ScopedSpan &operator=(const ScopedSpan &) = delete;
+
+        // For arguments only known part-way through the scope.
+        void setArgs(uint32_t id, int32_t arg)
+        {
+            id_ = id;
+            arg_ = arg;
+        }
+
+    private:
+        SpanRecorder *recorder_;
+        SpanRecorder::Kind kind_;
+        uint32_t id_;
+        int32_t arg_;
+        SpanRecorder::Clock::time_point start_;
+    };
+}
+
 class FsmSimulator
 {
 public:
-    FsmSimulator() { reset(); }
+    FsmSimulator() : external_events_(kExternalEventCapacity)
+    {
+        flight_recorder_.resize(kDefaultFlightSteps);
+        reset();
+    }
+    ~FsmSimulator()
+    {
+        stopRealtime();
+        closeTrace();
+    }
 
-    void loadFromJson(const std::string &json_str)
+    bool loadFromJson(const char *json_str, size_t size, ModelLoadError *error)
     {
-        states_.clear();
-        state_map_.clear();
-        transitions_.clear();
+        auto model = modelCache().loadJson(json_str, size, error);
+        if (!model)
+        {
+            triggerFlightDump("load error: " + (error ? error->message : std::string()));
+            return false;
+        }
+        loadModel(std::move(model));
+        return true;
+    }
 
-        auto data = json::parse(json_str);
+    // Models are immutable, so several simulators may share one image.
+    void loadModel(std::shared_ptr<const CompiledModel> model)
+    {
+        model_ = std::move(model);
+        editor_.reset();
+        step_memory_.resetCounters();
+        flight_row_pending_ = false;
+        flight_recorder_.resize(flight_recorder_.capacity()); // Recorded IDs belong to the old model
+        coverage_.clear();
+        sizeCoverage();
+        if (trace_writer_.isOpen())
+            traceStateNames();
+    }
 
-        for (const auto &s_data : data["states"])
+    const std::shared_ptr<const CompiledModel> &model() const { return model_; }
+
+    // --- Hot swap ---
+    // Moves the running instance onto another model without a reset: the
+    // active state path is mapped by name (or by ID), and variables, queued
+    // events, history and the trace carry over. What cannot be mapped is
+    // listed in rebind_report_; unless the policy is strict (then nothing
+    // changes), an unmapped active state halts the machine and unknown queued
+    // events stay queued, matching nothing. Refused while a step waits for
+    // guard answers, like edits.
+    bool rebind(std::shared_ptr<const CompiledModel> model, int32_t policy)
+    {
+        if (!pending_candidates_.empty())
+            return false;
+        bool by_id = (policy & FSM_REBIND_BY_ID) != 0;
+        std::vector<uint32_t> path;
+        json unmapped_states = json::array();
+        for (uint32_t id : current_state_path_)
         {
-            State s;
-            s.name = s_data.value("name", "");
-            s.entry_action = s_data.value("entry_action", "");
-            s.during_action = s_data.value("during_action", "");
-            s.exit_action = s_data.value("exit_action", "");
-            s.is_initial = s_data.value("is_initial", false);
-            s.is_final = s_data.value("is_final", false);
-            states_.push_back(s);
+            uint32_t mapped = model->findState(model_->stateName(id));
+            if (by_id)
+                mapped = id < model->stateCount() && !(model->state(id).flags & CompiledModel::STATE_REMOVED)
+                             ? id
+                             : CompiledModel::kNone;
+            if (mapped == CompiledModel::kNone)
+                unmapped_states.push_back(std::string(model_->stateName(id)));
+            else
+                path.push_back(mapped);
         }
+        json unmapped_events = json::array();
+        for (const std::pmr::string &event : internal_event_queue_)
+        {
+            if (model->findEvent(event) == CompiledModel::kNone)
+                unmapped_events.push_back(std::string(event));
+        }
+        bool complete = unmapped_states.empty() && unmapped_events.empty();
+        rebind_report_ = json{{"states", std::move(unmapped_states)}, {"events", std::move(unmapped_events)}}.dump();
+        if (!complete && (policy & FSM_REBIND_STRICT))
+            return false;
 
-        for (auto &state : states_)
+        if (path.size() != current_state_path_.size())
+            path.clear(); // Halt rather than run in a partially mapped configuration
+        loadModel(std::move(model));
+        if (path != current_state_path_)
         {
-            state_map_[state.name] = &state;
+            current_state_path_ = std::move(path);
+            markStateChanged();
         }
+        publishState();
+        return true;
+    }
 
-        for (const auto &t_data : data["transitions"])
+    const std::string &rebindReport() const { return rebind_report_; }
+
+    // --- Live model editing ---
+    // Runs one ModelEditor call and swaps in the patched model. The running
+    // configuration, variables, queued events and history are kept; if the
+    // active state was removed the machine halts. Refused while a step waits
+    // for guard answers, since the pending candidates are transition IDs of
+    // the current model.
+    template <typename Edit>
+    bool applyEdit(Edit &&edit)
+    {
+        if (!pending_candidates_.empty())
+            return false;
+        if (!editor_)
+            editor_ = std::make_unique<ModelEditor>(*model_);
+        if (!edit(*editor_))
+            return false;
+        std::shared_ptr<const CompiledModel> previous = std::move(model_);
+        model_ = editor_->commit();
+        sizeCoverage();
+
+        if (trace_writer_.isOpen())
+        {
+            for (uint32_t id = 0; id < model_->stateCount(); ++id)
+            {
+                if (id >= previous->stateCount() || previous->stateName(id) != model_->stateName(id))
+                    traceName(trace::NAME_STATE, id, model_->stateName(id));
+            }
+        }
+        bool active_removed = std::any_of(current_state_path_.begin(), current_state_path_.end(), [&](uint32_t id)
+                                          { return model_->state(id).flags & CompiledModel::STATE_REMOVED; });
+        if (active_removed)
         {
-            Transition t;
-            t.source = t_data.value("source", "");
-            t.target = t_data.value("target", "");
-            t.event = t_data.value("event", "");
-            t.condition = t_data.value("condition", "");
-            t.action = t_data.value("action", "");
-            transitions_.push_back(t);
+            current_state_path_.clear();
+            markStateChanged();
         }
+        publishState();
+        return true;
     }
 
     void setInitialVariables(const std::string &json_str)
@@ -77,47 +373,61 @@ public:
         auto data = json::parse(json_str);
         for (auto &el : data.items())
         {
-            initial_variables_[el.key()] = el.value().dump();
+            initial_variables_.push_back(Variable::fromJson(el.key(), el.value()));
         }
     }
 
     void reset()
     {
+        commitFlightRow();
         action_log_.clear();
+        history_.clear();
         variables_ = initial_variables_;
+        shared_names_stale_ = true;
+        variable_index_.clear();
+        change_version_++;
+        for (size_t slot = 0; slot < variables_.size(); ++slot)
+        {
+            variables_[slot].version = change_version_;
+            variable_index_[variables_[slot].name] = static_cast<int>(slot);
+        }
         current_tick_ = 0;
         current_state_path_.clear();
-        pending_transition_.reset();
+        state_version_ = change_version_;
+        pending_candidates_.clear();
+        pending_fallback_ = CompiledModel::kNone;
         internal_event_queue_.clear();
 
-        State *initial_state = nullptr;
-        for (auto &s : states_)
-        {
-            if (s.is_initial)
-            {
-                initial_state = &s;
-                break;
-            }
-        }
-        if (!initial_state && !states_.empty())
+        if (model_->initialState() != CompiledModel::kNone)
         {
-            initial_state = &states_[0];
+            enterState(model_->initialState());
         }
-
-        if (initial_state)
+        if (trace_writer_.isOpen())
         {
-            enterState(initial_state);
+            traceVariableNames(0);
+            traceKeyframe();
         }
+        history_row_pending_ = history_enabled_;
+        flight_change_version_ = change_version_;
+        publishState();
     }
 
     void step(const std::string &event_name_str)
     {
+        ScopedLatency timer(latencyHistogram(FSM_LATENCY_STEP));
+        ScopedSpan span(spans_, SpanRecorder::SPAN_STEP, CompiledModel::kNone, current_tick_);
+        commitHistoryRow();
+        commitFlightRow();
+        flight_row_ = FlightRecorder::Record{};
+        flight_row_.source = static_cast<uint32_t>(activeStateId());
         action_log_.clear();
+        step_event_.clear();
+        fired_transition_ = -1;
 
         // Add external event to queue if present
         if (!event_name_str.empty())
         {
-            internal_event_queue_.push_back(event_name_str);
+            internal_event_queue_.emplace_back(event_name_str);
         }
 
         if (current_state_path_.empty())
@@ -127,197 +437,1533 @@ public:
         if (event_name_str.empty())
         {
             current_tick_++;
-            executeAction("DURING_ACTION", current_state_path_.back()->during_action);
+            span.setArgs(CompiledModel::kNone, current_tick_);
+            executeAction(FSM_ACTION_DURING, model_->state(current_state_path_.back()).during_code);
         }
 
         bool transition_taken_this_step = false;
         while (!internal_event_queue_.empty() && !transition_taken_this_step)
         {
-            std::string current_event = internal_event_queue_.front();
+            std::string current_event(internal_event_queue_.front());
             internal_event_queue_.erase(internal_event_queue_.begin());
+            step_event_ = current_event;
 
             if (current_tick_ == 0 || !event_name_str.empty())
             {
                 current_tick_++;
             }
 
-            State *current_leaf_state = current_state_path_.back();
+            uint32_t current_leaf_state = current_state_path_.back();
+            uint32_t event_id = model_->findEvent(current_event);
+            span.setArgs(event_id, current_tick_);
+            flight_row_.event = event_id;
+            pending_candidates_.clear(); // A suspended earlier event is dropped, fallback included
+            pending_fallback_ = CompiledModel::kNone;
 
-            for (const auto &trans : transitions_)
+            // Only the leaf's own outgoing edges are scanned (CSR adjacency).
+            const uint32_t *edge = model_->edgesBegin(current_leaf_state);
+            const uint32_t *edges_end = event_id == CompiledModel::kNone ? edge : model_->edgesEnd(current_leaf_state);
+            for (; edge != edges_end; ++edge)
             {
-                if (trans.source == current_leaf_state->name && trans.event == current_event)
+                const CompiledModel::TransitionRecord &trans = model_->transition(*edge);
+                if (trans.event != event_id)
+                    continue;
+
+                if (trans.condition_code != CompiledModel::kNone && guard_fn_)
                 {
-                    if (!trans.condition.empty())
+                    // Registered guard callback: evaluate synchronously and
+                    // fall through to the next candidate when it fails.
+                    bool result;
                     {
-                        // Condition exists: ask Python to evaluate it.
-                        logAction("AWAIT_CONDITION", trans.condition);
-                        pending_transition_ = std::make_unique<Transition>(trans);
-                        return; // Pause C++ execution
+                        ScopedLatency timer(latencyHistogram(FSM_LATENCY_GUARD));
+                        ScopedSpan guard_span(spans_, SpanRecorder::SPAN_GUARD, *edge,
+                                              static_cast<int32_t>(trans.condition_code));
+                        result = guard_fn_(callback_user_data_, static_cast<int>(trans.condition_code));
                     }
+                    if (coverage_enabled_)
+                        coverage_.guardEvaluated(*edge, result);
+                    if (!result)
+                        continue;
+                }
+                else if (trans.condition_code != CompiledModel::kNone)
+                {
+                    // Collect every guarded candidate so the host can
+                    // answer all of them in a single round trip.
+                    pending_candidates_.push_back(*edge);
+                    continue;
+                }
 
-                    // No condition: execute transition immediately.
-                    executeTransition(trans);
-                    transition_taken_this_step = true;
+                // No condition: taken right away unless guarded candidates
+                // declared before it are still waiting for an answer.
+                if (!pending_candidates_.empty())
+                {
+                    pending_fallback_ = *edge;
                     break;
                 }
+                executeTransition(*edge);
+                transition_taken_this_step = true;
+                break;
+            }
+
+            if (!pending_candidates_.empty())
+            {
+                // Conditions exist: ask the host to evaluate them, in order.
+                LogEntry &entry = action_log_.emplace_back("AWAIT_CONDITIONS", -1, std::string_view());
+                for (uint32_t candidate : pending_candidates_)
+                    entry.code_ids.push_back(static_cast<int>(model_->transition(candidate).condition_code));
+                publishState();
+                return; // Pause C++ execution
             }
         }
+        finishStep();
     }
 
+    // Legacy single-answer form: answers the first pending candidate only.
     void resolve_condition(bool result)
     {
+        uint8_t answer = result ? 1 : 0;
+        resolveConditions(&answer, 1);
+    }
+
+    // Takes the first candidate whose guard is true. The unguarded fallback
+    // (if any) is only taken when every pending guard was answered false; the
+    // candidates past a short n were never evaluated, so coverage skips them.
+    // evaluated is false when the engine answered on its own (see
+    // realtimeTick), and then coverage records nothing.
+    void resolveConditions(const uint8_t *results, size_t n, bool evaluated = true)
+    {
+        ScopedLatency timer(latencyHistogram(FSM_LATENCY_STEP));
+        ScopedSpan span(spans_, SpanRecorder::SPAN_RESOLVE, static_cast<uint32_t>(pending_candidates_.size()),
+                        current_tick_);
         action_log_.clear();
-        if (!pending_transition_)
+        if (pending_candidates_.empty())
             return;
 
-        if (result)
+        uint32_t chosen = CompiledModel::kNone;
+        size_t answered = results ? std::min(n, pending_candidates_.size()) : 0;
+        for (size_t i = 0; i < answered && coverage_enabled_ && evaluated; ++i)
+            coverage_.guardEvaluated(pending_candidates_[i], results[i] != 0);
+        for (size_t i = 0; i < answered && chosen == CompiledModel::kNone; ++i)
         {
-            executeTransition(*pending_transition_);
+            if (results[i])
+                chosen = pending_candidates_[i];
+        }
+        if (chosen == CompiledModel::kNone && answered == pending_candidates_.size())
+            chosen = pending_fallback_;
+
+        if (chosen != CompiledModel::kNone)
+        {
+            executeTransition(chosen);
         }
         else
         {
-            logAction("INFO", "Condition failed, transition aborted.");
+            logInfo("Condition failed, transition aborted.");
         }
-        pending_transition_.reset();
+        pending_candidates_.clear();
+        pending_fallback_ = CompiledModel::kNone;
+        finishStep();
     }
 
     void queue_internal_event(const std::string &event_name)
     {
-        internal_event_queue_.push_back(event_name);
+        internal_event_queue_.emplace_back(event_name);
     }
 
     std::string getCurrentStateName() const
     {
         if (current_state_path_.empty())
             return "Halted";
-        return current_state_path_.back()->name;
+        return std::string(model_->stateName(current_state_path_.back()));
     }
 
     std::string getVariablesJson() const
     {
-        json j = variables_;
+        json j = json::object();
+        for (const auto &var : variables_)
+        {
+            j[var.name] = var.toJson();
+        }
         return j.dump();
     }
 
     std::string getAndClearLogJson()
     {
-        json j = action_log_;
+        json j = json::array();
+        for (const auto &entry : action_log_)
+        {
+            json log_entry;
+            log_entry["type"] = entry.type;
+            if (entry.code_id >= 0)
+                log_entry["id"] = entry.code_id;
+            else if (!entry.code_ids.empty())
+                log_entry["ids"] = entry.code_ids;
+            else
+                log_entry["data"] = entry.message;
+            j.push_back(std::move(log_entry));
+        }
         action_log_.clear();
         return j.dump();
     }
 
+    // ID -> source for every action and condition, as a JSON array. IDs are
+    // assigned in order of first appearance (states, then transitions), so
+    // they are stable across reloads of the same model.
+    std::string getCodeTableJson() const
+    {
+        json j = json::array();
+        for (uint32_t id = 0; id < model_->codeCount(); ++id)
+            j.push_back(model_->code(id));
+        return j.dump();
+    }
+
     int getCurrentTick() const { return current_tick_; }
 
-private:
-    void enterState(State *state)
+    // --- Real-time engine thread ---
+    // While the loop runs, the engine thread owns the simulator: hosts may only
+    // post events and read the published state until stopRealtime() returns.
+
+    bool startRealtime(double tick_rate_hz)
     {
-        current_state_path_.push_back(state);
-        executeAction("ENTRY_STATE", state->entry_action);
+        return realtime_loop_.start(tick_rate_hz, [this]
+                                    { realtimeTick(); });
     }
 
-    void executeTransition(const Transition &trans)
+    void stopRealtime() { realtime_loop_.stop(); }
+
+    // Published with the snapshot, for readers while the engine thread runs:
+    // the live counters and variable table may be changing under them.
+    uint64_t sharedChangeVersion() const { return shared_change_version_.load(std::memory_order_acquire); }
+    uint64_t sharedStateVersion() const { return shared_state_version_.load(std::memory_order_acquire); }
+    uint32_t sharedVariableCount() const { return shared_var_count_.load(std::memory_order_acquire); }
+
+    std::string sharedVariableName(int slot) const
     {
-        State *current_leaf_state = current_state_path_.back();
-        executeAction("EXIT_STATE", current_leaf_state->exit_action);
-        executeAction("TRANSITION_ACTION", trans.action);
+        std::lock_guard<std::mutex> lock(shared_names_mutex_);
+        if (slot < 0 || slot >= static_cast<int>(shared_names_.size()))
+            return "";
+        return shared_names_[slot];
+    }
 
-        current_state_path_.pop_back();
+    bool isRealtimeRunning() const { return realtime_loop_.isRunning(); }
+
+    // True when the calling thread may use the simulator directly: either no
+    // engine thread is running, or we *are* the engine thread (callbacks).
+    bool callerOwnsEngine() const { return !realtime_loop_.isRunning() || realtime_loop_.isLoopThread(); }
 
-        State *new_state = state_map_[trans.target];
-        if (new_state)
+    // --- Native callbacks ---
+
+    void setCallbacks(FsmGuardFn guard_fn, FsmActionFn action_fn, void *user_data)
+    {
+        guard_fn_ = guard_fn;
+        action_fn_ = action_fn;
+        callback_user_data_ = user_data;
+    }
+
+    std::string getCodeSource(int code_id) const
+    {
+        if (code_id < 0 || static_cast<uint32_t>(code_id) >= model_->codeCount())
+            return "";
+        return std::string(model_->code(static_cast<uint32_t>(code_id)));
+    }
+
+    bool postEvent(const std::string &event_name)
+    {
+        if (event_name.empty())
+            return false;
+        if (!external_events_.tryPush(event_name))
         {
-            enterState(new_state);
+            dropped_events_.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
+        return true;
+    }
+
+    void getRealtimeStatus(FsmRealtimeStatus *out) const
+    {
+        RealtimeLoop::Stats stats = realtime_loop_.stats();
+        out->running = realtime_loop_.isRunning();
+        out->tick = published_tick_.load(std::memory_order_acquire);
+        out->active_state_id = published_state_id_.load(std::memory_order_acquire);
+        out->loop_ticks = stats.ticks;
+        out->overruns = stats.overruns;
+        out->dropped_events = dropped_events_.load(std::memory_order_relaxed);
+        out->max_lateness_ns = stats.max_lateness_ns;
+    }
+
+    bool readSnapshot(uint64_t last_version, FsmStateSnapshot *out, FsmVarValue *vars, uint32_t var_capacity) const
+    {
+        uint64_t header[SeqlockSnapshot::kHeaderWords];
+        size_t record_words = 0;
+        bool changed = snapshot_.read(header, reinterpret_cast<uint64_t *>(vars),
+                                      vars ? static_cast<size_t>(var_capacity) * kWordsPerVar : 0,
+                                      &record_words, last_version);
+        out->version = header[0];
+        out->tick = header[1];
+        out->active_state_id = static_cast<int32_t>(header[2] >> 32);
+        out->var_count = static_cast<uint32_t>(header[2] & 0xffffffffu);
+        return changed;
+    }
+
+    // --- Binary trace recording ---
+
+    bool openTrace(const std::string &path)
+    {
+        if (!trace_writer_.open(path))
+            return false;
+        trace_event_ids_.clear();
+        traced_var_count_ = 0;
+        trace_steps_since_keyframe_ = 0;
+        traceStateNames();
+        traceVariableNames(0);
+        traceKeyframe();
+        return true;
+    }
+
+    bool closeTrace() { return trace_writer_.close(); }
+    bool isTraceOpen() const { return trace_writer_.isOpen(); }
+
+    void getTraceStats(FsmTraceStats *out) const
+    {
+        TraceWriter::Stats stats = trace_writer_.stats();
+        out->records = stats.records;
+        out->bytes_written = stats.bytes_written;
+        out->bytes_pending = stats.bytes_pending;
+        out->buffer_swaps = stats.swaps;
+        out->write_errors = stats.write_errors;
     }
 
-    void executeAction(const std::string &type, const std::string &code)
+    // --- Coverage counters ---
+
+    void enableCoverage(bool enable)
+    {
+        coverage_enabled_ = enable;
+        sizeCoverage();
+    }
+
+    void clearCoverage()
+    {
+        coverage_.clear();
+        sizeCoverage();
+    }
+
+    uint32_t readCoverage(int32_t kind, uint64_t *out, uint32_t capacity) const
+    {
+        return coverage_.read(kind, out, capacity);
+    }
+
+    // --- Latency histograms ---
+
+    void enableLatency(bool enable) { latency_enabled_ = enable; }
+
+    void resetLatency()
+    {
+        for (LatencyHistogram &histogram : latency_)
+            histogram.reset();
+    }
+
+    // Safe from any thread: the histograms are read through relaxed atomics.
+    void latencyStats(int32_t kind, FsmLatencyStats *out) const
+    {
+        if (kind < 0 || kind >= kLatencyKinds)
+            *out = FsmLatencyStats{};
+        else
+            latency_[kind].stats(out);
+    }
+
+    // --- Span recording ---
+
+    void enableSpans(uint32_t capacity) { spans_.start(capacity); }
+    void clearSpans() { spans_.clear(); }
+    bool dumpSpans(const std::string &path) const { return spans_.writeChromeJson(path, *model_); }
+
+    // --- Flight recorder ---
+
+    void setFlightCapacity(uint32_t capacity)
+    {
+        commitFlightRow();
+        flight_recorder_.resize(capacity);
+    }
+
+    void setFlightDumpPath(const std::string &path) { flight_dump_path_ = path; }
+
+    // Readable from any thread while the engine thread runs, otherwise only
+    // from the owning thread (see fsm_core.h). Names of variables are only
+    // resolved by the owner (the engine thread may be adding slots); others
+    // get "#<slot>".
+    std::string flightRecorderJson(const std::string &reason)
     {
-        if (!code.empty())
+        bool owner = callerOwnsEngine();
+        if (owner)
+            commitFlightRow();
+        std::vector<FlightRecorder::Record> records;
+        uint64_t recorded = flight_recorder_.read(records);
+
+        auto stateName = [&](uint32_t id)
+        { return id < model_->stateCount() ? json(std::string(model_->stateName(id))) : json(); };
+        json steps = json::array();
+        for (const FlightRecorder::Record &r : records)
         {
-            logAction(type, code);
+            json vars = json::object();
+            for (uint32_t i = 0; i < r.storedVars(); ++i)
+            {
+                const trace::TraceVar &var = r.vars[i];
+                std::string name = owner && var.slot < variables_.size() ? variables_[var.slot].name
+                                                                         : "#" + std::to_string(var.slot);
+                if (var.type == FSM_VAR_BOOL)
+                    vars[name] = var.raw != 0;
+                else if (var.type == FSM_VAR_INT)
+                    vars[name] = static_cast<int64_t>(var.raw);
+                else if (var.type == FSM_VAR_REAL)
+                    vars[name] = trace::bitsToDouble(var.raw);
+                else
+                    vars[name] = nullptr; // Only numeric values are recorded
+            }
+            steps.push_back(json{
+                {"tick", r.tick},
+                {"event", r.event < model_->eventCount() ? json(std::string(model_->eventName(r.event))) : json()},
+                {"transition", r.transition == FlightRecorder::kNone ? json() : json(r.transition)},
+                {"source", stateName(r.source)},
+                {"target", stateName(r.target)},
+                {"changed", r.var_count},
+                {"vars", std::move(vars)}});
         }
+        return json{{"reason", reason}, {"steps_recorded", recorded}, {"steps", std::move(steps)}}.dump();
+    }
+
+    bool dumpFlightRecorder(const std::string &path, const std::string &reason)
+    {
+        return flight_recorder_.isEnabled() && writeTextFile(path, flightRecorderJson(reason));
     }
 
-    void logAction(const std::string &type, const std::string &data)
+    // Load errors call this; hosts call it for their breakpoints and
+    // invariant checks. Writes to the configured path, if any.
+    bool triggerFlightDump(const std::string &reason)
     {
-        if (!data.empty())
+        return !flight_dump_path_.empty() && dumpFlightRecorder(flight_dump_path_, reason);
+    }
+
+    // --- Memory accounting ---
+    // Byte counts are capacities held (what the process pays for), not sizes
+    // in use; node-based maps are estimated per node.
+
+    void memoryStats(FsmMemoryStats *out)
+    {
+        FsmMemoryStats m{};
+        CompiledModel::Footprint footprint = model_->footprint();
+        m.model_bytes = model_->size();
+        m.model_string_bytes = footprint.strings;
+        m.model_table_bytes = footprint.tables;
+        m.model_code_bytes = footprint.code;
+        m.editor_bytes = editor_ ? editor_->memoryBytes() : 0;
+
+        m.instance_bytes = vectorBytes(current_state_path_) + vectorBytes(pending_candidates_) +
+                           mapNodeBytes(variable_index_) + vectorBytes(snapshot_records_) + snapshot_.memoryBytes() +
+                           coverage_.memoryBytes() + flight_recorder_.memoryBytes();
+        for (const auto &entry : variable_index_)
+            m.instance_bytes += heapBytes(entry.first);
+        for (const std::vector<Variable> *vars : {&variables_, &initial_variables_})
         {
-            json log_entry;
-            log_entry["type"] = type;
-            log_entry["data"] = data;
-            action_log_.push_back(log_entry.dump());
+            m.instance_bytes += vectorBytes(*vars);
+            for (const Variable &var : *vars)
+                m.instance_bytes += heapBytes(var.name) + heapBytes(var.json_value);
         }
-    }
 
-    std::vector<State> states_;
-    std::map<std::string, State *> state_map_;
-    std::vector<Transition> transitions_;
+        m.queue_bytes = vectorBytes(internal_event_queue_) + external_events_.memoryBytes();
+        for (const std::pmr::string &event : internal_event_queue_)
+            m.queue_bytes += heapBytes(event);
+        m.log_bytes = vectorBytes(action_log_);
+        for (const LogEntry &entry : action_log_)
+            m.log_bytes += heapBytes(entry.message) + vectorBytes(entry.code_ids);
 
-    int current_tick_;
-    std::vector<State *> current_state_path_;
-    std::map<std::string, std::string> variables_;
-    std::map<std::string, std::string> initial_variables_;
-    std::vector<std::string> action_log_;
+        FsmHistoryInfo history;
+        history_.info(&history);
+        m.history_bytes = history.bytes + vectorBytes(history_values_) + vectorBytes(series_ticks_) +
+                          vectorBytes(series_values_);
+        m.trace_bytes = trace_writer_.memoryBytes() + vectorBytes(trace_vars_) + hashNodeBytes(trace_event_ids_) +
+                        spans_.memoryBytes();
+        for (const auto &entry : trace_event_ids_)
+            m.trace_bytes += heapBytes(entry.first);
 
-    std::unique_ptr<Transition> pending_transition_;
-    std::vector<std::string> internal_event_queue_;
-};
+        m.total_bytes = m.model_bytes + m.editor_bytes + m.instance_bytes + m.queue_bytes + m.log_bytes +
+                        m.history_bytes + m.trace_bytes;
 
-// C API Implementation
-FSM_API FSM_HANDLE create_fsm() { return new FsmSimulator(); }
-FSM_API void destroy_fsm(FSM_HANDLE handle) { delete static_cast<FsmSimulator *>(handle); }
+        const CountingResource::Counters &counters = step_memory_.counters();
+        m.allocations = counters.allocations;
+        m.deallocations = counters.deallocations;
+        m.allocated_bytes = counters.bytes_allocated;
+        m.peak_bytes = counters.peak_bytes_in_use;
+        *out = m;
+    }
 
-FSM_API bool load_fsm_from_json(FSM_HANDLE handle, const char *json_string)
-{
-    try
+    // --- Variable history ---
+
+    void enableHistory(bool enable)
     {
-        static_cast<FsmSimulator *>(handle)->loadFromJson(json_string);
-        return true;
+        if (enable && !history_enabled_)
+        {
+            history_.clear();
+            history_row_pending_ = true; // Current values as the first row
+        }
+        else if (!enable)
+        {
+            commitHistoryRow();
+        }
+        history_enabled_ = enable;
     }
-    catch (const std::exception &)
+
+    void getHistoryInfo(FsmHistoryInfo *out)
     {
-        return false;
+        commitHistoryRow();
+        history_.info(out);
     }
-}
 
-FSM_API void set_initial_variables_from_json(FSM_HANDLE handle, const char *json_string)
-{
-    static_cast<FsmSimulator *>(handle)->setInitialVariables(json_string);
-}
+    uint32_t queryHistory(const std::string &var_name, uint64_t tick_from, uint64_t tick_to,
+                          FsmHistoryBucket *out, uint32_t bucket_count)
+    {
+        commitHistoryRow();
+        auto it = variable_index_.find(var_name);
+        if (it == variable_index_.end())
+            return 0;
+        return history_.query(it->second, tick_from, tick_to, out, bucket_count);
+    }
 
-FSM_API void reset_fsm(FSM_HANDLE handle) { static_cast<FsmSimulator *>(handle)->reset(); }
-FSM_API void step(FSM_HANDLE handle, const char *event_name) { static_cast<FsmSimulator *>(handle)->step(event_name ? std::string(event_name) : ""); }
-FSM_API void resolve_condition(FSM_HANDLE handle, bool result) { static_cast<FsmSimulator *>(handle)->resolve_condition(result); }
-FSM_API void queue_internal_event(FSM_HANDLE handle, const char *event_name) { static_cast<FsmSimulator *>(handle)->queue_internal_event(event_name); }
+    size_t downsampleHistory(const std::string &var_name, uint64_t tick_from, uint64_t tick_to, int mode,
+                             size_t max_points, double *out_x, double *out_y)
+    {
+        commitHistoryRow();
+        auto it = variable_index_.find(var_name);
+        if (it == variable_index_.end())
+            return 0;
+        history_.series(it->second, tick_from, tick_to, series_ticks_, series_values_);
 
-char *copy_string_to_c(const std::string &s)
-{
-    char *c_str = new char[s.length() + 1];
-#ifdef _WIN32
-    strcpy_s(c_str, s.length() + 1, s.c_str());
-#else
-    std::strcpy(c_str, s.c_str());
-#endif
-    return c_str;
-}
+        const double *x = series_ticks_.data();
+        const double *y = series_values_.data();
+        size_t n = series_ticks_.size();
+        if (mode == FSM_DOWNSAMPLE_LTTB)
+            return downsample::lttb(x, y, n, max_points, out_x, out_y);
+        if (max_points < 2)
+            return downsample::lttb(x, y, n, max_points, out_x, out_y); // No room for a min/max pair
+        return downsample::minMax(x, y, n, max_points / 2, out_x, out_y);
+    }
 
-FSM_API const char *get_current_state_name(FSM_HANDLE handle)
-{
-    std::string name = static_cast<FsmSimulator *>(handle)->getCurrentStateName();
-    return copy_string_to_c(name);
-}
+    // --- Change tracking ---
 
-FSM_API const char *get_variables_json(FSM_HANDLE handle)
-{
-    std::string vars = static_cast<FsmSimulator *>(handle)->getVariablesJson();
-    return copy_string_to_c(vars);
-}
+    uint64_t getChangeVersion() const { return change_version_; }
+    uint64_t getStateVersion() const { return state_version_; }
+    uint32_t getVariableCount() const { return static_cast<uint32_t>(variables_.size()); }
 
-FSM_API const char *get_and_clear_log_json(FSM_HANDLE handle)
-{
-    std::string log = static_cast<FsmSimulator *>(handle)->getAndClearLogJson();
-    return copy_string_to_c(log);
-}
+    // Writes back a variable modified by host-executed action code. Returns
+    // false if the value is not valid JSON. Unchanged values keep their version.
+    bool setVariableJson(const std::string &name, const std::string &json_value)
+    {
+        json value = json::parse(json_value, nullptr, false);
+        if (value.is_discarded())
+            return false;
+
+        Variable updated = Variable::fromJson(name, value);
+        auto it = variable_index_.find(name);
+        if (it != variable_index_.end())
+        {
+            Variable &var = variables_[it->second];
+            if (var.sameValue(updated))
+                return true;
+            updated.version = ++change_version_;
+            var = std::move(updated);
+            return true;
+        }
+
+        // New slot, e.g. a variable first assigned by an action.
+        updated.version = ++change_version_;
+        variable_index_[name] = static_cast<int>(variables_.size());
+        variables_.push_back(std::move(updated));
+        shared_names_stale_ = true;
+        return true;
+    }
+
+    // Copies the slots modified after since_version into out (up to capacity)
+    // and returns how many there are in total.
+    uint32_t getChangedVars(uint64_t since_version, FsmVarValue *out, uint32_t capacity) const
+    {
+        uint32_t count = 0;
+        for (size_t slot = 0; slot < variables_.size(); ++slot)
+        {
+            if (variables_[slot].version <= since_version)
+                continue;
+            if (out && count < capacity)
+                out[count] = toVarValue(static_cast<int>(slot));
+            ++count;
+        }
+        return count;
+    }
 
-FSM_API int get_current_tick(FSM_HANDLE handle) { return static_cast<FsmSimulator *>(handle)->getCurrentTick(); }
-FSM_API void free_string_memory(char *str) { delete[] str; }
\ No newline at end of file
+    std::string getVariableJson(int slot) const
+    {
+        if (slot < 0 || slot >= static_cast<int>(variables_.size()))
+            return "";
+        return variables_[slot].toJson().dump();
+    }
+
+    std::string getVariableName(int slot) const
+    {
+        if (slot < 0 || slot >= static_cast<int>(variables_.size()))
+            return "";
+        return variables_[slot].name;
+    }
+
+    std::string getStateName(int state_id) const
+    {
+        if (state_id < 0 || static_cast<uint32_t>(state_id) >= model_->stateCount())
+            return "";
+        return std::string(model_->stateName(static_cast<uint32_t>(state_id)));
+    }
+
+private:
+    static constexpr size_t kExternalEventCapacity = 1024;
+    static constexpr uint32_t kTraceKeyframeInterval = 4096;
+    static constexpr size_t kWordsPerVar = sizeof(FsmVarValue) / sizeof(uint64_t);
+    static constexpr int32_t kLatencyKinds = FSM_LATENCY_ACTION + 1;
+    static constexpr size_t kDefaultFlightSteps = 256;
+    static_assert(sizeof(FsmVarValue) % sizeof(uint64_t) == 0, "FsmVarValue must pack into whole words");
+
+    void realtimeTick()
+    {
+        std::string event_name;
+        while (external_events_.tryPop(event_name))
+        {
+            internal_event_queue_.emplace_back(event_name);
+        }
+
+        step("");
+
+        // Without a guard callback nobody can answer a guard synchronously on
+        // the engine thread, so a suspended guarded transition is treated as
+        // failed. No guard ran, so coverage does not count these answers.
+        if (!pending_candidates_.empty())
+        {
+            realtime_false_answers_.assign(pending_candidates_.size(), 0);
+            resolveConditions(realtime_false_answers_.data(), realtime_false_answers_.size(), false);
+        }
+        commitFlightRow(); // No host write-backs to wait for; readers see the tick right away
+    }
+
+    void markStateChanged() { state_version_ = ++change_version_; }
+
+    LatencyHistogram *latencyHistogram(FsmLatencyKind kind) { return latency_enabled_ ? &latency_[kind] : nullptr; }
+
+    // Counters are only allocated while enabled; sizes follow the model.
+    void sizeCoverage()
+    {
+        if (coverage_enabled_)
+            coverage_.resize(model_->stateCount(), model_->transitionCount());
+    }
+
+    int activeStateId() const
+    {
+        if (current_state_path_.empty())
+            return -1;
+        return static_cast<int>(current_state_path_.back());
+    }
+
+    // Called once a step has run to completion (not while suspended on guards).
+    void finishStep()
+    {
+        if (trace_writer_.isOpen())
+            traceStep();
+        history_row_pending_ = history_enabled_;
+        flight_row_.tick = static_cast<uint64_t>(current_tick_);
+        flight_row_.transition = fired_transition_ < 0 ? FlightRecorder::kNone : static_cast<uint32_t>(fired_transition_);
+        flight_row_.target = static_cast<uint32_t>(activeStateId());
+        flight_row_has_event_ = !step_event_.empty();
+        flight_row_pending_ = flight_recorder_.isEnabled();
+        publishState();
+    }
+
+    // Like the history row, the flight record of a step is stored once host
+    // write-backs for it are in. Idle ticks (no event, nothing changed) are
+    // left out so they do not push real activity out of the ring.
+    void commitFlightRow()
+    {
+        if (!flight_row_pending_)
+            return;
+        flight_row_pending_ = false;
+        FlightRecorder::Record &r = flight_row_;
+        r.var_count = 0;
+        for (size_t slot = 0; slot < variables_.size(); ++slot)
+        {
+            if (variables_[slot].version <= flight_change_version_)
+                continue;
+            if (r.var_count < FlightRecorder::kMaxVars)
+                r.vars[r.var_count] = traceVar(slot);
+            ++r.var_count;
+        }
+        flight_change_version_ = change_version_;
+        if (flight_row_has_event_ || r.var_count != 0)
+            flight_recorder_.record(r);
+    }
+
+    // The history row of a step is taken lazily - when the next step starts or
+    // the history is read - so values a log-mode host writes back after step()
+    // returns land in the row of the step that produced them.
+    void commitHistoryRow()
+    {
+        if (!history_row_pending_)
+            return;
+        history_row_pending_ = false;
+        history_values_.resize(variables_.size());
+        for (size_t slot = 0; slot < variables_.size(); ++slot)
+            history_values_[slot] = toVarValue(static_cast<int>(slot));
+        history_.append(static_cast<uint64_t>(current_tick_), history_values_.data(), history_values_.size());
+    }
+
+    void traceName(trace::NameKind kind, uint32_t id, std::string_view name)
+    {
+        trace_writer_.beginRecord(trace::RECORD_NAME);
+        std::vector<uint8_t> &out = trace_writer_.payload();
+        trace::putU8(out, kind);
+        trace::putU32(out, id);
+        trace::putBytes(out, name.data(), name.size());
+        trace_writer_.endRecord();
+    }
+
+    void traceStateNames()
+    {
+        for (uint32_t id = 0; id < model_->stateCount(); ++id)
+            traceName(trace::NAME_STATE, id, model_->stateName(id));
+    }
+
+    void traceVariableNames(size_t first_slot)
+    {
+        for (size_t slot = first_slot; slot < variables_.size(); ++slot)
+            traceName(trace::NAME_VARIABLE, static_cast<uint32_t>(slot), variables_[slot].name);
+        traced_var_count_ = variables_.size();
+    }
+
+    trace::TraceVar traceVar(size_t slot) const
+    {
+        const Variable &var = variables_[slot];
+        uint64_t raw = var.type == FSM_VAR_REAL ? trace::doubleBits(var.real_value) : static_cast<uint64_t>(var.int_value);
+        return trace::TraceVar{static_cast<uint32_t>(slot), static_cast<uint8_t>(var.type), raw};
+    }
+
+    // KEYFRAME: the complete variable set, as a record of its own so readers
+    // can seek to it.
+    void traceKeyframe()
+    {
+        trace_writer_.beginRecord(trace::RECORD_KEYFRAME);
+        std::vector<uint8_t> &out = trace_writer_.payload();
+        trace::putU64(out, static_cast<uint64_t>(current_tick_));
+        trace::putU32(out, static_cast<uint32_t>(activeStateId()));
+        trace::putU32(out, static_cast<uint32_t>(variables_.size()));
+        for (size_t slot = 0; slot < variables_.size(); ++slot)
+        {
+            trace::TraceVar var = traceVar(slot);
+            trace::putU32(out, var.slot);
+            trace::putU8(out, var.type);
+            trace::putU64(out, var.raw);
+        }
+        trace_writer_.endRecord();
+
+        traced_change_version_ = change_version_;
+        trace_steps_since_keyframe_ = 0;
+    }
+
+    void traceStep()
+    {
+        if (variables_.size() > traced_var_count_)
+            traceVariableNames(traced_var_count_);
+
+        int event_id = -1;
+        if (!step_event_.empty())
+        {
+            auto it = trace_event_ids_.find(step_event_);
+            if (it == trace_event_ids_.end())
+            {
+                event_id = static_cast<int>(trace_event_ids_.size());
+                trace_event_ids_.emplace(step_event_, event_id);
+                traceName(trace::NAME_EVENT, static_cast<uint32_t>(event_id), step_event_);
+            }
+            else
+            {
+                event_id = it->second;
+            }
+        }
+
+        // Only the slots modified since the previous record are stored.
+        trace_vars_.clear();
+        for (size_t slot = 0; slot < variables_.size(); ++slot)
+        {
+            if (variables_[slot].version > traced_change_version_)
+                trace_vars_.push_back(traceVar(slot));
+        }
+        trace::TraceStep step{static_cast<uint64_t>(current_tick_), event_id, fired_transition_, activeStateId(), 0, 0};
+        trace_writer_.addStep(step, trace_vars_.data(), trace_vars_.size());
+        traced_change_version_ = change_version_;
+
+        if (++trace_steps_since_keyframe_ >= kTraceKeyframeInterval)
+            traceKeyframe();
+    }
+
+    void publishState()
+    {
+        int state_id = activeStateId();
+        published_state_id_.store(state_id, std::memory_order_release);
+        published_tick_.store(static_cast<uint64_t>(current_tick_), std::memory_order_release);
+        if (shared_names_stale_)
+        {
+            // Rare (new slot or reset), so a lock the readers share is fine here
+            std::lock_guard<std::mutex> lock(shared_names_mutex_);
+            shared_names_.clear();
+            for (const Variable &var : variables_)
+                shared_names_.push_back(var.name);
+            shared_names_stale_ = false;
+        }
+        shared_change_version_.store(change_version_, std::memory_order_release);
+        shared_state_version_.store(state_version_, std::memory_order_release);
+        shared_var_count_.store(static_cast<uint32_t>(variables_.size()), std::memory_order_release);
+
+        // Only repack and bump the snapshot version when something changed.
+        if (published_change_version_ == change_version_ &&
+            snapshot_header_[1] == static_cast<uint64_t>(current_tick_) && snapshot_header_[0] != 0)
+            return;
+        published_change_version_ = change_version_;
+
+        // Variables are packed as FsmVarValue records (three words each).
+        snapshot_records_.resize(variables_.size() * kWordsPerVar);
+        uint64_t *record = snapshot_records_.data();
+        for (size_t slot = 0; slot < variables_.size(); ++slot, record += kWordsPerVar)
+        {
+            FsmVarValue value = toVarValue(static_cast<int>(slot));
+            std::memcpy(record, &value, sizeof(value));
+        }
+
+        snapshot_header_[0] += 1;
+        snapshot_header_[1] = static_cast<uint64_t>(current_tick_);
+        snapshot_header_[2] = (static_cast<uint64_t>(static_cast<uint32_t>(state_id)) << 32) | variables_.size();
+        snapshot_.publish(snapshot_header_, snapshot_records_.data(), snapshot_records_.size());
+    }
+
+    FsmVarValue toVarValue(int slot) const
+    {
+        const Variable &var = variables_[slot];
+        FsmVarValue value;
+        value.slot = slot;
+        value.type = var.type;
+        value.int_value = var.int_value;
+        value.real_value = var.real_value;
+        return value;
+    }
+
+    void enterState(uint32_t state)
+    {
+        current_state_path_.push_back(state);
+        markStateChanged();
+        state_entered_tick_ = current_tick_;
+        if (coverage_enabled_)
+            coverage_.stateVisited(state);
+        executeAction(FSM_ACTION_ENTRY, model_->state(state).entry_code);
+    }
+
+    void executeTransition(uint32_t transition_id)
+    {
+        ScopedSpan span(spans_, SpanRecorder::SPAN_TRANSITION, transition_id, 0);
+        const CompiledModel::TransitionRecord &trans = model_->transition(transition_id);
+        executeAction(FSM_ACTION_EXIT, model_->state(current_state_path_.back()).exit_code);
+        executeAction(FSM_ACTION_TRANSITION, trans.action_code);
+
+        if (coverage_enabled_)
+        {
+            coverage_.stateLeft(current_state_path_.back(), static_cast<uint64_t>(current_tick_ - state_entered_tick_));
+            coverage_.transitionFired(transition_id);
+        }
+        current_state_path_.pop_back();
+        markStateChanged();
+        fired_transition_ = static_cast<int>(transition_id);
+
+        if (trans.target != CompiledModel::kNone)
+        {
+            enterState(trans.target);
+        }
+    }
+
+    void executeAction(FsmActionKind kind, uint32_t code)
+    {
+        if (code == CompiledModel::kNone)
+            return;
+        int code_id = static_cast<int>(code);
+
+        if (action_fn_)
+        {
+            ScopedLatency timer(latencyHistogram(FSM_LATENCY_ACTION));
+            ScopedSpan span(spans_, SpanRecorder::SPAN_ACTION, static_cast<uint32_t>(code_id), kind);
+            action_fn_(callback_user_data_, kind, code_id);
+            return;
+        }
+
+        static const char *const kLogTypes[] = {"ENTRY_STATE", "EXIT_STATE", "TRANSITION_ACTION", "DURING_ACTION"};
+        logCode(kLogTypes[kind], code_id);
+    }
+
+    void logCode(const char *type, int code_id)
+    {
+        action_log_.emplace_back(type, code_id, std::string_view());
+    }
+
+    void logInfo(const std::string &message)
+    {
+        action_log_.emplace_back("INFO", -1, message);
+    }
+
+    std::shared_ptr<const CompiledModel> model_ = CompiledModel::Builder().build(); // Never null
+    std::unique_ptr<ModelEditor> editor_; // Created by the first edit after a load
+    std::string rebind_report_ = "{}";    // Unmapped elements of the last rebind, as JSON
+
+    FsmGuardFn guard_fn_ = nullptr;
+    FsmActionFn action_fn_ = nullptr;
+    void *callback_user_data_ = nullptr;
+
+    int current_tick_;
+    int state_entered_tick_ = 0; // Tick at which the leaf state was entered
+    std::vector<uint32_t> current_state_path_; // State IDs
+    std::vector<Variable> variables_; // Slot index == position
+    std::vector<Variable> initial_variables_;
+    std::map<std::string, int> variable_index_;
+
+    // Change tracking: every modification of the active state or a variable
+    // slot takes the next value of change_version_ and stamps it on the item.
+    uint64_t change_version_ = 0;
+    uint64_t state_version_ = 0;
+    CountingResource step_memory_; // Log and event queue; counters restart on load
+    std::pmr::vector<LogEntry> action_log_{&step_memory_};
+
+    // Guarded candidates awaiting host answers, in declaration order, plus the
+    // first unguarded transition after them (taken if all guards fail).
+    std::vector<uint32_t> pending_candidates_; // Transition IDs
+    uint32_t pending_fallback_ = CompiledModel::kNone;
+    std::pmr::vector<std::pmr::string> internal_event_queue_{&step_memory_};
+
+    RealtimeLoop realtime_loop_;
+    MpscQueue<std::string> external_events_;
+    std::vector<uint8_t> realtime_false_answers_; // realtimeTick scratch, reused so ticks do not allocate
+    std::atomic<uint64_t> dropped_events_{0};
+    std::atomic<uint64_t> published_tick_{0};
+    std::atomic<int> published_state_id_{-1};
+    std::atomic<uint64_t> shared_change_version_{0};
+    std::atomic<uint64_t> shared_state_version_{0};
+    std::atomic<uint32_t> shared_var_count_{0};
+    mutable std::mutex shared_names_mutex_;
+    std::vector<std::string> shared_names_;
+    bool shared_names_stale_ = true;
+
+    CoverageCounters coverage_;
+    bool coverage_enabled_ = true;
+    LatencyHistogram latency_[kLatencyKinds]; // Indexed by FsmLatencyKind
+    bool latency_enabled_ = false;
+    SpanRecorder spans_;
+
+    FlightRecorder flight_recorder_;
+    FlightRecorder::Record flight_row_; // Step in progress
+    bool flight_row_pending_ = false;
+    bool flight_row_has_event_ = false;
+    uint64_t flight_change_version_ = 0;
+    std::string flight_dump_path_; // Written by triggerFlightDump(); empty: no automatic dumps
+
+    // Per-step bookkeeping for the trace
+    std::string step_event_;
+    int fired_transition_ = -1;
+
+    TraceWriter trace_writer_;
+    std::unordered_map<std::string, int> trace_event_ids_;
+    size_t traced_var_count_ = 0;
+    uint64_t traced_change_version_ = 0;
+    uint32_t trace_steps_since_keyframe_ = 0;
+    std::vector<trace::TraceVar> trace_vars_; // Scratch for traceStep
+
+    HistoryStore history_;
+    std::vector<FsmVarValue> history_values_;
+    bool history_enabled_ = false;
+    bool history_row_pending_ = false;
+    std::vector<double> series_ticks_; // Scratch for fsm_history_downsample
+    std::vector<double> series_values_;
+
+    SeqlockSnapshot snapshot_;
+    uint64_t snapshot_header_[SeqlockSnapshot::kHeaderWords] = {0, 0, 0};
+    std::vector<uint64_t> snapshot_records_;
+    uint64_t published_change_version_ = 0;
+};
+
+// C API Implementation
+namespace
+{
+    FsmSimulator *asSim(FSM_HANDLE handle) { return static_cast<FsmSimulator *>(handle); }
+
+    // A model handle owns one reference to the shared, immutable image.
+    using ModelRef = std::shared_ptr<const CompiledModel>;
+    ModelRef &asModel(FSM_MODEL model) { return *static_cast<ModelRef *>(model); }
+    FSM_MODEL newModelHandle(ModelRef model) { return model ? new ModelRef(std::move(model)) : nullptr; }
+
+    // Why the last JSON load on this thread failed, see fsm_get_load_error().
+    thread_local ModelLoadError g_load_error;
+}
+
+FSM_API FSM_HANDLE create_fsm() { return new FsmSimulator(); }
+FSM_API void destroy_fsm(FSM_HANDLE handle) { delete asSim(handle); }
+
+FSM_API bool load_fsm_from_json(FSM_HANDLE handle, const char *json_string)
+{
+    g_load_error = ModelLoadError();
+    if (!json_string || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->loadFromJson(json_string, std::strlen(json_string), &g_load_error);
+}
+
+FSM_API void set_initial_variables_from_json(FSM_HANDLE handle, const char *json_string)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return;
+    asSim(handle)->setInitialVariables(json_string);
+}
+
+FSM_API void reset_fsm(FSM_HANDLE handle)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->reset();
+}
+
+FSM_API void step(FSM_HANDLE handle, const char *event_name)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->step(event_name ? std::string(event_name) : "");
+}
+
+FSM_API void resolve_condition(FSM_HANDLE handle, bool result)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->resolve_condition(result);
+}
+
+FSM_API void fsm_resolve_conditions(FSM_HANDLE handle, const uint8_t *results, size_t n)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->resolveConditions(results, n);
+}
+
+FSM_API void queue_internal_event(FSM_HANDLE handle, const char *event_name)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->queue_internal_event(event_name);
+    else
+        asSim(handle)->postEvent(event_name ? event_name : "");
+}
+
+char *copy_string_to_c(const std::string &s)
+{
+    char *c_str = new char[s.length() + 1];
+#ifdef _WIN32
+    strcpy_s(c_str, s.length() + 1, s.c_str());
+#else
+    std::strcpy(c_str, s.c_str());
+#endif
+    return c_str;
+}
+
+FSM_API const char *get_current_state_name(FSM_HANDLE handle)
+{
+    FsmSimulator *sim = asSim(handle);
+    std::string name;
+    if (!sim->callerOwnsEngine())
+    {
+        FsmRealtimeStatus status;
+        sim->getRealtimeStatus(&status);
+        name = status.active_state_id < 0 ? "Halted" : sim->getStateName(status.active_state_id);
+    }
+    else
+    {
+        name = sim->getCurrentStateName();
+    }
+    return copy_string_to_c(name);
+}
+
+FSM_API const char *get_variables_json(FSM_HANDLE handle)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return copy_string_to_c("{}");
+    std::string vars = asSim(handle)->getVariablesJson();
+    return copy_string_to_c(vars);
+}
+
+FSM_API const char *get_and_clear_log_json(FSM_HANDLE handle)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return copy_string_to_c("[]");
+    std::string log = asSim(handle)->getAndClearLogJson();
+    return copy_string_to_c(log);
+}
+
+FSM_API int get_current_tick(FSM_HANDLE handle)
+{
+    FsmSimulator *sim = asSim(handle);
+    if (!sim->callerOwnsEngine())
+    {
+        FsmRealtimeStatus status;
+        sim->getRealtimeStatus(&status);
+        return static_cast<int>(status.tick);
+    }
+    return sim->getCurrentTick();
+}
+
+FSM_API void free_string_memory(char *str) { delete[] str; }
+
+FSM_API bool fsm_start_realtime(FSM_HANDLE handle, double tick_rate_hz) { return asSim(handle)->startRealtime(tick_rate_hz); }
+FSM_API void fsm_stop_realtime(FSM_HANDLE handle) { asSim(handle)->stopRealtime(); }
+FSM_API bool fsm_is_realtime_running(FSM_HANDLE handle) { return asSim(handle)->isRealtimeRunning(); }
+FSM_API bool fsm_post_event(FSM_HANDLE handle, const char *event_name) { return event_name && asSim(handle)->postEvent(event_name); }
+FSM_API void fsm_get_realtime_status(FSM_HANDLE handle, FsmRealtimeStatus *out)
+{
+    if (out)
+        asSim(handle)->getRealtimeStatus(out);
+}
+
+FSM_API const char *fsm_get_state_name(FSM_HANDLE handle, int state_id)
+{
+    return copy_string_to_c(asSim(handle)->getStateName(state_id));
+}
+
+FSM_API bool fsm_read_snapshot(FSM_HANDLE handle, uint64_t last_version, FsmStateSnapshot *out,
+                               FsmVarValue *vars, uint32_t var_capacity)
+{
+    if (!out)
+        return false;
+    return asSim(handle)->readSnapshot(last_version, out, vars, var_capacity);
+}
+
+FSM_API const char *fsm_get_variable_name(FSM_HANDLE handle, int slot)
+{
+    FsmSimulator *sim = asSim(handle);
+    return copy_string_to_c(sim->callerOwnsEngine() ? sim->getVariableName(slot) : sim->sharedVariableName(slot));
+}
+
+FSM_API uint64_t fsm_get_change_version(FSM_HANDLE handle)
+{
+    FsmSimulator *sim = asSim(handle);
+    return sim->callerOwnsEngine() ? sim->getChangeVersion() : sim->sharedChangeVersion();
+}
+
+FSM_API uint64_t fsm_get_state_version(FSM_HANDLE handle)
+{
+    FsmSimulator *sim = asSim(handle);
+    return sim->callerOwnsEngine() ? sim->getStateVersion() : sim->sharedStateVersion();
+}
+
+FSM_API uint32_t fsm_get_variable_count(FSM_HANDLE handle)
+{
+    FsmSimulator *sim = asSim(handle);
+    return sim->callerOwnsEngine() ? sim->getVariableCount() : sim->sharedVariableCount();
+}
+
+FSM_API uint32_t fsm_get_changed_vars(FSM_HANDLE handle, uint64_t since_version, FsmVarValue *out, uint32_t capacity)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return 0;
+    return asSim(handle)->getChangedVars(since_version, out, capacity);
+}
+
+FSM_API bool fsm_set_variable_json(FSM_HANDLE handle, const char *name, const char *json_value)
+{
+    if (!name || !json_value || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->setVariableJson(name, json_value);
+}
+
+FSM_API const char *fsm_get_variable_json(FSM_HANDLE handle, int slot)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return copy_string_to_c("");
+    return copy_string_to_c(asSim(handle)->getVariableJson(slot));
+}
+
+FSM_API void fsm_set_callbacks(FSM_HANDLE handle, FsmGuardFn guard_fn, FsmActionFn action_fn, void *user_data)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->setCallbacks(guard_fn, action_fn, user_data);
+}
+
+FSM_API const char *fsm_get_code_source(FSM_HANDLE handle, int code_id)
+{
+    return copy_string_to_c(asSim(handle)->getCodeSource(code_id));
+}
+
+FSM_API const char *fsm_get_code_table_json(FSM_HANDLE handle)
+{
+    return copy_string_to_c(asSim(handle)->getCodeTableJson());
+}
+
+FSM_API FSM_MODEL fsm_model_compile_json(const char *json_string)
+{
+    g_load_error = ModelLoadError();
+    if (!json_string)
+        return nullptr;
+    return newModelHandle(modelCache().loadJson(json_string, std::strlen(json_string), &g_load_error));
+}
+
+FSM_API FSM_MODEL fsm_model_compile_file(const char *path)
+{
+    g_load_error = ModelLoadError();
+    if (!path)
+        return nullptr;
+    return newModelHandle(modelCache().loadJsonFile(path, &g_load_error));
+}
+
+FSM_API void fsm_model_cache_configure(uint32_t capacity, const char *directory)
+{
+    modelCache().configure(capacity, directory ? directory : "");
+}
+
+FSM_API void fsm_model_cache_clear() { modelCache().clear(); }
+
+FSM_API void fsm_model_cache_stats(FsmModelCacheStats *out)
+{
+    if (out)
+        modelCache().stats(out);
+}
+
+FSM_API const char *fsm_get_load_error(int64_t *byte_offset)
+{
+    if (byte_offset)
+        *byte_offset = g_load_error.byte_offset;
+    return copy_string_to_c(g_load_error.message);
+}
+
+FSM_API FSM_MODEL fsm_model_open(const char *path)
+{
+    if (!path)
+        return nullptr;
+    return newModelHandle(CompiledModel::openFile(path));
+}
+
+FSM_API bool fsm_model_save(FSM_MODEL model, const char *path) { return path && asModel(model)->save(path); }
+FSM_API void fsm_model_release(FSM_MODEL model) { delete static_cast<ModelRef *>(model); }
+
+FSM_API void fsm_model_info(FSM_MODEL model, FsmModelInfo *out)
+{
+    if (!out)
+        return;
+    const CompiledModel &m = *asModel(model);
+    *out = FsmModelInfo{m.stateCount(), m.transitionCount(), m.eventCount(), m.codeCount(), m.size(), m.isMapped()};
+}
+
+FSM_API bool fsm_load_model(FSM_HANDLE handle, FSM_MODEL model)
+{
+    if (!model || !asSim(handle)->callerOwnsEngine())
+        return false;
+    asSim(handle)->loadModel(asModel(model));
+    return true;
+}
+
+FSM_API bool fsm_rebind(FSM_HANDLE handle, FSM_MODEL new_model, int32_t mapping_policy)
+{
+    if (!new_model || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->rebind(asModel(new_model), mapping_policy);
+}
+
+FSM_API const char *fsm_get_rebind_report(FSM_HANDLE handle)
+{
+    return copy_string_to_c(asSim(handle)->rebindReport());
+}
+
+FSM_API bool fsm_edit_add_state(FSM_HANDLE handle, const char *name, const char *entry_action,
+                                const char *during_action, const char *exit_action, uint32_t flags)
+{
+    if (!name || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.addState(name, entry_action ? entry_action : "",
+                                                             during_action ? during_action : "",
+                                                             exit_action ? exit_action : "", flags) != CompiledModel::kNone; });
+}
+
+FSM_API bool fsm_edit_remove_state(FSM_HANDLE handle, const char *name)
+{
+    if (!name || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.removeState(name); });
+}
+
+FSM_API bool fsm_edit_rename_state(FSM_HANDLE handle, const char *name, const char *new_name)
+{
+    if (!name || !new_name || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.renameState(name, new_name); });
+}
+
+FSM_API bool fsm_edit_set_state_code(FSM_HANDLE handle, const char *name, const char *entry_action,
+                                     const char *during_action, const char *exit_action)
+{
+    if (!name || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.setStateCode(name, entry_action, during_action, exit_action); });
+}
+
+FSM_API bool fsm_edit_set_state_flags(FSM_HANDLE handle, const char *name, uint32_t flags)
+{
+    if (!name || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.setStateFlags(name, flags); });
+}
+
+FSM_API int32_t fsm_edit_add_transition(FSM_HANDLE handle, const char *source, const char *target, const char *event,
+                                        const char *condition, const char *action)
+{
+    if (!source || !target || !asSim(handle)->callerOwnsEngine())
+        return -1;
+    uint32_t id = CompiledModel::kNone;
+    asSim(handle)->applyEdit([&](ModelEditor &editor)
+                             {
+                                 id = editor.addTransition(source, target, event ? event : "",
+                                                           condition ? condition : "", action ? action : "");
+                                 return id != CompiledModel::kNone; });
+    return id == CompiledModel::kNone ? -1 : static_cast<int32_t>(id);
+}
+
+FSM_API bool fsm_edit_remove_transition(FSM_HANDLE handle, int32_t transition_id)
+{
+    if (transition_id < 0 || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.removeTransition(static_cast<uint32_t>(transition_id)); });
+}
+
+FSM_API bool fsm_edit_update_transition(FSM_HANDLE handle, int32_t transition_id, const char *source,
+                                        const char *target, const char *event)
+{
+    if (transition_id < 0 || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.updateTransition(static_cast<uint32_t>(transition_id), source,
+                                                                     target, event); });
+}
+
+FSM_API bool fsm_edit_set_transition_code(FSM_HANDLE handle, int32_t transition_id, const char *condition,
+                                          const char *action)
+{
+    if (transition_id < 0 || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->applyEdit([&](ModelEditor &editor)
+                                    { return editor.setTransitionCode(static_cast<uint32_t>(transition_id), condition,
+                                                                      action); });
+}
+
+FSM_API void fsm_coverage_enable(FSM_HANDLE handle, bool enable)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->enableCoverage(enable);
+}
+
+FSM_API void fsm_coverage_clear(FSM_HANDLE handle)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->clearCoverage();
+}
+
+FSM_API uint32_t fsm_coverage_read(FSM_HANDLE handle, int32_t kind, uint64_t *out, uint32_t capacity)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return 0;
+    return asSim(handle)->readCoverage(kind, out, capacity);
+}
+
+FSM_API void fsm_latency_enable(FSM_HANDLE handle, bool enable)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->enableLatency(enable);
+}
+
+FSM_API void fsm_latency_reset(FSM_HANDLE handle)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->resetLatency();
+}
+
+FSM_API void fsm_latency_stats(FSM_HANDLE handle, int32_t kind, FsmLatencyStats *out)
+{
+    if (out)
+        asSim(handle)->latencyStats(kind, out);
+}
+
+FSM_API void fsm_spans_enable(FSM_HANDLE handle, uint32_t capacity)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->enableSpans(capacity);
+}
+
+FSM_API void fsm_spans_clear(FSM_HANDLE handle)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->clearSpans();
+}
+
+FSM_API bool fsm_spans_dump(FSM_HANDLE handle, const char *path)
+{
+    if (!path || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->dumpSpans(path);
+}
+
+// Not from engine-thread callbacks either: other threads may be reading the
+// ring and the dump path meanwhile.
+FSM_API void fsm_flight_recorder_set_capacity(FSM_HANDLE handle, uint32_t steps)
+{
+    if (!asSim(handle)->isRealtimeRunning())
+        asSim(handle)->setFlightCapacity(steps);
+}
+
+FSM_API void fsm_flight_recorder_set_dump_path(FSM_HANDLE handle, const char *path)
+{
+    if (!asSim(handle)->isRealtimeRunning())
+        asSim(handle)->setFlightDumpPath(path ? path : "");
+}
+
+FSM_API const char *fsm_flight_recorder_json(FSM_HANDLE handle)
+{
+    return copy_string_to_c(asSim(handle)->flightRecorderJson("request"));
+}
+
+FSM_API bool fsm_flight_recorder_dump(FSM_HANDLE handle, const char *path, const char *reason)
+{
+    if (!path)
+        return false;
+    return asSim(handle)->dumpFlightRecorder(path, reason ? reason : "request");
+}
+
+FSM_API bool fsm_flight_recorder_trigger(FSM_HANDLE handle, const char *reason)
+{
+    return asSim(handle)->triggerFlightDump(reason ? reason : "trigger");
+}
+
+FSM_API void fsm_memory_stats(FSM_HANDLE handle, FsmMemoryStats *out)
+{
+    if (!out)
+        return;
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->memoryStats(out);
+    else
+        *out = FsmMemoryStats{};
+}
+
+FSM_API bool fsm_trace_open(FSM_HANDLE handle, const char *path)
+{
+    if (!path || !asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->openTrace(path);
+}
+
+FSM_API bool fsm_trace_close(FSM_HANDLE handle)
+{
+    if (!asSim(handle)->callerOwnsEngine())
+        return false;
+    return asSim(handle)->closeTrace();
+}
+
+FSM_API bool fsm_trace_is_open(FSM_HANDLE handle) { return asSim(handle)->isTraceOpen(); }
+
+FSM_API void fsm_get_trace_stats(FSM_HANDLE handle, FsmTraceStats *out)
+{
+    if (out)
+        asSim(handle)->getTraceStats(out);
+}
+
+FSM_API FSM_TRACE_READER fsm_trace_reader_open(const char *path)
+{
+    if (!path)
+        return nullptr;
+    auto reader = std::make_unique<TraceReader>();
+    if (!reader->open(path))
+        return nullptr;
+    return reader.release();
+}
+
+FSM_API void fsm_trace_reader_close(FSM_TRACE_READER reader) { delete static_cast<TraceReader *>(reader); }
+
+FSM_API void fsm_trace_reader_info(FSM_TRACE_READER reader, FsmTraceInfo *out)
+{
+    if (!out)
+        return;
+    const TraceReader::Info &info = static_cast<TraceReader *>(reader)->info();
+    out->step_count = info.step_count;
+    out->last_tick = info.last_tick;
+    out->run_count = info.run_count;
+    out->keyframe_count = info.keyframe_count;
+    out->indexed = info.indexed;
+}
+
+FSM_API size_t fsm_trace_query_variable(FSM_TRACE_READER reader, int run, const char *var_name,
+                                        uint64_t tick_from, uint64_t tick_to,
+                                        uint64_t *out_ticks, double *out_values, size_t capacity)
+{
+    if (!var_name || (capacity && (!out_ticks || !out_values)))
+        return 0;
+    return static_cast<TraceReader *>(reader)->queryVariable(run, var_name, tick_from, tick_to,
+                                                             out_ticks, out_values, capacity);
+}
+
+FSM_API size_t fsm_trace_query_state_entries(FSM_TRACE_READER reader, int run, const char *state_name,
+                                             uint64_t tick_from, uint64_t tick_to,
+                                             uint64_t *out_ticks, size_t capacity)
+{
+    if (!state_name || (capacity && !out_ticks))
+        return 0;
+    return static_cast<TraceReader *>(reader)->queryStateEntries(run, state_name, tick_from, tick_to,
+                                                                 out_ticks, capacity);
+}
+
+FSM_API void fsm_history_enable(FSM_HANDLE handle, bool enable)
+{
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->enableHistory(enable);
+}
+
+FSM_API void fsm_get_history_info(FSM_HANDLE handle, FsmHistoryInfo *out)
+{
+    if (!out)
+        return;
+    if (asSim(handle)->callerOwnsEngine())
+        asSim(handle)->getHistoryInfo(out);
+    else
+        *out = FsmHistoryInfo{};
+}
+
+FSM_API uint32_t fsm_history_query(FSM_HANDLE handle, const char *var_name, uint64_t tick_from, uint64_t tick_to,
+                                   FsmHistoryBucket *out, uint32_t bucket_count)
+{
+    if (!var_name || !asSim(handle)->callerOwnsEngine())
+        return 0;
+    return asSim(handle)->queryHistory(var_name, tick_from, tick_to, out, bucket_count);
+}
+
+FSM_API size_t fsm_history_downsample(FSM_HANDLE handle, const char *var_name, uint64_t tick_from, uint64_t tick_to,
+                                      int32_t mode, size_t max_points, double *out_x, double *out_y)
+{
+    if (!var_name || !out_x || !out_y || max_points == 0 || !asSim(handle)->callerOwnsEngine())
+        return 0;
+    return asSim(handle)->downsampleHistory(var_name, tick_from, tick_to, mode, max_points, out_x, out_y);
+}
+
+FSM_API size_t fsm_downsample_minmax(const double *x, const double *y, size_t n, size_t buckets,
+                                     double *out_x, double *out_y)
+{
+    if (!x || !y || !out_x || !out_y)
+        return 0;
+    return downsample::minMax(x, y, n, buckets, out_x, out_y);
+}
+
+FSM_API size_t fsm_downsample_lttb(const double *x, const double *y, size_t n, size_t threshold,
+                                   double *out_x, double *out_y)
+{
+    if (!x || !y || !out_x || !out_y)
+        return 0;
+    return downsample::lttb(x, y, n, threshold, out_x, out_y);
+}
@@ -14,9 +14,221 @@
 #define FSM_API
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+
 // Opaque handle to the C++ FsmSimulator object
 typedef void *FSM_HANDLE;
 
+// Opaque handle to a memory-mapped trace file reader
+typedef void *FSM_TRACE_READER;
+
+// Opaque, reference-counted handle to an immutable compiled model (.fsmb)
+typedef void *FSM_MODEL;
+
+// Snapshot of the real-time engine thread, see fsm_get_realtime_status().
+typedef struct
+{
+    bool running;
+    int32_t active_state_id; // -1 when halted
+    uint64_t tick;
+    uint64_t loop_ticks;      // Ticks executed by the loop since start
+    uint64_t overruns;        // Ticks skipped because the engine fell behind
+    uint64_t dropped_events;  // Events rejected because the event queue was full
+    int64_t max_lateness_ns;  // Worst observed wake-up delay past a deadline
+} FsmRealtimeStatus;
+
+// Variable value types. Bools and integers are carried in int_value, floats in
+// real_value; anything else (strings, lists, ...) is only available as JSON.
+enum FsmVarType
+{
+    FSM_VAR_BOOL = 1,
+    FSM_VAR_INT = 2,
+    FSM_VAR_REAL = 3,
+    FSM_VAR_OTHER = 4
+};
+
+typedef struct
+{
+    int32_t slot; // Stable index of the variable, see fsm_get_variable_name()
+    int32_t type; // FsmVarType
+    int64_t int_value;
+    double real_value;
+} FsmVarValue;
+
+// Which action slot an action callback is running for.
+typedef enum
+{
+    FSM_ACTION_ENTRY = 0,
+    FSM_ACTION_EXIT = 1,
+    FSM_ACTION_TRANSITION = 2,
+    FSM_ACTION_DURING = 3
+} FsmActionKind;
+
+// Host callbacks, invoked synchronously by the engine with the code ID of the
+// condition/action (see fsm_get_code_source()). Return true to take the
+// guarded transition.
+typedef bool (*FsmGuardFn)(void *user_data, int32_t condition_id);
+typedef void (*FsmActionFn)(void *user_data, int32_t action_kind, int32_t action_id);
+
+// Counters of the binary trace writer, see fsm_get_trace_stats().
+typedef struct
+{
+    uint64_t records;
+    uint64_t bytes_written; // Handed to the OS by the background writer
+    uint64_t bytes_pending; // Still buffered in memory
+    uint64_t buffer_swaps;
+    uint64_t write_errors; // Failed writes; the file is truncated when nonzero
+} FsmTraceStats;
+
+// Heap footprint of one simulator, see fsm_memory_stats(). Bytes are
+// capacities held, not sizes in use.
+typedef struct
+{
+    uint64_t model_bytes;        // Compiled image (shared by every handle that loaded it; file-backed
+                                 // pages when mapped from a .fsmb), split into the next three
+    uint64_t model_string_bytes; // State and event names
+    uint64_t model_table_bytes;  // State/transition records, CSR edges, name indexes
+    uint64_t model_code_bytes;   // Code table and snippet text
+    uint64_t editor_bytes;       // Working tables kept once the model has been edited live
+    uint64_t instance_bytes;     // Active states, variables, pending guards, snapshot, coverage,
+                                 // flight recorder
+    uint64_t queue_bytes;        // Internal event queue and the external event ring
+    uint64_t log_bytes;          // Step log not yet drained by get_and_clear_log_json()
+    uint64_t history_bytes;      // Variable history columns
+    uint64_t trace_bytes;        // Trace writer buffers and footer index, span ring
+    uint64_t total_bytes;
+    // Allocations by the step log and event queue since the last model load
+    uint64_t allocations;
+    uint64_t deallocations;
+    uint64_t allocated_bytes; // Cumulative
+    uint64_t peak_bytes;      // Highest amount held at once
+} FsmMemoryStats;
+
+// What fsm_latency_stats() reports on.
+typedef enum
+{
+    FSM_LATENCY_STEP = 0,   // One engine call: step(), or answering awaited guards
+    FSM_LATENCY_GUARD = 1,  // A guard callback
+    FSM_LATENCY_ACTION = 2  // An action callback
+} FsmLatencyKind;
+
+// Wall-clock latency distribution, see fsm_latency_stats(). Percentiles are
+// the upper bound of their histogram bucket (within about 3%), capped at max.
+typedef struct
+{
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    double mean_ns;
+} FsmLatencyStats;
+
+// Summary of a trace file, see fsm_trace_reader_info().
+typedef struct
+{
+    uint64_t step_count;
+    uint64_t last_tick;
+    uint32_t run_count; // A new run starts at every reset
+    uint32_t keyframe_count;
+    bool indexed; // False if the footer was missing and the index was rebuilt by scanning
+} FsmTraceInfo;
+
+// One downsampled bucket of a variable's history, see fsm_history_query().
+typedef struct
+{
+    uint64_t tick_first; // First and last tick with a sample in the bucket
+    uint64_t tick_last;
+    double min;
+    double max;
+    double last;    // Value at tick_last
+    uint32_t count; // Samples aggregated
+} FsmHistoryBucket;
+
+// Reduction applied by fsm_history_downsample().
+typedef enum
+{
+    FSM_DOWNSAMPLE_MINMAX = 0, // Min and max per bucket (keeps spikes)
+    FSM_DOWNSAMPLE_LTTB = 1    // Largest-Triangle-Three-Buckets (keeps shape)
+} FsmDownsampleMode;
+
+// Size of the in-memory variable history, see fsm_get_history_info().
+typedef struct
+{
+    uint64_t rows; // One row per completed step
+    uint64_t first_tick;
+    uint64_t last_tick;
+    uint64_t bytes; // Column storage currently allocated
+    uint32_t chunks;
+} FsmHistoryInfo;
+
+// Summary of a compiled model, see fsm_model_info().
+typedef struct
+{
+    uint32_t state_count;
+    uint32_t transition_count;
+    uint32_t event_count;
+    uint32_t code_count; // Distinct action/condition snippets
+    uint64_t image_bytes;
+    bool mapped; // Used in place from a memory-mapped file
+} FsmModelInfo;
+
+// Flags of fsm_edit_add_state() / fsm_edit_set_state_flags().
+typedef enum
+{
+    FSM_STATE_INITIAL = 1, // Entered on reset (the first initial state wins)
+    FSM_STATE_FINAL = 2
+} FsmStateFlags;
+
+// Mapping policy of fsm_rebind(), a combination of flags.
+typedef enum
+{
+    FSM_REBIND_BY_NAME = 0, // Match states by name
+    FSM_REBIND_BY_ID = 1,   // Match states by ID (same declaration order)
+    FSM_REBIND_STRICT = 2   // Fail unless everything maps
+} FsmRebindPolicy;
+
+// Arrays copied by fsm_coverage_read(). Per-transition arrays are indexed by
+// transition ID, the others by state ID.
+typedef enum
+{
+    FSM_COVERAGE_STATE_VISITS = 0,     // Times each state was entered
+    FSM_COVERAGE_TRANSITION_FIRES = 1, // Times each transition was taken
+    FSM_COVERAGE_GUARD_TRUE = 2,       // Guard evaluations per transition, by outcome
+    FSM_COVERAGE_GUARD_FALSE = 3,
+    FSM_COVERAGE_RESIDENCY = 4 // FSM_RESIDENCY_BUCKETS counts per state, state-major
+} FsmCoverageKind;
+
+// Buckets of a residency histogram: bucket 0 counts visits that lasted zero
+// ticks, bucket b counts visits of [2^(b-1), 2^b) ticks; the last bucket
+// takes everything longer.
+#define FSM_RESIDENCY_BUCKETS 32
+
+// Counters of the process-wide compiled-model cache, see fsm_model_cache_stats().
+typedef struct
+{
+    uint32_t entries; // Models held in memory
+    uint32_t capacity;
+    uint64_t raw_hits;      // Byte-identical JSON, reused without parsing
+    uint64_t semantic_hits; // Same logic with different layout/formatting
+    uint64_t disk_hits;     // Mapped from the cache directory
+    uint64_t compiles;
+    uint64_t disk_writes;
+    uint64_t disk_evictions; // Files pruned from the cache directory
+} FsmModelCacheStats;
+
+// Header of the lock-free published state, see fsm_read_snapshot().
+typedef struct
+{
+    uint64_t version; // Increases every time the published content changes
+    uint64_t tick;
+    int32_t active_state_id; // -1 when halted
+    uint32_t var_count;      // Total variables, may exceed what was copied
+} FsmStateSnapshot;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -27,13 +239,23 @@ extern "C"
     FSM_API void destroy_fsm(FSM_HANDLE handle);
 
     // --- Configuration ---
+    // JSON models are streamed (no DOM is built) and only the semantic keys of
+    // states and transitions are read; layout keys are skipped.
     FSM_API bool load_fsm_from_json(FSM_HANDLE handle, const char *json_string);
     FSM_API void set_initial_variables_from_json(FSM_HANDLE handle, const char *json_string);
     FSM_API void reset_fsm(FSM_HANDLE handle);
 
     // --- Simulation ---
     FSM_API void step(FSM_HANDLE handle, const char *event_name);
-    FSM_API void resolve_condition(FSM_HANDLE handle, bool condition_result);
+    // When guarded transitions leave the active state on the stepped event, the
+    // step suspends with one AWAIT_CONDITIONS log entry listing their condition
+    // IDs in declaration order. Answer them all at once: the first true result
+    // wins, and an unguarded transition declared after them is taken only if
+    // all n == len(ids) answers are false. n may stop at the first true answer;
+    // the guards after it count as not evaluated (coverage skips them). A short
+    // n without a true answer aborts the step. Guards should be side-effect free.
+    FSM_API void fsm_resolve_conditions(FSM_HANDLE handle, const uint8_t *results, size_t n);
+    FSM_API void resolve_condition(FSM_HANDLE handle, bool condition_result); // Answers the first candidate only
     FSM_API void queue_internal_event(FSM_HANDLE handle, const char *event_name);
 
     // --- Data Retrieval ---
@@ -41,12 +263,278 @@ extern "C"
     // The caller (Python) is responsible for freeing it with free_string_memory().
     FSM_API const char *get_current_state_name(FSM_HANDLE handle);
     FSM_API const char *get_variables_json(FSM_HANDLE handle);
+    // Log entries are objects: {"type": "ENTRY_STATE", "id": <code ID>} for
+    // actions, {"type": "AWAIT_CONDITIONS", "ids": [...]} for pending guards and
+    // {"type": "INFO", "data": "<text>"} otherwise.
     FSM_API const char *get_and_clear_log_json(FSM_HANDLE handle);
     FSM_API int get_current_tick(FSM_HANDLE handle);
 
+    // --- Compiled Model Cache ---
+    // load_fsm_from_json and fsm_model_compile_* go through a process-wide
+    // cache keyed by a hash of the model's semantic content (layout, key order
+    // and whitespace do not count), so reloading an unchanged diagram reuses
+    // the compiled model. It keeps the `capacity` most recently used models in
+    // memory (default 8, 0 = none) and, when `directory` is non-empty, also
+    // stores them there as <hash>.fsmb files mapped on later loads, by any
+    // process. Hits are verified against a second hash or the compiled image,
+    // file names carry the image and loader versions, and the directory is
+    // pruned to the most recently used files. Safe to call from any thread.
+    FSM_API void fsm_model_cache_configure(uint32_t capacity, const char *directory);
+    FSM_API void fsm_model_cache_clear(void); // Drops the in-memory models and resets the counters
+    FSM_API void fsm_model_cache_stats(FsmModelCacheStats *out);
+
+    // --- Load Errors ---
+    // Why the last load_fsm_from_json / fsm_model_compile_* call made on this
+    // thread failed ("" after a success). byte_offset receives the position of
+    // malformed JSON, or -1 when the document parsed but has the wrong shape
+    // (the message then names the offending element, e.g. "states[3]: ...").
+    FSM_API const char *fsm_get_load_error(int64_t *byte_offset); // Free with free_string_memory()
+
     // --- Memory Management ---
     FSM_API void free_string_memory(char *str);
 
+    // --- Real-Time Engine Thread ---
+    // Optionally hand the simulator to an engine-owned thread that advances one
+    // tick per period at a fixed real-time rate. While it runs, step/reset/load
+    // calls are ignored; events go through the lock-free fsm_post_event() (or
+    // queue_internal_event) and state is read via the published values.
+    // fsm_stop_realtime() is ignored when called from a callback on the
+    // engine thread.
+    FSM_API bool fsm_start_realtime(FSM_HANDLE handle, double tick_rate_hz);
+    FSM_API void fsm_stop_realtime(FSM_HANDLE handle);
+    FSM_API bool fsm_is_realtime_running(FSM_HANDLE handle);
+    FSM_API bool fsm_post_event(FSM_HANDLE handle, const char *event_name); // Safe from any thread
+    FSM_API void fsm_get_realtime_status(FSM_HANDLE handle, FsmRealtimeStatus *out);
+    FSM_API const char *fsm_get_state_name(FSM_HANDLE handle, int state_id); // Free with free_string_memory()
+
+    // --- Published State Snapshot ---
+    // Lock-free, consistent copy of the active state, tick and typed variables,
+    // safe to call from any thread (including while the engine thread runs).
+    // Returns false and copies nothing but the header when the version still
+    // equals last_version; otherwise copies up to var_capacity variables.
+    FSM_API bool fsm_read_snapshot(FSM_HANDLE handle, uint64_t last_version, FsmStateSnapshot *out,
+                                   FsmVarValue *vars, uint32_t var_capacity);
+    FSM_API const char *fsm_get_variable_name(FSM_HANDLE handle, int slot); // Free with free_string_memory()
+
+    // --- Change Tracking ---
+    // Each modification of the active state or of a variable slot takes the
+    // next handle-wide change version. Callers remember the version they last
+    // read and ask only for what moved since then. While the engine thread
+    // runs, the versions and count are those of the last published step, and
+    // fsm_get_changed_vars(), fsm_get_variable_json() and get_variables_json()
+    // return nothing; read the values through fsm_read_snapshot() instead.
+    FSM_API uint64_t fsm_get_change_version(FSM_HANDLE handle);
+    FSM_API uint64_t fsm_get_state_version(FSM_HANDLE handle);
+    FSM_API uint32_t fsm_get_variable_count(FSM_HANDLE handle);
+    // Copies up to capacity slots modified after since_version; returns the total number modified.
+    FSM_API uint32_t fsm_get_changed_vars(FSM_HANDLE handle, uint64_t since_version, FsmVarValue *out, uint32_t capacity);
+    // Writes back a variable changed by host-executed action code (value as JSON).
+    FSM_API bool fsm_set_variable_json(FSM_HANDLE handle, const char *name, const char *json_value);
+    FSM_API const char *fsm_get_variable_json(FSM_HANDLE handle, int slot); // Free with free_string_memory()
+
+    // --- Native Callbacks ---
+    // With callbacks registered the engine never suspends: guards are evaluated
+    // in declaration order (a failing guard falls through to the next candidate)
+    // and actions run in place instead of being logged. Pass NULLs to return to
+    // the log-and-poll protocol. Callbacks may queue events or write variables,
+    // but must not call step/reset/load. They run on the engine thread while
+    // the real-time loop is active.
+    FSM_API void fsm_set_callbacks(FSM_HANDLE handle, FsmGuardFn guard_fn, FsmActionFn action_fn, void *user_data);
+    FSM_API const char *fsm_get_code_source(FSM_HANDLE handle, int code_id); // Free with free_string_memory()
+
+    // --- Code Table ---
+    // Every distinct action/condition snippet gets a stable integer ID at load
+    // time (order of first appearance). Fetch the ID -> source table once per
+    // load as a JSON array, compile each snippet once and dispatch by ID.
+    FSM_API const char *fsm_get_code_table_json(FSM_HANDLE handle); // Free with free_string_memory()
+
+    // --- Compiled Models ---
+    // A diagram compiled once into a flat binary image (layout in
+    // compiled_model.h): interned names, CSR transition lists, the code table
+    // and a string pool, with no diagram layout fields. fsm_model_open() maps a
+    // saved .fsmb read-only and uses it in place, so loading costs one bounds
+    // check pass and the pages are shared by every process that opens it.
+    // Models are immutable; a handle stays valid until released, independently
+    // of the simulators it was loaded into.
+    FSM_API FSM_MODEL fsm_model_compile_json(const char *json_string); // NULL on failure
+    FSM_API FSM_MODEL fsm_model_compile_file(const char *path);        // A .bsm/JSON file, NULL on failure
+    FSM_API FSM_MODEL fsm_model_open(const char *path);                // NULL on failure
+    FSM_API bool fsm_model_save(FSM_MODEL model, const char *path);
+    FSM_API void fsm_model_release(FSM_MODEL model);
+    FSM_API void fsm_model_info(FSM_MODEL model, FsmModelInfo *out);
+    // Same effect as load_fsm_from_json() with the model's source diagram.
+    FSM_API bool fsm_load_model(FSM_HANDLE handle, FSM_MODEL model);
+
+    // --- Hot Swap ---
+    // Moves a running simulator onto another model (e.g. the diagram after a
+    // re-import) without a reset: the active state is mapped by name, or by ID
+    // with FSM_REBIND_BY_ID, and variables, queued events, history and the
+    // open trace carry over. fsm_get_rebind_report() lists what could not be
+    // mapped as {"states": [...], "events": [...]} (active states, and queued
+    // events the new model never handles). By default an unmapped active
+    // state halts the machine; with FSM_REBIND_STRICT the call instead fails
+    // and changes nothing. Also fails while a step awaits guard answers.
+    FSM_API bool fsm_rebind(FSM_HANDLE handle, FSM_MODEL new_model, int32_t mapping_policy); // FsmRebindPolicy flags
+    FSM_API const char *fsm_get_rebind_report(FSM_HANDLE handle); // Free with free_string_memory()
+
+    // --- Live Model Editing ---
+    // Patch the loaded model in place while the simulation keeps its active
+    // state, variables, queued events and history; only an edit that removes
+    // the active state halts it. An edit patches the compiled tables and lays
+    // them out again, tens of microseconds for a 5,000-state model, instead
+    // of a full reload and reset. The loaded model
+    // itself is immutable: an edit gives this handle its own patched copy, so
+    // FSM_MODEL handles and other simulators sharing the model are unaffected.
+    // Transition IDs are declaration order in the loaded diagram, then order of
+    // fsm_edit_add_transition(); state and transition IDs never change. Code
+    // IDs of existing snippets are stable too, and new code gets new IDs, so
+    // refetch fsm_get_code_table_json() after editing code. For the optional
+    // arguments, NULL keeps the current value and "" clears code. Calls fail
+    // (false / -1) when a name is not a live state, a new state name is empty
+    // or taken, a transition ID is unknown or removed, or a step awaits guard
+    // answers.
+    FSM_API bool fsm_edit_add_state(FSM_HANDLE handle, const char *name, const char *entry_action,
+                                    const char *during_action, const char *exit_action, uint32_t flags); // FsmStateFlags
+    FSM_API bool fsm_edit_remove_state(FSM_HANDLE handle, const char *name); // With its transitions
+    FSM_API bool fsm_edit_rename_state(FSM_HANDLE handle, const char *name, const char *new_name);
+    FSM_API bool fsm_edit_set_state_code(FSM_HANDLE handle, const char *name, const char *entry_action,
+                                         const char *during_action, const char *exit_action);
+    FSM_API bool fsm_edit_set_state_flags(FSM_HANDLE handle, const char *name, uint32_t flags);
+    // Returns the new transition's ID, or -1.
+    FSM_API int32_t fsm_edit_add_transition(FSM_HANDLE handle, const char *source, const char *target,
+                                            const char *event, const char *condition, const char *action);
+    FSM_API bool fsm_edit_remove_transition(FSM_HANDLE handle, int32_t transition_id);
+    FSM_API bool fsm_edit_update_transition(FSM_HANDLE handle, int32_t transition_id, const char *source,
+                                            const char *target, const char *event);
+    FSM_API bool fsm_edit_set_transition_code(FSM_HANDLE handle, int32_t transition_id, const char *condition,
+                                              const char *action);
+
+    // --- Coverage Counters ---
+    // Visit, fire and guard-outcome counts plus time-in-state histograms (in
+    // ticks), kept by the engine as it steps. On by default; recording costs
+    // a few increments per step, and residency histograms are only allocated
+    // for states that have been left. A visit still in progress is not in
+    // the histogram yet. Counts accumulate across resets and live edits, and
+    // are cleared by fsm_coverage_clear() or loading (or rebinding to)
+    // another model. Guards count only real evaluations (by a callback or a
+    // host answer); the false results the real-time loop assumes for guards
+    // it cannot ask about are not counted.
+    FSM_API void fsm_coverage_enable(FSM_HANDLE handle, bool enable);
+    FSM_API void fsm_coverage_clear(FSM_HANDLE handle);
+    // Copies up to capacity values of one FsmCoverageKind array and returns
+    // its full length (0 while the engine thread runs).
+    FSM_API uint32_t fsm_coverage_read(FSM_HANDLE handle, int32_t kind, uint64_t *out, uint32_t capacity);
+
+    // --- Latency Histograms ---
+    // Wall-clock time of every engine step and of each guard and action
+    // callback, in log-linear (HDR-style) histograms, for showing that a
+    // hardware-in-the-loop run keeps up with its event rate. Off by default;
+    // when on, each timed section costs two monotonic clock reads. Actions and
+    // guards run by the host from the step log are not timed (the engine never
+    // sees them). Enabling does not clear; fsm_latency_reset() does.
+    // fsm_latency_stats() may be polled from any thread, also while the engine
+    // thread runs.
+    FSM_API void fsm_latency_enable(FSM_HANDLE handle, bool enable);
+    FSM_API void fsm_latency_reset(FSM_HANDLE handle);
+    FSM_API void fsm_latency_stats(FSM_HANDLE handle, int32_t kind, FsmLatencyStats *out); // FsmLatencyKind
+
+    // --- Span Recording ---
+    // Records timed spans of engine activity - steps, guard resolutions,
+    // transitions, and guard and action callbacks - with the thread they ran
+    // on, into a ring of the last `capacity` spans (32 bytes each; 0 stops
+    // recording). fsm_spans_dump() writes them as Chrome trace-event JSON, to
+    // open in chrome://tracing or Perfetto; names are resolved against the
+    // loaded model at dump time. Callbacks show up nested inside the step that
+    // made them. Off by default; starting clears the ring.
+    FSM_API void fsm_spans_enable(FSM_HANDLE handle, uint32_t capacity);
+    FSM_API void fsm_spans_clear(FSM_HANDLE handle);
+    FSM_API bool fsm_spans_dump(FSM_HANDLE handle, const char *path);
+
+    // --- Flight Recorder ---
+    // The last `steps` completed steps (256 by default; 0 turns it off): tick,
+    // event, fired transition, active state before and after, and up to six
+    // of the numeric variables the step changed, with the total changed. Idle
+    // ticks - no event and no variable change - are not recorded.
+    // Recording is a handful of relaxed stores per step into a preallocated
+    // ring, and readers never block the stepping thread. While the engine
+    // thread runs, the JSON, dump and trigger calls are safe from any thread,
+    // and the capacity and dump path are fixed (their setters are ignored,
+    // also from callbacks). When it is stopped, call them from the thread
+    // that steps the simulator, like the rest of this API: they finish the
+    // step in progress and read its variables. Loading another model clears
+    // it. With a dump path set, the ring is written there when a model fails
+    // to load, and whenever the host reports a breakpoint or invariant
+    // violation through fsm_flight_recorder_trigger().
+    FSM_API void fsm_flight_recorder_set_capacity(FSM_HANDLE handle, uint32_t steps);
+    FSM_API void fsm_flight_recorder_set_dump_path(FSM_HANDLE handle, const char *path); // NULL or "" for none
+    // {"reason": ..., "steps_recorded": n, "steps": [...]}; free with free_string_memory().
+    FSM_API const char *fsm_flight_recorder_json(FSM_HANDLE handle);
+    FSM_API bool fsm_flight_recorder_dump(FSM_HANDLE handle, const char *path, const char *reason);
+    // Returns true if a dump was written.
+    FSM_API bool fsm_flight_recorder_trigger(FSM_HANDLE handle, const char *reason);
+
+    // --- Memory Accounting ---
+    // Where a simulator's memory goes, for sizing hosts and catching growth
+    // (e.g. events queued faster than steps consume them). Cost is linear in the number of variables,
+    // queued events and log entries; zeroes while the engine thread runs.
+    FSM_API void fsm_memory_stats(FSM_HANDLE handle, FsmMemoryStats *out);
+
+    // --- Binary Trace Recording ---
+    // Streams every completed step (tick, event, fired transition, resulting
+    // state and changed variables) to a versioned, length-prefixed binary file
+    // (format in trace_format.h), in column-compressed blocks of up to 1024
+    // steps. Encoding happens on the stepping thread; disk writes happen on a
+    // background thread, so stepping never waits for I/O.
+    // fsm_trace_close() blocks until everything recorded is on disk, and
+    // returns false if a write failed (the stats keep the error count until the
+    // next open). The stats and fsm_trace_is_open() may be read from any thread.
+    FSM_API bool fsm_trace_open(FSM_HANDLE handle, const char *path);
+    FSM_API bool fsm_trace_close(FSM_HANDLE handle);
+    FSM_API bool fsm_trace_is_open(FSM_HANDLE handle);
+    FSM_API void fsm_get_trace_stats(FSM_HANDLE handle, FsmTraceStats *out);
+
+    // --- Trace Reader ---
+    // Memory-maps a trace and answers range queries by seeking through the
+    // keyframe index, without reading the rest of the file. run selects the
+    // reset-delimited run (-1 for the last one). Query functions return the
+    // total number of results; at most capacity are copied out.
+    FSM_API FSM_TRACE_READER fsm_trace_reader_open(const char *path); // NULL on failure
+    FSM_API void fsm_trace_reader_close(FSM_TRACE_READER reader);
+    FSM_API void fsm_trace_reader_info(FSM_TRACE_READER reader, FsmTraceInfo *out);
+    // Value at tick_from, then every change up to tick_to (numeric variables only).
+    FSM_API size_t fsm_trace_query_variable(FSM_TRACE_READER reader, int run, const char *var_name,
+                                            uint64_t tick_from, uint64_t tick_to,
+                                            uint64_t *out_ticks, double *out_values, size_t capacity);
+    // Ticks at which the named state was entered.
+    FSM_API size_t fsm_trace_query_state_entries(FSM_TRACE_READER reader, int run, const char *state_name,
+                                                 uint64_t tick_from, uint64_t tick_to,
+                                                 uint64_t *out_ticks, size_t capacity);
+
+    // --- Variable History ---
+    // In-memory columnar record of every numeric variable, one row per
+    // completed step (taken once host write-backs for that step are in).
+    // Enabling clears it, as does every reset. Queries aggregate a tick range
+    // into at most bucket_count equal-width buckets (e.g. one per pixel column)
+    // and return the number of non-empty buckets written.
+    FSM_API void fsm_history_enable(FSM_HANDLE handle, bool enable);
+    FSM_API void fsm_get_history_info(FSM_HANDLE handle, FsmHistoryInfo *out);
+    FSM_API uint32_t fsm_history_query(FSM_HANDLE handle, const char *var_name, uint64_t tick_from, uint64_t tick_to,
+                                       FsmHistoryBucket *out, uint32_t bucket_count);
+    // Samples of a numeric variable in the range reduced to at most max_points
+    // (x = tick). out_x/out_y must hold max_points; returns the count written.
+    FSM_API size_t fsm_history_downsample(FSM_HANDLE handle, const char *var_name, uint64_t tick_from, uint64_t tick_to,
+                                          int32_t mode, size_t max_points, double *out_x, double *out_y);
+
+    // --- Downsampling Kernels ---
+    // Operate on caller arrays (e.g. numpy buffers) and write into caller
+    // arrays, so nothing is copied through intermediate containers. x must be
+    // sorted. min-max writes up to 2 * buckets points, LTTB exactly threshold
+    // (or n when the series is already short enough).
+    FSM_API size_t fsm_downsample_minmax(const double *x, const double *y, size_t n, size_t buckets,
+                                         double *out_x, double *out_y);
+    FSM_API size_t fsm_downsample_lttb(const double *x, const double *y, size_t n, size_t threshold,
+                                       double *out_x, double *out_y);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,197 @@
+
+#include "history_store.h"
+#include <algorithm>
+
+namespace
+{
+    // Accumulates samples into consecutive buckets; ticks arrive in order.
+    class BucketWriter
+    {
+    public:
+        BucketWriter(FsmHistoryBucket *out, uint32_t bucket_count, uint64_t tick_from, uint64_t tick_to)
+            : out_(out), bucket_count_(bucket_count), tick_from_(tick_from),
+              scale_(static_cast<double>(bucket_count) / (static_cast<double>(tick_to - tick_from) + 1.0))
+        {
+        }
+
+        uint64_t bucketOf(uint64_t tick) const
+        {
+            uint64_t bucket = static_cast<uint64_t>(static_cast<double>(tick - tick_from_) * scale_);
+            return std::min<uint64_t>(bucket, bucket_count_ - 1);
+        }
+
+        void add(uint64_t bucket, uint64_t tick_first, uint64_t tick_last, double min, double max, double last,
+                 uint32_t samples)
+        {
+            if (count_ == 0 || bucket != current_)
+            {
+                current_ = bucket;
+                out_[count_++] = FsmHistoryBucket{tick_first, tick_last, min, max, last, samples};
+                return;
+            }
+            FsmHistoryBucket &b = out_[count_ - 1];
+            b.tick_last = tick_last;
+            b.min = std::min(b.min, min);
+            b.max = std::max(b.max, max);
+            b.last = last;
+            b.count += samples;
+        }
+
+        uint32_t count() const { return count_; }
+
+    private:
+        FsmHistoryBucket *out_;
+        uint32_t bucket_count_;
+        uint64_t tick_from_;
+        double scale_;
+        uint32_t count_ = 0;
+        uint64_t current_ = 0;
+    };
+}
+
+void HistoryStore::clear()
+{
+    chunks_.clear();
+    rows_ = 0;
+}
+
+bool HistoryStore::layoutMatches(const Chunk &chunk, const FsmVarValue *values, size_t count) const
+{
+    if (chunk.columns.size() != count)
+        return false;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (chunk.columns[i].type != values[i].type)
+            return false;
+    }
+    return true;
+}
+
+void HistoryStore::startChunk(const FsmVarValue *values, size_t count)
+{
+    chunks_.emplace_back();
+    Chunk &chunk = chunks_.back();
+    chunk.ticks.reserve(kChunkRows);
+    chunk.columns.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Column &column = chunk.columns[i];
+        column.type = values[i].type;
+        if (column.type == FSM_VAR_REAL)
+            column.reals.reserve(kChunkRows);
+        else if (column.numeric())
+            column.ints.reserve(kChunkRows);
+    }
+}
+
+void HistoryStore::append(uint64_t tick, const FsmVarValue *values, size_t count)
+{
+    if (chunks_.empty() || chunks_.back().ticks.size() >= kChunkRows || !layoutMatches(chunks_.back(), values, count))
+        startChunk(values, count);
+
+    Chunk &chunk = chunks_.back();
+    bool first_row = chunk.ticks.empty();
+    chunk.ticks.push_back(tick);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Column &column = chunk.columns[i];
+        if (!column.numeric())
+            continue;
+
+        double value;
+        if (column.type == FSM_VAR_REAL)
+        {
+            column.reals.push_back(values[i].real_value);
+            value = values[i].real_value;
+        }
+        else
+        {
+            column.ints.push_back(values[i].int_value);
+            value = static_cast<double>(values[i].int_value);
+        }
+        column.min = first_row ? value : std::min(column.min, value);
+        column.max = first_row ? value : std::max(column.max, value);
+    }
+    ++rows_;
+}
+
+void HistoryStore::info(FsmHistoryInfo *out) const
+{
+    *out = FsmHistoryInfo{rows_, 0, 0, 0, static_cast<uint32_t>(chunks_.size())};
+    if (chunks_.empty())
+        return;
+    out->first_tick = chunks_.front().ticks.front();
+    out->last_tick = chunks_.back().ticks.back();
+    for (const Chunk &chunk : chunks_)
+    {
+        out->bytes += chunk.ticks.capacity() * sizeof(uint64_t);
+        for (const Column &column : chunk.columns)
+            out->bytes += column.ints.capacity() * sizeof(int64_t) + column.reals.capacity() * sizeof(double);
+    }
+}
+
+uint32_t HistoryStore::query(int slot, uint64_t tick_from, uint64_t tick_to, FsmHistoryBucket *out,
+                             uint32_t bucket_count) const
+{
+    if (slot < 0 || !out || bucket_count == 0 || tick_to < tick_from)
+        return 0;
+
+    BucketWriter writer(out, bucket_count, tick_from, tick_to);
+    auto chunk_it = std::lower_bound(chunks_.begin(), chunks_.end(), tick_from,
+                                     [](const Chunk &chunk, uint64_t tick)
+                                     { return chunk.ticks.back() < tick; });
+
+    for (; chunk_it != chunks_.end() && chunk_it->ticks.front() <= tick_to; ++chunk_it)
+    {
+        const Chunk &chunk = *chunk_it;
+        if (slot >= static_cast<int>(chunk.columns.size()) || !chunk.columns[slot].numeric())
+            continue;
+        const Column &column = chunk.columns[slot];
+        const std::vector<uint64_t> &ticks = chunk.ticks;
+
+        // Whole chunk inside one bucket: the column summary is enough.
+        if (ticks.front() >= tick_from && ticks.back() <= tick_to &&
+            writer.bucketOf(ticks.front()) == writer.bucketOf(ticks.back()))
+        {
+            writer.add(writer.bucketOf(ticks.front()), ticks.front(), ticks.back(), column.min, column.max,
+                       column.at(ticks.size() - 1), static_cast<uint32_t>(ticks.size()));
+            continue;
+        }
+
+        size_t begin = std::lower_bound(ticks.begin(), ticks.end(), tick_from) - ticks.begin();
+        size_t end = std::upper_bound(ticks.begin(), ticks.end(), tick_to) - ticks.begin();
+        for (size_t row = begin; row < end; ++row)
+        {
+            double value = column.at(row);
+            writer.add(writer.bucketOf(ticks[row]), ticks[row], ticks[row], value, value, value, 1);
+        }
+    }
+    return writer.count();
+}
+
+void HistoryStore::series(int slot, uint64_t tick_from, uint64_t tick_to, std::vector<double> &ticks,
+                          std::vector<double> &values) const
+{
+    ticks.clear();
+    values.clear();
+    if (slot < 0 || tick_to < tick_from)
+        return;
+
+    auto chunk_it = std::lower_bound(chunks_.begin(), chunks_.end(), tick_from,
+                                     [](const Chunk &chunk, uint64_t tick)
+                                     { return chunk.ticks.back() < tick; });
+    for (; chunk_it != chunks_.end() && chunk_it->ticks.front() <= tick_to; ++chunk_it)
+    {
+        const Chunk &chunk = *chunk_it;
+        if (slot >= static_cast<int>(chunk.columns.size()) || !chunk.columns[slot].numeric())
+            continue;
+        const Column &column = chunk.columns[slot];
+        size_t begin = std::lower_bound(chunk.ticks.begin(), chunk.ticks.end(), tick_from) - chunk.ticks.begin();
+        size_t end = std::upper_bound(chunk.ticks.begin(), chunk.ticks.end(), tick_to) - chunk.ticks.begin();
+        for (size_t row = begin; row < end; ++row)
+        {
+            ticks.push_back(static_cast<double>(chunk.ticks[row]));
+            values.push_back(column.at(row));
+        }
+    }
+}
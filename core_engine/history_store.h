@@ -0,0 +1,66 @@
+
+#ifndef FSM_HISTORY_STORE_H
+#define FSM_HISTORY_STORE_H
+
+#include "fsm_core.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Columnar in-memory history of variable values, one row per step.
+//
+// Rows are grouped into chunks of up to kChunkRows: a tick column plus one
+// typed column per variable slot (int64 for bools/ints, double for reals,
+// nothing for other types). A chunk has a fixed column layout; when slots are
+// added or change type a new chunk is started. Each column keeps its min/max,
+// so a query whose bucket spans a whole chunk uses the summary instead of
+// visiting the rows.
+class HistoryStore
+{
+public:
+    static constexpr size_t kChunkRows = 4096;
+
+    void clear();
+    bool empty() const { return chunks_.empty(); }
+
+    // Appends one row. values[i] describes slot i; ticks must not decrease.
+    void append(uint64_t tick, const FsmVarValue *values, size_t count);
+
+    void info(FsmHistoryInfo *out) const;
+
+    // Aggregates the column of one slot over [tick_from, tick_to] into
+    // bucket_count equal-width buckets; writes only the non-empty ones.
+    uint32_t query(int slot, uint64_t tick_from, uint64_t tick_to, FsmHistoryBucket *out,
+                   uint32_t bucket_count) const;
+
+    // Copies the raw samples of one slot in [tick_from, tick_to] (cleared first).
+    void series(int slot, uint64_t tick_from, uint64_t tick_to, std::vector<double> &ticks,
+                std::vector<double> &values) const;
+
+private:
+    struct Column
+    {
+        int32_t type = FSM_VAR_OTHER;
+        std::vector<int64_t> ints;  // FSM_VAR_BOOL and FSM_VAR_INT
+        std::vector<double> reals;  // FSM_VAR_REAL
+        double min = 0.0;
+        double max = 0.0;
+
+        bool numeric() const { return type == FSM_VAR_BOOL || type == FSM_VAR_INT || type == FSM_VAR_REAL; }
+        double at(size_t row) const { return type == FSM_VAR_REAL ? reals[row] : static_cast<double>(ints[row]); }
+    };
+
+    struct Chunk
+    {
+        std::vector<uint64_t> ticks;
+        std::vector<Column> columns;
+    };
+
+    bool layoutMatches(const Chunk &chunk, const FsmVarValue *values, size_t count) const;
+    void startChunk(const FsmVarValue *values, size_t count);
+
+    std::vector<Chunk> chunks_;
+    uint64_t rows_ = 0;
+};
+
+#endif // FSM_HISTORY_STORE_H
@@ -0,0 +1,60 @@
+
+#include "latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<uint64_t> &count : counts_)
+        count.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    min_ns_.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::bucketHighest(size_t index)
+{
+    if (index < 2 * kSubBuckets)
+        return index;
+    unsigned shift = static_cast<unsigned>(index / kSubBuckets) - 1;
+    uint64_t lowest = (index % kSubBuckets + kSubBuckets) << shift;
+    return lowest + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::stats(FsmLatencyStats *out) const
+{
+    // Percentiles come from one copy of the buckets, so they agree with each
+    // other even while the recording thread keeps adding samples.
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i)
+    {
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    FsmLatencyStats s{};
+    s.count = total;
+    if (total != 0)
+    {
+        s.max_ns = max_ns_.load(std::memory_order_relaxed);
+        s.min_ns = std::min(min_ns_.load(std::memory_order_relaxed), s.max_ns); // Not set yet by a racing record()
+        uint64_t recorded = count_.load(std::memory_order_relaxed);
+        s.mean_ns = recorded ? static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) / recorded : 0.0;
+
+        const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        uint64_t *results[] = {&s.p50_ns, &s.p90_ns, &s.p99_ns, &s.p999_ns};
+        uint64_t seen = 0;
+        size_t bucket = 0;
+        for (size_t q = 0; q < 4; ++q)
+        {
+            uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantiles[q] * total)));
+            while (seen + counts[bucket] < rank)
+                seen += counts[bucket++];
+            *results[q] = std::min(bucketHighest(bucket), s.max_ns);
+        }
+    }
+    *out = s;
+}
@@ -0,0 +1,86 @@
+
+#ifndef FSM_LATENCY_HISTOGRAM_H
+#define FSM_LATENCY_HISTOGRAM_H
+
+#include "fsm_core.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// HDR-style log-linear histogram of durations in nanoseconds.
+//
+// Values below 2 * kSubBuckets get a bucket each; above that every power of
+// two is split into kSubBuckets linear buckets, so a recorded value is known
+// to within 1/kSubBuckets (about 3%) whatever its magnitude, in a fixed 8 KiB.
+// Values from 2^kMaxExponent ns (about 69 s) up share the last bucket; the
+// exact min and max are kept separately.
+//
+// One thread records, any thread may read: counters are relaxed atomics
+// bumped with a plain load and store (no locked instruction on the step
+// path). A concurrent reader sees each bucket either before or after an
+// update, which is all a monitoring poll needs.
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned kSubBucketBits = 5;
+    static constexpr uint64_t kSubBuckets = uint64_t(1) << kSubBucketBits;
+    static constexpr unsigned kMaxExponent = 36;
+    static constexpr size_t kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram() { reset(); }
+
+    void record(uint64_t ns)
+    {
+        bump(counts_[bucketIndex(ns)], 1);
+        bump(count_, 1);
+        bump(sum_ns_, ns);
+        if (ns < min_ns_.load(std::memory_order_relaxed))
+            min_ns_.store(ns, std::memory_order_relaxed);
+        if (ns > max_ns_.load(std::memory_order_relaxed))
+            max_ns_.store(ns, std::memory_order_relaxed);
+    }
+
+    void reset();
+    void stats(FsmLatencyStats *out) const;
+
+    static size_t bucketIndex(uint64_t ns)
+    {
+        if (ns >= (uint64_t(1) << kMaxExponent))
+            ns = (uint64_t(1) << kMaxExponent) - 1;
+        if (ns < 2 * kSubBuckets)
+            return static_cast<size_t>(ns);
+        unsigned shift = floorLog2(ns) - kSubBucketBits;
+        return static_cast<size_t>((shift + 1) * kSubBuckets + (ns >> shift) - kSubBuckets);
+    }
+
+    // Largest value that lands in the bucket, as HDR histograms report it.
+    static uint64_t bucketHighest(size_t index);
+
+private:
+    static void bump(std::atomic<uint64_t> &counter, uint64_t delta)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    static unsigned floorLog2(uint64_t v)
+    {
+        unsigned log2 = 0;
+        for (unsigned step = 32; step != 0; step >>= 1)
+        {
+            if (v >> step)
+            {
+                v >>= step;
+                log2 += step;
+            }
+        }
+        return log2;
+    }
+
+    std::atomic<uint64_t> counts_[kBucketCount];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_ns_;
+    std::atomic<uint64_t> min_ns_;
+    std::atomic<uint64_t> max_ns_;
+};
+
+#endif // FSM_LATENCY_HISTOGRAM_H
@@ -0,0 +1,399 @@
+
+#include "model_cache.h"
+#include "content_hash.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // A layout edit adds a raw-byte hash per load; older ones are forgotten.
+    constexpr size_t kMaxRawKeysPerEntry = 8;
+
+    // Seed of the second raw-byte hash that confirms a raw-hash hit.
+    constexpr uint64_t kRawCheckSeed = 0x6a09e667f3bcc909ull;
+
+    // Temporaries older than this were left by a writer that died.
+    constexpr std::chrono::hours kStaleTempAge{1};
+
+    // ".v<image version>-<loader version>", part of every cache file name.
+    const std::string &versionTag()
+    {
+        static const std::string tag =
+            ".v" + std::to_string(CompiledModel::kVersion) + "-" + std::to_string(kModelJsonLoaderVersion);
+        return tag;
+    }
+
+    std::string cachePath(const std::string &directory, uint64_t key, const char *extension)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+        return (fs::path(directory) / (name + versionTag() + extension)).string();
+    }
+
+    // <semantic hash>.fsmb holds a compiled image; <raw hash>.ref holds the
+    // semantic hash of a source document and the second hash of its bytes,
+    // so byte-identical input finds its image in a later process without
+    // being parsed.
+    std::string imagePath(const std::string &directory, uint64_t key) { return cachePath(directory, key, ".fsmb"); }
+    std::string refPath(const std::string &directory, uint64_t raw_key) { return cachePath(directory, raw_key, ".ref"); }
+
+    bool sameImage(const CompiledModel &a, const CompiledModel &b)
+    {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size()) == 0;
+    }
+
+    // Marks a file as recently used for pruneDirectory().
+    void touch(const std::string &path)
+    {
+        std::error_code ignored;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ignored);
+    }
+
+    std::string tempPath(const std::string &path)
+    {
+        return path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "-" +
+               std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    }
+
+    // Written under a unique temporary name and renamed into place, so other
+    // processes never map a partially written image.
+    bool saveAtomically(const CompiledModel &model, const std::string &path)
+    {
+        std::string temp = tempPath(path);
+        if (model.save(temp) && std::rename(temp.c_str(), path.c_str()) == 0)
+            return true;
+        std::remove(temp.c_str());
+        return false;
+    }
+
+    std::FILE *openFile(const std::string &path, const char *mode)
+    {
+        std::FILE *file = nullptr;
+#ifdef _WIN32
+        if (fopen_s(&file, path.c_str(), mode) != 0)
+            file = nullptr;
+#else
+        file = std::fopen(path.c_str(), mode);
+#endif
+        return file;
+    }
+
+    // "<semantic hash> <raw check>", both as 16 hex digits.
+    bool readRef(const std::string &path, uint64_t *key, uint64_t *raw_check)
+    {
+        std::FILE *file = openFile(path, "rb");
+        if (!file)
+            return false;
+        char text[34] = {};
+        bool ok = std::fread(text, 1, 33, file) == 33 && text[16] == ' ';
+        std::fclose(file);
+        text[16] = '\0';
+        char *end = nullptr;
+        *key = std::strtoull(text, &end, 16);
+        ok = ok && end == text + 16;
+        *raw_check = std::strtoull(text + 17, &end, 16);
+        return ok && end == text + 33;
+    }
+
+    bool writeRef(const std::string &path, uint64_t key, uint64_t raw_check)
+    {
+        std::string temp = tempPath(path);
+        std::FILE *file = openFile(temp, "wb");
+        if (!file)
+            return false;
+        bool ok = std::fprintf(file, "%016llx %016llx\n", static_cast<unsigned long long>(key),
+                               static_cast<unsigned long long>(raw_check)) > 0;
+        ok = std::fclose(file) == 0 && ok && std::rename(temp.c_str(), path.c_str()) == 0;
+        if (!ok)
+            std::remove(temp.c_str());
+        return ok;
+    }
+
+    // Cache files are named <16 hex digits>.<...>.fsmb or .ref, plus a .tmp
+    // suffix while being written; anything else in the directory is left alone.
+    bool isCacheFileName(const std::string &name)
+    {
+        if (name.size() <= 16 || name[16] != '.')
+            return false;
+        for (size_t i = 0; i < 16; ++i)
+        {
+            if (!std::isxdigit(static_cast<unsigned char>(name[i])))
+                return false;
+        }
+        return name.find(".fsmb") != std::string::npos || name.find(".ref") != std::string::npos;
+    }
+
+    bool endsWith(const std::string &s, const std::string &suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Removes cache files of other versions and stale temporaries, then the
+    // least recently used images and refs beyond the limits (the newest image
+    // is always kept). Other processes may be pruning too, so errors are
+    // ignored. Returns the number of files removed.
+    uint64_t pruneDirectory(const std::string &directory, size_t max_images, uint64_t max_bytes, size_t max_refs)
+    {
+        struct CacheFile
+        {
+            fs::path path;
+            fs::file_time_type time;
+            uintmax_t size;
+        };
+        const std::string image_suffix = versionTag() + ".fsmb";
+        const std::string ref_suffix = versionTag() + ".ref";
+        const fs::file_time_type now = fs::file_time_type::clock::now();
+
+        std::vector<CacheFile> images;
+        std::vector<CacheFile> refs;
+        uint64_t removed = 0;
+        std::error_code ec;
+        for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec))
+        {
+            std::string name = it->path().filename().string();
+            std::error_code file_ec;
+            fs::file_time_type time = it->last_write_time(file_ec);
+            if (file_ec || !isCacheFileName(name))
+                continue;
+            if (endsWith(name, image_suffix))
+                images.push_back(CacheFile{it->path(), time, it->file_size(file_ec)});
+            else if (endsWith(name, ref_suffix))
+                refs.push_back(CacheFile{it->path(), time, 0});
+            else if (name.find(".tmp") == std::string::npos || now - time > kStaleTempAge)
+                removed += fs::remove(it->path(), file_ec) ? 1 : 0;
+        }
+
+        auto newestFirst = [](const CacheFile &a, const CacheFile &b)
+        { return a.time > b.time; };
+        std::sort(images.begin(), images.end(), newestFirst);
+        std::sort(refs.begin(), refs.end(), newestFirst);
+
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            bytes += images[i].size;
+            if (i > 0 && (i >= max_images || bytes > max_bytes))
+                removed += fs::remove(images[i].path, ec) ? 1 : 0;
+        }
+        for (size_t i = max_refs; i < refs.size(); ++i)
+            removed += fs::remove(refs[i].path, ec) ? 1 : 0;
+        return removed;
+    }
+}
+
+void ModelCache::configure(size_t capacity, const std::string &directory)
+{
+    if (!directory.empty())
+    {
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    directory_ = directory;
+    while (entries_.size() > capacity_)
+        evictLocked();
+}
+
+void ModelCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    by_key_.clear();
+    raw_to_key_.clear();
+    stats_ = FsmModelCacheStats{};
+}
+
+void ModelCache::stats(FsmModelCacheStats *out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    *out = stats_;
+    out->entries = static_cast<uint32_t>(entries_.size());
+    out->capacity = static_cast<uint32_t>(capacity_);
+}
+
+std::shared_ptr<const CompiledModel> ModelCache::loadJson(const char *data, size_t size, ModelLoadError *error)
+{
+    bool disabled;
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        disabled = capacity_ == 0 && directory_.empty();
+        stats_.compiles += disabled ? 1 : 0;
+        directory = directory_;
+    }
+    if (disabled)
+        return loadModelJson(data, size, error);
+
+    ContentHash raw;
+    ContentHash raw_check_hash(kRawCheckSeed);
+    raw.bytes(data, size);
+    raw_check_hash.bytes(data, size);
+    uint64_t raw_key = raw.digest();
+    uint64_t raw_check = raw_check_hash.digest();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = raw_to_key_.find(raw_key);
+        if (it != raw_to_key_.end() && it->second.check == raw_check)
+        {
+            if (auto model = findLocked(it->second.key))
+            {
+                ++stats_.raw_hits;
+                return model;
+            }
+        }
+    }
+
+    // Input seen by an earlier process: its .ref names the compiled image.
+    uint64_t key;
+    uint64_t ref_check;
+    std::string ref = directory.empty() ? std::string() : refPath(directory, raw_key);
+    if (!ref.empty() && readRef(ref, &key, &ref_check) && ref_check == raw_check)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto model = findLocked(key))
+            {
+                ++stats_.semantic_hits;
+                insertLocked(key, raw_key, raw_check, model);
+                return model;
+            }
+        }
+        std::string image = imagePath(directory, key);
+        if (auto model = CompiledModel::openFile(image))
+        {
+            touch(ref);
+            touch(image);
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.disk_hits;
+            insertLocked(key, raw_key, raw_check, model);
+            return model;
+        }
+    }
+
+    // One SAX pass both compiles and computes the semantic key.
+    auto model = loadModelJson(data, size, error, &key);
+    if (!model)
+        return nullptr;
+
+    // An image already stored under this key is only referenced if it holds
+    // exactly what was just compiled; if not, the key collided and the
+    // directory is left as it is.
+    bool written = false;
+    uint64_t evicted = 0;
+    if (!directory.empty())
+    {
+        std::string image = imagePath(directory, key);
+        auto existing = CompiledModel::openFile(image);
+        bool stored = existing ? sameImage(*existing, *model) : saveAtomically(*model, image);
+        written = stored && writeRef(ref, key, raw_check);
+        if (written)
+        {
+            touch(image);
+            evicted = pruneDirectory(directory, kMaxDiskImages, kMaxDiskBytes, kMaxDiskRefs);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.disk_writes += written ? 1 : 0;
+    stats_.disk_evictions += evicted;
+    if (auto cached = findLocked(key))
+    {
+        if (!sameImage(*cached, *model))
+        {
+            ++stats_.compiles; // Key collision: the cached model keeps the slot
+            return model;
+        }
+        // Same logic as a model already in memory: share that one.
+        ++stats_.semantic_hits;
+        model = cached;
+    }
+    else
+    {
+        ++stats_.compiles;
+    }
+    insertLocked(key, raw_key, raw_check, model);
+    return model;
+}
+
+std::shared_ptr<const CompiledModel> ModelCache::loadJsonFile(const std::string &path, ModelLoadError *error)
+{
+    MappedFile file;
+    if (!file.open(path))
+    {
+        if (error)
+            *error = ModelLoadError{"cannot read " + path, -1};
+        return nullptr;
+    }
+    return loadJson(reinterpret_cast<const char *>(file.data()), file.size(), error);
+}
+
+std::shared_ptr<const CompiledModel> ModelCache::findLocked(uint64_t key)
+{
+    auto it = by_key_.find(key);
+    if (it == by_key_.end())
+        return nullptr;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->model;
+}
+
+void ModelCache::insertLocked(uint64_t key, uint64_t raw_key, uint64_t raw_check,
+                              std::shared_ptr<const CompiledModel> model)
+{
+    if (capacity_ == 0)
+        return;
+
+    auto it = by_key_.find(key);
+    if (it == by_key_.end())
+    {
+        entries_.push_front(Entry{key, std::move(model), {}});
+        it = by_key_.emplace(key, entries_.begin()).first;
+    }
+    else
+    {
+        entries_.splice(entries_.begin(), entries_, it->second);
+    }
+
+    Entry &entry = *it->second;
+    auto raw_it = raw_to_key_.find(raw_key);
+    if (raw_it == raw_to_key_.end() || raw_it->second.key != key || raw_it->second.check != raw_check)
+    {
+        raw_to_key_[raw_key] = RawRef{key, raw_check};
+        entry.raw_keys.push_back(raw_key);
+        if (entry.raw_keys.size() > kMaxRawKeysPerEntry)
+        {
+            forgetRawKeyLocked(entry.raw_keys.front(), key);
+            entry.raw_keys.erase(entry.raw_keys.begin());
+        }
+    }
+
+    while (entries_.size() > capacity_)
+        evictLocked();
+}
+
+void ModelCache::evictLocked()
+{
+    const Entry &victim = entries_.back();
+    for (uint64_t raw_key : victim.raw_keys)
+        forgetRawKeyLocked(raw_key, victim.key);
+    by_key_.erase(victim.key);
+    entries_.pop_back();
+}
+
+// A raw key may have been re-pointed at a newer entry since it was recorded.
+void ModelCache::forgetRawKeyLocked(uint64_t raw_key, uint64_t key)
+{
+    auto it = raw_to_key_.find(raw_key);
+    if (it != raw_to_key_.end() && it->second.key == key)
+        raw_to_key_.erase(it);
+}
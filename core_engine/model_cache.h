@@ -0,0 +1,85 @@
+
+#ifndef FSM_MODEL_CACHE_H
+#define FSM_MODEL_CACHE_H
+
+#include "compiled_model.h"
+#include "fsm_core.h"
+#include "model_json_loader.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide cache of compiled models keyed by the semantic hash of their
+// JSON source (see loadModelJson), so reloading a diagram reuses the compiled
+// image instead of re-parsing and re-compiling it.
+//
+// Lookup order:
+//   1. hash of the raw bytes against the in-memory LRU: identical input is
+//      recognised without parsing;
+//   2. with a cache directory, <raw hash>.ref names the semantic hash of input
+//      seen by an earlier process, whose <hash>.fsmb is mapped in place;
+//   3. otherwise one SAX pass compiles and hashes. If the semantic hash is
+//      already cached (a layout-only edit) the cached model is shared; new
+//      images and refs are written atomically (temp file + rename).
+//
+// The hashes are not cryptographic, so no hit is taken on the hash alone: a
+// raw-hash hit must also match a second, independently seeded hash of the
+// bytes (kept in memory and in the .ref), and a semantic-hash hit must have a
+// byte-identical compiled image; a mismatch is compiled and left uncached.
+// File names carry CompiledModel::kVersion and kModelJsonLoaderVersion, and
+// every disk write prunes the directory: files of other versions, stale
+// temporaries, then the least recently used images and refs beyond
+// kMaxDiskImages / kMaxDiskBytes / kMaxDiskRefs. All methods are thread-safe;
+// parsing and compiling run outside the lock.
+class ModelCache
+{
+public:
+    static constexpr size_t kDefaultCapacity = 8;
+    static constexpr size_t kMaxDiskImages = 64;
+    static constexpr uint64_t kMaxDiskBytes = 256ull << 20;
+    static constexpr size_t kMaxDiskRefs = 1024;
+
+    // capacity 0 keeps nothing in memory; an empty directory disables the disk tier.
+    void configure(size_t capacity, const std::string &directory);
+    void clear();
+    void stats(FsmModelCacheStats *out) const;
+
+    std::shared_ptr<const CompiledModel> loadJson(const char *data, size_t size, ModelLoadError *error);
+    std::shared_ptr<const CompiledModel> loadJsonFile(const std::string &path, ModelLoadError *error);
+
+private:
+    struct Entry
+    {
+        uint64_t key; // Semantic hash
+        std::shared_ptr<const CompiledModel> model;
+        std::vector<uint64_t> raw_keys; // Raw-byte hashes that resolved to this entry
+    };
+    using EntryList = std::list<Entry>;
+
+    struct RawRef
+    {
+        uint64_t key;   // Semantic hash
+        uint64_t check; // Second hash of the raw bytes
+    };
+
+    // Callers hold mutex_.
+    std::shared_ptr<const CompiledModel> findLocked(uint64_t key);
+    void insertLocked(uint64_t key, uint64_t raw_key, uint64_t raw_check, std::shared_ptr<const CompiledModel> model);
+    void evictLocked();
+    void forgetRawKeyLocked(uint64_t raw_key, uint64_t key);
+
+    mutable std::mutex mutex_;
+    size_t capacity_ = kDefaultCapacity;
+    std::string directory_;
+    EntryList entries_; // Most recently used first
+    std::unordered_map<uint64_t, EntryList::iterator> by_key_;
+    std::unordered_map<uint64_t, RawRef> raw_to_key_;
+    FsmModelCacheStats stats_{};
+};
+
+#endif // FSM_MODEL_CACHE_H
@@ -0,0 +1,288 @@
+
+#include "model_editor.h"
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    constexpr uint32_t kNone = CompiledModel::kNone;
+    constexpr uint32_t kEditableFlags = CompiledModel::STATE_INITIAL | CompiledModel::STATE_FINAL;
+}
+
+ModelEditor::ModelEditor(const CompiledModel &model) : tables_(model.tables())
+{
+    for (uint32_t id = 0; id < tables_.code.size(); ++id)
+        code_ids_.emplace(std::string(string(tables_.code[id])), id);
+}
+
+// --- States ---
+
+uint32_t ModelEditor::addState(std::string_view name, std::string_view entry, std::string_view during,
+                               std::string_view exit, uint32_t flags)
+{
+    if (name.empty() || findState(name) != kNone)
+        return kNone;
+    uint32_t id = static_cast<uint32_t>(tables_.states.size());
+    CompiledModel::StateRecord record;
+    record.name = appendString(name);
+    record.entry_code = internCode(entry);
+    record.during_code = internCode(during);
+    record.exit_code = internCode(exit);
+    record.flags = flags & kEditableFlags;
+    tables_.states.push_back(record);
+    tables_.edge_offsets.push_back(tables_.edge_offsets.back());
+    indexState(id);
+    tables_.initial_state = tables_.firstInitialState();
+    return id;
+}
+
+bool ModelEditor::removeState(std::string_view name)
+{
+    uint32_t id = findState(name);
+    if (id == kNone)
+        return false;
+    for (uint32_t t = 0; t < tables_.transitions.size(); ++t)
+    {
+        if (tables_.transitions[t].source == id || tables_.transitions[t].target == id)
+            detachTransition(t);
+    }
+    tables_.states[id].flags |= CompiledModel::STATE_REMOVED;
+    tables_.initial_state = tables_.firstInitialState();
+    return true;
+}
+
+bool ModelEditor::renameState(std::string_view name, std::string_view new_name)
+{
+    uint32_t id = findState(name);
+    if (id == kNone || new_name.empty() || findState(new_name) != kNone)
+        return false;
+    unindexState(id);
+    tables_.states[id].name = appendString(new_name);
+    indexState(id);
+    return true;
+}
+
+bool ModelEditor::setStateCode(std::string_view name, const char *entry, const char *during, const char *exit)
+{
+    uint32_t id = findState(name);
+    if (id == kNone)
+        return false;
+    CompiledModel::StateRecord &record = tables_.states[id];
+    if (entry)
+        record.entry_code = internCode(entry);
+    if (during)
+        record.during_code = internCode(during);
+    if (exit)
+        record.exit_code = internCode(exit);
+    return true;
+}
+
+bool ModelEditor::setStateFlags(std::string_view name, uint32_t flags)
+{
+    uint32_t id = findState(name);
+    if (id == kNone)
+        return false;
+    tables_.states[id].flags = flags & kEditableFlags;
+    tables_.initial_state = tables_.firstInitialState();
+    return true;
+}
+
+// --- Transitions ---
+
+uint32_t ModelEditor::addTransition(std::string_view source, std::string_view target, std::string_view event,
+                                    std::string_view condition, std::string_view action)
+{
+    uint32_t source_id = findState(source);
+    uint32_t target_id = findState(target);
+    if (source_id == kNone || target_id == kNone)
+        return kNone;
+    uint32_t id = static_cast<uint32_t>(tables_.transitions.size());
+    tables_.transitions.push_back(CompiledModel::TransitionRecord{source_id, target_id, internEvent(event),
+                                                                  internCode(condition), internCode(action)});
+    linkEdge(id);
+    return id;
+}
+
+bool ModelEditor::removeTransition(uint32_t id)
+{
+    if (!isLiveTransition(id))
+        return false;
+    detachTransition(id);
+    return true;
+}
+
+bool ModelEditor::updateTransition(uint32_t id, const char *source, const char *target, const char *event)
+{
+    if (!isLiveTransition(id))
+        return false;
+    uint32_t source_id = source ? findState(source) : tables_.transitions[id].source;
+    uint32_t target_id = target ? findState(target) : tables_.transitions[id].target;
+    if ((source && source_id == kNone) || (target && target_id == kNone))
+        return false;
+
+    CompiledModel::TransitionRecord &record = tables_.transitions[id];
+    if (source_id != record.source)
+    {
+        unlinkEdge(id);
+        record.source = source_id;
+        linkEdge(id);
+    }
+    record.target = target_id;
+    if (event)
+        record.event = internEvent(event);
+    return true;
+}
+
+bool ModelEditor::setTransitionCode(uint32_t id, const char *condition, const char *action)
+{
+    if (!isLiveTransition(id))
+        return false;
+    CompiledModel::TransitionRecord &record = tables_.transitions[id];
+    if (condition)
+        record.condition_code = internCode(condition);
+    if (action)
+        record.action_code = internCode(action);
+    return true;
+}
+
+// --- Tables ---
+
+size_t ModelEditor::memoryBytes() const
+{
+    const CompiledModel::Tables &t = tables_;
+    size_t bytes = t.states.capacity() * sizeof(CompiledModel::StateRecord) +
+                   t.transitions.capacity() * sizeof(CompiledModel::TransitionRecord) + t.string_pool.capacity() +
+                   (t.edge_offsets.capacity() + t.edges.capacity() + t.events.capacity() + t.code.capacity() +
+                    t.state_index.capacity() + t.event_index.capacity() + t.string_offsets.capacity()) *
+                       sizeof(uint32_t);
+    // A tree node is the value plus three links and a color word; the key
+    // duplicates the snippet text.
+    for (const auto &entry : code_ids_)
+        bytes += sizeof(entry) + 4 * sizeof(void *) + entry.first.capacity() + 1;
+    return bytes;
+}
+
+std::string_view ModelEditor::string(uint32_t id) const
+{
+    uint32_t begin = tables_.string_offsets[id];
+    return std::string_view(tables_.string_pool.data() + begin, tables_.string_offsets[id + 1] - begin - 1);
+}
+
+// A removed transition keeps its record, detached from both states.
+bool ModelEditor::isLiveTransition(uint32_t id) const
+{
+    return id < tables_.transitions.size() && tables_.transitions[id].source != kNone;
+}
+
+// Same rule as CompiledModel::findState: the last live state with the name.
+uint32_t ModelEditor::findState(std::string_view name) const
+{
+    const std::vector<uint32_t> &index = tables_.state_index;
+    auto it = std::upper_bound(index.begin(), index.end(), name, [&](std::string_view key, uint32_t id)
+                               { return key < stateName(id); });
+    for (; it != index.begin() && stateName(*(it - 1)) == name; --it)
+    {
+        if (!(tables_.states[*(it - 1)].flags & CompiledModel::STATE_REMOVED))
+            return *(it - 1);
+    }
+    return kNone;
+}
+
+uint32_t ModelEditor::appendString(std::string_view s)
+{
+    uint32_t id = static_cast<uint32_t>(tables_.string_offsets.size() - 1);
+    tables_.string_pool.insert(tables_.string_pool.end(), s.begin(), s.end());
+    tables_.string_pool.push_back('\0');
+    tables_.string_offsets.push_back(static_cast<uint32_t>(tables_.string_pool.size()));
+    return id;
+}
+
+uint32_t ModelEditor::internEvent(std::string_view name)
+{
+    std::vector<uint32_t> &index = tables_.event_index;
+    auto it = std::lower_bound(index.begin(), index.end(), name, [&](uint32_t id, std::string_view key)
+                               { return string(tables_.events[id]) < key; });
+    if (it != index.end() && string(tables_.events[*it]) == name)
+        return *it;
+    uint32_t id = static_cast<uint32_t>(tables_.events.size());
+    tables_.events.push_back(appendString(name));
+    index.insert(it, id);
+    return id;
+}
+
+uint32_t ModelEditor::internCode(std::string_view code)
+{
+    if (code.empty())
+        return kNone;
+    auto it = code_ids_.find(code);
+    if (it != code_ids_.end())
+        return it->second;
+    uint32_t id = static_cast<uint32_t>(tables_.code.size());
+    tables_.code.push_back(appendString(code));
+    code_ids_.emplace(std::string(code), id);
+    return id;
+}
+
+// The state index is ordered by (name, ID), as the builder's stable sort left it.
+void ModelEditor::indexState(uint32_t id)
+{
+    std::vector<uint32_t> &index = tables_.state_index;
+    std::string_view name = stateName(id);
+    auto it = std::upper_bound(index.begin(), index.end(), id, [&](uint32_t key, uint32_t other)
+                               {
+                                   std::string_view other_name = stateName(other);
+                                   return name < other_name || (name == other_name && key < other);
+                               });
+    index.insert(it, id);
+}
+
+void ModelEditor::unindexState(uint32_t id)
+{
+    std::vector<uint32_t> &index = tables_.state_index;
+    std::string_view name = stateName(id);
+    auto it = std::lower_bound(index.begin(), index.end(), id, [&](uint32_t other, uint32_t key)
+                               {
+                                   std::string_view other_name = stateName(other);
+                                   return other_name < name || (other_name == name && other < key);
+                               });
+    if (it != index.end() && *it == id)
+        index.erase(it);
+}
+
+// Edge slices stay in ascending transition ID (declaration) order, which is
+// the order guards are tried in.
+void ModelEditor::linkEdge(uint32_t id)
+{
+    uint32_t source = tables_.transitions[id].source;
+    if (source == kNone)
+        return;
+    std::vector<uint32_t> &edges = tables_.edges;
+    auto begin = edges.begin() + tables_.edge_offsets[source];
+    auto end = edges.begin() + tables_.edge_offsets[source + 1];
+    edges.insert(std::lower_bound(begin, end, id), id);
+    for (size_t s = source + 1; s < tables_.edge_offsets.size(); ++s)
+        ++tables_.edge_offsets[s];
+}
+
+void ModelEditor::unlinkEdge(uint32_t id)
+{
+    uint32_t source = tables_.transitions[id].source;
+    if (source == kNone)
+        return;
+    std::vector<uint32_t> &edges = tables_.edges;
+    auto begin = edges.begin() + tables_.edge_offsets[source];
+    auto end = edges.begin() + tables_.edge_offsets[source + 1];
+    auto it = std::lower_bound(begin, end, id);
+    if (it == end || *it != id)
+        return;
+    edges.erase(it);
+    for (size_t s = source + 1; s < tables_.edge_offsets.size(); ++s)
+        --tables_.edge_offsets[s];
+}
+
+void ModelEditor::detachTransition(uint32_t id)
+{
+    unlinkEdge(id);
+    tables_.transitions[id].source = kNone;
+    tables_.transitions[id].target = kNone;
+}
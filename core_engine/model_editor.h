@@ -0,0 +1,73 @@
+
+#ifndef FSM_MODEL_EDITOR_H
+#define FSM_MODEL_EDITOR_H
+
+#include "compiled_model.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Applies live edits to a compiled model without recompiling it.
+//
+// The editor decodes the image's tables once and patches them in place: name
+// and event indexes by a sorted insert, CSR edge lists by splicing one slice
+// and shifting the offsets after it. commit() lays the tables out as a new
+// image; models are immutable, so simulators still running the old one are
+// unaffected.
+//
+// State and transition IDs stay stable across edits. A removed state keeps
+// its slot, flagged STATE_REMOVED, and a removed transition keeps its record
+// with no source or target, so IDs held by a running instance, a trace or a
+// host never move. The string pool and code table only grow: replacing a
+// snippet interns the new source under a new code ID (or reuses the ID of an
+// identical snippet) and leaves the old one in place.
+//
+// For the pointer arguments below, nullptr keeps the current value and ""
+// clears code. Every call returns false (kNone) without changing anything
+// when a name does not resolve to a live state, a new name is empty or
+// already taken, or a transition ID is out of range or already removed.
+class ModelEditor
+{
+public:
+    explicit ModelEditor(const CompiledModel &model);
+
+    uint32_t addState(std::string_view name, std::string_view entry, std::string_view during,
+                      std::string_view exit, uint32_t flags);
+    bool removeState(std::string_view name); // Also removes the transitions into and out of it
+    bool renameState(std::string_view name, std::string_view new_name);
+    bool setStateCode(std::string_view name, const char *entry, const char *during, const char *exit);
+    bool setStateFlags(std::string_view name, uint32_t flags); // STATE_INITIAL | STATE_FINAL
+
+    uint32_t addTransition(std::string_view source, std::string_view target, std::string_view event,
+                           std::string_view condition, std::string_view action);
+    bool removeTransition(uint32_t id);
+    bool updateTransition(uint32_t id, const char *source, const char *target, const char *event);
+    bool setTransitionCode(uint32_t id, const char *condition, const char *action);
+
+    std::shared_ptr<const CompiledModel> commit() const { return CompiledModel::fromTables(tables_); }
+
+    size_t memoryBytes() const; // Working tables and the code lookup (estimated per node)
+
+private:
+    std::string_view string(uint32_t id) const;
+    std::string_view stateName(uint32_t id) const { return string(tables_.states[id].name); }
+    uint32_t findState(std::string_view name) const;
+    bool isLiveTransition(uint32_t id) const;
+
+    uint32_t appendString(std::string_view s);
+    uint32_t internEvent(std::string_view name);
+    uint32_t internCode(std::string_view code);
+
+    void indexState(uint32_t id);
+    void unindexState(uint32_t id);
+    void linkEdge(uint32_t id);
+    void unlinkEdge(uint32_t id);
+    void detachTransition(uint32_t id);
+
+    CompiledModel::Tables tables_;
+    std::map<std::string, uint32_t, std::less<>> code_ids_;
+};
+
+#endif // FSM_MODEL_EDITOR_H
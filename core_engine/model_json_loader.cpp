@@ -0,0 +1,486 @@
+
+#include "model_json_loader.h"
+#include "content_hash.h"
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+    // Where the parser currently is in the document.
+    enum class Context
+    {
+        Start,       // Before the root value
+        Root,        // Inside the root object
+        States,      // Inside the "states" array
+        State,       // Inside one state object
+        Transitions, // Inside the "transitions" array
+        Transition,  // Inside one transition object
+        Done
+    };
+
+    // Meaning of the value that follows the last key.
+    enum class Field
+    {
+        Skip,
+        StateList,
+        TransitionList,
+        Name,
+        EntryAction,
+        DuringAction,
+        ExitAction,
+        IsInitial,
+        IsFinal,
+        Source,
+        Target,
+        Event,
+        Condition,
+        Action
+    };
+
+    struct FieldName
+    {
+        const char *key;
+        Field field;
+    };
+
+    const FieldName kStateFields[] = {{"name", Field::Name},
+                                      {"entry_action", Field::EntryAction},
+                                      {"during_action", Field::DuringAction},
+                                      {"exit_action", Field::ExitAction},
+                                      {"is_initial", Field::IsInitial},
+                                      {"is_final", Field::IsFinal}};
+
+    const FieldName kTransitionFields[] = {{"source", Field::Source},
+                                           {"target", Field::Target},
+                                           {"event", Field::Event},
+                                           {"condition", Field::Condition},
+                                           {"action", Field::Action}};
+
+    template <size_t N>
+    Field lookupField(const FieldName (&fields)[N], const std::string &key)
+    {
+        for (const FieldName &f : fields)
+        {
+            if (key == f.key)
+                return f.field;
+        }
+        return Field::Skip;
+    }
+
+    // Byte offset of the occurrence-th (1-based) key named key in the root
+    // object, or -1. Only used to report an error, on a document the parser
+    // has already accepted up to that key, so it just tracks strings and depth.
+    int64_t rootKeyOffset(std::string_view document, std::string_view key, int occurrence)
+    {
+        int depth = 0;
+        for (size_t i = 0; i < document.size(); ++i)
+        {
+            char c = document[i];
+            if (c == '{' || c == '[')
+                ++depth;
+            else if (c == '}' || c == ']')
+                --depth;
+            else if (c == '"')
+            {
+                size_t start = i++;
+                while (i < document.size() && document[i] != '"')
+                    i += document[i] == '\\' ? 2 : 1;
+                size_t colon = document.find_first_not_of(" \t\r\n", i + 1);
+                bool is_key = colon != std::string_view::npos && document[colon] == ':';
+                if (is_key && depth == 1 && document.substr(start + 1, i - start - 1) == key && --occurrence == 0)
+                    return static_cast<int64_t>(start);
+            }
+        }
+        return -1;
+    }
+
+    // Forwards to the builder while hashing the semantic fields. States and
+    // transitions are hashed as separate streams, so the key does not depend
+    // on which of the two lists comes first in the document.
+    class HashingBuilder
+    {
+    public:
+        explicit HashingBuilder(CompiledModel::Builder &builder) : builder_(builder) {}
+
+        void addState(std::string_view name, std::string_view entry, std::string_view during,
+                      std::string_view exit, bool is_initial, bool is_final)
+        {
+            states_.string(name);
+            states_.string(entry);
+            states_.string(during);
+            states_.string(exit);
+            states_.u64((is_initial ? 1 : 0) | (is_final ? 2 : 0));
+            builder_.addState(name, entry, during, exit, is_initial, is_final);
+        }
+
+        void addTransition(std::string_view source, std::string_view target, std::string_view event,
+                           std::string_view condition, std::string_view action)
+        {
+            transitions_.string(source);
+            transitions_.string(target);
+            transitions_.string(event);
+            transitions_.string(condition);
+            transitions_.string(action);
+            builder_.addTransition(source, target, event, condition, action);
+        }
+
+        uint64_t digest() const
+        {
+            ContentHash combined;
+            combined.u64(states_.digest());
+            combined.u64(transitions_.digest());
+            return combined.digest();
+        }
+
+    private:
+        CompiledModel::Builder &builder_;
+        ContentHash states_;
+        ContentHash transitions_;
+    };
+
+    // SAX handler (static interface, see nlohmann::json_sax). Values under
+    // unknown keys are consumed by counting container depth and dropping
+    // scalars, so nothing is stored for them. Sink is the model builder, or
+    // a HashingBuilder when the semantic hash is wanted too.
+    template <typename Sink>
+    class ModelSaxHandler
+    {
+    public:
+        ModelSaxHandler(Sink &sink, ModelLoadError *error, std::string_view document)
+            : sink_(sink), error_(error), document_(document) {}
+
+        bool null() { return scalar(ValueKind::Null); }
+        bool boolean(bool val)
+        {
+            if (skip_depth_ == 0 && context_ == Context::State &&
+                (field_ == Field::IsInitial || field_ == Field::IsFinal))
+            {
+                (field_ == Field::IsInitial ? is_initial_ : is_final_) = val;
+                return true;
+            }
+            return scalar(ValueKind::Boolean);
+        }
+        bool number_integer(json::number_integer_t) { return scalar(ValueKind::Number); }
+        bool number_unsigned(json::number_unsigned_t) { return scalar(ValueKind::Number); }
+        bool number_float(json::number_float_t, const json::string_t &) { return scalar(ValueKind::Number); }
+        bool binary(json::binary_t &) { return scalar(ValueKind::Number); }
+
+        bool string(json::string_t &val)
+        {
+            if (skip_depth_ == 0 && (context_ == Context::State || context_ == Context::Transition))
+            {
+                // Copied into a buffer that keeps its capacity from element
+                // to element, so reading a field does not allocate.
+                if (std::string *target = stringField())
+                {
+                    target->assign(val);
+                    return true;
+                }
+            }
+            return scalar(ValueKind::String);
+        }
+
+        bool start_object(std::size_t)
+        {
+            if (skip_depth_ > 0 || skipsValue())
+                return beginSkip();
+            switch (context_)
+            {
+            case Context::Start:
+                context_ = Context::Root;
+                field_ = Field::Skip;
+                return true;
+            case Context::Root:
+                // An object in place of a list contributes its values, like
+                // iterating it in the DOM did.
+                if (field_ != Field::StateList && field_ != Field::TransitionList)
+                    return fail("expected " + expected());
+                context_ = field_ == Field::StateList ? Context::States : Context::Transitions;
+                return true;
+            case Context::States:
+                context_ = Context::State;
+                clearFields();
+                return true;
+            case Context::Transitions:
+                context_ = Context::Transition;
+                clearFields();
+                return true;
+            default:
+                return fail("expected " + expected());
+            }
+        }
+
+        bool start_array(std::size_t)
+        {
+            if (skip_depth_ > 0 || skipsValue())
+                return beginSkip();
+            if (context_ == Context::Root && field_ == Field::StateList)
+            {
+                context_ = Context::States;
+                return true;
+            }
+            if (context_ == Context::Root && field_ == Field::TransitionList)
+            {
+                context_ = Context::Transitions;
+                return true;
+            }
+            return fail("expected " + expected());
+        }
+
+        bool key(json::string_t &key)
+        {
+            if (skip_depth_ > 0)
+                return true;
+            switch (context_)
+            {
+            case Context::Root:
+                field_ = key == "states" ? Field::StateList : key == "transitions" ? Field::TransitionList : Field::Skip;
+                // A repeated list would append to the first one (a DOM keeps
+                // only the last), so it is rejected rather than merged.
+                if (field_ != Field::Skip)
+                {
+                    bool &seen = field_ == Field::StateList ? seen_states_ : seen_transitions_;
+                    if (seen)
+                        return failAt("duplicate key \"" + key + "\"", rootKeyOffset(document_, key, 2));
+                    seen = true;
+                }
+                break;
+            case Context::State:
+                field_ = lookupField(kStateFields, key);
+                break;
+            case Context::Transition:
+                field_ = lookupField(kTransitionFields, key);
+                break;
+            default:
+                return true; // Keys of an object used as a list
+            }
+            if (field_ != Field::Skip)
+                key_.assign(key);
+            return true;
+        }
+
+        bool end_object()
+        {
+            if (skip_depth_ > 0)
+                return endSkip();
+            switch (context_)
+            {
+            case Context::State:
+                sink_.addState(name_, entry_, during_, exit_, is_initial_, is_final_);
+                ++state_count_;
+                context_ = Context::States;
+                break;
+            case Context::Transition:
+                sink_.addTransition(source_, target_, event_, condition_, action_);
+                ++transition_count_;
+                context_ = Context::Transitions;
+                break;
+            case Context::States:
+            case Context::Transitions:
+                context_ = Context::Root;
+                field_ = Field::Skip;
+                break;
+            default:
+                context_ = Context::Done;
+                break;
+            }
+            return true;
+        }
+
+        bool end_array()
+        {
+            if (skip_depth_ > 0)
+                return endSkip();
+            context_ = Context::Root;
+            field_ = Field::Skip;
+            return true;
+        }
+
+        bool parse_error(std::size_t position, const std::string &, const nlohmann::detail::exception &ex)
+        {
+            if (error_)
+            {
+                error_->message = ex.what();
+                error_->byte_offset = static_cast<int64_t>(position);
+            }
+            return false;
+        }
+
+    private:
+        enum class ValueKind
+        {
+            Null,
+            Boolean,
+            Number,
+            String
+        };
+
+        // Unknown key inside an object we read: its value is not needed.
+        bool skipsValue() const
+        {
+            return field_ == Field::Skip &&
+                   (context_ == Context::Root || context_ == Context::State || context_ == Context::Transition);
+        }
+
+        bool beginSkip()
+        {
+            ++skip_depth_;
+            return true;
+        }
+
+        bool endSkip()
+        {
+            --skip_depth_;
+            return true;
+        }
+
+        // Any scalar the handlers above did not consume.
+        bool scalar(ValueKind kind)
+        {
+            if (skip_depth_ > 0)
+                return true;
+            switch (context_)
+            {
+            case Context::Start:
+                // A null document is an empty model; other scalars are not models.
+                context_ = Context::Done;
+                return kind == ValueKind::Null || fail("expected a JSON object");
+            case Context::Root:
+                // Missing and null lists both mean "none".
+                return field_ == Field::Skip || kind == ValueKind::Null || fail("expected " + expected());
+            case Context::State:
+            case Context::Transition:
+                return field_ == Field::Skip || fail("expected " + expected());
+            default:
+                return fail("expected " + expected());
+            }
+        }
+
+        std::string *stringField()
+        {
+            switch (field_)
+            {
+            case Field::Name:
+                return &name_;
+            case Field::EntryAction:
+                return &entry_;
+            case Field::DuringAction:
+                return &during_;
+            case Field::ExitAction:
+                return &exit_;
+            case Field::Source:
+                return &source_;
+            case Field::Target:
+                return &target_;
+            case Field::Event:
+                return &event_;
+            case Field::Condition:
+                return &condition_;
+            case Field::Action:
+                return &action_;
+            default:
+                return nullptr;
+            }
+        }
+
+        void clearFields()
+        {
+            field_ = Field::Skip;
+            name_.clear();
+            entry_.clear();
+            during_.clear();
+            exit_.clear();
+            source_.clear();
+            target_.clear();
+            event_.clear();
+            condition_.clear();
+            action_.clear();
+            is_initial_ = false;
+            is_final_ = false;
+        }
+
+        std::string expected() const
+        {
+            switch (context_)
+            {
+            case Context::Root:
+                return "an array for \"" + key_ + "\"";
+            case Context::States:
+            case Context::Transitions:
+                return "an object in \"" + std::string(context_ == Context::States ? "states" : "transitions") + "\"";
+            case Context::State:
+            case Context::Transition:
+                return (field_ == Field::IsInitial || field_ == Field::IsFinal ? "a boolean" : "a string") +
+                       std::string(" for \"") + key_ + "\"";
+            default:
+                return "a JSON object";
+            }
+        }
+
+        bool fail(const std::string &message)
+        {
+            if (error_)
+            {
+                if (context_ == Context::State || context_ == Context::States)
+                    error_->message = "states[" + std::to_string(state_count_) + "]: " + message;
+                else if (context_ == Context::Transition || context_ == Context::Transitions)
+                    error_->message = "transitions[" + std::to_string(transition_count_) + "]: " + message;
+                else
+                    error_->message = message;
+                error_->byte_offset = -1;
+            }
+            return false;
+        }
+
+        bool failAt(const std::string &message, int64_t byte_offset)
+        {
+            if (error_)
+            {
+                error_->message = message;
+                error_->byte_offset = byte_offset;
+            }
+            return false;
+        }
+
+        Sink &sink_;
+        ModelLoadError *error_;
+        std::string_view document_;
+        Context context_ = Context::Start;
+        Field field_ = Field::Skip;
+        std::string key_; // Last semantic key, for error messages
+        size_t skip_depth_ = 0;
+        size_t state_count_ = 0;
+        size_t transition_count_ = 0;
+        bool seen_states_ = false;
+        bool seen_transitions_ = false;
+
+        // Fields of the state or transition being read
+        std::string name_, entry_, during_, exit_;
+        std::string source_, target_, event_, condition_, action_;
+        bool is_initial_ = false;
+        bool is_final_ = false;
+    };
+}
+
+std::shared_ptr<const CompiledModel> loadModelJson(const char *data, size_t size, ModelLoadError *error,
+                                                   uint64_t *semantic_hash)
+{
+    CompiledModel::Builder builder;
+    if (semantic_hash)
+    {
+        HashingBuilder sink(builder);
+        ModelSaxHandler<HashingBuilder> handler(sink, error, std::string_view(data, size));
+        if (!json::sax_parse(data, data + size, &handler))
+            return nullptr;
+        *semantic_hash = sink.digest();
+        return builder.build();
+    }
+    ModelSaxHandler<CompiledModel::Builder> handler(builder, error, std::string_view(data, size));
+    if (!json::sax_parse(data, data + size, &handler))
+        return nullptr;
+    return builder.build();
+}
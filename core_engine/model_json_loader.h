@@ -0,0 +1,35 @@
+
+#ifndef FSM_MODEL_JSON_LOADER_H
+#define FSM_MODEL_JSON_LOADER_H
+
+#include "compiled_model.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Bumped whenever the same JSON document would compile to a different model,
+// so images cached by an older loader are not reused (see ModelCache).
+constexpr uint32_t kModelJsonLoaderVersion = 1;
+
+// Why a JSON model could not be loaded.
+struct ModelLoadError
+{
+    std::string message;
+    int64_t byte_offset = -1; // Position of malformed input or a repeated key, -1 for structural errors
+};
+
+// Streams a diagram (.bsm / load_fsm_from_json format) straight into a
+// CompiledModel::Builder through nlohmann's SAX interface, so no JSON DOM is
+// built. Only the semantic keys of states and transitions are kept; layout and
+// presentation keys (x, y, width, color, font_*, icon_path, sub_fsm_data,
+// comments, ...) are skipped as they stream past, including any nesting.
+// Returns nullptr and fills error (if given) on malformed input, including a
+// repeated "states" or "transitions" key.
+//
+// semantic_hash, if given, receives a stable hash of exactly what was kept:
+// documents that differ only in layout, key order or whitespace hash equal.
+std::shared_ptr<const CompiledModel> loadModelJson(const char *data, size_t size, ModelLoadError *error,
+                                                   uint64_t *semantic_hash = nullptr);
+
+#endif // FSM_MODEL_JSON_LOADER_H
@@ -0,0 +1,114 @@
+
+#include "realtime_loop.h"
+
+namespace
+{
+    // The OS sleep is only trusted to within this margin; the remainder of the
+    // wait is spent spinning so ticks land close to their deadline.
+    constexpr auto kSpinMargin = std::chrono::microseconds(200);
+}
+
+bool RealtimeLoop::start(double tick_rate_hz, std::function<void()> on_tick)
+{
+    if (tick_rate_hz <= 0.0 || !on_tick || running_.load())
+        return false;
+
+    auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / tick_rate_hz));
+    if (period.count() <= 0)
+        return false;
+
+    on_tick_ = std::move(on_tick);
+    ticks_ = 0;
+    overruns_ = 0;
+    max_lateness_ns_ = 0;
+    stop_requested_ = false;
+    running_ = true;
+    thread_ = std::thread(&RealtimeLoop::run, this, period);
+    return true;
+}
+
+void RealtimeLoop::stop()
+{
+    if (isLoopThread())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_requested_ = true;
+    }
+    wake_cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+    running_ = false;
+}
+
+RealtimeLoop::Stats RealtimeLoop::stats() const
+{
+    Stats s;
+    s.ticks = ticks_.load(std::memory_order_relaxed);
+    s.overruns = overruns_.load(std::memory_order_relaxed);
+    s.max_lateness_ns = max_lateness_ns_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void RealtimeLoop::run(Clock::duration period)
+{
+    loop_thread_id_.store(std::this_thread::get_id(), std::memory_order_release);
+    Clock::time_point anchor = Clock::now();
+    uint64_t tick_index = 0;
+
+    while (!stop_requested_.load(std::memory_order_acquire))
+    {
+        Clock::time_point deadline = anchor + period * static_cast<int64_t>(tick_index + 1);
+        waitUntil(deadline);
+        if (stop_requested_.load(std::memory_order_acquire))
+            break;
+
+        int64_t lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - deadline).count();
+        if (lateness > max_lateness_ns_.load(std::memory_order_relaxed))
+            max_lateness_ns_.store(lateness, std::memory_order_relaxed);
+
+        on_tick_();
+        ticks_.fetch_add(1, std::memory_order_relaxed);
+        ++tick_index;
+
+        // Drift compensation: if we are more than a whole period behind, catch
+        // up a bounded number of ticks, then re-anchor and count the rest.
+        Clock::time_point now = Clock::now();
+        int caught_up = 0;
+        while (now >= anchor + period * static_cast<int64_t>(tick_index + 1) &&
+               caught_up < kMaxCatchUpTicks && !stop_requested_.load(std::memory_order_acquire))
+        {
+            on_tick_();
+            ticks_.fetch_add(1, std::memory_order_relaxed);
+            ++tick_index;
+            ++caught_up;
+            now = Clock::now();
+        }
+
+        Clock::time_point next_deadline = anchor + period * static_cast<int64_t>(tick_index + 1);
+        if (now >= next_deadline)
+        {
+            auto behind = static_cast<uint64_t>((now - next_deadline) / period) + 1;
+            overruns_.fetch_add(behind, std::memory_order_relaxed);
+            anchor = now;
+            tick_index = 0;
+        }
+    }
+    loop_thread_id_.store(std::thread::id(), std::memory_order_release);
+    running_.store(false, std::memory_order_release);
+}
+
+void RealtimeLoop::waitUntil(Clock::time_point deadline)
+{
+    {
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_cv_.wait_until(lock, deadline - kSpinMargin,
+                            [this]
+                            { return stop_requested_.load(std::memory_order_acquire); });
+    }
+    while (Clock::now() < deadline && !stop_requested_.load(std::memory_order_acquire))
+    {
+        std::this_thread::yield();
+    }
+}
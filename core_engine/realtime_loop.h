@@ -0,0 +1,64 @@
+
+#ifndef FSM_REALTIME_LOOP_H
+#define FSM_REALTIME_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs a callback at a fixed real-time rate on a dedicated thread.
+//
+// Deadlines are computed from the loop's start time (start + n * period) on
+// the monotonic clock rather than from the end of the previous tick, so
+// scheduling jitter does not accumulate into drift. When the callback falls
+// behind, up to kMaxCatchUpTicks missed ticks are run back-to-back; beyond
+// that the schedule is re-anchored to "now" and the skipped ticks are counted
+// as overruns.
+class RealtimeLoop
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        uint64_t ticks = 0;
+        uint64_t overruns = 0;
+        int64_t max_lateness_ns = 0;
+    };
+
+    RealtimeLoop() = default;
+    ~RealtimeLoop() { stop(); }
+
+    RealtimeLoop(const RealtimeLoop &) = delete;
+    RealtimeLoop &operator=(const RealtimeLoop &) = delete;
+
+    bool start(double tick_rate_hz, std::function<void()> on_tick);
+    void stop(); // Ignored on the loop thread itself, which cannot join itself
+    bool isRunning() const { return running_.load(std::memory_order_acquire); }
+    bool isLoopThread() const { return std::this_thread::get_id() == loop_thread_id_.load(std::memory_order_acquire); }
+    Stats stats() const;
+
+private:
+    static constexpr int kMaxCatchUpTicks = 4;
+
+    void run(Clock::duration period);
+    void waitUntil(Clock::time_point deadline);
+
+    std::function<void()> on_tick_;
+    std::thread thread_;
+    std::atomic<std::thread::id> loop_thread_id_{};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+
+    std::atomic<uint64_t> ticks_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<int64_t> max_lateness_ns_{0};
+};
+
+#endif // FSM_REALTIME_LOOP_H
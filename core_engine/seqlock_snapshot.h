@@ -0,0 +1,145 @@
+
+#ifndef FSM_SEQLOCK_SNAPSHOT_H
+#define FSM_SEQLOCK_SNAPSHOT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Single-writer / multi-reader publication of a record made of a fixed-size
+// header plus a variable number of 64-bit words.
+//
+// Two buffers are kept, each guarded by its own sequence counter: the writer
+// always fills the buffer readers are *not* pointed at and then flips the
+// pointer, so a reader only has to retry if the writer laps it twice during a
+// single copy. Neither side ever takes a lock. Every word is an atomic
+// accessed with relaxed ordering; the sequence counters supply the fences.
+class SeqlockSnapshot
+{
+public:
+    static constexpr size_t kHeaderWords = 3;
+
+    SeqlockSnapshot() { grow(0); }
+
+    SeqlockSnapshot(const SeqlockSnapshot &) = delete;
+    SeqlockSnapshot &operator=(const SeqlockSnapshot &) = delete;
+
+    // Writer side. Must only be called from one thread at a time.
+    void publish(const uint64_t *header, const uint64_t *records, size_t record_words)
+    {
+        Pair *pair = pairs_.back().get();
+        if (record_words > pair->capacity)
+        {
+            pair = grow(record_words);
+        }
+
+        const Buffer *latest = latest_.load(std::memory_order_relaxed);
+        Buffer &target = (latest == &pair->buffers[0]) ? pair->buffers[1] : pair->buffers[0];
+
+        uint64_t seq = target.seq.load(std::memory_order_relaxed);
+        target.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < kHeaderWords; ++i)
+            target.header[i].store(header[i], std::memory_order_relaxed);
+        target.record_words.store(record_words, std::memory_order_relaxed);
+        for (size_t i = 0; i < record_words; ++i)
+            target.records[i].store(records[i], std::memory_order_relaxed);
+
+        target.seq.store(seq + 2, std::memory_order_release);
+        latest_.store(&target, std::memory_order_release);
+    }
+
+    // Writer side only. Buffers of outgrown pairs are included (see grow()).
+    size_t memoryBytes() const
+    {
+        size_t bytes = pairs_.capacity() * sizeof(pairs_[0]);
+        for (const auto &pair : pairs_)
+            bytes += sizeof(Pair) + 2 * pair->capacity * sizeof(std::atomic<uint64_t>);
+        return bytes;
+    }
+
+    // Reader side, safe from any thread. Copies the latest header and up to
+    // record_capacity record words. Returns false without copying records when
+    // the published header[0] equals skip_first_word (i.e. nothing changed).
+    bool read(uint64_t *header, uint64_t *records, size_t record_capacity,
+              size_t *record_words, uint64_t skip_first_word) const
+    {
+        for (;;)
+        {
+            const Buffer *buffer = latest_.load(std::memory_order_acquire);
+            uint64_t seq_before = buffer->seq.load(std::memory_order_acquire);
+            if (seq_before & 1)
+                continue;
+
+            for (size_t i = 0; i < kHeaderWords; ++i)
+                header[i] = buffer->header[i].load(std::memory_order_relaxed);
+
+            bool unchanged = header[0] == skip_first_word;
+            size_t words = buffer->record_words.load(std::memory_order_relaxed);
+            size_t to_copy = unchanged ? 0 : (words < record_capacity ? words : record_capacity);
+            for (size_t i = 0; i < to_copy; ++i)
+                records[i] = buffer->records[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (buffer->seq.load(std::memory_order_relaxed) != seq_before)
+                continue;
+
+            if (record_words)
+                *record_words = words;
+            return !unchanged;
+        }
+    }
+
+private:
+    struct Buffer
+    {
+        std::atomic<uint64_t> seq{0};
+        std::atomic<uint64_t> header[kHeaderWords];
+        std::atomic<size_t> record_words{0};
+        std::unique_ptr<std::atomic<uint64_t>[]> records;
+
+        Buffer()
+        {
+            for (auto &word : header)
+                word.store(0, std::memory_order_relaxed);
+        }
+    };
+
+    struct Pair
+    {
+        Buffer buffers[2];
+        size_t capacity = 0;
+    };
+
+    // Buffers are never freed while the snapshot lives: a reader may still be
+    // copying out of an outgrown pair. Capacity doubles, so the total stays
+    // within twice the largest record.
+    Pair *grow(size_t min_words)
+    {
+        size_t capacity = pairs_.empty() ? 16 : pairs_.back()->capacity * 2;
+        while (capacity < min_words)
+            capacity *= 2;
+
+        auto pair = std::make_unique<Pair>();
+        pair->capacity = capacity;
+        for (auto &buffer : pair->buffers)
+        {
+            buffer.records.reset(new std::atomic<uint64_t>[capacity]);
+            for (size_t i = 0; i < capacity; ++i)
+                buffer.records[i].store(0, std::memory_order_relaxed);
+        }
+        if (pairs_.empty())
+            latest_.store(&pair->buffers[0], std::memory_order_release);
+
+        pairs_.push_back(std::move(pair));
+        return pairs_.back().get();
+    }
+
+    std::vector<std::unique_ptr<Pair>> pairs_;
+    std::atomic<const Buffer *> latest_{nullptr};
+};
+
+#endif // FSM_SEQLOCK_SNAPSHOT_H
@@ -0,0 +1,114 @@
+
+#include "span_recorder.h"
+#include "compiled_model.h"
+#include "fsm_core.h"
+#include <atomic>
+#include <cstdio>
+#include <nlohmann/json.hpp>
+
+namespace
+{
+    std::FILE *openForWrite(const std::string &path)
+    {
+        std::FILE *file = nullptr;
+#ifdef _WIN32
+        if (fopen_s(&file, path.c_str(), "wb") != 0)
+            file = nullptr;
+#else
+        file = std::fopen(path.c_str(), "wb");
+#endif
+        return file;
+    }
+
+    // A JSON string literal, quoted and escaped.
+    std::string quoted(std::string_view text) { return nlohmann::json(std::string(text)).dump(); }
+
+    std::string nameOr(std::string_view (CompiledModel::*name_of)(uint32_t) const, const CompiledModel &model,
+                       uint32_t id, uint32_t count)
+    {
+        return id < count ? quoted((model.*name_of)(id)) : "null";
+    }
+}
+
+void SpanRecorder::start(size_t capacity)
+{
+    ring_.assign(capacity, Span{});
+    ring_.shrink_to_fit();
+    clear();
+}
+
+void SpanRecorder::clear()
+{
+    next_ = 0;
+    recorded_ = 0;
+    epoch_ = Clock::now();
+}
+
+uint32_t SpanRecorder::threadId()
+{
+    static std::atomic<uint32_t> next_id{1};
+    thread_local uint32_t id = next_id.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+bool SpanRecorder::writeChromeJson(const std::string &path, const CompiledModel &model) const
+{
+    std::FILE *file = openForWrite(path);
+    if (!file)
+        return false;
+
+    static const char *const kActionKinds[] = {"entry", "exit", "transition", "during"};
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":%llu},\"traceEvents\":[\n",
+                 static_cast<unsigned long long>(dropped()));
+    std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"fsm_core\"}}");
+
+    size_t count = size();
+    size_t first = count < ring_.size() ? 0 : next_;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const Span &span = ring_[(first + i) % ring_.size()];
+        const char *name = "step";
+        const char *category = "engine";
+        std::string args;
+        switch (span.kind)
+        {
+        case SPAN_STEP:
+            args = "\"event\":" + nameOr(&CompiledModel::eventName, model, span.id, model.eventCount()) +
+                   ",\"tick\":" + std::to_string(span.arg);
+            break;
+        case SPAN_RESOLVE:
+            name = "resolve_guards";
+            args = "\"candidates\":" + std::to_string(span.id) + ",\"tick\":" + std::to_string(span.arg);
+            break;
+        case SPAN_TRANSITION:
+        {
+            name = "transition";
+            args = "\"id\":" + std::to_string(span.id);
+            if (span.id < model.transitionCount())
+            {
+                const CompiledModel::TransitionRecord &record = model.transition(span.id);
+                args += ",\"source\":" + nameOr(&CompiledModel::stateName, model, record.source, model.stateCount()) +
+                        ",\"target\":" + nameOr(&CompiledModel::stateName, model, record.target, model.stateCount());
+            }
+            break;
+        }
+        case SPAN_GUARD:
+            name = "guard";
+            category = "callback";
+            args = "\"transition\":" + std::to_string(span.id) + ",\"code\":" + std::to_string(span.arg);
+            break;
+        case SPAN_ACTION:
+            name = "action";
+            category = "callback";
+            args = "\"code\":" + std::to_string(span.id) + ",\"kind\":\"" +
+                   (span.arg >= 0 && span.arg <= FSM_ACTION_DURING ? kActionKinds[span.arg] : "?") + "\"";
+            break;
+        }
+        std::fprintf(file,
+                     ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,"
+                     "\"args\":{%s}}",
+                     name, category, span.start_ns / 1000.0, span.duration_ns / 1000.0, span.thread, args.c_str());
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,83 @@
+
+#ifndef FSM_SPAN_RECORDER_H
+#define FSM_SPAN_RECORDER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CompiledModel;
+
+// Ring of timed engine spans, written out as Chrome trace-event JSON (the
+// format chrome://tracing and Perfetto open).
+//
+// A span is a fixed 32-byte record - kind, thread, start, duration and two
+// numeric arguments - so recording is a clock read and a store into a
+// preallocated slot; names are only looked up when the ring is written out.
+// Once full, the oldest spans are overwritten. Not thread-safe: spans are
+// recorded and dumped by whichever thread owns the simulator, and the thread
+// ID in each span tells the host thread and the real-time loop apart.
+class SpanRecorder
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Kind : uint8_t
+    {
+        SPAN_STEP,       // id: event ID, arg: tick
+        SPAN_RESOLVE,    // Answering awaited guards; id: candidates, arg: tick
+        SPAN_TRANSITION, // id: transition ID
+        SPAN_GUARD,      // Guard callback; id: transition ID, arg: code ID
+        SPAN_ACTION      // Action callback; id: code ID, arg: FsmActionKind
+    };
+
+    struct Span
+    {
+        int64_t start_ns; // Since start()
+        int64_t duration_ns;
+        uint32_t thread;
+        uint32_t id;
+        int32_t arg;
+        uint8_t kind;
+    };
+
+    bool isEnabled() const { return !ring_.empty(); }
+    void start(size_t capacity); // Clears; capacity 0 stops recording
+    void clear();
+
+    Clock::time_point now() const { return Clock::now(); }
+    void record(Kind kind, Clock::time_point start, uint32_t id, int32_t arg)
+    {
+        Clock::time_point end = Clock::now();
+        Span &span = ring_[next_];
+        span.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_).count();
+        span.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        span.thread = threadId();
+        span.id = id;
+        span.arg = arg;
+        span.kind = kind;
+        next_ = next_ + 1 == ring_.size() ? 0 : next_ + 1;
+        ++recorded_;
+    }
+
+    size_t size() const { return recorded_ < ring_.size() ? static_cast<size_t>(recorded_) : ring_.size(); }
+    uint64_t dropped() const { return recorded_ - size(); }
+
+    // Writes the spans still in the ring, oldest first. State, event and code
+    // names come from `model`, so dump before loading another one.
+    bool writeChromeJson(const std::string &path, const CompiledModel &model) const;
+
+    size_t memoryBytes() const { return ring_.capacity() * sizeof(Span); }
+
+private:
+    static uint32_t threadId(); // Small, stable per-thread number for the viewer
+
+    std::vector<Span> ring_;
+    size_t next_ = 0;
+    uint64_t recorded_ = 0;
+    Clock::time_point epoch_;
+};
+
+#endif // FSM_SPAN_RECORDER_H
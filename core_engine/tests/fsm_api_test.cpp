@@ -0,0 +1,51 @@
+
+#include "fsm_core.h"
+#include "test_support.h"
+
+#include <string>
+
+// Drives the engine through its public C API, as the Python host does.
+namespace
+{
+    std::string currentState(FSM_HANDLE fsm)
+    {
+        char *name = const_cast<char *>(get_current_state_name(fsm));
+        std::string result = name ? name : "";
+        free_string_memory(name);
+        return result;
+    }
+
+    void testDroppedSuspensionForgetsItsFallback()
+    {
+        // e suspends on [g] with e's unguarded A -> C as fallback; f then
+        // replaces the suspension with its own guard [h], which has none.
+        const char *json = R"({"states": [{"name": "A", "is_initial": true}, {"name": "B"}, {"name": "C"},
+                                          {"name": "D"}],
+            "transitions": [{"source": "A", "target": "B", "event": "e", "condition": "g"},
+                            {"source": "A", "target": "C", "event": "e"},
+                            {"source": "A", "target": "D", "event": "f", "condition": "h"}]})";
+        FSM_HANDLE fsm = create_fsm();
+        CHECK(load_fsm_from_json(fsm, json));
+        reset_fsm(fsm); // Enters the initial state
+        CHECK(currentState(fsm) == "A");
+
+        step(fsm, "e");
+        step(fsm, "f");
+        const uint8_t h_false = 0;
+        fsm_resolve_conditions(fsm, &h_false, 1);
+        CHECK(currentState(fsm) == "A");
+
+        // The fallback still applies to the event that set it
+        step(fsm, "e");
+        const uint8_t g_false = 0;
+        fsm_resolve_conditions(fsm, &g_false, 1);
+        CHECK(currentState(fsm) == "C");
+        destroy_fsm(fsm);
+    }
+}
+
+int main()
+{
+    testDroppedSuspensionForgetsItsFallback();
+    return test::exitCode();
+}
@@ -0,0 +1,204 @@
+
+#include "model_cache.h"
+#include "model_json_loader.h"
+#include "test_support.h"
+#include <cstring>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // A small model whose logic depends on n; layout adds a key the loader skips.
+    std::string modelJson(int n, bool layout = false)
+    {
+        std::string state = "S" + std::to_string(n);
+        return "{\"states\": [{\"name\": \"" + state + "\", \"is_initial\": true" + (layout ? ", \"x\": 120" : "") +
+               "}, {\"name\": \"T\"}], \"transitions\": [{\"source\": \"" + state +
+               "\", \"target\": \"T\", \"event\": \"go\"}]}";
+    }
+
+    std::shared_ptr<const CompiledModel> load(ModelCache &cache, const std::string &json)
+    {
+        ModelLoadError error;
+        auto model = cache.loadJson(json.data(), json.size(), &error);
+        CHECK(model != nullptr);
+        return model;
+    }
+
+    bool sameModel(const std::shared_ptr<const CompiledModel> &model, const std::string &json)
+    {
+        auto expected = loadModelJson(json.data(), json.size(), nullptr);
+        return model && expected && model->size() == expected->size() &&
+               std::memcmp(model->data(), expected->data(), model->size()) == 0;
+    }
+
+    FsmModelCacheStats statsOf(const ModelCache &cache)
+    {
+        FsmModelCacheStats stats;
+        cache.stats(&stats);
+        return stats;
+    }
+
+    // A fresh, empty cache directory, removed again on destruction.
+    class TempDir
+    {
+    public:
+        explicit TempDir(const std::string &name) : path_(fs::temp_directory_path() / name)
+        {
+            fs::remove_all(path_);
+            fs::create_directories(path_);
+        }
+        ~TempDir()
+        {
+            std::error_code ignored;
+            fs::remove_all(path_, ignored);
+        }
+
+        std::string path() const { return path_.string(); }
+
+        std::vector<std::string> files(const std::string &suffix) const
+        {
+            std::vector<std::string> names;
+            for (const auto &entry : fs::directory_iterator(path_))
+            {
+                std::string name = entry.path().filename().string();
+                if (name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+                    names.push_back(name);
+            }
+            return names;
+        }
+
+        std::string file(const std::string &name) const { return (path_ / name).string(); }
+
+    private:
+        fs::path path_;
+    };
+
+    std::string versionedSuffix(const char *extension)
+    {
+        return ".v" + std::to_string(CompiledModel::kVersion) + "-" + std::to_string(kModelJsonLoaderVersion) +
+               extension;
+    }
+
+    void copyFile(const std::string &from, const std::string &to)
+    {
+        fs::copy_file(from, to, fs::copy_options::overwrite_existing);
+    }
+
+    void testMemoryHits()
+    {
+        ModelCache cache;
+        cache.configure(8, "");
+        auto a = load(cache, modelJson(1));
+        CHECK(load(cache, modelJson(1)) == a);        // Same bytes
+        CHECK(load(cache, modelJson(1, true)) == a);  // Layout-only edit
+        CHECK(load(cache, modelJson(2)) != a);
+        FsmModelCacheStats stats = statsOf(cache);
+        CHECK(stats.raw_hits == 1 && stats.semantic_hits == 1 && stats.compiles == 2);
+    }
+
+    void testDiskHits()
+    {
+        TempDir dir("fsm_model_cache_disk");
+        {
+            ModelCache cache;
+            cache.configure(8, dir.path());
+            load(cache, modelJson(1));
+            CHECK(statsOf(cache).disk_writes == 1);
+        }
+        CHECK(dir.files(versionedSuffix(".fsmb")).size() == 1);
+        CHECK(dir.files(versionedSuffix(".ref")).size() == 1);
+
+        ModelCache cache;
+        cache.configure(8, dir.path());
+        CHECK(sameModel(load(cache, modelJson(1)), modelJson(1)));
+        CHECK(statsOf(cache).disk_hits == 1 && statsOf(cache).compiles == 0);
+    }
+
+    // A .ref whose raw bytes hash the same but whose second hash differs (as
+    // after a collision) must not be followed.
+    void testRefCollision()
+    {
+        TempDir dir("fsm_model_cache_ref");
+        std::string ref_a, ref_b;
+        {
+            ModelCache cache;
+            cache.configure(8, dir.path());
+            load(cache, modelJson(1));
+            ref_a = dir.files(".ref").at(0);
+            load(cache, modelJson(2));
+            for (const std::string &name : dir.files(".ref"))
+                ref_b = name != ref_a ? name : ref_b;
+        }
+        copyFile(dir.file(ref_a), dir.file(ref_b)); // B's ref now names A's image
+
+        ModelCache cache;
+        cache.configure(8, dir.path());
+        CHECK(sameModel(load(cache, modelJson(2)), modelJson(2)));
+        CHECK(statsOf(cache).disk_hits == 0 && statsOf(cache).compiles == 1);
+    }
+
+    // An image stored under a semantic hash is only reused if it holds the
+    // model just compiled.
+    void testImageCollision()
+    {
+        TempDir dir("fsm_model_cache_image");
+        std::string image_a, image_b;
+        {
+            ModelCache cache;
+            cache.configure(8, dir.path());
+            load(cache, modelJson(1));
+            image_a = dir.files(".fsmb").at(0);
+            load(cache, modelJson(2));
+            for (const std::string &name : dir.files(".fsmb"))
+                image_b = name != image_a ? name : image_b;
+        }
+        copyFile(dir.file(image_b), dir.file(image_a)); // A's hash now holds B's image
+        size_t refs = dir.files(".ref").size();
+
+        ModelCache cache;
+        cache.configure(8, dir.path());
+        CHECK(sameModel(load(cache, modelJson(1, true)), modelJson(1)));
+        CHECK(statsOf(cache).disk_writes == 0);
+        CHECK(dir.files(".ref").size() == refs); // No ref to the mismatched image
+    }
+
+    void testPruning()
+    {
+        TempDir dir("fsm_model_cache_prune");
+        const std::string fresh_temp = "0123456789abcdef" + versionedSuffix(".fsmb") + ".tmp42-7";
+        for (const std::string &name : {std::string("0123456789abcdef.fsmb"), std::string("0123456789abcdef.ref"),
+                                        std::string("0123456789abcdef.v0-1.fsmb"), std::string("notes.txt"), fresh_temp})
+            std::ofstream(dir.file(name)) << "x";
+        ModelCache cache;
+        cache.configure(0, dir.path());
+        load(cache, modelJson(0));
+        // Unversioned and other-version files go; foreign files and a fresh
+        // temporary (another writer) stay.
+        CHECK(!fs::exists(dir.file("0123456789abcdef.fsmb")));
+        CHECK(!fs::exists(dir.file("0123456789abcdef.ref")));
+        CHECK(!fs::exists(dir.file("0123456789abcdef.v0-1.fsmb")));
+        CHECK(fs::exists(dir.file("notes.txt")));
+        CHECK(fs::exists(dir.file(fresh_temp)));
+        CHECK(statsOf(cache).disk_evictions == 3);
+
+        for (int n = 1; n <= static_cast<int>(ModelCache::kMaxDiskImages) + 5; ++n)
+            load(cache, modelJson(n));
+        CHECK(dir.files(versionedSuffix(".fsmb")).size() == ModelCache::kMaxDiskImages);
+        // The most recent model is still on disk
+        ModelCache later;
+        later.configure(0, dir.path());
+        load(later, modelJson(static_cast<int>(ModelCache::kMaxDiskImages) + 5));
+        CHECK(statsOf(later).disk_hits == 1);
+    }
+}
+
+int main()
+{
+    testMemoryHits();
+    testDiskHits();
+    testRefCollision();
+    testImageCollision();
+    testPruning();
+    return test::exitCode();
+}
@@ -0,0 +1,103 @@
+
+#include "model_editor.h"
+#include "model_json_loader.h"
+#include "test_support.h"
+
+namespace
+{
+    constexpr uint32_t kNone = CompiledModel::kNone;
+
+    std::shared_ptr<const CompiledModel> loadModel()
+    {
+        const std::string json = R"({"states": [{"name": "A", "is_initial": true}, {"name": "B"}, {"name": "C"}],
+            "transitions": [{"source": "A", "target": "B", "event": "go"},
+                            {"source": "B", "target": "C", "event": "go", "action": "n = 1"},
+                            {"source": "C", "target": "A", "event": "back"}]})";
+        auto model = loadModelJson(json.data(), json.size(), nullptr);
+        CHECK(model != nullptr);
+        return model;
+    }
+
+    bool hasEdge(const CompiledModel &model, uint32_t state, uint32_t transition)
+    {
+        for (const uint32_t *edge = model.edgesBegin(state); edge != model.edgesEnd(state); ++edge)
+        {
+            if (*edge == transition)
+                return true;
+        }
+        return false;
+    }
+
+    void testRemovedTransitionStaysRemoved()
+    {
+        auto model = loadModel();
+        ModelEditor editor(*model);
+        CHECK(editor.removeTransition(1));
+
+        // A removed ID is not an existing transition any more
+        CHECK(!editor.removeTransition(1));
+        CHECK(!editor.updateTransition(1, nullptr, nullptr, nullptr));
+        CHECK(!editor.updateTransition(1, "A", nullptr, nullptr));
+        CHECK(!editor.updateTransition(1, nullptr, "C", "go"));
+        CHECK(!editor.setTransitionCode(1, "", "n = 2"));
+
+        auto edited = editor.commit();
+        CHECK(edited->transition(1).source == kNone && edited->transition(1).target == kNone);
+        CHECK(!hasEdge(*edited, edited->findState("B"), 1));
+        CHECK(edited->transitionCount() == 3);
+    }
+
+    void testTransitionsOfRemovedState()
+    {
+        auto model = loadModel();
+        ModelEditor editor(*model);
+        CHECK(editor.removeState("C"));
+        CHECK(!editor.removeTransition(1)); // B -> C went with C
+        CHECK(!editor.updateTransition(2, nullptr, "B", nullptr));
+        CHECK(editor.updateTransition(0, nullptr, "A", nullptr)); // Live ones still edit
+
+        auto edited = editor.commit();
+        CHECK(edited->transition(0).target == edited->findState("A"));
+        CHECK(edited->transition(2).source == kNone);
+    }
+
+    void testUnknownIds()
+    {
+        auto model = loadModel();
+        ModelEditor editor(*model);
+        CHECK(!editor.removeTransition(3));
+        CHECK(!editor.removeTransition(kNone));
+        CHECK(!editor.updateTransition(3, "A", "B", "go"));
+        CHECK(!editor.setTransitionCode(7, "x", nullptr));
+        CHECK(!editor.updateTransition(0, "Missing", nullptr, nullptr));
+
+        // Nothing changed
+        auto edited = editor.commit();
+        CHECK(edited->size() == model->size());
+    }
+
+    void testLiveEdits()
+    {
+        auto model = loadModel();
+        ModelEditor editor(*model);
+        uint32_t id = editor.addTransition("B", "A", "reset", "", "");
+        CHECK(id == 3);
+        CHECK(editor.updateTransition(id, "C", nullptr, "stop"));
+        CHECK(editor.setTransitionCode(id, "n > 0", nullptr));
+        CHECK(editor.removeTransition(id));
+        CHECK(!editor.removeTransition(id));
+
+        auto edited = editor.commit();
+        CHECK(!hasEdge(*edited, edited->findState("C"), id));
+        CHECK(hasEdge(*edited, edited->findState("C"), 2));
+    }
+}
+
+int main()
+{
+    testRemovedTransitionStaysRemoved();
+    testTransitionsOfRemovedState();
+    testUnknownIds();
+    testLiveEdits();
+    return test::exitCode();
+}
@@ -0,0 +1,174 @@
+
+#include "tools/snippet_interpreter.h"
+#include "test_support.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// With no arguments, checks a table of snippets against the results CPython
+// gives. "--list" prints the table's sources and "--eval" evaluates the
+// expressions on stdin, one per line, so snippet_vs_cpython.py can compare
+// them (and random ones) with a live CPython.
+namespace
+{
+    class NullHost : public snippet::Host
+    {
+    public:
+        bool lookup(uint32_t, snippet::Value *) override { return false; }
+        void send(const std::string &) override {}
+    };
+
+    // The result as JSON, the exception type when it raises ("OverflowError"),
+    // or "unsupported" when the subset cannot parse it.
+    std::string evalExpression(const std::string &source)
+    {
+        snippet::SymbolTable symbols;
+        snippet::Program program = snippet::Program::parseExpression(source, symbols);
+        if (!program.supported())
+            return "unsupported";
+        snippet::Environment env;
+        env.resize(symbols.size());
+        NullHost host;
+        try
+        {
+            return program.evaluate(env, host).toJson();
+        }
+        catch (const snippet::EvalError &e)
+        {
+            std::string message = e.what();
+            return message.substr(0, message.find(':'));
+        }
+    }
+
+    struct Case
+    {
+        const char *source;
+        const char *expected; // As CPython has it, with ints bounded to 64 bits
+    };
+
+    constexpr Case kCases[] = {
+        {"9223372036854775807 + 1", "OverflowError"},
+        {"-9223372036854775807 - 1", "-9223372036854775808"},
+        {"-9223372036854775807 - 2", "OverflowError"},
+        {"9223372036854775807 - -1", "OverflowError"},
+        {"3037000499 * 3037000499", "9223372030926249001"},
+        {"3037000500 * 3037000500", "OverflowError"},
+        {"-3037000500 * 3037000500", "OverflowError"},
+        {"-(-9223372036854775807 - 1)", "OverflowError"},
+        {"abs(-9223372036854775807 - 1)", "OverflowError"},
+        {"abs(-9223372036854775807)", "9223372036854775807"},
+        {"9223372036854775808", "unsupported"},
+
+        {"(-9223372036854775807 - 1) // -1", "OverflowError"},
+        {"(-9223372036854775807 - 1) % -1", "0"},
+        {"9223372036854775807 // -1", "-9223372036854775807"},
+        {"7 // -1", "-7"},
+        {"-7 // 2", "-4"},
+        {"-7 % 2", "1"},
+        {"7 % -2", "-1"},
+        {"7 // 0", "ZeroDivisionError"},
+        {"7 % 0", "ZeroDivisionError"},
+
+        {"2 ** 62", "4611686018427387904"},
+        {"2 ** 63", "OverflowError"},
+        {"(-2) ** 63", "-9223372036854775808"},
+        {"3 ** 39", "4052555153018976267"},
+        {"3 ** 40", "OverflowError"},
+        {"2 ** 1000000000000000", "OverflowError"},
+        {"1 ** 1000000000000000", "1"},
+        {"(-1) ** 1000000000000001", "-1"},
+        {"0 ** 1000000000000000", "0"},
+        {"0 ** 0", "1"},
+        {"2 ** -1", "0.5"},
+        {"0 ** -1", "ZeroDivisionError"},
+
+        {"10.0 ** 400", "OverflowError"},
+        {"0.0 ** -1", "ZeroDivisionError"},
+        {"(-8) ** 0.5", "ValueError"},
+        {"(-8.0) ** 3", "-512.0"},
+        {"-7.5 // 2", "-4.0"},
+        {"-7.5 % 2", "0.5"},
+        {"7.5 % -2", "-0.5"},
+        {"-0.0 % 5", "0.0"},
+        {"0.0 // -5", "-0.0"},
+        {"1 / 3", "0.3333333333333333"},
+        {"1e308 * 10", "null"},
+
+        {"int(9.3e18)", "OverflowError"},
+        {"int(-9.2e18)", "-9200000000000000000"},
+        {"int('99999999999999999999')", "OverflowError"},
+        {"int(-7.9)", "-7"},
+        {"round(2.5)", "2"},
+        {"round(-0.5)", "0"},
+        {"round(1e19)", "OverflowError"},
+
+        {"'ab' * 3", "\"ababab\""},
+        {"'ab' * -1", "\"\""},
+        {"'ab' * 1000000000000", "MemoryError"},
+        {"True + True", "2"},
+    };
+
+    void testCasesMatchPython()
+    {
+        for (const Case &c : kCases)
+        {
+            std::string actual = evalExpression(c.source);
+            if (actual != c.expected)
+                std::fprintf(stderr, "%s: expected %s, got %s\n", c.source, c.expected, actual.c_str());
+            CHECK(actual == c.expected);
+        }
+    }
+
+    void testHugeExponentIsFast()
+    {
+        auto start = std::chrono::steady_clock::now();
+        CHECK(evalExpression("3 ** 9223372036854775807") == "OverflowError");
+        CHECK(evalExpression("(-1) ** 9223372036854775807") == "-1");
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+    }
+
+    void testOverflowLeavesTargetUnchanged()
+    {
+        snippet::SymbolTable symbols;
+        snippet::Program program = snippet::Program::parseStatements("n = 9223372036854775807\nn += 1", symbols);
+        CHECK(program.supported());
+        snippet::Environment env;
+        env.resize(symbols.size());
+        NullHost host;
+        bool raised = false;
+        try
+        {
+            program.run(env, host);
+        }
+        catch (const snippet::EvalError &e)
+        {
+            raised = std::strncmp(e.what(), "OverflowError:", 14) == 0;
+        }
+        CHECK(raised);
+        CHECK(env.vars[symbols.find("n")].type == snippet::Value::INT);
+        CHECK(env.vars[symbols.find("n")].i == INT64_MAX);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "--list") == 0)
+    {
+        for (const Case &c : kCases)
+            std::cout << c.source << '\n';
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--eval") == 0)
+    {
+        std::string line;
+        while (std::getline(std::cin, line))
+            std::cout << evalExpression(line) << '\n';
+        return 0;
+    }
+
+    testCasesMatchPython();
+    testHugeExponentIsFast();
+    testOverflowLeavesTargetUnchanged();
+    return test::exitCode();
+}
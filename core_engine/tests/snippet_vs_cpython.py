@@ -0,0 +1,167 @@
+"""Compares the snippet interpreter with CPython.
+
+Usage: snippet_vs_cpython.py <snippet_interpreter_test binary> [random cases]
+
+Evaluates the binary's own table and a batch of random arithmetic
+expressions both ways. CPython is the reference, except that an int leaving
+the 64-bit range anywhere in the expression must raise OverflowError, as the
+interpreter does.
+"""
+import ast
+import json
+import math
+import operator
+import random
+import subprocess
+import sys
+
+INT64_MIN, INT64_MAX = -2 ** 63, 2 ** 63 - 1
+MAX_REPEAT_BYTES = 1 << 24  # kMaxRepeatBytes in snippet_interpreter.cpp
+
+BINARY_OPS = {ast.Add: operator.add, ast.Sub: operator.sub, ast.Mult: operator.mul, ast.Div: operator.truediv,
+              ast.FloorDiv: operator.floordiv, ast.Mod: operator.mod, ast.Pow: operator.pow}
+UNARY_OPS = {ast.USub: operator.neg, ast.UAdd: operator.pos, ast.Not: operator.not_}
+COMPARE_OPS = {ast.Eq: operator.eq, ast.NotEq: operator.ne, ast.Lt: operator.lt, ast.LtE: operator.le,
+               ast.Gt: operator.gt, ast.GtE: operator.ge}
+FUNCTIONS = {"abs": abs, "min": min, "max": max, "int": int, "float": float, "bool": bool, "round": round}
+
+
+class Incomparable(Exception):
+    """Python computes this exactly where a 64-bit interpreter cannot."""
+
+
+class Unsupported(Exception):
+    """The interpreter rejects this while parsing."""
+
+
+def bounded(value):
+    if isinstance(value, int) and not isinstance(value, bool) and not INT64_MIN <= value <= INT64_MAX:
+        raise OverflowError
+    if isinstance(value, complex):
+        raise ValueError  # The interpreter has no complex numbers
+    return value
+
+
+def binary(op, left, right):
+    ints = all(isinstance(v, int) for v in (left, right))
+    if op is ast.Pow and ints and abs(left) > 1 and right > 64:
+        raise OverflowError  # Without computing a number with quadrillions of digits
+    if op is ast.Div and ints and max(abs(left), abs(right)) > 2 ** 53:
+        raise Incomparable  # CPython divides exactly, not as two doubles
+    if op is ast.Mult and isinstance(left, str) and isinstance(right, int) and len(left) * right > MAX_REPEAT_BYTES:
+        raise MemoryError
+    return BINARY_OPS[op](left, right)
+
+
+def evaluate(node):
+    if isinstance(node, ast.Expression):
+        return evaluate(node.body)
+    if isinstance(node, ast.Constant):
+        if isinstance(node.value, int) and not INT64_MIN <= node.value <= INT64_MAX:
+            raise Unsupported  # The literal itself does not parse
+        return node.value
+    if isinstance(node, ast.UnaryOp):
+        return bounded(UNARY_OPS[type(node.op)](evaluate(node.operand)))
+    if isinstance(node, ast.BinOp):
+        return bounded(binary(type(node.op), evaluate(node.left), evaluate(node.right)))
+    if isinstance(node, ast.Compare):
+        left = evaluate(node.left)
+        for op, comparator in zip(node.ops, node.comparators):
+            right = evaluate(comparator)
+            if {type(left), type(right)} == {int, float} and max(abs(left), abs(right)) > 2 ** 53:
+                raise Incomparable  # CPython compares exactly, not as doubles
+            if not COMPARE_OPS[type(op)](left, right):
+                return False
+            left = right
+        return True
+    if isinstance(node, ast.BoolOp):
+        value = evaluate(node.values[0])
+        for operand in node.values[1:]:
+            if bool(value) == isinstance(node.op, ast.Or):
+                break
+            value = evaluate(operand)
+        return value
+    if isinstance(node, ast.IfExp):
+        return evaluate(node.body) if evaluate(node.test) else evaluate(node.orelse)
+    if isinstance(node, ast.Call) and isinstance(node.func, ast.Name) and node.func.id in FUNCTIONS:
+        return bounded(FUNCTIONS[node.func.id](*[evaluate(arg) for arg in node.args]))
+    raise Incomparable
+
+
+def expected(source):
+    try:
+        value = evaluate(ast.parse(source, mode="eval"))
+    except Incomparable:
+        return None
+    except Unsupported:
+        return "unsupported"
+    except OverflowError:
+        return "OverflowError"
+    except Exception as e:  # The interpreter reports the same exception type
+        return type(e).__name__
+    if isinstance(value, float):
+        return repr(value) if math.isfinite(value) else "null"
+    return json.dumps(value)
+
+
+def normalized(output):
+    """The binary prints JSON; floats are compared by repr, so -0.0 != 0.0."""
+    try:
+        value = json.loads(output)
+    except ValueError:
+        return output
+    return repr(value) if isinstance(value, float) else json.dumps(value)
+
+
+def random_operand(rng, depth):
+    if depth > 0 and rng.random() < 0.6:
+        return random_expression(rng, depth - 1)
+    kind = rng.random()
+    if kind < 0.4:
+        return str(rng.randint(-20, 20))
+    if kind < 0.6:
+        return str(rng.choice([INT64_MAX, INT64_MAX - 1, 2 ** 62, 3037000499, 3037000500, 2 ** 31, -1, 0]))
+    if kind < 0.7:
+        return "(-9223372036854775807 - 1)"
+    if kind < 0.9:
+        return repr(rng.choice([0.0, -0.0, 0.5, -2.5, 7.25, 1e-300, 1e300, rng.uniform(-100, 100)]))
+    return rng.choice(["True", "False"])
+
+
+def random_expression(rng, depth=2):
+    left, right = random_operand(rng, depth), random_operand(rng, depth)
+    shape = rng.random()
+    if shape < 0.1:
+        return f"{rng.choice(['-', 'abs', 'int', 'round'])}({left})"
+    if shape < 0.2:
+        return f"({left}) {rng.choice(['<', '<=', '==', '!=', '>', '>='])} ({right})"
+    return f"({left}) {rng.choice(['+', '-', '*', '/', '//', '%', '**'])} ({right})"
+
+
+def main():
+    binary_path = sys.argv[1]
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else 20000
+    table = subprocess.run([binary_path, "--list"], check=True, capture_output=True, text=True).stdout.splitlines()
+    rng = random.Random(1234)
+    sources = table + [random_expression(rng) for _ in range(count)]
+
+    results = subprocess.run([binary_path, "--eval"], input="\n".join(sources) + "\n", check=True,
+                             capture_output=True, text=True).stdout.splitlines()
+    assert len(results) == len(sources), "the interpreter did not answer every expression"
+
+    mismatches, compared = 0, 0
+    for source, actual in zip(sources, results):
+        reference = expected(source)
+        if reference is None:
+            continue
+        compared += 1
+        if normalized(actual) != reference:
+            mismatches += 1
+            if mismatches <= 20:
+                print(f"{source}\n    CPython: {reference}\n    snippet: {actual}")
+    print(f"{compared} expressions compared, {mismatches} mismatches")
+    return 1 if mismatches else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,72 @@
+
+#ifndef FSM_TEST_SUPPORT_H
+#define FSM_TEST_SUPPORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Minimal harness for the core_engine unit tests (no test framework is
+// vendored). A failed CHECK prints its location and keeps going; main()
+// returns test::exitCode(), which ctest reads as pass/fail.
+namespace test
+{
+    inline int &failureCount()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline int exitCode()
+    {
+        if (failureCount() > 0)
+            std::fprintf(stderr, "%d check(s) failed\n", failureCount());
+        return failureCount() > 0 ? 1 : 0;
+    }
+
+    // A file under the system temp directory, removed again on destruction.
+    class TempFile
+    {
+    public:
+        explicit TempFile(const std::string &name)
+            : path_((std::filesystem::temp_directory_path() / name).string()) {}
+        ~TempFile()
+        {
+            std::error_code ignored;
+            std::filesystem::remove(path_, ignored);
+        }
+
+        const std::string &path() const { return path_; }
+
+        std::vector<uint8_t> read() const
+        {
+            std::ifstream in(path_, std::ios::binary);
+            return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        void write(const uint8_t *data, size_t size) const
+        {
+            std::ofstream out(path_, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+        }
+
+    private:
+        std::string path_;
+    };
+}
+
+#define CHECK(condition)                                                                   \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(condition))                                                                  \
+        {                                                                                  \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++test::failureCount();                                                        \
+        }                                                                                  \
+    } while (0)
+
+#endif // FSM_TEST_SUPPORT_H
@@ -0,0 +1,189 @@
+
+#include "fsm_core.h"
+#include "test_support.h"
+#include "trace_codec.h"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    struct Block
+    {
+        std::vector<trace::TraceStep> steps;
+        std::vector<trace::TraceVar> vars;
+
+        void add(uint64_t tick, int32_t event_id, int32_t transition_id, int32_t state_id,
+                 std::vector<trace::TraceVar> changes = {})
+        {
+            steps.push_back(trace::TraceStep{tick, event_id, transition_id, state_id,
+                                             static_cast<uint32_t>(vars.size()),
+                                             static_cast<uint32_t>(changes.size())});
+            vars.insert(vars.end(), changes.begin(), changes.end());
+        }
+    };
+
+    std::vector<uint8_t> encode(const Block &block)
+    {
+        trace::StepBlockEncoder encoder;
+        for (const trace::TraceStep &step : block.steps)
+            encoder.add(step, block.vars.data() + step.first_var, step.var_count);
+        std::vector<uint8_t> payload;
+        encoder.encode(payload);
+        return payload;
+    }
+
+    // Encodes the block, decodes it again and compares field by field (REAL
+    // values by bit pattern, so NaN payloads and -0.0 must survive).
+    void checkRoundTrip(const Block &block)
+    {
+        std::vector<uint8_t> payload = encode(block);
+        std::vector<trace::TraceStep> steps;
+        std::vector<trace::TraceVar> vars;
+        CHECK(trace::decodeStepBlock(payload.data(), payload.data() + payload.size(), steps, vars));
+        CHECK(steps.size() == block.steps.size());
+        CHECK(vars.size() == block.vars.size());
+        if (steps.size() != block.steps.size() || vars.size() != block.vars.size())
+            return;
+
+        for (size_t i = 0; i < steps.size(); ++i)
+        {
+            const trace::TraceStep &a = block.steps[i];
+            const trace::TraceStep &b = steps[i];
+            CHECK(a.tick == b.tick && a.event_id == b.event_id && a.transition_id == b.transition_id &&
+                  a.state_id == b.state_id && a.first_var == b.first_var && a.var_count == b.var_count);
+        }
+        for (size_t i = 0; i < vars.size(); ++i)
+            CHECK(block.vars[i].slot == vars[i].slot && block.vars[i].type == vars[i].type &&
+                  block.vars[i].raw == vars[i].raw);
+    }
+
+    trace::TraceVar intVar(uint32_t slot, int64_t value)
+    {
+        return trace::TraceVar{slot, FSM_VAR_INT, static_cast<uint64_t>(value)};
+    }
+
+    trace::TraceVar realVar(uint32_t slot, double value)
+    {
+        return trace::TraceVar{slot, FSM_VAR_REAL, trace::doubleBits(value)};
+    }
+
+    void testExtremeDeltas()
+    {
+        constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+        constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+        // Integer values jumping between the ends of the range (deltas that
+        // wrap), and IDs at the ends of int32.
+        Block block;
+        int64_t values[] = {0, kMax, kMin, kMax, -1, kMin, 0, kMin, kMin, kMax, 1};
+        uint64_t tick = 0;
+        for (int64_t value : values)
+            block.add(tick++, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), -1,
+                      {intVar(0, value), intVar(7, static_cast<int64_t>(0 - static_cast<uint64_t>(value)))});
+        checkRoundTrip(block);
+
+        // Tick deltas of the whole uint64 range
+        Block ticks;
+        ticks.add(0, -1, -1, 0);
+        ticks.add(UINT64_MAX, -1, -1, 0);
+        ticks.add(UINT64_MAX, -1, -1, 0);
+        checkRoundTrip(ticks);
+        Block backwards;
+        backwards.add(UINT64_MAX, -1, -1, 0);
+        backwards.add(0, -1, -1, 0);
+        checkRoundTrip(backwards);
+    }
+
+    // Repeats of length kMinRun - 1, kMinRun and kMinRun + 1 (kMinRun is 3),
+    // at the start, middle and end of a column, between literals.
+    void testRunBoundaries()
+    {
+        for (size_t run = 1; run <= 5; ++run)
+        {
+            for (size_t before = 0; before <= 2; ++before)
+            {
+                for (size_t after = 0; after <= 2; ++after)
+                {
+                    Block block;
+                    uint64_t tick = 100;
+                    int32_t id = 0;
+                    for (size_t i = 0; i < before; ++i, ++id)
+                        block.add(tick += 1 + i, id, id, id, {intVar(1, static_cast<int64_t>(i))});
+                    for (size_t i = 0; i < run; ++i)
+                        block.add(tick += 1, 42, 42, 42, {intVar(1, 5)});
+                    for (size_t i = 0; i < after; ++i, ++id)
+                        block.add(tick += 3 + i, id, -1, id, {intVar(2, -static_cast<int64_t>(i))});
+                    checkRoundTrip(block);
+                }
+            }
+        }
+    }
+
+    void testRealBitPatterns()
+    {
+        const double values[] = {0.0, -0.0, 1.5, -1e308, std::numeric_limits<double>::denorm_min(),
+                                 std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(),
+                                 std::numeric_limits<double>::quiet_NaN(), -std::numeric_limits<double>::quiet_NaN()};
+        Block block;
+        uint64_t tick = 0;
+        for (double value : values)
+            block.add(tick++, 0, 0, 0, {realVar(0, value), intVar(1, static_cast<int64_t>(tick))});
+        // A NaN with a non-default payload, and a REAL slot mixed with an INT one
+        block.add(tick++, 0, 0, 0, {trace::TraceVar{0, FSM_VAR_REAL, 0x7ff8dead0000beefull}});
+        block.add(tick++, 0, 0, 0, {trace::TraceVar{3, FSM_VAR_REAL, 0xfff0000000000001ull}, intVar(3, -9)});
+        checkRoundTrip(block);
+    }
+
+    // Full-size blocks: identical steps (one run per column), distinct steps
+    // (all literals), and mixes with steps that change nothing.
+    void testFullBlocks()
+    {
+        Block idle;
+        for (uint64_t i = 0; i < trace::kBlockSteps; ++i)
+            idle.add(1000 + i, -1, -1, 2);
+        checkRoundTrip(idle);
+        CHECK(encode(idle).size() < 64);
+
+        Block busy;
+        for (uint64_t i = 0; i < trace::kBlockSteps; ++i)
+        {
+            std::vector<trace::TraceVar> changes;
+            for (uint32_t slot = 0; slot < i % 4; ++slot)
+                changes.push_back(slot % 2 ? realVar(slot, i * 0.25) : intVar(slot, static_cast<int64_t>(i * i) - 5000));
+            busy.add(i * (i % 7 + 1), static_cast<int32_t>(i % 5) - 1, static_cast<int32_t>(i % 3) - 1,
+                     static_cast<int32_t>(i / 100), changes);
+        }
+        checkRoundTrip(busy);
+    }
+
+    // Every prefix of a valid payload must decode cleanly or be rejected.
+    void testTruncatedPayload()
+    {
+        Block block;
+        for (uint64_t i = 0; i < 20; ++i)
+            block.add(i, 1, -1, 0, {intVar(0, static_cast<int64_t>(i) * 1000), realVar(1, i / 3.0)});
+        std::vector<uint8_t> payload = encode(block);
+        std::vector<trace::TraceStep> steps;
+        std::vector<trace::TraceVar> vars;
+        for (size_t cut = 0; cut < payload.size(); ++cut)
+        {
+            std::vector<uint8_t> prefix(payload.begin(), payload.begin() + cut);
+            CHECK(!trace::decodeStepBlock(prefix.data(), prefix.data() + prefix.size(), steps, vars));
+        }
+
+        // A step count above kBlockSteps is rejected before anything is allocated
+        std::vector<uint8_t> oversized = payload;
+        oversized[2] = 0xff;
+        CHECK(!trace::decodeStepBlock(oversized.data(), oversized.data() + oversized.size(), steps, vars));
+    }
+}
+
+int main()
+{
+    testExtremeDeltas();
+    testRunBoundaries();
+    testRealBitPatterns();
+    testFullBlocks();
+    testTruncatedPayload();
+    return test::exitCode();
+}
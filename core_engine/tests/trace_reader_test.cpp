@@ -0,0 +1,248 @@
+
+#include "fsm_core.h"
+#include "test_support.h"
+#include "trace_reader.h"
+#include "trace_writer.h"
+
+namespace
+{
+    constexpr uint64_t kSteps = 3000;
+    constexpr uint64_t kKeyframeInterval = 500;
+
+    void putName(TraceWriter &writer, trace::NameKind kind, uint32_t id, const std::string &name)
+    {
+        writer.beginRecord(trace::RECORD_NAME);
+        trace::putU8(writer.payload(), kind);
+        trace::putU32(writer.payload(), id);
+        trace::putBytes(writer.payload(), name.data(), name.size());
+        writer.endRecord();
+    }
+
+    void putKeyframe(TraceWriter &writer, uint64_t tick, int32_t state_id, int64_t x)
+    {
+        writer.beginRecord(trace::RECORD_KEYFRAME);
+        std::vector<uint8_t> &out = writer.payload();
+        trace::putU64(out, tick);
+        trace::putU32(out, static_cast<uint32_t>(state_id));
+        trace::putU32(out, 1);
+        trace::putU32(out, 0);
+        trace::putU8(out, FSM_VAR_INT);
+        trace::putU64(out, static_cast<uint64_t>(x));
+        writer.endRecord();
+    }
+
+    int32_t stateAt(uint64_t tick) { return static_cast<int32_t>((tick / 100) % 2); }
+
+    // One run over states A (0) and B (1), switching every 100 ticks, with a
+    // variable x that equals the tick.
+    void writeTrace(const std::string &path)
+    {
+        TraceWriter writer;
+        CHECK(writer.open(path));
+        putName(writer, trace::NAME_STATE, 0, "A");
+        putName(writer, trace::NAME_STATE, 1, "B");
+        putName(writer, trace::NAME_VARIABLE, 0, "x");
+        putKeyframe(writer, 0, 0, 0);
+        for (uint64_t tick = 1; tick <= kSteps; ++tick)
+        {
+            int32_t state = stateAt(tick);
+            trace::TraceVar var{0, FSM_VAR_INT, tick};
+            trace::TraceStep step{tick, -1, state != stateAt(tick - 1) ? 0 : -1, state, 0, 0};
+            writer.addStep(step, &var, 1);
+            if (tick % kKeyframeInterval == 0)
+                putKeyframe(writer, tick, state, static_cast<int64_t>(tick));
+        }
+        CHECK(writer.close());
+        CHECK(writer.stats().write_errors == 0);
+    }
+
+    uint64_t indexOffset(const std::vector<uint8_t> &bytes)
+    {
+        return trace::getU64(bytes.data() + bytes.size() - 8);
+    }
+
+    void putU32At(std::vector<uint8_t> &bytes, size_t at, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            bytes[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    void putU64At(std::vector<uint8_t> &bytes, size_t at, uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            bytes[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    // Runs every query over the whole trace; only has to not crash.
+    void queryEverything(const TraceReader &reader)
+    {
+        std::vector<uint64_t> ticks(64);
+        std::vector<double> values(64);
+        for (int run = -1; run < 2; ++run)
+        {
+            reader.queryVariable(run, "x", 0, UINT64_MAX, ticks.data(), values.data(), ticks.size());
+            reader.queryStateEntries(run, "B", 0, UINT64_MAX, ticks.data(), ticks.size());
+        }
+    }
+
+    void checkComplete(const TraceReader &reader)
+    {
+        CHECK(reader.info().step_count == kSteps);
+        CHECK(reader.info().last_tick == kSteps);
+        CHECK(reader.info().run_count == 1);
+        CHECK(reader.info().keyframe_count == 1 + kSteps / kKeyframeInterval);
+
+        uint64_t ticks[16];
+        double values[16];
+        CHECK(reader.queryVariable(-1, "x", 1234, 1240, ticks, values, 16) == 7);
+        CHECK(ticks[0] == 1234 && values[0] == 1234.0);
+        CHECK(ticks[6] == 1240 && values[6] == 1240.0);
+        CHECK(reader.queryStateEntries(-1, "B", 0, kSteps, ticks, 16) == 15);
+        CHECK(ticks[0] == 100 && ticks[1] == 300);
+    }
+
+    void testRoundTrip()
+    {
+        test::TempFile file("fsm_trace_reader_roundtrip.fsmtrace");
+        writeTrace(file.path());
+        TraceReader reader;
+        CHECK(reader.open(file.path()));
+        CHECK(reader.info().indexed);
+        checkComplete(reader);
+    }
+
+    void testTruncated()
+    {
+        test::TempFile source("fsm_trace_reader_source.fsmtrace");
+        test::TempFile file("fsm_trace_reader_truncated.fsmtrace");
+        writeTrace(source.path());
+        std::vector<uint8_t> bytes = source.read();
+        uint64_t index_offset = indexOffset(bytes);
+
+        // Cut right before the footer: the record scan recovers everything.
+        file.write(bytes.data(), index_offset);
+        TraceReader reader;
+        CHECK(reader.open(file.path()));
+        CHECK(!reader.info().indexed);
+        checkComplete(reader);
+
+        // Any other cut loses the footer and possibly a tail of records.
+        for (size_t cut = 0; cut < bytes.size(); cut += cut < 64 || cut + 64 > bytes.size() ? 1 : 7)
+        {
+            file.write(bytes.data(), cut);
+            TraceReader truncated;
+            if (!truncated.open(file.path()))
+            {
+                CHECK(cut < trace::kFileHeaderSize);
+                continue;
+            }
+            CHECK(!truncated.info().indexed);
+            CHECK(truncated.info().step_count <= kSteps);
+            queryEverything(truncated);
+        }
+    }
+
+    // Rewrites one field of a valid trace and checks that the footer is
+    // rejected, so the reader falls back to scanning the records.
+    template <typename Patch>
+    void checkCorruptFooter(const std::vector<uint8_t> &original, const test::TempFile &file, Patch patch,
+                            bool records_intact)
+    {
+        std::vector<uint8_t> bytes = original;
+        patch(bytes);
+        file.write(bytes.data(), bytes.size());
+        TraceReader reader;
+        CHECK(reader.open(file.path()));
+        CHECK(!reader.info().indexed);
+        if (records_intact)
+            checkComplete(reader);
+        queryEverything(reader);
+    }
+
+    void testCorruptFooter()
+    {
+        test::TempFile source("fsm_trace_reader_source.fsmtrace");
+        test::TempFile file("fsm_trace_reader_corrupt.fsmtrace");
+        writeTrace(source.path());
+        const std::vector<uint8_t> bytes = source.read();
+        const size_t index = indexOffset(bytes);
+        const size_t keyframe_count_at = index + trace::kRecordHeaderSize + 16;
+        const size_t keyframe_count = trace::getU32(bytes.data() + keyframe_count_at);
+        const size_t names_at = keyframe_count_at + 4 + keyframe_count * 20;
+
+        // INDEX offset past the end of the file, or wrapping around
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU64At(b, b.size() - 8, b.size()); }, true);
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU64At(b, b.size() - 8, UINT64_MAX - 2); }, true);
+        // INDEX length running into the trailer
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU32At(b, index, 0xfffffff0u); }, true);
+        // Keyframe and name counts larger than the INDEX record
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU32At(b, keyframe_count_at, 0xffffffffu); }, true);
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU32At(b, names_at, 0x20000000u); }, true);
+        // Keyframe offset inside the file header
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU64At(b, keyframe_count_at + 4 + 8, 3); }, true);
+        // Name offsets at the INDEX record itself, near its start, and far away
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU64At(b, names_at + 4, index); }, true);
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU64At(b, names_at + 4, index - 6); }, true);
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU64At(b, names_at + 4, UINT64_MAX - 4); }, true);
+        // A NAME record whose length runs past the INDEX and the file; the scan
+        // then stops at that record.
+        checkCorruptFooter(bytes, file, [&](std::vector<uint8_t> &b)
+                           { putU32At(b, trace::kFileHeaderSize, 0xffffff00u); }, false);
+    }
+
+    // Flips every byte of a small trace in turn. The reader must never read
+    // outside the file, whatever the damage.
+    void testByteFlips()
+    {
+        test::TempFile source("fsm_trace_reader_small.fsmtrace");
+        test::TempFile file("fsm_trace_reader_flipped.fsmtrace");
+        {
+            TraceWriter writer;
+            CHECK(writer.open(source.path()));
+            putName(writer, trace::NAME_STATE, 0, "A");
+            putName(writer, trace::NAME_STATE, 1, "B");
+            putName(writer, trace::NAME_VARIABLE, 0, "x");
+            putKeyframe(writer, 0, 0, 0);
+            for (uint64_t tick = 1; tick <= 40; ++tick)
+            {
+                trace::TraceVar var{0, FSM_VAR_INT, tick * 3};
+                trace::TraceStep step{tick, -1, tick % 10 == 0 ? 0 : -1, static_cast<int32_t>((tick / 10) % 2), 0, 0};
+                writer.addStep(step, &var, 1);
+                if (tick == 20)
+                    putKeyframe(writer, tick, 0, static_cast<int64_t>(tick * 3));
+            }
+            CHECK(writer.close());
+        }
+        const std::vector<uint8_t> bytes = source.read();
+        for (size_t i = 0; i < bytes.size(); ++i)
+        {
+            for (uint8_t mask : {0x01, 0x80, 0xff})
+            {
+                std::vector<uint8_t> flipped = bytes;
+                flipped[i] ^= mask;
+                file.write(flipped.data(), flipped.size());
+                TraceReader reader;
+                if (reader.open(file.path()))
+                    queryEverything(reader);
+            }
+        }
+    }
+}
+
+int main()
+{
+    testRoundTrip();
+    testTruncated();
+    testCorruptFooter();
+    testByteFlips();
+    return test::exitCode();
+}
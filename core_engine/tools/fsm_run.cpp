@@ -0,0 +1,822 @@
+
+// Headless runner: simulates a model through the public C API without Python,
+// for CI and soak jobs that run thousands of scenarios.
+//
+//   fsm_run MODEL [--events FILE|-] [--vars JSON|@FILE] [--ticks N]
+//           [--trace FILE] [--csv FILE|-] [--invariant EXPR]...
+//           [--expect-state NAME] [--flight-dump FILE] [--keep-going]
+//           [--strict] [--quiet]
+//
+// MODEL is a .bsm/JSON diagram or a compiled .fsmb image. Action and condition
+// snippets run through the snippet interpreter (tools/snippet_interpreter.h);
+// those outside its Python subset are skipped with a warning (guards then
+// count as false). The event script has one entry per line, '#' starting a
+// comment, and is read as a stream:
+//
+//   12 door_open        event processed by the step that reaches tick 12
+//   +3 door_closed      3 ticks after the previous entry
+//   timeout             the tick after the previous entry
+//   20 set speed 4.5    variable (JSON value) set before the step to tick 20
+//   40 -                idle steps up to tick 40
+//
+// Ticks may repeat (the event goes to the next step) but not decrease. Idle
+// steps fill the gaps, and --ticks N keeps stepping idle until tick N.
+// Invariants are snippet expressions checked after reset and after every
+// step; they may also read `state` (active state name) and `tick`. A
+// violation, or one that fails to evaluate, dumps the flight recorder (to
+// --flight-dump) and stops the run unless --keep-going.
+//
+// Exit codes: 0 success, 1 invariant violated or final state differs from
+// --expect-state, 2 bad arguments, model or script, or a trace that could not
+// be written, 3 with --strict when a snippet was unsupported or raised.
+
+#include "fsm_core.h"
+#include "tools/snippet_interpreter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum ExitCode
+    {
+        EXIT_OK = 0,
+        EXIT_VIOLATION = 1,
+        EXIT_USAGE = 2,
+        EXIT_SNIPPET = 3
+    };
+
+    struct Config
+    {
+        std::string model;
+        std::string events; // "-" for stdin, "" for none
+        std::string vars;   // JSON object, or @FILE
+        uint64_t ticks = 0;
+        std::string trace;
+        std::string csv; // "-" for stdout
+        std::vector<std::string> invariants;
+        std::string expect_state;
+        bool has_expect_state = false;
+        std::string flight_dump;
+        bool keep_going = false;
+        bool strict = false;
+        bool quiet = false;
+    };
+
+    // Takes ownership of a string returned by the C API.
+    std::string takeString(const char *str)
+    {
+        std::string copy = str ? str : "";
+        free_string_memory(const_cast<char *>(str));
+        return copy;
+    }
+
+    snippet::Value valueFromJson(const json &value)
+    {
+        if (value.is_boolean())
+            return snippet::Value::boolean(value.get<bool>());
+        if (value.is_number_integer())
+            return snippet::Value::integer(value.get<int64_t>());
+        if (value.is_number())
+            return snippet::Value::real(value.get<double>());
+        if (value.is_string())
+            return snippet::Value::string(value.get<std::string>());
+        return snippet::Value::none();
+    }
+
+    // --- Event script ---
+
+    struct ScriptEntry
+    {
+        enum Kind
+        {
+            EVENT,
+            SET,
+            IDLE
+        };
+
+        Kind kind = EVENT;
+        uint64_t tick = 0;
+        std::string name;  // Event or variable
+        std::string value; // SET: JSON text
+    };
+
+    class ScriptReader
+    {
+    public:
+        explicit ScriptReader(std::istream &in) : in_(in) {}
+
+        // False at the end of the script or on an error (error() non-empty).
+        bool next(ScriptEntry *entry)
+        {
+            std::string line;
+            while (std::getline(in_, line))
+            {
+                ++line_number_;
+                size_t hash = line.find('#');
+                if (hash != std::string::npos)
+                    line.resize(hash);
+                std::istringstream fields(line);
+                std::string first;
+                if (!(fields >> first))
+                    continue;
+
+                uint64_t tick = last_tick_ + 1;
+                std::string word = first;
+                if (first[0] == '+' || std::isdigit(static_cast<unsigned char>(first[0])))
+                {
+                    char *end = nullptr;
+                    uint64_t number = std::strtoull(first.c_str() + (first[0] == '+'), &end, 10);
+                    if (*end != '\0')
+                        return fail("bad tick '" + first + "'");
+                    tick = first[0] == '+' ? last_tick_ + number : number;
+                    if (!(fields >> word))
+                        return fail("missing event after tick");
+                }
+                if (tick < last_tick_)
+                    return fail("tick " + std::to_string(tick) + " is before tick " + std::to_string(last_tick_));
+
+                entry->tick = tick;
+                entry->name.clear();
+                entry->value.clear();
+                if (word == "-")
+                    entry->kind = ScriptEntry::IDLE;
+                else if (word == "set")
+                {
+                    entry->kind = ScriptEntry::SET;
+                    if (!(fields >> entry->name))
+                        return fail("'set' needs a variable name and a JSON value");
+                    std::getline(fields >> std::ws, entry->value);
+                    if (entry->value.empty() || !json::accept(entry->value))
+                        return fail("'set " + entry->name + "' needs a JSON value");
+                }
+                else
+                {
+                    entry->kind = ScriptEntry::EVENT;
+                    entry->name = word;
+                    std::string extra;
+                    if (fields >> extra)
+                        return fail("unexpected '" + extra + "' after event '" + word + "'");
+                }
+                last_tick_ = tick;
+                return true;
+            }
+            return false;
+        }
+
+        const std::string &error() const { return error_; }
+
+    private:
+        bool fail(const std::string &message)
+        {
+            error_ = "line " + std::to_string(line_number_) + ": " + message;
+            return false;
+        }
+
+        std::istream &in_;
+        uint64_t last_tick_ = 0;
+        uint64_t line_number_ = 0;
+        std::string error_;
+    };
+
+    // --- Session ---
+
+    // One simulator with its snippets compiled against a shared symbol table,
+    // wired to the engine through the native callbacks.
+    class Session : public snippet::Host
+    {
+    public:
+        explicit Session(FSM_HANDLE handle) : handle_(handle)
+        {
+            slot_state_ = symbols_.intern("state");
+            slot_tick_ = symbols_.intern("tick");
+            slot_current_tick_ = symbols_.intern("current_tick");
+        }
+
+        // Call after the model is loaded.
+        void loadCodeTable()
+        {
+            json table = json::parse(takeString(fsm_get_code_table_json(handle_)), nullptr, false);
+            if (table.is_array())
+                for (const json &source : table)
+                    sources_.push_back(source.is_string() ? source.get<std::string>() : "");
+            actions_.resize(sources_.size());
+            guards_.resize(sources_.size());
+            warned_.assign(sources_.size(), 0);
+            // Actions are parsed up front so the assigned names are known for CSV columns
+            for (size_t id = 0; id < sources_.size(); ++id)
+                actions_[id] = std::make_unique<snippet::Program>(
+                    snippet::Program::parseStatements(sources_[id], symbols_));
+            env_.resize(symbols_.size());
+        }
+
+        void setVariable(const std::string &name, const json &value)
+        {
+            uint32_t slot = symbols_.intern(name);
+            env_.resize(symbols_.size());
+            env_.assign(slot, valueFromJson(value));
+            writeBack();
+        }
+
+        // Initial values, before the reset that runs the first entry action.
+        void setInitialVariables(const json &vars)
+        {
+            for (auto &item : vars.items())
+            {
+                uint32_t slot = symbols_.intern(item.key());
+                env_.resize(symbols_.size());
+                env_.vars[slot] = valueFromJson(item.value());
+                initial_names_.push_back(item.key());
+            }
+        }
+
+        // Variables and action-assigned names, sorted.
+        std::vector<std::string> columns() const
+        {
+            std::vector<std::string> names = initial_names_;
+            for (const auto &program : actions_)
+                for (uint32_t slot : program->assignedSlots())
+                    names.push_back(symbols_.name(slot));
+            std::sort(names.begin(), names.end());
+            names.erase(std::unique(names.begin(), names.end()), names.end());
+            return names;
+        }
+
+        const snippet::Value &variable(const std::string &name) const
+        {
+            static const snippet::Value kUndefined;
+            uint32_t slot = symbols_.find(name);
+            return slot < env_.vars.size() ? env_.vars[slot] : kUndefined;
+        }
+
+        // Invariants share the table so they see the same variables.
+        snippet::Program parseInvariant(const std::string &source)
+        {
+            snippet::Program program = snippet::Program::parseExpression(source, symbols_);
+            env_.resize(symbols_.size());
+            return program;
+        }
+
+        // Throws snippet::EvalError.
+        bool check(const snippet::Program &invariant) { return invariant.evaluate(env_, *this).truthy(); }
+
+        const std::string &stateName()
+        {
+            uint64_t version = fsm_get_state_version(handle_);
+            if (version != state_version_ || !state_valid_)
+            {
+                state_name_ = takeString(get_current_state_name(handle_));
+                state_version_ = version;
+                state_valid_ = true;
+            }
+            return state_name_;
+        }
+
+        uint64_t unsupported() const { return unsupported_; }
+        uint64_t errors() const { return errors_; }
+
+        bool lookup(uint32_t slot, snippet::Value *out) override
+        {
+            if (slot == slot_state_)
+                *out = snippet::Value::string(stateName());
+            else if (slot == slot_tick_ || slot == slot_current_tick_)
+                *out = snippet::Value::integer(get_current_tick(handle_));
+            else
+                return false;
+            return true;
+        }
+
+        void send(const std::string &event) override { queue_internal_event(handle_, event.c_str()); }
+
+        static bool onGuard(void *user_data, int32_t condition_id)
+        {
+            return static_cast<Session *>(user_data)->guard(condition_id);
+        }
+
+        static void onAction(void *user_data, int32_t, int32_t action_id)
+        {
+            static_cast<Session *>(user_data)->action(action_id);
+        }
+
+    private:
+        bool guard(int32_t id)
+        {
+            if (id < 0 || static_cast<size_t>(id) >= sources_.size())
+                return false;
+            if (!guards_[id])
+            {
+                guards_[id] = std::make_unique<snippet::Program>(
+                    snippet::Program::parseExpression(sources_[id], symbols_));
+                env_.resize(symbols_.size());
+            }
+            const snippet::Program &program = *guards_[id];
+            if (!program.supported())
+            {
+                reportUnsupported(id, program);
+                return false;
+            }
+            try
+            {
+                return program.evaluate(env_, *this).truthy();
+            }
+            catch (const snippet::EvalError &e)
+            {
+                reportError(id, "condition", e.what());
+                return false;
+            }
+        }
+
+        void action(int32_t id)
+        {
+            if (id < 0 || static_cast<size_t>(id) >= sources_.size())
+                return;
+            const snippet::Program &program = *actions_[id];
+            if (!program.supported())
+            {
+                reportUnsupported(id, program);
+                return;
+            }
+            try
+            {
+                program.run(env_, *this);
+            }
+            catch (const snippet::EvalError &e)
+            {
+                reportError(id, "action", e.what());
+            }
+            writeBack();
+        }
+
+        void writeBack()
+        {
+            for (uint32_t slot : env_.dirty)
+                fsm_set_variable_json(handle_, symbols_.name(slot).c_str(), env_.vars[slot].toJson().c_str());
+            env_.clearDirty();
+        }
+
+        void reportUnsupported(int32_t id, const snippet::Program &program)
+        {
+            if (warned_[id] & 1)
+                return;
+            warned_[id] |= 1;
+            ++unsupported_;
+            std::cerr << "fsm_run: skipping snippet " << id << " (" << program.error() << "):\n"
+                      << indent(sources_[id]) << "\n";
+        }
+
+        void reportError(int32_t id, const char *kind, const char *message)
+        {
+            ++errors_;
+            if (warned_[id] & 2)
+                return;
+            warned_[id] |= 2;
+            std::cerr << "fsm_run: " << kind << " " << id << " raised at tick " << get_current_tick(handle_) << ": "
+                      << message << "\n"
+                      << indent(sources_[id]) << "\n";
+        }
+
+        static std::string indent(const std::string &source)
+        {
+            std::string out = "    ";
+            for (char c : source)
+            {
+                out += c;
+                if (c == '\n')
+                    out += "    ";
+            }
+            return out;
+        }
+
+        FSM_HANDLE handle_;
+        snippet::SymbolTable symbols_;
+        snippet::Environment env_;
+        std::vector<std::string> sources_;
+        std::vector<std::unique_ptr<snippet::Program>> actions_;
+        std::vector<std::unique_ptr<snippet::Program>> guards_; // Parsed on first use
+        std::vector<uint8_t> warned_;                           // 1: unsupported, 2: raised
+        std::vector<std::string> initial_names_;
+        uint32_t slot_state_ = 0;
+        uint32_t slot_tick_ = 0;
+        uint32_t slot_current_tick_ = 0;
+        std::string state_name_;
+        uint64_t state_version_ = 0;
+        bool state_valid_ = false;
+        uint64_t unsupported_ = 0;
+        uint64_t errors_ = 0;
+    };
+
+    // --- Output ---
+
+    std::string csvField(const std::string &text)
+    {
+        if (text.find_first_of(",\"\n\r") == std::string::npos)
+            return text;
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"')
+                quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    std::string csvValue(const snippet::Value &value)
+    {
+        switch (value.type)
+        {
+        case snippet::Value::UNDEFINED:
+        case snippet::Value::NONE:
+            return "";
+        case snippet::Value::STRING:
+            return csvField(value.s);
+        default:
+            return value.toJson();
+        }
+    }
+
+    // --- Runner ---
+
+    class Runner
+    {
+    public:
+        Runner(const Config &config, FSM_HANDLE handle, Session &session, std::ostream *csv)
+            : config_(config), handle_(handle), session_(session), csv_(csv)
+        {
+        }
+
+        bool addInvariant(const std::string &source)
+        {
+            snippet::Program program = session_.parseInvariant(source);
+            if (!program.supported())
+            {
+                std::cerr << "fsm_run: invariant '" << source << "': " << program.error() << "\n";
+                return false;
+            }
+            invariants_.push_back({source, std::move(program)});
+            return true;
+        }
+
+        void start()
+        {
+            if (csv_)
+            {
+                columns_ = session_.columns();
+                *csv_ << "tick,event,state";
+                for (const std::string &name : columns_)
+                    *csv_ << "," << csvField(name);
+                *csv_ << "\n";
+                writeRow("");
+            }
+            checkInvariants();
+        }
+
+        bool stopped() const { return stopped_; }
+        uint64_t steps() const { return steps_; }
+        uint64_t events() const { return events_; }
+        uint64_t violations() const { return violations_; }
+        uint64_t tick() const { return static_cast<uint64_t>(get_current_tick(handle_)); }
+
+        // Idle steps until the current tick is `target`.
+        void idleUntil(uint64_t target)
+        {
+            while (!stopped_ && tick() < target)
+                stepOnce(nullptr);
+        }
+
+        void event(uint64_t at, const std::string &name)
+        {
+            if (at > 0)
+                idleUntil(at - 1);
+            if (!stopped_)
+            {
+                ++events_;
+                stepOnce(name.c_str());
+            }
+        }
+
+    private:
+        struct Invariant
+        {
+            std::string source;
+            snippet::Program program;
+        };
+
+        void stepOnce(const char *event)
+        {
+            step(handle_, event);
+            ++steps_;
+            if (csv_)
+                writeRow(event ? event : "");
+            checkInvariants();
+        }
+
+        void writeRow(const char *event)
+        {
+            *csv_ << tick() << "," << csvField(event) << "," << csvField(session_.stateName());
+            for (const std::string &name : columns_)
+                *csv_ << "," << csvValue(session_.variable(name));
+            *csv_ << "\n";
+        }
+
+        void checkInvariants()
+        {
+            for (const Invariant &invariant : invariants_)
+            {
+                std::string failure;
+                try
+                {
+                    if (session_.check(invariant.program))
+                        continue;
+                }
+                catch (const snippet::EvalError &e)
+                {
+                    failure = std::string(" (") + e.what() + ")";
+                }
+                ++violations_;
+                std::string reason = "invariant violated: " + invariant.source;
+                std::cerr << "fsm_run: tick " << tick() << ", state " << session_.stateName() << ": " << reason
+                          << failure << "\n";
+                if (violations_ == 1 && fsm_flight_recorder_trigger(handle_, reason.c_str()) && !config_.quiet)
+                    std::cerr << "fsm_run: flight recorder written to " << config_.flight_dump << "\n";
+                if (!config_.keep_going)
+                {
+                    stopped_ = true;
+                    return;
+                }
+            }
+        }
+
+        const Config &config_;
+        FSM_HANDLE handle_;
+        Session &session_;
+        std::ostream *csv_;
+        std::vector<std::string> columns_;
+        std::vector<Invariant> invariants_;
+        uint64_t steps_ = 0;
+        uint64_t events_ = 0;
+        uint64_t violations_ = 0;
+        bool stopped_ = false;
+    };
+
+    bool endsWith(const std::string &text, const std::string &suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    bool readFile(const std::string &path, std::string *out)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        *out = buffer.str();
+        return true;
+    }
+
+    bool parseArgs(int argc, char **argv, Config *config)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&]() -> const char *
+            { return i + 1 < argc ? argv[++i] : nullptr; };
+            const char *v = nullptr;
+            if (arg == "--keep-going")
+                config->keep_going = true;
+            else if (arg == "--strict")
+                config->strict = true;
+            else if (arg == "--quiet")
+                config->quiet = true;
+            else if (arg == "--events" && (v = value()))
+                config->events = v;
+            else if (arg == "--vars" && (v = value()))
+                config->vars = v;
+            else if (arg == "--ticks" && (v = value()))
+                config->ticks = std::strtoull(v, nullptr, 10);
+            else if (arg == "--trace" && (v = value()))
+                config->trace = v;
+            else if (arg == "--csv" && (v = value()))
+                config->csv = v;
+            else if (arg == "--invariant" && (v = value()))
+                config->invariants.push_back(v);
+            else if (arg == "--expect-state" && (v = value()))
+            {
+                config->expect_state = v;
+                config->has_expect_state = true;
+            }
+            else if (arg == "--flight-dump" && (v = value()))
+                config->flight_dump = v;
+            else if (!arg.empty() && arg[0] != '-' && config->model.empty())
+                config->model = arg;
+            else
+                return false;
+        }
+        return !config->model.empty();
+    }
+
+    FSM_MODEL loadModel(const std::string &path)
+    {
+        FSM_MODEL model = endsWith(path, ".fsmb") ? fsm_model_open(path.c_str()) : fsm_model_compile_file(path.c_str());
+        if (!model)
+        {
+            int64_t offset = -1;
+            std::string error = takeString(fsm_get_load_error(&offset));
+            std::cerr << "fsm_run: cannot load " << path;
+            if (!error.empty())
+                std::cerr << ": " << error;
+            if (offset >= 0)
+                std::cerr << " (at byte " << offset << ")";
+            std::cerr << "\n";
+        }
+        return model;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Config config;
+    if (!parseArgs(argc, argv, &config))
+    {
+        std::cerr << "usage: fsm_run MODEL [--events FILE|-] [--vars JSON|@FILE] [--ticks N]\n"
+                     "               [--trace FILE] [--csv FILE|-] [--invariant EXPR]...\n"
+                     "               [--expect-state NAME] [--flight-dump FILE] [--keep-going]\n"
+                     "               [--strict] [--quiet]\n";
+        return EXIT_USAGE;
+    }
+
+    json vars = json::object();
+    if (!config.vars.empty())
+    {
+        std::string text = config.vars;
+        if (text[0] == '@' && !readFile(text.substr(1), &text))
+        {
+            std::cerr << "fsm_run: cannot read " << config.vars.substr(1) << "\n";
+            return EXIT_USAGE;
+        }
+        vars = json::parse(text, nullptr, false);
+        if (!vars.is_object())
+        {
+            std::cerr << "fsm_run: --vars must be a JSON object\n";
+            return EXIT_USAGE;
+        }
+    }
+
+    std::ifstream events_file;
+    std::istream *events = nullptr;
+    if (config.events == "-")
+        events = &std::cin;
+    else if (!config.events.empty())
+    {
+        events_file.open(config.events);
+        if (!events_file)
+        {
+            std::cerr << "fsm_run: cannot read " << config.events << "\n";
+            return EXIT_USAGE;
+        }
+        events = &events_file;
+    }
+
+    std::ofstream csv_file;
+    std::ostream *csv = nullptr;
+    if (config.csv == "-")
+        csv = &std::cout;
+    else if (!config.csv.empty())
+    {
+        csv_file.open(config.csv);
+        if (!csv_file)
+        {
+            std::cerr << "fsm_run: cannot write " << config.csv << "\n";
+            return EXIT_USAGE;
+        }
+        csv = &csv_file;
+    }
+
+    // --- Load ---
+    FSM_MODEL model = loadModel(config.model);
+    if (!model)
+        return EXIT_USAGE;
+    FSM_HANDLE handle = create_fsm();
+    std::string vars_json = vars.dump();
+    set_initial_variables_from_json(handle, vars_json.c_str());
+    bool loaded = fsm_load_model(handle, model);
+    fsm_model_release(model);
+    if (!loaded)
+    {
+        std::cerr << "fsm_run: cannot load " << config.model << ": " << takeString(fsm_get_load_error(nullptr)) << "\n";
+        destroy_fsm(handle);
+        return EXIT_USAGE;
+    }
+
+    Session session(handle);
+    session.loadCodeTable();
+    session.setInitialVariables(vars);
+    Runner runner(config, handle, session, csv);
+    for (const std::string &source : config.invariants)
+    {
+        if (!runner.addInvariant(source))
+        {
+            destroy_fsm(handle);
+            return EXIT_USAGE;
+        }
+    }
+
+    if (!config.flight_dump.empty())
+        fsm_flight_recorder_set_dump_path(handle, config.flight_dump.c_str());
+    if (!config.trace.empty() && !fsm_trace_open(handle, config.trace.c_str()))
+    {
+        std::cerr << "fsm_run: cannot write " << config.trace << "\n";
+        destroy_fsm(handle);
+        return EXIT_USAGE;
+    }
+    fsm_set_callbacks(handle, &Session::onGuard, &Session::onAction, &session);
+
+    // --- Run ---
+    Clock::time_point start = Clock::now();
+    reset_fsm(handle);
+    runner.start();
+
+    std::string script_error;
+    if (events)
+    {
+        ScriptReader reader(*events);
+        ScriptEntry entry;
+        while (!runner.stopped() && reader.next(&entry))
+        {
+            switch (entry.kind)
+            {
+            case ScriptEntry::EVENT:
+                runner.event(entry.tick, entry.name);
+                break;
+            case ScriptEntry::SET:
+                runner.idleUntil(entry.tick > 0 ? entry.tick - 1 : 0);
+                session.setVariable(entry.name, json::parse(entry.value));
+                break;
+            case ScriptEntry::IDLE:
+                runner.idleUntil(entry.tick);
+                break;
+            }
+        }
+        script_error = reader.error();
+    }
+    if (script_error.empty())
+        runner.idleUntil(config.ticks);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    bool trace_failed = !config.trace.empty() && !fsm_trace_close(handle);
+    if (csv)
+        csv->flush();
+
+    std::string final_state = session.stateName();
+    int exit_code = EXIT_OK;
+    if (!script_error.empty())
+    {
+        std::cerr << "fsm_run: " << (config.events == "-" ? "stdin" : config.events) << ": " << script_error << "\n";
+        exit_code = EXIT_USAGE;
+    }
+    else if (runner.violations() > 0)
+        exit_code = EXIT_VIOLATION;
+    else if (config.has_expect_state && final_state != config.expect_state)
+    {
+        std::cerr << "fsm_run: final state " << final_state << ", expected " << config.expect_state << "\n";
+        exit_code = EXIT_VIOLATION;
+    }
+    else if (config.strict && (session.unsupported() > 0 || session.errors() > 0))
+        exit_code = EXIT_SNIPPET;
+    if (trace_failed)
+    {
+        std::cerr << "fsm_run: error writing " << config.trace << ", the trace is truncated\n";
+        if (exit_code == EXIT_OK)
+            exit_code = EXIT_USAGE;
+    }
+
+    if (!config.quiet)
+    {
+        std::fprintf(stderr,
+                     "fsm_run: %llu steps (%llu events) to tick %llu in %.3f s (%.0f steps/s), final state %s; "
+                     "%llu invariant violations, %llu unsupported snippets, %llu snippet errors\n",
+                     static_cast<unsigned long long>(runner.steps()), static_cast<unsigned long long>(runner.events()),
+                     static_cast<unsigned long long>(runner.tick()), seconds,
+                     seconds > 0 ? runner.steps() / seconds : 0.0, final_state.c_str(),
+                     static_cast<unsigned long long>(runner.violations()),
+                     static_cast<unsigned long long>(session.unsupported()),
+                     static_cast<unsigned long long>(session.errors()));
+    }
+
+    fsm_set_callbacks(handle, nullptr, nullptr, nullptr);
+    destroy_fsm(handle);
+    return exit_code;
+}
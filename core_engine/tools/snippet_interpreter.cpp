@@ -0,0 +1,1284 @@
+
+#include "snippet_interpreter.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+namespace snippet
+{
+    namespace
+    {
+        enum Op : uint8_t
+        {
+            OP_NONE,
+            OP_ADD,
+            OP_SUB,
+            OP_MUL,
+            OP_DIV,
+            OP_FLOORDIV,
+            OP_MOD,
+            OP_POW,
+            OP_NEG,
+            OP_POS,
+            OP_NOT,
+            OP_EQ,
+            OP_NE,
+            OP_LT,
+            OP_LE,
+            OP_GT,
+            OP_GE
+        };
+
+        enum Function : uint8_t
+        {
+            FN_ABS,
+            FN_MIN,
+            FN_MAX,
+            FN_INT,
+            FN_FLOAT,
+            FN_BOOL,
+            FN_ROUND,
+            FN_SEND,
+            FN_PRINT
+        };
+
+        struct FunctionName
+        {
+            std::string_view name;
+            Function id;
+        };
+
+        constexpr FunctionName kFunctions[] = {{"abs", FN_ABS},     {"min", FN_MIN},     {"max", FN_MAX},
+                                               {"int", FN_INT},     {"float", FN_FLOAT}, {"bool", FN_BOOL},
+                                               {"round", FN_ROUND}, {"print", FN_PRINT}};
+
+        // Python keywords that start something this subset does not run.
+        constexpr std::string_view kUnsupportedKeywords[] = {
+            "if",     "elif",   "else",   "for",   "while",  "def",    "class", "return", "import", "from",
+            "lambda", "global", "nonlocal", "try", "except", "finally", "with", "del",    "yield",  "raise",
+            "assert", "break",  "continue", "is",  "in"};
+
+        const char *typeName(const Value &v)
+        {
+            switch (v.type)
+            {
+            case Value::NONE:
+                return "NoneType";
+            case Value::BOOL:
+                return "bool";
+            case Value::INT:
+                return "int";
+            case Value::REAL:
+                return "float";
+            case Value::STRING:
+                return "str";
+            default:
+                return "undefined";
+            }
+        }
+
+        [[noreturn]] void typeError(const char *what, const Value &l, const Value &r)
+        {
+            throw EvalError(std::string("TypeError: unsupported operand type(s) for ") + what + ": '" + typeName(l) +
+                            "' and '" + typeName(r) + "'");
+        }
+
+        const char *opSymbol(uint8_t op)
+        {
+            static const char *const kSymbols[] = {"",  "+", "-",  "*",  "/",  "//", "%", "**", "-",
+                                                   "+", "not", "==", "!=", "<", "<=", ">", ">="};
+            return op < sizeof(kSymbols) / sizeof(kSymbols[0]) ? kSymbols[op] : "?";
+        }
+
+        // Snippet ints are 64-bit; where a Python int would grow, they raise.
+        [[noreturn]] void intOverflow()
+        {
+            throw EvalError("OverflowError: integer result does not fit in 64 bits");
+        }
+
+        int64_t checkedAdd(int64_t a, int64_t b)
+        {
+            int64_t result;
+#if defined(__GNUC__) || defined(__clang__)
+            if (__builtin_add_overflow(a, b, &result))
+                intOverflow();
+#else
+            if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b))
+                intOverflow();
+            result = a + b;
+#endif
+            return result;
+        }
+
+        int64_t checkedSub(int64_t a, int64_t b)
+        {
+            int64_t result;
+#if defined(__GNUC__) || defined(__clang__)
+            if (__builtin_sub_overflow(a, b, &result))
+                intOverflow();
+#else
+            if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b))
+                intOverflow();
+            result = a - b;
+#endif
+            return result;
+        }
+
+        int64_t checkedMul(int64_t a, int64_t b)
+        {
+            int64_t result;
+#if defined(__GNUC__) || defined(__clang__)
+            if (__builtin_mul_overflow(a, b, &result))
+                intOverflow();
+#else
+            if (a > 0 ? (b > 0 ? a > INT64_MAX / b : b < INT64_MIN / a)
+                      : (b > 0 ? a < INT64_MIN / b : a != 0 && b < INT64_MAX / a))
+                intOverflow();
+            result = a * b;
+#endif
+            return result;
+        }
+
+        // b != 0. A -1 divisor is split off: INT64_MIN / -1 traps.
+        int64_t floorDiv(int64_t a, int64_t b)
+        {
+            if (b == -1)
+                return checkedSub(0, a);
+            int64_t q = a / b;
+            if ((a % b != 0) && ((a < 0) != (b < 0)))
+                --q;
+            return q;
+        }
+
+        int64_t floorMod(int64_t a, int64_t b)
+        {
+            if (b == -1)
+                return 0;
+            int64_t m = a % b;
+            if (m != 0 && ((m < 0) != (b < 0)))
+                m += b;
+            return m;
+        }
+
+        // b >= 0, by squaring so a huge exponent costs at most 64 rounds.
+        int64_t intPow(int64_t a, int64_t b)
+        {
+            if (a == 0 || a == 1)
+                return b == 0 ? 1 : a;
+            if (a == -1)
+                return b % 2 == 0 ? 1 : -1;
+            int64_t result = 1;
+            while (b > 0)
+            {
+                if (b & 1)
+                    result = checkedMul(result, a);
+                b >>= 1;
+                if (b > 0)
+                    a = checkedMul(a, a); // |a| >= 2, so the result would overflow as well
+            }
+            return result;
+        }
+
+        // Python's float floor division and modulo (floatobject.c), which a
+        // plain floor(a / b) gets wrong for signed zeros and rounded quotients.
+        double floatMod(double a, double b)
+        {
+            double m = std::fmod(a, b);
+            if (m != 0.0)
+            {
+                if ((b < 0.0) != (m < 0.0))
+                    m += b;
+            }
+            else
+                m = std::copysign(0.0, b);
+            return m;
+        }
+
+        double floatFloorDiv(double a, double b)
+        {
+            double m = std::fmod(a, b);
+            double div = (a - m) / b;
+            if (m != 0.0 && ((b < 0.0) != (m < 0.0)))
+                div -= 1.0;
+            if (div == 0.0)
+                return std::copysign(0.0, a / b);
+            double floored = std::floor(div);
+            return div - floored > 0.5 ? floored + 1.0 : floored;
+        }
+
+        // int() of a float: truncates, and fails where Python would need a big int.
+        int64_t truncToInt(double v)
+        {
+            if (std::isnan(v))
+                throw EvalError("ValueError: cannot convert float NaN to integer");
+            if (std::isinf(v))
+                throw EvalError("OverflowError: cannot convert float infinity to integer");
+            v = std::trunc(v);
+            if (v < -9223372036854775808.0 || v >= 9223372036854775808.0)
+                intOverflow();
+            return static_cast<int64_t>(v);
+        }
+
+        // Longest string a '*' repetition may build.
+        constexpr size_t kMaxRepeatBytes = size_t(1) << 24;
+
+        int64_t intOf(const Value &v) { return v.type == Value::BOOL ? (v.b ? 1 : 0) : v.i; }
+
+        Value binary(uint8_t op, const Value &l, const Value &r)
+        {
+            if (l.isNumber() && r.isNumber())
+            {
+                bool integral = l.type != Value::REAL && r.type != Value::REAL;
+                if (integral && op != OP_DIV && !(op == OP_POW && intOf(r) < 0))
+                {
+                    int64_t a = intOf(l), b = intOf(r);
+                    switch (op)
+                    {
+                    case OP_ADD:
+                        return Value::integer(checkedAdd(a, b));
+                    case OP_SUB:
+                        return Value::integer(checkedSub(a, b));
+                    case OP_MUL:
+                        return Value::integer(checkedMul(a, b));
+                    case OP_FLOORDIV:
+                    case OP_MOD:
+                        if (b == 0)
+                            throw EvalError("ZeroDivisionError: integer division or modulo by zero");
+                        return Value::integer(op == OP_MOD ? floorMod(a, b) : floorDiv(a, b));
+                    case OP_POW:
+                        return Value::integer(intPow(a, b));
+                    }
+                }
+
+                double a = l.asReal(), b = r.asReal();
+                switch (op)
+                {
+                case OP_ADD:
+                    return Value::real(a + b);
+                case OP_SUB:
+                    return Value::real(a - b);
+                case OP_MUL:
+                    return Value::real(a * b);
+                case OP_DIV:
+                case OP_FLOORDIV:
+                case OP_MOD:
+                    if (b == 0.0)
+                        throw EvalError("ZeroDivisionError: division by zero");
+                    if (op == OP_DIV)
+                        return Value::real(a / b);
+                    return Value::real(op == OP_FLOORDIV ? floatFloorDiv(a, b) : floatMod(a, b));
+                case OP_POW:
+                {
+                    if (a == 0.0 && b < 0.0 && std::isfinite(b))
+                        throw EvalError("ZeroDivisionError: 0.0 cannot be raised to a negative power");
+                    if (a < 0.0 && std::isfinite(a) && std::isfinite(b) && b != std::floor(b))
+                    {
+                        // Python goes complex here, and overflows like the magnitude would
+                        if (std::isinf(std::pow(-a, b)))
+                            throw EvalError("OverflowError: numerical result out of range");
+                        throw EvalError("ValueError: complex results are not supported");
+                    }
+                    double result = std::pow(a, b);
+                    if (std::isinf(result) && std::isfinite(a) && std::isfinite(b))
+                        throw EvalError("OverflowError: numerical result out of range");
+                    return Value::real(result);
+                }
+                }
+            }
+            if (l.type == Value::STRING && r.type == Value::STRING && op == OP_ADD)
+                return Value::string(l.s + r.s);
+            if (l.type == Value::STRING && (r.type == Value::INT || r.type == Value::BOOL) && op == OP_MUL)
+            {
+                int64_t n = intOf(r);
+                if (n <= 0 || l.s.empty())
+                    return Value::string(std::string());
+                if (static_cast<uint64_t>(n) > kMaxRepeatBytes / l.s.size())
+                    throw EvalError("MemoryError: repeated string would be longer than " +
+                                    std::to_string(kMaxRepeatBytes) + " bytes");
+                std::string repeated;
+                repeated.reserve(l.s.size() * static_cast<size_t>(n));
+                for (; n > 0; --n)
+                    repeated += l.s;
+                return Value::string(std::move(repeated));
+            }
+            typeError(opSymbol(op), l, r);
+        }
+
+        bool compare(uint8_t op, const Value &l, const Value &r)
+        {
+            int order = 0;
+            if (l.isNumber() && r.isNumber())
+            {
+                if (l.type != Value::REAL && r.type != Value::REAL)
+                    order = intOf(l) < intOf(r) ? -1 : intOf(l) > intOf(r) ? 1 : 0;
+                else
+                {
+                    double a = l.asReal(), b = r.asReal();
+                    if (std::isnan(a) || std::isnan(b))
+                        return op == OP_NE;
+                    order = a < b ? -1 : a > b ? 1 : 0;
+                }
+            }
+            else if (l.type == Value::STRING && r.type == Value::STRING)
+                order = l.s.compare(r.s);
+            else if (op == OP_EQ || op == OP_NE)
+                return (op == OP_EQ) == (l.type == r.type && l.type == Value::NONE);
+            else
+                throw EvalError(std::string("TypeError: '") + opSymbol(op) + "' not supported between instances of '" +
+                                typeName(l) + "' and '" + typeName(r) + "'");
+
+            switch (op)
+            {
+            case OP_EQ:
+                return order == 0;
+            case OP_NE:
+                return order != 0;
+            case OP_LT:
+                return order < 0;
+            case OP_LE:
+                return order <= 0;
+            case OP_GT:
+                return order > 0;
+            default:
+                return order >= 0;
+            }
+        }
+
+        struct ParseError
+        {
+            std::string message;
+        };
+
+        struct Token
+        {
+            enum Kind : uint8_t
+            {
+                END,
+                NEWLINE,
+                INDENT,
+                DEDENT,
+                NUMBER,
+                STRING,
+                NAME,
+                OP
+            };
+
+            Kind kind = END;
+            std::string_view text;
+            Value value; // NUMBER and STRING
+        };
+
+        bool isNameStart(char c) { return std::isalpha(static_cast<unsigned char>(c)) || c == '_'; }
+        bool isNameChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+        std::vector<Token> tokenize(std::string_view src)
+        {
+            std::vector<Token> tokens;
+            std::vector<size_t> indents; // Widths of the open blocks; the first line sets the base
+            int brackets = 0;            // Newlines inside brackets do not end a statement
+            size_t i = 0;
+            bool line_start = true;
+            while (i < src.size())
+            {
+                if (line_start && brackets == 0)
+                {
+                    size_t width = 0;
+                    while (i < src.size() && (src[i] == ' ' || src[i] == '\t' || src[i] == '\r'))
+                    {
+                        if (src[i] != '\r')
+                            width = src[i] == '\t' ? (width / 8 + 1) * 8 : width + 1;
+                        ++i;
+                    }
+                    if (i >= src.size() || src[i] == '\n' || src[i] == '#')
+                    {
+                        while (i < src.size() && src[i] != '\n')
+                            ++i;
+                        ++i;
+                        continue;
+                    }
+                    line_start = false;
+                    if (indents.empty())
+                        indents.push_back(width);
+                    else if (width > indents.back())
+                    {
+                        indents.push_back(width);
+                        tokens.push_back({Token::INDENT, {}, {}});
+                    }
+                    else
+                    {
+                        while (!indents.empty() && width < indents.back())
+                        {
+                            indents.pop_back();
+                            tokens.push_back({Token::DEDENT, {}, {}});
+                        }
+                        if (indents.empty() || width != indents.back())
+                            throw ParseError{"unindent does not match any outer indentation level"};
+                    }
+                    continue;
+                }
+
+                char c = src[i];
+                if (c == '\n')
+                {
+                    if (brackets == 0)
+                    {
+                        tokens.push_back({Token::NEWLINE, src.substr(i, 1), {}});
+                        line_start = true;
+                    }
+                    ++i;
+                    continue;
+                }
+                if (c == ' ' || c == '\t' || c == '\r')
+                {
+                    ++i;
+                    continue;
+                }
+                if (c == '#')
+                {
+                    while (i < src.size() && src[i] != '\n')
+                        ++i;
+                    continue;
+                }
+
+                // String literals, with an optional f/r/b prefix (the prefix is not interpreted)
+                size_t prefix = 0;
+                while (prefix < 2 && i + prefix < src.size() && std::strchr("fFrRbBuU", src[i + prefix]) &&
+                       src[i + prefix] != '\0')
+                    ++prefix;
+                if (i + prefix < src.size() && (src[i + prefix] == '\'' || src[i + prefix] == '"') &&
+                    (prefix == 0 || !isNameChar(i > 0 ? src[i - 1] : ' ')))
+                {
+                    char quote = src[i + prefix];
+                    size_t start = i;
+                    i += prefix + 1;
+                    std::string text;
+                    while (i < src.size() && src[i] != quote)
+                    {
+                        if (src[i] == '\n')
+                            throw ParseError{"unterminated string"};
+                        if (src[i] == '\\' && i + 1 < src.size())
+                        {
+                            char e = src[++i];
+                            text += e == 'n' ? '\n' : e == 't' ? '\t' : e == 'r' ? '\r' : e == '0' ? '\0' : e;
+                        }
+                        else
+                            text += src[i];
+                        ++i;
+                    }
+                    if (i >= src.size())
+                        throw ParseError{"unterminated string"};
+                    ++i;
+                    tokens.push_back({Token::STRING, src.substr(start, i - start), Value::string(std::move(text))});
+                    continue;
+                }
+
+                if (isNameStart(c))
+                {
+                    size_t start = i;
+                    while (i < src.size() && isNameChar(src[i]))
+                        ++i;
+                    tokens.push_back({Token::NAME, src.substr(start, i - start), {}});
+                    continue;
+                }
+
+                if (std::isdigit(static_cast<unsigned char>(c)) ||
+                    (c == '.' && i + 1 < src.size() && std::isdigit(static_cast<unsigned char>(src[i + 1]))))
+                {
+                    size_t start = i;
+                    bool real = false;
+                    while (i < src.size())
+                    {
+                        char d = src[i];
+                        if (d == '.' || ((d == 'e' || d == 'E') && !(i > start + 1 && (src[start + 1] == 'x' || src[start + 1] == 'X'))))
+                        {
+                            real = true;
+                            if ((d == 'e' || d == 'E') && i + 1 < src.size() && (src[i + 1] == '+' || src[i + 1] == '-'))
+                                ++i;
+                        }
+                        else if (!isNameChar(d))
+                            break;
+                        ++i;
+                    }
+                    std::string digits;
+                    for (char d : src.substr(start, i - start))
+                        if (d != '_')
+                            digits += d;
+                    char *end = nullptr;
+                    errno = 0;
+                    Value value = real ? Value::real(std::strtod(digits.c_str(), &end))
+                                       : Value::integer(static_cast<int64_t>(std::strtoll(digits.c_str(), &end, 0)));
+                    if (end != digits.c_str() + digits.size())
+                        throw ParseError{"invalid number '" + digits + "'"};
+                    if (!real && errno == ERANGE)
+                        throw ParseError{"integer literal '" + digits + "' does not fit in 64 bits"};
+                    tokens.push_back({Token::NUMBER, src.substr(start, i - start), std::move(value)});
+                    continue;
+                }
+
+                static constexpr std::string_view kOperators[] = {"**=", "//=", "==", "!=", "<=", ">=", "**", "//",
+                                                                  "+=",  "-=",  "*=", "/=", "%=", "+",  "-",  "*",
+                                                                  "/",   "%",   "<",  ">",  "=",  "(",  ")",  ",",
+                                                                  ".",   ":",   ";"};
+                bool matched = false;
+                for (std::string_view op : kOperators)
+                {
+                    if (src.substr(i, op.size()) == op)
+                    {
+                        if (op == "(")
+                            ++brackets;
+                        else if (op == ")" && brackets > 0)
+                            --brackets;
+                        tokens.push_back({Token::OP, src.substr(i, op.size()), {}});
+                        i += op.size();
+                        matched = true;
+                        break;
+                    }
+                }
+                if (!matched)
+                    throw ParseError{std::string("unsupported syntax '") + c + "'"};
+            }
+            if (!tokens.empty() && tokens.back().kind != Token::NEWLINE)
+                tokens.push_back({Token::NEWLINE, {}, {}});
+            for (size_t open = indents.size(); open > 1; --open)
+                tokens.push_back({Token::DEDENT, {}, {}});
+            tokens.push_back({Token::END, {}, {}});
+            return tokens;
+        }
+    }
+
+    // --- Value ---
+
+    Value Value::none()
+    {
+        Value v;
+        v.type = NONE;
+        return v;
+    }
+
+    Value Value::boolean(bool value)
+    {
+        Value v;
+        v.type = BOOL;
+        v.b = value;
+        return v;
+    }
+
+    Value Value::integer(int64_t value)
+    {
+        Value v;
+        v.type = INT;
+        v.i = value;
+        return v;
+    }
+
+    Value Value::real(double value)
+    {
+        Value v;
+        v.type = REAL;
+        v.r = value;
+        return v;
+    }
+
+    Value Value::string(std::string value)
+    {
+        Value v;
+        v.type = STRING;
+        v.s = std::move(value);
+        return v;
+    }
+
+    bool Value::truthy() const
+    {
+        switch (type)
+        {
+        case BOOL:
+            return b;
+        case INT:
+            return i != 0;
+        case REAL:
+            return r != 0.0;
+        case STRING:
+            return !s.empty();
+        default:
+            return false;
+        }
+    }
+
+    std::string Value::toJson() const
+    {
+        switch (type)
+        {
+        case BOOL:
+            return b ? "true" : "false";
+        case INT:
+            return std::to_string(i);
+        case REAL:
+            return std::isfinite(r) ? nlohmann::json(r).dump() : "null";
+        case STRING:
+            return nlohmann::json(s).dump();
+        default:
+            return "null";
+        }
+    }
+
+    // --- SymbolTable / Environment ---
+
+    uint32_t SymbolTable::intern(std::string_view name)
+    {
+        auto [it, inserted] = slots_.try_emplace(std::string(name), static_cast<uint32_t>(names_.size()));
+        if (inserted)
+            names_.push_back(it->first);
+        return it->second;
+    }
+
+    uint32_t SymbolTable::find(std::string_view name) const
+    {
+        auto it = slots_.find(std::string(name));
+        return it == slots_.end() ? kNoSlot : it->second;
+    }
+
+    void Environment::resize(uint32_t slots)
+    {
+        vars.resize(slots);
+        is_dirty.resize(slots, 0);
+    }
+
+    void Environment::assign(uint32_t slot, Value value)
+    {
+        vars[slot] = std::move(value);
+        if (!is_dirty[slot])
+        {
+            is_dirty[slot] = 1;
+            dirty.push_back(slot);
+        }
+    }
+
+    void Environment::clearDirty()
+    {
+        for (uint32_t slot : dirty)
+            is_dirty[slot] = 0;
+        dirty.clear();
+    }
+
+    // --- Parser ---
+
+    // Recursive descent over Python's statement and expression grammar,
+    // producing the flat statement and node arrays of a Program.
+    class Parser
+    {
+    public:
+        Parser(std::string_view source, SymbolTable &symbols, Program &program)
+            : tokens_(tokenize(source)), symbols_(symbols), program_(program)
+        {
+            program_.symbols_ = &symbols;
+        }
+
+        void statements()
+        {
+            while (peek().kind != Token::END)
+            {
+                if (accept(Token::NEWLINE))
+                    continue;
+                statementLine();
+            }
+        }
+
+        void expression()
+        {
+            skipNewlines();
+            push(SymbolTable::kNoSlot, 0, test());
+            skipNewlines();
+            if (peek().kind != Token::END)
+                fail("unexpected '" + std::string(peek().text) + "'");
+        }
+
+    private:
+        const Token &peek(size_t ahead = 0) const { return tokens_[std::min(pos_ + ahead, tokens_.size() - 1)]; }
+        const Token &next() { return tokens_[pos_ < tokens_.size() - 1 ? pos_++ : pos_]; }
+        bool isOp(std::string_view op, size_t ahead = 0) const
+        {
+            return peek(ahead).kind == Token::OP && peek(ahead).text == op;
+        }
+        bool isName(std::string_view name) const { return peek().kind == Token::NAME && peek().text == name; }
+        bool accept(Token::Kind kind)
+        {
+            if (peek().kind != kind)
+                return false;
+            next();
+            return true;
+        }
+        bool acceptOp(std::string_view op)
+        {
+            if (!isOp(op))
+                return false;
+            next();
+            return true;
+        }
+        void expectOp(std::string_view op)
+        {
+            if (!acceptOp(op))
+                fail("expected '" + std::string(op) + "'");
+        }
+        void skipNewlines()
+        {
+            while (accept(Token::NEWLINE))
+            {
+            }
+        }
+        [[noreturn]] void fail(const std::string &message) const { throw ParseError{message}; }
+
+        uint32_t add(Program::Node node)
+        {
+            program_.nodes_.push_back(node);
+            return static_cast<uint32_t>(program_.nodes_.size() - 1);
+        }
+
+        uint32_t constant(Value value)
+        {
+            program_.constants_.push_back(std::move(value));
+            return add({Program::CONSTANT, 0, static_cast<uint32_t>(program_.constants_.size() - 1)});
+        }
+
+        void checkName(std::string_view name) const
+        {
+            for (std::string_view keyword : kUnsupportedKeywords)
+                if (name == keyword)
+                    fail("'" + std::string(name) + "' is not supported");
+        }
+
+        void push(uint32_t slot, uint8_t op, uint32_t expr)
+        {
+            Program::Statement statement;
+            statement.slot = slot;
+            statement.op = op;
+            statement.expr = expr;
+            program_.statements_.push_back(statement);
+        }
+
+        uint32_t statementCount() const { return static_cast<uint32_t>(program_.statements_.size()); }
+
+        void statementLine()
+        {
+            if (isName("if"))
+            {
+                next();
+                ifStatement();
+            }
+            else
+                simpleStatements();
+        }
+
+        // statement (';' statement)* [';'] NEWLINE
+        void simpleStatements()
+        {
+            statement();
+            while (acceptOp(";"))
+            {
+                if (peek().kind == Token::NEWLINE || peek().kind == Token::END)
+                    break;
+                statement();
+            }
+            if (!accept(Token::NEWLINE) && peek().kind != Token::END)
+                fail(peek().kind == Token::INDENT ? "unexpected indent" : "expected end of statement");
+        }
+
+        // After 'if' or 'elif'.
+        void ifStatement()
+        {
+            Program::Statement statement;
+            statement.is_if = true;
+            statement.expr = test();
+            uint32_t index = statementCount();
+            program_.statements_.push_back(statement);
+            expectOp(":");
+            suite();
+            program_.statements_[index].body_end = statementCount();
+            if (isName("elif"))
+            {
+                next();
+                ifStatement();
+            }
+            else if (isName("else"))
+            {
+                next();
+                expectOp(":");
+                suite();
+            }
+            program_.statements_[index].end = statementCount();
+        }
+
+        void suite()
+        {
+            if (!accept(Token::NEWLINE))
+            {
+                simpleStatements();
+                return;
+            }
+            if (!accept(Token::INDENT))
+                fail("expected an indented block");
+            while (!accept(Token::DEDENT))
+            {
+                if (peek().kind == Token::END)
+                    fail("unexpected end of block");
+                if (!accept(Token::NEWLINE))
+                    statementLine();
+            }
+        }
+
+        void statement()
+        {
+            if (isName("pass"))
+            {
+                next();
+                return;
+            }
+            if (peek().kind == Token::NAME && peek(1).kind == Token::OP)
+            {
+                static constexpr std::pair<std::string_view, uint8_t> kAssignOps[] = {
+                    {"=", OP_NONE},    {"+=", OP_ADD},       {"-=", OP_SUB}, {"*=", OP_MUL},
+                    {"/=", OP_DIV},    {"//=", OP_FLOORDIV}, {"%=", OP_MOD}, {"**=", OP_POW}};
+                for (const auto &[text, op] : kAssignOps)
+                {
+                    if (peek(1).text == text)
+                    {
+                        std::string_view target = next().text;
+                        checkName(target);
+                        if (target == "True" || target == "False" || target == "None")
+                            fail("cannot assign to " + std::string(target));
+                        next();
+                        uint32_t slot = symbols_.intern(target);
+                        push(slot, op, test());
+                        return;
+                    }
+                }
+            }
+            push(SymbolTable::kNoSlot, 0, test());
+        }
+
+        // body if condition else other
+        uint32_t test()
+        {
+            uint32_t body = orTest();
+            if (!isName("if"))
+                return body;
+            next();
+            uint32_t condition = orTest();
+            if (!isName("else"))
+                fail("expected 'else'");
+            next();
+            Program::Node node{Program::CONDITIONAL, 0, condition, body};
+            node.first_arg = test();
+            return add(node);
+        }
+
+        uint32_t orTest()
+        {
+            uint32_t left = andTest();
+            while (isName("or"))
+            {
+                next();
+                left = add({Program::OR, 0, left, andTest()});
+            }
+            return left;
+        }
+
+        uint32_t andTest()
+        {
+            uint32_t left = notTest();
+            while (isName("and"))
+            {
+                next();
+                left = add({Program::AND, 0, left, notTest()});
+            }
+            return left;
+        }
+
+        uint32_t notTest()
+        {
+            if (isName("not"))
+            {
+                next();
+                return add({Program::UNARY, OP_NOT, notTest()});
+            }
+            return comparison();
+        }
+
+        // a < b < c is (a < b) and (b < c), with b shared.
+        uint32_t comparison()
+        {
+            static constexpr std::pair<std::string_view, uint8_t> kCompareOps[] = {
+                {"==", OP_EQ}, {"!=", OP_NE}, {"<=", OP_LE}, {">=", OP_GE}, {"<", OP_LT}, {">", OP_GT}};
+            uint32_t left = arith();
+            uint32_t result = 0;
+            bool chained = false;
+            for (;;)
+            {
+                uint8_t op = OP_NONE;
+                for (const auto &[text, id] : kCompareOps)
+                    if (isOp(text))
+                        op = id;
+                if (op == OP_NONE)
+                    break;
+                next();
+                uint32_t right = arith();
+                uint32_t node = add({Program::COMPARE, op, left, right});
+                result = chained ? add({Program::AND, 0, result, node}) : node;
+                chained = true;
+                left = right;
+            }
+            return chained ? result : left;
+        }
+
+        uint32_t arith()
+        {
+            uint32_t left = term();
+            for (;;)
+            {
+                uint8_t op = isOp("+") ? OP_ADD : isOp("-") ? OP_SUB : OP_NONE;
+                if (op == OP_NONE)
+                    return left;
+                next();
+                left = add({Program::BINARY, op, left, term()});
+            }
+        }
+
+        uint32_t term()
+        {
+            uint32_t left = factor();
+            for (;;)
+            {
+                uint8_t op = isOp("*") ? OP_MUL : isOp("/") ? OP_DIV : isOp("//") ? OP_FLOORDIV : isOp("%") ? OP_MOD : OP_NONE;
+                if (op == OP_NONE)
+                    return left;
+                next();
+                left = add({Program::BINARY, op, left, factor()});
+            }
+        }
+
+        uint32_t factor()
+        {
+            if (acceptOp("-"))
+                return add({Program::UNARY, OP_NEG, factor()});
+            if (acceptOp("+"))
+                return add({Program::UNARY, OP_POS, factor()});
+            uint32_t base = atom();
+            if (acceptOp("**"))
+                return add({Program::BINARY, OP_POW, base, factor()});
+            return base;
+        }
+
+        uint32_t call(uint8_t function)
+        {
+            expectOp("(");
+            if (function == FN_PRINT)
+            {
+                // Output is dropped, so the arguments (often f-strings) are never evaluated
+                for (int depth = 1; depth > 0;)
+                {
+                    const Token &token = next();
+                    if (token.kind == Token::END || token.kind == Token::NEWLINE)
+                        fail("expected ')'");
+                    depth += token.kind == Token::OP && token.text == "(" ? 1 : token.kind == Token::OP && token.text == ")" ? -1 : 0;
+                }
+                return add({Program::CALL, function});
+            }
+
+            std::vector<uint32_t> args;
+            if (!isOp(")"))
+            {
+                do
+                    args.push_back(test());
+                while (acceptOp(","));
+            }
+            expectOp(")");
+            Program::Node node{Program::CALL, function};
+            node.first_arg = static_cast<uint32_t>(program_.args_.size());
+            node.arg_count = static_cast<uint32_t>(args.size());
+            program_.args_.insert(program_.args_.end(), args.begin(), args.end());
+            return add(node);
+        }
+
+        uint32_t atom()
+        {
+            const Token &token = next();
+            switch (token.kind)
+            {
+            case Token::NUMBER:
+            case Token::STRING:
+                return constant(token.value);
+            case Token::NAME:
+            {
+                std::string_view name = token.text;
+                if (name == "True" || name == "False")
+                    return constant(Value::boolean(name == "True"));
+                if (name == "None")
+                    return constant(Value::none());
+                checkName(name);
+                if (name == "sm" && isOp("."))
+                {
+                    next();
+                    if (!isName("send"))
+                        fail("only sm.send() is supported");
+                    next();
+                    return call(FN_SEND);
+                }
+                if (isOp("("))
+                {
+                    for (const FunctionName &function : kFunctions)
+                        if (function.name == name)
+                            return call(function.id);
+                    fail("call to '" + std::string(name) + "' is not supported");
+                }
+                if (isOp("."))
+                    fail("attribute access is not supported");
+                return add({Program::NAME, 0, symbols_.intern(name)});
+            }
+            case Token::OP:
+                if (token.text == "(")
+                {
+                    uint32_t inner = test();
+                    expectOp(")");
+                    return inner;
+                }
+                break;
+            default:
+                break;
+            }
+            fail(token.kind == Token::END || token.kind == Token::NEWLINE ? "unexpected end of statement"
+                                                                            : "unexpected '" + std::string(token.text) + "'");
+        }
+
+        std::vector<Token> tokens_;
+        size_t pos_ = 0;
+        SymbolTable &symbols_;
+        Program &program_;
+    };
+
+    // --- Program ---
+
+    Program Program::parseStatements(std::string_view source, SymbolTable &symbols)
+    {
+        Program program;
+        try
+        {
+            Parser(source, symbols, program).statements();
+        }
+        catch (const ParseError &e)
+        {
+            program = Program();
+            program.error_ = e.message;
+        }
+        return program;
+    }
+
+    Program Program::parseExpression(std::string_view source, SymbolTable &symbols)
+    {
+        Program program;
+        try
+        {
+            Parser(source, symbols, program).expression();
+        }
+        catch (const ParseError &e)
+        {
+            program = Program();
+            program.error_ = e.message;
+        }
+        return program;
+    }
+
+    std::vector<uint32_t> Program::assignedSlots() const
+    {
+        std::vector<uint32_t> slots;
+        for (const Statement &statement : statements_)
+            if (statement.slot != SymbolTable::kNoSlot)
+                slots.push_back(statement.slot);
+        return slots;
+    }
+
+    void Program::run(Environment &env, Host &host) const
+    {
+        exec(0, static_cast<uint32_t>(statements_.size()), env, host);
+    }
+
+    void Program::exec(uint32_t begin, uint32_t end, Environment &env, Host &host) const
+    {
+        for (uint32_t index = begin; index < end; ++index)
+        {
+            const Statement &statement = statements_[index];
+            if (statement.is_if)
+            {
+                if (eval(statement.expr, env, host).truthy())
+                    exec(index + 1, statement.body_end, env, host);
+                else
+                    exec(statement.body_end, statement.end, env, host);
+                index = statement.end - 1;
+                continue;
+            }
+            Value value = eval(statement.expr, env, host);
+            if (statement.slot == SymbolTable::kNoSlot)
+                continue;
+            if (statement.op != OP_NONE)
+            {
+                Value current = env.vars[statement.slot];
+                if (current.type == Value::UNDEFINED && !host.lookup(statement.slot, &current))
+                    throw EvalError("NameError: name '" + symbols_->name(statement.slot) + "' is not defined");
+                value = binary(statement.op, current, value);
+            }
+            env.assign(statement.slot, std::move(value));
+        }
+    }
+
+    Value Program::evaluate(Environment &env, Host &host) const
+    {
+        return statements_.empty() ? Value::none() : eval(statements_.front().expr, env, host);
+    }
+
+    Value Program::eval(uint32_t index, Environment &env, Host &host) const
+    {
+        const Node &node = nodes_[index];
+        switch (node.kind)
+        {
+        case CONSTANT:
+            return constants_[node.a];
+        case NAME:
+        {
+            const Value &value = env.vars[node.a];
+            if (value.type != Value::UNDEFINED)
+                return value;
+            Value builtin;
+            if (host.lookup(node.a, &builtin))
+                return builtin;
+            throw EvalError("NameError: name '" + symbols_->name(node.a) + "' is not defined");
+        }
+        case UNARY:
+        {
+            Value operand = eval(node.a, env, host);
+            if (node.op == OP_NOT)
+                return Value::boolean(!operand.truthy());
+            if (operand.type == Value::REAL)
+                return Value::real(node.op == OP_NEG ? -operand.r : operand.r);
+            if (operand.type == Value::INT || operand.type == Value::BOOL)
+                return Value::integer(node.op == OP_NEG ? checkedSub(0, intOf(operand)) : intOf(operand));
+            throw EvalError(std::string("TypeError: bad operand type for unary ") + opSymbol(node.op) + ": '" +
+                            typeName(operand) + "'");
+        }
+        case BINARY:
+        case COMPARE:
+        {
+            // Left first, as Python does; argument order is unspecified in C++
+            Value left = eval(node.a, env, host);
+            Value right = eval(node.b, env, host);
+            return node.kind == BINARY ? binary(node.op, left, right)
+                                       : Value::boolean(compare(node.op, left, right));
+        }
+        case AND:
+        {
+            Value left = eval(node.a, env, host);
+            return left.truthy() ? eval(node.b, env, host) : left;
+        }
+        case OR:
+        {
+            Value left = eval(node.a, env, host);
+            return left.truthy() ? left : eval(node.b, env, host);
+        }
+        case CONDITIONAL:
+            return eval(node.a, env, host).truthy() ? eval(node.b, env, host) : eval(node.first_arg, env, host);
+        case CALL:
+            return call(node, env, host);
+        }
+        return Value::none();
+    }
+
+    Value Program::call(const Node &node, Environment &env, Host &host) const
+    {
+        if (node.op == FN_PRINT)
+            return Value::none();
+
+        std::vector<Value> args;
+        args.reserve(node.arg_count);
+        for (uint32_t i = 0; i < node.arg_count; ++i)
+            args.push_back(eval(args_[node.first_arg + i], env, host));
+        auto arity = [&](uint32_t low, uint32_t high, const char *name)
+        {
+            if (args.size() < low || args.size() > high)
+                throw EvalError(std::string("TypeError: wrong number of arguments to ") + name + "()");
+        };
+
+        switch (node.op)
+        {
+        case FN_ABS:
+            arity(1, 1, "abs");
+            if (args[0].type == Value::REAL)
+                return Value::real(std::fabs(args[0].r));
+            if (args[0].isNumber())
+                return Value::integer(intOf(args[0]) < 0 ? checkedSub(0, intOf(args[0])) : intOf(args[0]));
+            throw EvalError(std::string("TypeError: bad operand type for abs(): '") + typeName(args[0]) + "'");
+        case FN_MIN:
+        case FN_MAX:
+        {
+            arity(1, 0xffffffffu, node.op == FN_MIN ? "min" : "max");
+            size_t best = 0;
+            for (size_t i = 1; i < args.size(); ++i)
+                if (compare(node.op == FN_MIN ? OP_LT : OP_GT, args[i], args[best]))
+                    best = i;
+            return args[best];
+        }
+        case FN_INT:
+            arity(1, 1, "int");
+            if (args[0].type == Value::REAL)
+                return Value::integer(truncToInt(args[0].r));
+            if (args[0].isNumber())
+                return Value::integer(intOf(args[0]));
+            if (args[0].type == Value::STRING)
+            {
+                char *end = nullptr;
+                errno = 0;
+                long long parsed = std::strtoll(args[0].s.c_str(), &end, 10);
+                if (!args[0].s.empty() && *end == '\0')
+                {
+                    if (errno == ERANGE)
+                        intOverflow();
+                    return Value::integer(parsed);
+                }
+            }
+            throw EvalError("ValueError: invalid literal for int()");
+        case FN_FLOAT:
+            arity(1, 1, "float");
+            if (args[0].isNumber())
+                return Value::real(args[0].asReal());
+            if (args[0].type == Value::STRING)
+            {
+                char *end = nullptr;
+                double parsed = std::strtod(args[0].s.c_str(), &end);
+                if (!args[0].s.empty() && *end == '\0')
+                    return Value::real(parsed);
+            }
+            throw EvalError("ValueError: could not convert to float");
+        case FN_BOOL:
+            arity(0, 1, "bool");
+            return Value::boolean(!args.empty() && args[0].truthy());
+        case FN_ROUND:
+        {
+            arity(1, 2, "round");
+            if (!args[0].isNumber())
+                throw EvalError(std::string("TypeError: type ") + typeName(args[0]) + " doesn't define __round__");
+            if (args.size() == 1)
+                return args[0].type == Value::REAL ? Value::integer(truncToInt(std::nearbyint(args[0].r)))
+                                                   : Value::integer(intOf(args[0]));
+            double scale = std::pow(10.0, args[1].asReal());
+            return Value::real(std::nearbyint(args[0].asReal() * scale) / scale);
+        }
+        case FN_SEND:
+            arity(1, 1, "send");
+            if (args[0].type != Value::STRING)
+                throw EvalError("TypeError: sm.send() expects an event name");
+            host.send(args[0].s);
+            return Value::none();
+        }
+        return Value::none();
+    }
+}
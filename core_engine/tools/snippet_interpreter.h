@@ -0,0 +1,174 @@
+
+#ifndef FSM_SNIPPET_INTERPRETER_H
+#define FSM_SNIPPET_INTERPRETER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interpreter for the Python subset that diagram action and condition snippets
+// are written in, so a host without Python can still run a model natively.
+//
+// Supported: int/float/bool/None/string literals, variables, + - * / // % **,
+// comparisons (chained), and/or/not, conditional expressions,
+// abs/min/max/int/float/bool/round, assignments (= += -= *= /= //= %= **=)
+// separated by newlines or ';', if/elif/else blocks, sm.send(event),
+// print(...) (ignored) and pass. Snippets with anything else - loops,
+// functions, other calls - parse as unsupported, and the caller decides
+// whether to skip them. Semantics follow Python: / is true division, // and %
+// floor, and/or return an operand. Ints are 64-bit: a result Python would
+// grow into a big int raises OverflowError instead.
+namespace snippet
+{
+    struct Value
+    {
+        enum Type : uint8_t
+        {
+            UNDEFINED, // Never assigned; reading it is a NameError
+            NONE,
+            BOOL,
+            INT,
+            REAL,
+            STRING
+        };
+
+        Type type = UNDEFINED;
+        bool b = false;
+        int64_t i = 0;
+        double r = 0.0;
+        std::string s;
+
+        static Value none();
+        static Value boolean(bool value);
+        static Value integer(int64_t value);
+        static Value real(double value);
+        static Value string(std::string value);
+
+        bool truthy() const;
+        bool isNumber() const { return type == BOOL || type == INT || type == REAL; }
+        double asReal() const { return type == REAL ? r : type == INT ? static_cast<double>(i) : b ? 1.0 : 0.0; }
+        std::string toJson() const;
+    };
+
+    // Raised while evaluating, with a Python-style message ("NameError: ...").
+    class EvalError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Names -> dense slots, shared by every program of one model so variables
+    // live in a flat array indexed by slot.
+    class SymbolTable
+    {
+    public:
+        uint32_t intern(std::string_view name);
+        uint32_t find(std::string_view name) const; // kNoSlot if never interned
+        const std::string &name(uint32_t slot) const { return names_[slot]; }
+        uint32_t size() const { return static_cast<uint32_t>(names_.size()); }
+
+        static constexpr uint32_t kNoSlot = 0xffffffffu;
+
+    private:
+        std::unordered_map<std::string, uint32_t> slots_;
+        std::vector<std::string> names_;
+    };
+
+    // What a program can reach outside its variables.
+    class Host
+    {
+    public:
+        virtual ~Host() = default;
+        // Value of a name no assignment has defined (e.g. current_tick); false
+        // makes it a NameError.
+        virtual bool lookup(uint32_t slot, Value *out) = 0;
+        virtual void send(const std::string &event) = 0;
+    };
+
+    // Variables of one running model, indexed by SymbolTable slot. Assignments
+    // mark their slot dirty so the host can write just those back.
+    struct Environment
+    {
+        std::vector<Value> vars;
+        std::vector<uint32_t> dirty;
+        std::vector<uint8_t> is_dirty;
+
+        void resize(uint32_t slots);
+        void assign(uint32_t slot, Value value);
+        void clearDirty();
+    };
+
+    class Program
+    {
+    public:
+        // An action (statements) or a condition/invariant (one expression).
+        static Program parseStatements(std::string_view source, SymbolTable &symbols);
+        static Program parseExpression(std::string_view source, SymbolTable &symbols);
+
+        bool supported() const { return error_.empty(); }
+        const std::string &error() const { return error_; } // Why it is unsupported
+
+        // Names the program assigns to.
+        std::vector<uint32_t> assignedSlots() const;
+
+        // Both throw EvalError; env.vars must cover every slot of the table,
+        // which must outlive the program.
+        void run(Environment &env, Host &host) const;
+        Value evaluate(Environment &env, Host &host) const;
+
+    private:
+        friend class Parser;
+
+        enum NodeKind : uint8_t
+        {
+            CONSTANT,
+            NAME,
+            UNARY,
+            BINARY,
+            COMPARE,
+            AND,
+            OR,
+            CONDITIONAL, // b if a else first_arg
+            CALL
+        };
+
+        struct Node
+        {
+            NodeKind kind;
+            uint8_t op = 0;
+            uint32_t a = 0; // Operand node, constant index or slot
+            uint32_t b = 0;
+            uint32_t first_arg = 0; // CALL arguments in args_
+            uint32_t arg_count = 0;
+        };
+
+        // Statements are stored in source order; an IF owns the statements up
+        // to its end, its body being those before body_end and its else
+        // branch the rest (an elif is an IF nested in that branch).
+        struct Statement
+        {
+            bool is_if = false;
+            uint32_t slot = SymbolTable::kNoSlot; // Target; kNoSlot for a bare expression
+            uint8_t op = 0;                        // Augmented assignment operator, 0 for '='
+            uint32_t expr = 0;                     // Value, or the IF condition
+            uint32_t body_end = 0;
+            uint32_t end = 0;
+        };
+
+        void exec(uint32_t begin, uint32_t end, Environment &env, Host &host) const;
+        Value eval(uint32_t node, Environment &env, Host &host) const;
+        Value call(const Node &node, Environment &env, Host &host) const;
+
+        std::vector<Node> nodes_;
+        std::vector<uint32_t> args_;
+        std::vector<Value> constants_;
+        std::vector<Statement> statements_;
+        const SymbolTable *symbols_ = nullptr; // For error messages
+        std::string error_;
+    };
+}
+
+#endif // FSM_SNIPPET_INTERPRETER_H
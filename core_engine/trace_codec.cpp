@@ -0,0 +1,227 @@
+
+#include "trace_codec.h"
+#include "fsm_core.h"
+
+namespace
+{
+    // Runs shorter than this are cheaper as part of a literal block.
+    constexpr size_t kMinRun = 3;
+
+    // Sanity bound for slots read from a file (sizes the per-slot delta table).
+    constexpr uint32_t kMaxSlot = 1u << 24;
+
+    // Header varint: (length << 1) | 1 for a run (one value follows), or
+    // (length << 1) for a literal block (length values follow).
+    void putRleColumn(std::vector<uint8_t> &out, const std::vector<int64_t> &values)
+    {
+        size_t literal_start = 0;
+        size_t i = 0;
+        auto flushLiterals = [&](size_t end)
+        {
+            if (end == literal_start)
+                return;
+            trace::putVarint(out, static_cast<uint64_t>(end - literal_start) << 1);
+            for (size_t j = literal_start; j < end; ++j)
+                trace::putVarint(out, trace::zigzag(values[j]));
+        };
+
+        while (i < values.size())
+        {
+            size_t run = 1;
+            while (i + run < values.size() && values[i + run] == values[i])
+                ++run;
+            if (run >= kMinRun)
+            {
+                flushLiterals(i);
+                trace::putVarint(out, (static_cast<uint64_t>(run) << 1) | 1);
+                trace::putVarint(out, trace::zigzag(values[i]));
+                literal_start = i + run;
+            }
+            i += run;
+        }
+        flushLiterals(values.size());
+    }
+
+    const uint8_t *getRleColumn(const uint8_t *p, const uint8_t *end, size_t count, std::vector<int64_t> &values)
+    {
+        values.clear();
+        while (p && values.size() < count)
+        {
+            uint64_t header;
+            uint64_t value;
+            if (!(p = trace::getVarint(p, end, &header)))
+                return nullptr;
+            uint64_t length = header >> 1;
+            if (length == 0 || length > count - values.size())
+                return nullptr;
+            if (header & 1)
+            {
+                if (!(p = trace::getVarint(p, end, &value)))
+                    return nullptr;
+                values.insert(values.end(), length, trace::unzigzag(value));
+                continue;
+            }
+            for (uint64_t j = 0; j < length; ++j)
+            {
+                if (!(p = trace::getVarint(p, end, &value)))
+                    return nullptr;
+                values.push_back(trace::unzigzag(value));
+            }
+        }
+        return p;
+    }
+}
+
+namespace trace
+{
+    void StepBlockEncoder::add(const TraceStep &step, const TraceVar *vars, size_t count)
+    {
+        TraceStep stored = step;
+        stored.first_var = static_cast<uint32_t>(vars_.size());
+        stored.var_count = static_cast<uint32_t>(count);
+        steps_.push_back(stored);
+        vars_.insert(vars_.end(), vars, vars + count);
+    }
+
+    void StepBlockEncoder::clear()
+    {
+        steps_.clear();
+        vars_.clear();
+    }
+
+    void StepBlockEncoder::encode(std::vector<uint8_t> &out)
+    {
+        if (steps_.empty())
+            return;
+
+        putU32(out, static_cast<uint32_t>(steps_.size()));
+        putU64(out, steps_.front().tick);
+        putU64(out, steps_.back().tick);
+        putU32(out, static_cast<uint32_t>(vars_.size()));
+
+        auto putStepColumn = [&](auto field)
+        {
+            column_.clear();
+            for (const TraceStep &step : steps_)
+                column_.push_back(field(step));
+            putRleColumn(out, column_);
+        };
+
+        uint64_t previous_tick = steps_.front().tick;
+        putStepColumn([&](const TraceStep &step)
+                      {
+                          int64_t delta = static_cast<int64_t>(step.tick - previous_tick);
+                          previous_tick = step.tick;
+                          return delta; });
+        putStepColumn([](const TraceStep &step)
+                      { return static_cast<int64_t>(step.event_id); });
+        putStepColumn([](const TraceStep &step)
+                      { return static_cast<int64_t>(step.transition_id); });
+        putStepColumn([](const TraceStep &step)
+                      { return static_cast<int64_t>(step.state_id); });
+        putStepColumn([](const TraceStep &step)
+                      { return static_cast<int64_t>(step.var_count); });
+
+        column_.clear();
+        for (const TraceVar &var : vars_)
+            column_.push_back(var.slot);
+        putRleColumn(out, column_);
+        column_.clear();
+        for (const TraceVar &var : vars_)
+            column_.push_back(var.type);
+        putRleColumn(out, column_);
+
+        last_ints_.assign(last_ints_.size(), 0);
+        for (const TraceVar &var : vars_)
+        {
+            if (var.type == FSM_VAR_REAL)
+            {
+                putU64(out, var.raw);
+                continue;
+            }
+            if (var.slot >= last_ints_.size())
+                last_ints_.resize(var.slot + 1, 0);
+            // Wrapping unsigned difference: exact for any pair of int64 values.
+            putVarint(out, zigzag(static_cast<int64_t>(var.raw - static_cast<uint64_t>(last_ints_[var.slot]))));
+            last_ints_[var.slot] = static_cast<int64_t>(var.raw);
+        }
+    }
+
+    bool decodeStepBlock(const uint8_t *payload, const uint8_t *end, std::vector<TraceStep> &steps,
+                         std::vector<TraceVar> &vars)
+    {
+        steps.clear();
+        vars.clear();
+        if (end - payload < static_cast<ptrdiff_t>(kBlockHeaderSize))
+            return false;
+
+        uint32_t step_count = getU32(payload);
+        uint64_t tick = getU64(payload + 4);
+        uint32_t change_count = getU32(payload + 20);
+        const uint8_t *p = payload + kBlockHeaderSize;
+
+        // Bound the counts before anything is allocated: blocks never exceed
+        // kBlockSteps, and every change value takes at least one byte.
+        if (step_count > kBlockSteps || change_count > static_cast<uint64_t>(end - p))
+            return false;
+
+        steps.resize(step_count);
+        std::vector<int64_t> column;
+        p = getRleColumn(p, end, step_count, column);
+        for (size_t i = 0; p && i < step_count; ++i)
+        {
+            tick += static_cast<uint64_t>(column[i]);
+            steps[i].tick = tick;
+        }
+        p = p ? getRleColumn(p, end, step_count, column) : nullptr;
+        for (size_t i = 0; p && i < step_count; ++i)
+            steps[i].event_id = static_cast<int32_t>(column[i]);
+        p = p ? getRleColumn(p, end, step_count, column) : nullptr;
+        for (size_t i = 0; p && i < step_count; ++i)
+            steps[i].transition_id = static_cast<int32_t>(column[i]);
+        p = p ? getRleColumn(p, end, step_count, column) : nullptr;
+        for (size_t i = 0; p && i < step_count; ++i)
+            steps[i].state_id = static_cast<int32_t>(column[i]);
+        p = p ? getRleColumn(p, end, step_count, column) : nullptr;
+        uint64_t first_var = 0;
+        for (size_t i = 0; p && i < step_count; ++i)
+        {
+            steps[i].first_var = static_cast<uint32_t>(first_var);
+            steps[i].var_count = static_cast<uint32_t>(column[i]);
+            first_var += steps[i].var_count;
+        }
+        if (!p || first_var != change_count)
+            return false;
+
+        vars.resize(change_count);
+        p = getRleColumn(p, end, change_count, column);
+        for (size_t i = 0; p && i < change_count; ++i)
+            vars[i].slot = static_cast<uint32_t>(column[i]);
+        p = p ? getRleColumn(p, end, change_count, column) : nullptr;
+        for (size_t i = 0; p && i < change_count; ++i)
+            vars[i].type = static_cast<uint8_t>(column[i]);
+        if (!p)
+            return false;
+
+        std::vector<uint64_t> last_ints;
+        for (TraceVar &var : vars)
+        {
+            if (var.type == FSM_VAR_REAL)
+            {
+                if (end - p < 8)
+                    return false;
+                var.raw = getU64(p);
+                p += 8;
+                continue;
+            }
+            uint64_t delta;
+            if (!(p = getVarint(p, end, &delta)) || var.slot >= kMaxSlot)
+                return false;
+            if (var.slot >= last_ints.size())
+                last_ints.resize(var.slot + 1, 0);
+            var.raw = last_ints[var.slot] + static_cast<uint64_t>(unzigzag(delta));
+            last_ints[var.slot] = var.raw;
+        }
+        return true;
+    }
+}
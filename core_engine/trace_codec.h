@@ -0,0 +1,68 @@
+
+#ifndef FSM_TRACE_CODEC_H
+#define FSM_TRACE_CODEC_H
+
+#include "trace_format.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Columnar compression of step records into BLOCK records (format v2).
+//
+// Long recordings are mostly runs of "nothing happened" steps and slowly
+// moving integers, so every column is delta/zigzag-varint encoded and grouped
+// into run-length blocks (a repeated value costs two varints however long the
+// run is) or literal blocks (a header varint followed by the values).
+namespace trace
+{
+    // One variable value as carried by a step (same content as VarValue).
+    struct TraceVar
+    {
+        uint32_t slot;
+        uint8_t type;
+        uint64_t raw; // i64, or IEEE double bits for FSM_VAR_REAL
+    };
+
+    struct TraceStep
+    {
+        uint64_t tick;
+        int32_t event_id;
+        int32_t transition_id;
+        int32_t state_id;
+        uint32_t first_var; // Index of the step's first change in the vars array
+        uint32_t var_count;
+    };
+
+    constexpr size_t kBlockSteps = 1024;
+
+    // Accumulates steps in memory and encodes them as one BLOCK payload.
+    class StepBlockEncoder
+    {
+    public:
+        void add(const TraceStep &step, const TraceVar *vars, size_t count);
+        size_t stepCount() const { return steps_.size(); }
+        bool empty() const { return steps_.empty(); }
+        void clear();
+        size_t memoryBytes() const
+        {
+            return steps_.capacity() * sizeof(TraceStep) + vars_.capacity() * sizeof(TraceVar) +
+                   (column_.capacity() + last_ints_.capacity()) * sizeof(int64_t);
+        }
+
+        // Appends the BLOCK payload (without the record header) to out.
+        void encode(std::vector<uint8_t> &out);
+
+    private:
+        std::vector<TraceStep> steps_;
+        std::vector<TraceVar> vars_;
+        std::vector<int64_t> column_;     // Scratch for one column
+        std::vector<int64_t> last_ints_;  // Per slot, for value deltas
+    };
+
+    // Decodes a BLOCK payload. Steps index into vars via first_var/var_count.
+    // Returns false if the payload is malformed.
+    bool decodeStepBlock(const uint8_t *payload, const uint8_t *end, std::vector<TraceStep> &steps,
+                         std::vector<TraceVar> &vars);
+}
+
+#endif // FSM_TRACE_CODEC_H
@@ -0,0 +1,178 @@
+
+#ifndef FSM_TRACE_FORMAT_H
+#define FSM_TRACE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Binary trace file layout (all integers little-endian):
+//
+//   FileHeader   "FSMTRACE" magic, u16 version, u16 flags, u32 reserved
+//   Record*      u32 length (of kind + payload), u8 kind, payload
+//
+// Records:
+//   NAME      u8 name_kind, u32 id, UTF-8 bytes          Maps IDs used below to names
+//   STEP      u64 tick, i32 event_id, i32 transition_id, i32 state_id,
+//             u32 count, count x VarValue                 Variables changed by the step (v1 only)
+//   BLOCK     u32 step_count, u64 first_tick, u64 last_tick,
+//             u32 change_count, columns                   Up to kBlockSteps steps, compressed (v2)
+//   KEYFRAME  u64 tick, i32 state_id, u32 count,
+//             count x VarValue                            Full variable set, for seeking
+//
+//   INDEX     u64 step_count, u64 last_tick,
+//             u32 n, n x (u64 tick, u64 offset, u32 run)  Offsets of every KEYFRAME
+//             u32 m, m x u64 offset                       Offsets of every NAME record
+//   TRAILER   u64 offset of the INDEX record              Always the last 13 bytes
+//
+//   VarValue  u32 slot, u8 type (FsmVarType), 8-byte value (i64, or IEEE double bits)
+//
+// BLOCK columns (see trace_codec.h) store the same fields as a run of STEP
+// records, column by column: tick deltas, event IDs, transition IDs, state
+// IDs and per-step change counts, then the slot and type of every change, as
+// zigzag varints grouped into run-length / literal blocks; then the change
+// values (integers as varint deltas from the slot's previous value in the
+// block, reals as raw double bits). A block never spans a KEYFRAME, so a
+// reader seeking to a keyframe starts decoding at a block boundary.
+//
+// A "run" starts at every reset: its KEYFRAME goes back in time relative to
+// the previous record. Ticks only increase within a run.
+//
+// INDEX and TRAILER are appended when the trace is closed cleanly; readers of
+// a truncated trace rebuild the same index by scanning record headers.
+//
+// IDs are -1 when absent (no event, no transition fired, halted). A NAME
+// record always precedes the first use of its ID; a later NAME record for the
+// same ID (after a model reload) replaces the mapping.
+namespace trace
+{
+    constexpr char kMagic[8] = {'F', 'S', 'M', 'T', 'R', 'A', 'C', 'E'};
+    constexpr uint16_t kVersion = 2;       // Written by TraceWriter
+    constexpr uint16_t kMinReadVersion = 1; // Oldest version TraceReader accepts
+    constexpr size_t kFileHeaderSize = 16;
+    constexpr size_t kRecordHeaderSize = 5;
+    constexpr size_t kVarValueSize = 13;
+
+    enum RecordKind : uint8_t
+    {
+        RECORD_NAME = 1,
+        RECORD_STEP = 2,
+        RECORD_KEYFRAME = 3,
+        RECORD_INDEX = 4,
+        RECORD_TRAILER = 5,
+        RECORD_BLOCK = 6
+    };
+
+    constexpr size_t kBlockHeaderSize = 24; // Fixed BLOCK fields before the columns
+
+    constexpr size_t kTrailerSize = kRecordHeaderSize + 8;
+
+    enum NameKind : uint8_t
+    {
+        NAME_STATE = 0,
+        NAME_EVENT = 1,
+        NAME_VARIABLE = 2
+    };
+
+    inline void putU8(std::vector<uint8_t> &out, uint8_t v) { out.push_back(v); }
+
+    inline void putU16(std::vector<uint8_t> &out, uint16_t v)
+    {
+        out.push_back(static_cast<uint8_t>(v));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    inline void putU32(std::vector<uint8_t> &out, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    inline void putU64(std::vector<uint8_t> &out, uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+
+    inline void putBytes(std::vector<uint8_t> &out, const void *data, size_t n)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        out.insert(out.end(), bytes, bytes + n);
+    }
+
+    inline void patchU32(std::vector<uint8_t> &out, size_t at, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            out[at + i] = static_cast<uint8_t>(v >> (8 * i));
+    }
+
+    inline uint16_t getU16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+    inline uint32_t getU32(const uint8_t *p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint64_t getU64(const uint8_t *p)
+    {
+        return static_cast<uint64_t>(getU32(p)) | (static_cast<uint64_t>(getU32(p + 4)) << 32);
+    }
+
+    inline uint64_t doubleBits(double d)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return bits;
+    }
+
+    inline double bitsToDouble(uint64_t bits)
+    {
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    // LEB128: 7 bits per byte, high bit set on all but the last byte.
+    inline void putVarint(std::vector<uint8_t> &out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(v) | 0x80);
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    // Returns the byte after the varint, or nullptr if it runs past end.
+    inline const uint8_t *getVarint(const uint8_t *p, const uint8_t *end, uint64_t *v)
+    {
+        uint64_t result = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7)
+        {
+            uint8_t byte = *p++;
+            result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                *v = result;
+                return p;
+            }
+        }
+        return nullptr;
+    }
+
+    // Maps small negative numbers to small unsigned ones (-1 -> 1, 1 -> 2).
+    inline uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    inline int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+    inline void putFileHeader(std::vector<uint8_t> &out)
+    {
+        putBytes(out, kMagic, sizeof(kMagic));
+        putU16(out, kVersion);
+        putU16(out, 0); // flags
+        putU32(out, 0); // reserved
+    }
+}
+
+#endif // FSM_TRACE_FORMAT_H
@@ -0,0 +1,378 @@
+
+#include "trace_reader.h"
+#include "fsm_core.h"
+
+namespace
+{
+    // Decodes a v1 STEP record or a KEYFRAME record into a single step.
+    bool decodeStepRecord(uint8_t kind, const uint8_t *p, const uint8_t *end, std::vector<trace::TraceStep> &steps,
+                          std::vector<trace::TraceVar> &vars)
+    {
+        steps.clear();
+        vars.clear();
+        trace::TraceStep step{0, -1, -1, -1, 0, 0};
+        size_t fixed = kind == trace::RECORD_STEP ? 24 : 16;
+        if (end - p < static_cast<ptrdiff_t>(fixed))
+            return false;
+
+        step.tick = trace::getU64(p);
+        if (kind == trace::RECORD_STEP)
+        {
+            step.event_id = static_cast<int32_t>(trace::getU32(p + 8));
+            step.transition_id = static_cast<int32_t>(trace::getU32(p + 12));
+        }
+        step.state_id = static_cast<int32_t>(trace::getU32(p + fixed - 8));
+        step.var_count = trace::getU32(p + fixed - 4);
+        p += fixed;
+        if (static_cast<uint64_t>(step.var_count) * trace::kVarValueSize > static_cast<uint64_t>(end - p))
+            return false;
+
+        vars.resize(step.var_count);
+        for (trace::TraceVar &var : vars)
+        {
+            var.slot = trace::getU32(p);
+            var.type = p[4];
+            var.raw = trace::getU64(p + 5);
+            p += trace::kVarValueSize;
+        }
+        steps.push_back(step);
+        return true;
+    }
+}
+
+bool TraceReader::open(const std::string &path)
+{
+    if (!file_.open(path))
+        return false;
+
+    const uint8_t *data = file_.data();
+    if (file_.size() < trace::kFileHeaderSize ||
+        std::memcmp(data, trace::kMagic, sizeof(trace::kMagic)) != 0 ||
+        trace::getU16(data + 8) < trace::kMinReadVersion || trace::getU16(data + 8) > trace::kVersion)
+    {
+        file_.close();
+        return false;
+    }
+
+    info_ = Info();
+    keyframes_.clear();
+    state_ids_.clear();
+    var_slots_.clear();
+
+    if (!loadFooter())
+        scanRecords();
+    return true;
+}
+
+bool TraceReader::loadFooter()
+{
+    const uint8_t *data = file_.data();
+    size_t size = file_.size();
+    if (size < trace::kFileHeaderSize + trace::kTrailerSize)
+        return false;
+
+    const uint8_t *trailer = data + size - trace::kTrailerSize;
+    if (trace::getU32(trailer) != 9 || trailer[4] != trace::RECORD_TRAILER)
+        return false;
+
+    // Every offset below comes from the file, so each is checked against the
+    // bytes that precede it before it is dereferenced.
+    uint64_t trailer_offset = size - trace::kTrailerSize;
+    uint64_t index_offset = trace::getU64(trailer + trace::kRecordHeaderSize);
+    if (index_offset < trace::kFileHeaderSize || index_offset > trailer_offset - trace::kRecordHeaderSize)
+        return false;
+
+    const uint8_t *record = data + index_offset;
+    uint64_t length = trace::getU32(record);
+    if (record[4] != trace::RECORD_INDEX || length > trailer_offset - index_offset - 4)
+        return false;
+    const uint8_t *end = record + 4 + length;
+
+    const uint8_t *p = record + trace::kRecordHeaderSize;
+    if (p + 20 > end)
+        return false;
+    info_.step_count = trace::getU64(p);
+    info_.last_tick = trace::getU64(p + 8);
+    uint32_t keyframe_count = trace::getU32(p + 16);
+    p += 20;
+    if (static_cast<uint64_t>(keyframe_count) * 20 + 4 > static_cast<uint64_t>(end - p))
+        return false;
+
+    keyframes_.reserve(keyframe_count);
+    for (uint32_t i = 0; i < keyframe_count; ++i, p += 20)
+    {
+        Keyframe kf{trace::getU64(p), trace::getU64(p + 8), trace::getU32(p + 16)};
+        if (kf.offset < trace::kFileHeaderSize || kf.offset >= index_offset)
+            return false;
+        keyframes_.push_back(kf);
+    }
+
+    uint32_t name_count = trace::getU32(p);
+    p += 4;
+    if (static_cast<uint64_t>(name_count) * 8 > static_cast<uint64_t>(end - p))
+        return false;
+    for (uint32_t i = 0; i < name_count; ++i, p += 8)
+    {
+        uint64_t offset = trace::getU64(p);
+        if (offset < trace::kFileHeaderSize || offset >= index_offset ||
+            !readName(data + offset, data + index_offset))
+            return false;
+    }
+
+    info_.indexed = true;
+    buildRuns(index_offset);
+    return true;
+}
+
+// Fallback for traces that were not closed cleanly: walk the record headers
+// once and rebuild what the footer would have contained.
+void TraceReader::scanRecords()
+{
+    info_ = Info(); // A rejected footer may have filled some of it
+    keyframes_.clear();
+    state_ids_.clear();
+    var_slots_.clear();
+
+    const uint8_t *data = file_.data();
+    size_t size = file_.size();
+    uint64_t offset = trace::kFileHeaderSize;
+    uint32_t run = 0;
+
+    while (offset + trace::kRecordHeaderSize <= size)
+    {
+        uint64_t length = trace::getU32(data + offset);
+        if (length == 0 || offset + 4 + length > size)
+            break; // Truncated tail
+
+        const uint8_t *record = data + offset;
+        uint8_t kind = record[4];
+        if (kind == trace::RECORD_INDEX || kind == trace::RECORD_TRAILER)
+            break;
+
+        if (kind == trace::RECORD_STEP && length >= 9)
+        {
+            info_.step_count++;
+            info_.last_tick = trace::getU64(record + trace::kRecordHeaderSize);
+        }
+        else if (kind == trace::RECORD_BLOCK && length >= 1 + trace::kBlockHeaderSize)
+        {
+            info_.step_count += trace::getU32(record + trace::kRecordHeaderSize);
+            info_.last_tick = trace::getU64(record + trace::kRecordHeaderSize + 12);
+        }
+        else if (kind == trace::RECORD_KEYFRAME && length >= 9)
+        {
+            uint64_t tick = trace::getU64(record + trace::kRecordHeaderSize);
+            if (tick < info_.last_tick)
+                ++run;
+            info_.last_tick = tick;
+            keyframes_.push_back(Keyframe{tick, offset, run});
+        }
+        else if (kind == trace::RECORD_NAME)
+        {
+            readName(record, data + size);
+        }
+        offset += 4 + length;
+    }
+
+    buildRuns(offset);
+}
+
+// Reads the NAME record at record, which must lie entirely before end.
+// Returns false if it is not a well-formed NAME record.
+bool TraceReader::readName(const uint8_t *record, const uint8_t *end)
+{
+    if (end - record < static_cast<ptrdiff_t>(trace::kRecordHeaderSize + 5))
+        return false;
+    uint64_t length = trace::getU32(record);
+    if (record[4] != trace::RECORD_NAME || length < 6 || length > static_cast<uint64_t>(end - record - 4))
+        return false;
+
+    uint8_t kind = record[5];
+    int32_t id = static_cast<int32_t>(trace::getU32(record + 6));
+    std::string name(reinterpret_cast<const char *>(record + 10), length - 6);
+    if (kind == trace::NAME_STATE)
+        state_ids_[name] = id;
+    else if (kind == trace::NAME_VARIABLE)
+        var_slots_[name] = id;
+    return true;
+}
+
+void TraceReader::buildRuns(uint64_t records_end)
+{
+    runs_.clear();
+    for (size_t i = 0; i < keyframes_.size(); ++i)
+    {
+        if (runs_.empty() || keyframes_[i].run != keyframes_[i - 1].run)
+        {
+            if (!runs_.empty())
+                runs_.back().end_offset = keyframes_[i].offset;
+            RunRange range;
+            range.first_keyframe = i;
+            runs_.push_back(range);
+        }
+        runs_.back().keyframe_count++;
+    }
+    if (!runs_.empty())
+        runs_.back().end_offset = records_end;
+
+    info_.run_count = static_cast<uint32_t>(runs_.size());
+    info_.keyframe_count = static_cast<uint32_t>(keyframes_.size());
+}
+
+const TraceReader::RunRange *TraceReader::findRun(int run) const
+{
+    if (runs_.empty())
+        return nullptr;
+    if (run < 0)
+        return &runs_.back();
+    if (run >= static_cast<int>(runs_.size()))
+        return nullptr;
+    return &runs_[run];
+}
+
+size_t TraceReader::seekKeyframe(const RunRange &run, uint64_t tick) const
+{
+    size_t lo = run.first_keyframe;
+    size_t hi = run.first_keyframe + run.keyframe_count; // Exclusive
+    while (hi - lo > 1)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (keyframes_[mid].tick <= tick)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Calls fn for every step (and keyframe) of the run, starting at the last
+// keyframe at or before tick_from, until fn returns false. v1 STEP records and
+// v2 BLOCK records are decoded into the same StepView.
+template <typename Fn>
+void TraceReader::walkSteps(const RunRange &range, uint64_t tick_from, Fn fn) const
+{
+    const uint8_t *data = file_.data();
+    uint64_t run_start = keyframes_[range.first_keyframe].offset;
+    uint64_t offset = keyframes_[seekKeyframe(range, tick_from)].offset;
+    std::vector<trace::TraceStep> steps;
+    std::vector<trace::TraceVar> vars;
+
+    while (offset + trace::kRecordHeaderSize <= range.end_offset)
+    {
+        uint64_t length = trace::getU32(data + offset);
+        if (length == 0 || offset + 4 + length > range.end_offset)
+            break;
+
+        uint64_t record_offset = offset;
+        uint8_t kind = data[offset + 4];
+        const uint8_t *payload = data + offset + trace::kRecordHeaderSize;
+        const uint8_t *end = data + offset + 4 + length;
+        offset += 4 + length;
+
+        bool decoded;
+        if (kind == trace::RECORD_STEP || kind == trace::RECORD_KEYFRAME)
+            decoded = decodeStepRecord(kind, payload, end, steps, vars);
+        else if (kind == trace::RECORD_BLOCK)
+            decoded = trace::decodeStepBlock(payload, end, steps, vars);
+        else
+            continue; // NAME records
+        if (!decoded)
+            break;
+
+        bool keyframe = kind == trace::RECORD_KEYFRAME;
+        for (const trace::TraceStep &step : steps)
+        {
+            StepView view{keyframe, keyframe && record_offset == run_start, step.tick, step.transition_id,
+                          step.state_id, vars.data() + step.first_var, step.var_count};
+            if (!fn(view))
+                return;
+        }
+    }
+}
+
+size_t TraceReader::queryVariable(int run, const std::string &name, uint64_t tick_from, uint64_t tick_to,
+                                  uint64_t *out_ticks, double *out_values, size_t capacity) const
+{
+    const RunRange *range = findRun(run);
+    auto slot_it = var_slots_.find(name);
+    if (!range || slot_it == var_slots_.end() || tick_to < tick_from)
+        return 0;
+    uint32_t slot = static_cast<uint32_t>(slot_it->second);
+
+    size_t count = 0;
+    auto emit = [&](uint64_t tick, double value)
+    {
+        if (count < capacity)
+        {
+            out_ticks[count] = tick;
+            out_values[count] = value;
+        }
+        ++count;
+    };
+
+    bool known = false;
+    bool initial_emitted = false;
+    double value = 0.0;
+    walkSteps(*range, tick_from, [&](const StepView &step)
+              {
+        if (step.tick > tick_to)
+            return false;
+
+        // The first record past tick_from settles the value "at" tick_from.
+        if (step.tick > tick_from && !initial_emitted)
+        {
+            if (known)
+                emit(tick_from, value);
+            initial_emitted = true;
+        }
+
+        for (size_t i = 0; i < step.var_count; ++i)
+        {
+            const trace::TraceVar &var = step.vars[i];
+            if (var.slot != slot)
+                continue;
+            if (var.type == FSM_VAR_REAL)
+                value = trace::bitsToDouble(var.raw);
+            else if (var.type == FSM_VAR_BOOL || var.type == FSM_VAR_INT)
+                value = static_cast<double>(static_cast<int64_t>(var.raw));
+            else
+                break; // Not numeric
+            known = true;
+            if (initial_emitted && !step.keyframe)
+                emit(step.tick, value);
+            break;
+        }
+        return true; });
+
+    if (!initial_emitted && known)
+        emit(tick_from, value);
+    return count;
+}
+
+size_t TraceReader::queryStateEntries(int run, const std::string &name, uint64_t tick_from, uint64_t tick_to,
+                                      uint64_t *out_ticks, size_t capacity) const
+{
+    const RunRange *range = findRun(run);
+    auto state_it = state_ids_.find(name);
+    if (!range || state_it == state_ids_.end() || tick_to < tick_from)
+        return 0;
+    int32_t state_id = state_it->second;
+
+    size_t count = 0;
+    walkSteps(*range, tick_from, [&](const StepView &step)
+              {
+        if (step.tick > tick_to)
+            return false;
+        if (step.tick < tick_from || step.state_id != state_id)
+            return true;
+
+        bool entered = step.keyframe ? step.run_start : step.transition_id >= 0;
+        if (entered)
+        {
+            if (count < capacity)
+                out_ticks[count] = step.tick;
+            ++count;
+        }
+        return true; });
+    return count;
+}
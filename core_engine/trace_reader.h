@@ -0,0 +1,90 @@
+
+#ifndef FSM_TRACE_READER_H
+#define FSM_TRACE_READER_H
+
+#include "mapped_file.h"
+#include "trace_codec.h"
+#include "trace_format.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Random-access reader for binary traces written by TraceWriter.
+//
+// The file is memory-mapped; only the footer index (or, for a trace that was
+// not closed cleanly, the record headers) is read up front. A query binary
+// searches the keyframe index for the last keyframe at or before its start
+// tick and decodes forward from there until its end tick, so its cost is
+// proportional to the requested range, not to the file size.
+class TraceReader
+{
+public:
+    struct Info
+    {
+        uint64_t step_count = 0;
+        uint64_t last_tick = 0;
+        uint32_t run_count = 0;
+        uint32_t keyframe_count = 0;
+        bool indexed = false; // Footer index present (trace closed cleanly)
+    };
+
+    bool open(const std::string &path);
+    const Info &info() const { return info_; }
+
+    // Value of a variable at tick_from followed by every change up to tick_to.
+    // Returns the total number of samples; at most capacity are copied.
+    size_t queryVariable(int run, const std::string &name, uint64_t tick_from, uint64_t tick_to,
+                         uint64_t *out_ticks, double *out_values, size_t capacity) const;
+
+    // Ticks at which the machine entered the named state (including the start
+    // of the run if it begins there).
+    size_t queryStateEntries(int run, const std::string &name, uint64_t tick_from, uint64_t tick_to,
+                             uint64_t *out_ticks, size_t capacity) const;
+
+private:
+    struct Keyframe
+    {
+        uint64_t tick;
+        uint64_t offset;
+        uint32_t run;
+    };
+
+    struct RunRange
+    {
+        size_t first_keyframe = 0;
+        size_t keyframe_count = 0;
+        uint64_t end_offset = 0; // First byte past the run's records
+    };
+
+    // One step or keyframe, whatever record it was decoded from.
+    struct StepView
+    {
+        bool keyframe;
+        bool run_start; // The keyframe that opens the run
+        uint64_t tick;
+        int32_t transition_id;
+        int32_t state_id;
+        const trace::TraceVar *vars;
+        size_t var_count;
+    };
+
+    bool loadFooter();
+    void scanRecords();
+    bool readName(const uint8_t *record, const uint8_t *end);
+    void buildRuns(uint64_t records_end);
+    const RunRange *findRun(int run) const;
+    size_t seekKeyframe(const RunRange &run, uint64_t tick) const;
+    template <typename Fn>
+    void walkSteps(const RunRange &range, uint64_t tick_from, Fn fn) const;
+
+    MappedFile file_;
+    Info info_;
+    std::vector<Keyframe> keyframes_;
+    std::vector<RunRange> runs_;
+    std::map<std::string, int32_t> state_ids_;
+    std::map<std::string, int32_t> var_slots_;
+};
+
+#endif // FSM_TRACE_READER_H
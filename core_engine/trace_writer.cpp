@@ -0,0 +1,226 @@
+
+#include "trace_writer.h"
+
+bool TraceWriter::open(const std::string &path)
+{
+    close();
+#ifdef _WIN32
+    if (fopen_s(&file_, path.c_str(), "wb") != 0)
+        file_ = nullptr;
+#else
+    file_ = std::fopen(path.c_str(), "wb");
+#endif
+    if (!file_)
+        return false;
+    std::setvbuf(file_, nullptr, _IONBF, 0); // Buffers are large already; lets fwrite report disk errors
+
+    active_.clear();
+    active_.reserve(kFlushThreshold + 4096);
+    standby_.clear();
+    standby_.reserve(kFlushThreshold + 4096);
+    records_ = 0;
+    swaps_ = 0;
+    active_base_offset_ = 0;
+    block_.clear();
+    keyframes_.clear();
+    name_offsets_.clear();
+    step_count_ = 0;
+    last_tick_ = 0;
+    run_ = 0;
+    bytes_written_ = 0;
+    bytes_pending_ = 0;
+    write_errors_ = 0;
+    standby_pending_ = false;
+    stop_requested_ = false;
+
+    trace::putFileHeader(active_);
+    thread_ = std::thread(&TraceWriter::run, this);
+    open_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool TraceWriter::close()
+{
+    if (!file_)
+        return true;
+
+    flushBlock();
+    writeIndex();
+    handOff(true);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_requested_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+
+    if (std::fclose(file_) != 0)
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+    file_ = nullptr;
+    open_.store(false, std::memory_order_relaxed);
+    bytes_pending_.store(0, std::memory_order_relaxed);
+    return write_errors_.load(std::memory_order_relaxed) == 0;
+}
+
+TraceWriter::Stats TraceWriter::stats() const
+{
+    Stats s;
+    s.records = records_.load(std::memory_order_relaxed);
+    s.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    s.bytes_pending = bytes_pending_.load(std::memory_order_relaxed);
+    s.swaps = swaps_.load(std::memory_order_relaxed);
+    s.write_errors = write_errors_.load(std::memory_order_relaxed);
+    return s;
+}
+
+size_t TraceWriter::memoryBytes()
+{
+    std::lock_guard<std::mutex> lock(mutex_); // standby_ may be with the writer thread
+    return active_.capacity() + standby_.capacity() + block_.memoryBytes() +
+           keyframes_.capacity() * sizeof(KeyframeEntry) + name_offsets_.capacity() * sizeof(uint64_t);
+}
+
+void TraceWriter::beginRecord(trace::RecordKind kind)
+{
+    flushBlock();
+    startRecord(kind);
+}
+
+void TraceWriter::startRecord(trace::RecordKind kind)
+{
+    record_start_ = active_.size();
+    trace::putU32(active_, 0); // Length, patched in endRecord()
+    trace::putU8(active_, kind);
+}
+
+void TraceWriter::endRecord()
+{
+    trace::patchU32(active_, record_start_, static_cast<uint32_t>(active_.size() - record_start_ - 4));
+    records_.fetch_add(1, std::memory_order_relaxed);
+    indexRecord();
+    if (active_.size() >= kFlushThreshold)
+        handOff(false);
+    bytes_pending_.store(active_.size(), std::memory_order_relaxed);
+}
+
+void TraceWriter::addStep(const trace::TraceStep &step, const trace::TraceVar *vars, size_t count)
+{
+    block_.add(step, vars, count);
+    if (block_.stepCount() >= trace::kBlockSteps)
+        flushBlock();
+}
+
+void TraceWriter::flushBlock()
+{
+    if (block_.empty())
+        return;
+    startRecord(trace::RECORD_BLOCK);
+    block_.encode(active_);
+    block_.clear();
+    endRecord();
+}
+
+// Swaps the active buffer into the standby slot for the writer thread. When
+// wait_for_idle is false this gives up immediately if the writer is busy.
+void TraceWriter::handOff(bool wait_for_idle)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (standby_pending_)
+    {
+        if (!wait_for_idle)
+            return;
+        cv_.wait(lock, [this]
+                 { return !standby_pending_; });
+    }
+    if (active_.empty())
+        return;
+
+    active_base_offset_ += active_.size();
+    active_.swap(standby_);
+    standby_pending_ = true;
+    swaps_.fetch_add(1, std::memory_order_relaxed);
+    lock.unlock();
+    cv_.notify_all();
+}
+
+// Remembers where seekable records live so close() can write the footer.
+void TraceWriter::indexRecord()
+{
+    const uint8_t *record = active_.data() + record_start_;
+    uint64_t offset = active_base_offset_ + record_start_;
+    switch (record[4])
+    {
+    case trace::RECORD_BLOCK:
+        step_count_ += trace::getU32(record + trace::kRecordHeaderSize);
+        last_tick_ = trace::getU64(record + trace::kRecordHeaderSize + 12);
+        break;
+    case trace::RECORD_KEYFRAME:
+    {
+        uint64_t tick = trace::getU64(record + trace::kRecordHeaderSize);
+        if (tick < last_tick_)
+            ++run_; // Reset: time went backwards
+        last_tick_ = tick;
+        keyframes_.push_back(KeyframeEntry{tick, offset, run_});
+        break;
+    }
+    case trace::RECORD_NAME:
+        name_offsets_.push_back(offset);
+        break;
+    default:
+        break;
+    }
+}
+
+void TraceWriter::writeIndex()
+{
+    uint64_t index_offset = active_base_offset_ + active_.size();
+    record_start_ = active_.size();
+    trace::putU32(active_, 0);
+    trace::putU8(active_, trace::RECORD_INDEX);
+    trace::putU64(active_, step_count_);
+    trace::putU64(active_, last_tick_);
+    trace::putU32(active_, static_cast<uint32_t>(keyframes_.size()));
+    for (const auto &entry : keyframes_)
+    {
+        trace::putU64(active_, entry.tick);
+        trace::putU64(active_, entry.offset);
+        trace::putU32(active_, entry.run);
+    }
+    trace::putU32(active_, static_cast<uint32_t>(name_offsets_.size()));
+    for (uint64_t offset : name_offsets_)
+        trace::putU64(active_, offset);
+    trace::patchU32(active_, record_start_, static_cast<uint32_t>(active_.size() - record_start_ - 4));
+
+    trace::putU32(active_, 9);
+    trace::putU8(active_, trace::RECORD_TRAILER);
+    trace::putU64(active_, index_offset);
+}
+
+void TraceWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        cv_.wait(lock, [this]
+                 { return standby_pending_ || stop_requested_; });
+        if (!standby_pending_)
+            break; // Stop requested and nothing left to write
+
+        lock.unlock();
+        if (write_errors_.load(std::memory_order_relaxed) == 0)
+        {
+            size_t written = std::fwrite(standby_.data(), 1, standby_.size(), file_);
+            bytes_written_.fetch_add(written, std::memory_order_relaxed);
+            if (written != standby_.size())
+                write_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+        standby_.clear();
+        lock.lock();
+
+        standby_pending_ = false;
+        cv_.notify_all();
+    }
+    if (std::fflush(file_) != 0)
+        write_errors_.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,106 @@
+
+#ifndef FSM_TRACE_WRITER_H
+#define FSM_TRACE_WRITER_H
+
+#include "trace_codec.h"
+#include "trace_format.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams trace records to disk without ever blocking the stepping thread on
+// file I/O.
+//
+// Steps are collected into a columnar StepBlockEncoder and emitted as one
+// compressed BLOCK record every kBlockSteps steps, or before any other record
+// so that records stay in tick order. Records are encoded into an in-memory
+// "active" buffer. Once it passes the
+// flush threshold it is swapped with the idle "standby" buffer and a
+// background thread writes it out. If the previous standby buffer is still
+// being written, the active buffer simply keeps growing until the next step
+// can swap - stepping never waits for the disk. Only close() blocks, to drain
+// everything that was recorded and append the INDEX/TRAILER footer.
+//
+// A failed write (e.g. a full disk) is counted in write_errors and stops all
+// further writes, so the file ends at the last complete buffer; close() then
+// reports failure. stats() and isOpen() may be called from any thread.
+class TraceWriter
+{
+public:
+    struct Stats
+    {
+        uint64_t records = 0;
+        uint64_t bytes_written = 0; // Bytes handed to the OS so far
+        uint64_t bytes_pending = 0; // Bytes still buffered in memory
+        uint64_t swaps = 0;
+        uint64_t write_errors = 0; // Failed fwrite/fflush/fclose calls
+    };
+
+    TraceWriter() = default;
+    ~TraceWriter() { close(); }
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    bool open(const std::string &path);
+    bool close(); // False if anything recorded did not reach the file
+    bool isOpen() const { return open_.load(std::memory_order_relaxed); }
+    Stats stats() const;
+    size_t memoryBytes(); // Write buffers, block encoder and footer index
+
+    // --- Record encoding (stepping thread only) ---
+    void beginRecord(trace::RecordKind kind);
+    std::vector<uint8_t> &payload() { return active_; }
+    void endRecord();
+    void addStep(const trace::TraceStep &step, const trace::TraceVar *vars, size_t count);
+
+private:
+    static constexpr size_t kFlushThreshold = 256 * 1024;
+
+    void run();
+    void startRecord(trace::RecordKind kind);
+    void flushBlock();
+    void handOff(bool wait_for_idle);
+    void indexRecord();
+    void writeIndex();
+
+    std::FILE *file_ = nullptr;
+    std::atomic<bool> open_{false};
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool standby_pending_ = false; // Guarded by mutex_
+    bool stop_requested_ = false;  // Guarded by mutex_
+
+    std::vector<uint8_t> active_;
+    std::vector<uint8_t> standby_;
+    size_t record_start_ = 0;
+    trace::StepBlockEncoder block_;
+    uint64_t active_base_offset_ = 0; // File offset of active_[0]
+
+    // Footer index, written by close()
+    struct KeyframeEntry
+    {
+        uint64_t tick;
+        uint64_t offset;
+        uint32_t run;
+    };
+    std::vector<KeyframeEntry> keyframes_;
+    std::vector<uint64_t> name_offsets_;
+    uint64_t step_count_ = 0;
+    uint64_t last_tick_ = 0;
+    uint32_t run_ = 0;
+
+    // Counters, written by the stepping and writer threads, read by stats()
+    std::atomic<uint64_t> records_{0};
+    std::atomic<uint64_t> bytes_written_{0};
+    std::atomic<uint64_t> bytes_pending_{0};
+    std::atomic<uint64_t> swaps_{0};
+    std::atomic<uint64_t> write_errors_{0};
+};
+
+#endif // FSM_TRACE_WRITER_H
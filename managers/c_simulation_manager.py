@@ -285,7 +285,8 @@ class CCompilerWorker(QObject):
             # For C file: replace FSM_API with dllexport for function definitions
             fixed_c_code = c_code.replace('FSM_API ', '__declspec(dllexport) ')
         else:
-            fixed_h_code = h_code.replace('FSM_API ', 'extern ')
+            # Table headers already declare their data as 'FSM_API extern'
+            fixed_h_code = h_code.replace('FSM_API extern ', 'extern ').replace('FSM_API ', 'extern ')
             fixed_c_code = c_code.replace('FSM_API ', '')
         
         # Add missing variable declarations and includes at the top of C file
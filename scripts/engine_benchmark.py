@@ -0,0 +1,473 @@
+# fsm_designer_project/scripts/engine_benchmark.py
+"""
+Cross-engine benchmark: runs one model and one event script through every
+simulation backend and reports steps/sec, per-step latency percentiles and
+memory for each.
+
+Engines:
+  python     core/fsm_simulator.py (FSMSimulator; actions run through exec/eval)
+  core       core/c_fsm_simulator.py over the fsm_core library, log-and-poll protocol
+  core-cb    the same with native callbacks, one FFI call per step
+  generated  C from assets/templates/fsm_table.c.j2, built by the C simulation
+             manager's compiler worker and driven through ctypes
+
+Latency is wall time around each step call as seen from Python, so for the
+native engines it includes the FFI crossing. To separate the two, the core
+engines also report their in-engine step time, and the generated C runs the
+whole script once more inside a native loop.
+
+Usage:
+  python scripts/engine_benchmark.py examples/traffic_light.bsm --events script.txt
+  python scripts/engine_benchmark.py --synthetic 500 --steps 20000 --out report.json
+
+An event script has one step per line: an event name, or '-' for a step
+without an event. Blank lines and '#' comments are skipped. The script is repeated
+until --steps steps have run. Without --events, a random script is drawn from
+the model's events with --seed.
+"""
+
+import argparse
+import copy
+import ctypes
+import glob
+import importlib
+import json
+import os
+import random
+import re
+import statistics
+import sys
+import time
+import tracemalloc
+from contextlib import contextmanager
+from typing import Any, Dict, List, Optional
+
+# Make 'import fsm_designer_project' work when run as a plain script
+script_dir = os.path.dirname(os.path.abspath(__file__))
+project_root = os.path.dirname(script_dir)
+project_parent_dir = os.path.dirname(project_root)
+if project_parent_dir not in sys.path:
+    sys.path.insert(0, project_parent_dir)
+package_name = os.path.basename(project_root)
+
+ENGINES = ("python", "core", "core-cb", "generated")
+
+# Declared (or #defined) by the compiler worker's own prelude; declaring them again would not compile
+MANAGER_DECLARED_NAMES = {"timer_start_tick", "current_tick", "event_sent",
+                          "GREEN_DURATION", "YELLOW_DURATION", "RED_DURATION"}
+
+qt_app = None
+
+
+def ensure_qt_app():
+    """Package imports reach UI modules (fonts, icons), which need an application object first."""
+    global qt_app
+    os.environ.setdefault("QT_QPA_PLATFORM", "offscreen")
+    from PyQt6.QtWidgets import QApplication
+    qt_app = QApplication.instance() or QApplication([])
+
+
+# --- Models and event scripts ---
+
+def make_synthetic_model(num_states: int, transitions_per_state: int, num_events: int,
+                         guard_density: float, seed: int) -> Dict:
+    """A ring S0 -> S1 -> ... on 'e0' plus random extra transitions, like fsm_core_bench generates.
+
+    Every entry and transition action increments 'counter'; guarded transitions test its parity,
+    which the Python engines and the generated C all evaluate the same way.
+    """
+    rng = random.Random(seed)
+    states = [{"name": f"S{i}", "is_initial": i == 0,
+               "entry_action": "counter = 0" if i == 0 else "counter = counter + 1"}
+              for i in range(num_states)]
+    transitions = []
+    for i in range(num_states):
+        transitions.append({"source": f"S{i}", "target": f"S{(i + 1) % num_states}", "event": "e0"})
+        for _ in range(transitions_per_state - 1):
+            transition = {"source": f"S{i}", "target": f"S{rng.randrange(num_states)}",
+                          "event": f"e{rng.randrange(1, max(2, num_events))}",
+                          "action": "counter = counter + 1"}
+            if rng.random() < guard_density:
+                transition["condition"] = "counter % 2 == 0"
+            transitions.append(transition)
+    return {"states": states, "transitions": transitions}
+
+
+def model_events(diagram_data: Dict) -> List[str]:
+    return sorted({t["event"] for t in diagram_data.get("transitions", []) if t.get("event")})
+
+
+def load_event_script(path: str) -> List[Optional[str]]:
+    script = []
+    with open(path, encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if line:
+                script.append(None if line == "-" else line)
+    return script
+
+
+def random_event_script(events: List[str], length: int, idle_fraction: float, seed: int) -> List[Optional[str]]:
+    rng = random.Random(seed)
+    return [None if not events or rng.random() < idle_fraction else rng.choice(events) for _ in range(length)]
+
+
+def expand_script(script: List[Optional[str]], steps: int) -> List[Optional[str]]:
+    if not script:
+        return [None] * steps
+    return [script[i % len(script)] for i in range(steps)]
+
+
+# --- Measurement helpers ---
+
+def latency_summary(samples_ns: List[int]) -> Dict[str, float]:
+    """Exact percentiles of per-step wall times (nanoseconds)."""
+    if not samples_ns:
+        return {"count": 0}
+    ordered = sorted(samples_ns)
+
+    def percentile(q: float) -> int:
+        return ordered[min(len(ordered) - 1, max(0, int(q * len(ordered) + 0.5) - 1))]
+
+    return {"count": len(ordered), "min_ns": ordered[0], "p50_ns": percentile(0.5), "p90_ns": percentile(0.9),
+            "p99_ns": percentile(0.99), "p999_ns": percentile(0.999), "max_ns": ordered[-1],
+            "mean_ns": sum(ordered) / len(ordered)}
+
+
+def timed_run(step, script: List[Any]) -> Dict[str, Any]:
+    """Runs `step` over the script, timing every call."""
+    clock = time.perf_counter_ns
+    samples = [0] * len(script)
+    start = clock()
+    for i, event in enumerate(script):
+        t0 = clock()
+        step(event)
+        samples[i] = clock() - t0
+    elapsed = clock() - start
+    return {"steps": len(script), "seconds": elapsed / 1e9,
+            "steps_per_sec": len(script) / (elapsed / 1e9) if elapsed else 0.0,
+            "latency": latency_summary(samples)}
+
+
+def best_of(runs: List[Dict[str, Any]]) -> Dict[str, Any]:
+    """The run with the median throughput; the others only show the spread."""
+    ordered = sorted(runs, key=lambda r: r["steps_per_sec"])
+    result = dict(ordered[len(ordered) // 2])
+    if len(runs) > 1:
+        rates = [r["steps_per_sec"] for r in runs]
+        result["steps_per_sec_min"], result["steps_per_sec_max"] = min(rates), max(rates)
+        result["steps_per_sec_stdev"] = statistics.stdev(rates)
+    return result
+
+
+@contextmanager
+def quiet_stdout(enabled: bool = True):
+    """Sends fd 1 to the null device, so print() in Python actions and printf() in generated C
+    don't end up in (or slow down through) the report."""
+    if not enabled:
+        yield
+        return
+    sys.stdout.flush()
+    saved_fd = os.dup(1)
+    devnull = os.open(os.devnull, os.O_WRONLY)
+    os.dup2(devnull, 1)
+    try:
+        yield
+    finally:
+        sys.stdout.flush()
+        _flush_c_stdio()
+        os.dup2(saved_fd, 1)
+        os.close(saved_fd)
+        os.close(devnull)
+
+
+def _flush_c_stdio():
+    try:
+        libc = ctypes.CDLL(None) if sys.platform != "win32" else ctypes.cdll.msvcrt
+        libc.fflush(None)
+    except (OSError, AttributeError):
+        pass
+
+
+# --- Engines ---
+
+def bench_python(diagram_data: Dict, script: List[Optional[str]], args) -> Dict[str, Any]:
+    fsm_parser = importlib.import_module(f"{package_name}.core.fsm_parser")
+    fsm_simulator = importlib.import_module(f"{package_name}.core.fsm_simulator")
+
+    def build():
+        sim = fsm_simulator.FSMSimulator(fsm_parser.parse_diagram_to_ir(copy.deepcopy(diagram_data)))
+        if args.initial_vars:
+            sim.set_initial_variables(args.initial_vars)
+        return sim
+
+    # Memory on a separate instance: tracemalloc would slow the timed runs down several times
+    tracemalloc.start()
+    sim = build()
+    instance_bytes = tracemalloc.get_traced_memory()[0]
+    tracemalloc.reset_peak()
+    for event in script[:args.memory_steps]:
+        sim.step(event)
+    peak_bytes = tracemalloc.get_traced_memory()[1]
+    tracemalloc.stop()
+
+    runs = []
+    for _ in range(args.repeat):
+        sim = build()
+        run = timed_run(sim.step, script)
+        run["final_state"] = sim.get_current_state_name()
+        runs.append(run)
+    result = best_of(runs)
+    result["memory"] = {"instance_bytes": instance_bytes, "peak_bytes": peak_bytes}
+    return result
+
+
+def find_core_library() -> Optional[str]:
+    names = ("libfsm_core.so", "libfsm_core.dylib", "fsm_core.dll")
+    candidates = []
+    for name in names:
+        candidates += glob.glob(os.path.join(project_root, "core_engine", "**", name), recursive=True)
+    candidates.sort(key=os.path.getmtime, reverse=True)
+    return candidates[0] if candidates else None
+
+
+def bench_core(diagram_data: Dict, script: List[Optional[str]], args, callbacks: bool) -> Dict[str, Any]:
+    c_fsm_simulator = importlib.import_module(f"{package_name}.core.c_fsm_simulator")
+
+    def build():
+        sim = c_fsm_simulator.CFsmSimulator(args.core_lib)
+        if callbacks:
+            sim.enable_native_callbacks()
+        sim.load_fsm(diagram_data)
+        if args.initial_vars:
+            sim.set_initial_variables(args.initial_vars)
+        return sim
+
+    runs = []
+    for _ in range(args.repeat):
+        sim = build()
+        sim.enable_latency()
+        run = timed_run(sim.step, script)
+        run["engine_step_latency"] = sim.get_latency_stats()["step"]
+        run["final_state"] = sim.current_state_name
+        run["memory"] = sim.get_memory_stats()
+        runs.append(run)
+        del sim
+    result = best_of(runs)
+
+    engine_p50 = result["engine_step_latency"].get("p50_ns", 0)
+    result["ffi_overhead_p50_ns"] = max(0, result["latency"].get("p50_ns", 0) - engine_p50)
+    return result
+
+
+def generated_c_prelude(diagram_data: Dict, initial_vars: Dict) -> str:
+    """Declarations for the variables the action stubs assign, which the generator leaves to the user."""
+    names = dict.fromkeys(initial_vars)
+    snippets = [s.get(key, "") for s in diagram_data["states"] for key in ("entry_action", "during_action", "exit_action")]
+    snippets += [t.get("action", "") for t in diagram_data.get("transitions", [])]
+    for code in snippets:
+        for line in (code or "").splitlines():
+            match = re.match(r"\s*([A-Za-z_]\w*)\s*=(?!=)", line)
+            if match:
+                names.setdefault(match.group(1))
+    lines = ["#include <iso646.h> /* Python-style 'and'/'or'/'not' in guards */"]
+    for name in names:
+        if name not in MANAGER_DECLARED_NAMES:
+            value = initial_vars.get(name, 0)
+            lines.append(f"static long {name} = {int(value) if isinstance(value, (bool, int, float)) else 0};")
+    return "\n".join(lines) + "\n"
+
+
+def generated_c_driver(fsm_name: str) -> str:
+    return f"""
+/* ---- Benchmark driver (appended by scripts/engine_benchmark.py) ------- */
+FSM_API size_t {fsm_name}_bench_instance_size(void) {{
+    return sizeof({fsm_name}_t);
+}}
+
+FSM_API void {fsm_name}_bench_run({fsm_name}_t* fsm, const FSM_EventId_t* events, size_t count) {{
+    for (size_t i = 0; i < count; ++i) {{
+        {fsm_name}_dispatch(fsm, events[i]);
+    }}
+}}
+"""
+
+
+def compile_generated_c(diagram_data: Dict, fsm_name: str, initial_vars: Dict, optimize: bool):
+    """Generates the table-driven C and builds it with the same worker the C simulation dock uses."""
+    codegen = importlib.import_module(f"{package_name}.codegen.c_code_generator")
+    manager = importlib.import_module(f"{package_name}.managers.c_simulation_manager")
+
+    # The generator annotates the diagram data it is given, so hand it a copy
+    code = codegen.generate_c_code_content(copy.deepcopy(diagram_data), fsm_name, "State Table (Function Pointers)")
+    c_code = generated_c_prelude(diagram_data, initial_vars) + code["c"] + generated_c_driver(code["fsm_name_c"])
+
+    results = []
+    worker = manager.CCompilerWorker()
+    worker.compile_finished.connect(results.append)
+    worker.run_compile(c_code, code["h"], code["fsm_name_c"], optimize)
+    return code, results[0] if results else None
+
+
+def bench_generated(diagram_data: Dict, script: List[Optional[str]], args) -> Dict[str, Any]:
+    codegen = importlib.import_module(f"{package_name}.codegen.c_code_generator")
+    fsm_name = "bench_fsm"
+    code, compiled = compile_generated_c(diagram_data, fsm_name, args.initial_vars or {}, not args.debug_c)
+    if compiled is None or not compiled.success:
+        errors = compiled.errors if compiled else []
+        return {"error": "compilation failed", "compiler_errors": errors[:10]}
+    name = code["fsm_name_c"]
+
+    lib = ctypes.CDLL(compiled.library_path)
+    init, dispatch, current_state = (getattr(lib, f"{name}_{fn}") for fn in ("init", "dispatch", "current_state"))
+    instance_size, run_native = (getattr(lib, f"{name}_bench_{fn}") for fn in ("instance_size", "run"))
+    # The generator sizes the ID types to the model
+    c_types = {"int8_t": ctypes.c_int8, "int16_t": ctypes.c_int16, "int32_t": ctypes.c_int32,
+               "uint8_t": ctypes.c_uint8, "uint16_t": ctypes.c_uint16}
+    state_id_type, event_id_type = (c_types[re.search(rf"typedef\s+(\w+)\s+{t};", code["h"]).group(1)]
+                                    for t in ("FSM_StateId_t", "FSM_EventId_t"))
+    init.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+    init.restype = None
+    dispatch.argtypes = [ctypes.c_void_p, event_id_type]
+    dispatch.restype = None
+    current_state.argtypes = [ctypes.c_void_p]
+    current_state.restype = state_id_type
+    instance_size.restype = ctypes.c_size_t
+    run_native.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    run_native.restype = None
+
+    # Events by enum value; names the model doesn't know are idle steps, as in the other engines
+    event_ids = {f"EVENT_{n.upper()}": int(v) for n, v in re.findall(r"EVENT_(\w+)\s*=\s*(\d+)", code["h"])}
+    no_event = -1  # FSM_NO_EVENT
+    ids = [no_event if e is None else event_ids.get(f"EVENT_{codegen.sanitize_c_identifier(e, 'evt_').upper()}", no_event)
+           for e in script]
+    state_names = [s["name"] for s in diagram_data["states"]]
+
+    fsm = ctypes.create_string_buffer(instance_size())
+    runs = []
+    for _ in range(args.repeat):
+        init(fsm, None)
+        run = timed_run(lambda event_id: dispatch(fsm, event_id), ids)
+        state = current_state(fsm)
+        run["final_state"] = state_names[state] if 0 <= state < len(state_names) else state
+        runs.append(run)
+    result = best_of(runs)
+
+    events_array = (event_id_type * len(ids))(*ids)
+    native_rates = []
+    for _ in range(args.repeat):
+        init(fsm, None)
+        start = time.perf_counter_ns()
+        run_native(fsm, events_array, len(ids))
+        elapsed = time.perf_counter_ns() - start
+        native_rates.append(len(ids) / (elapsed / 1e9) if elapsed else 0.0)
+    native_rate = statistics.median(native_rates)
+    result["native_loop_steps_per_sec"] = native_rate
+    if native_rate:
+        result["ffi_overhead_p50_ns"] = max(0.0, result["latency"].get("p50_ns", 0) - 1e9 / native_rate)
+    result["memory"] = {"instance_bytes": instance_size(), "library_bytes": os.path.getsize(compiled.library_path)}
+    result["compiler"] = compiled.compiler_type.value
+    return result
+
+
+# --- Report ---
+
+def print_summary(report: Dict[str, Any], stream=sys.stderr):
+    print(f"{'engine':<10} {'steps/s':>12} {'p50 us':>9} {'p99 us':>9} {'p99.9 us':>9} {'memory':>12}  final state",
+          file=stream)
+    for name, result in report["engines"].items():
+        if "error" in result:
+            print(f"{name:<10} {'-':>12} {'-':>9} {'-':>9} {'-':>9} {'-':>12}  {result['error']}", file=stream)
+            continue
+        latency = result["latency"]
+        memory = result.get("memory", {})
+        memory_bytes = memory.get("total_bytes", memory.get("instance_bytes", 0))
+        print(f"{name:<10} {result['steps_per_sec']:>12,.0f} {latency['p50_ns'] / 1e3:>9.2f} "
+              f"{latency['p99_ns'] / 1e3:>9.2f} {latency['p999_ns'] / 1e3:>9.2f} {memory_bytes:>12,}  "
+              f"{result.get('final_state')}", file=stream)
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip(),
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", nargs="?", help=".bsm/JSON model (omit with --synthetic)")
+    parser.add_argument("--events", help="event script file, one event per line")
+    parser.add_argument("--steps", type=int, default=10000, help="steps per run (the script repeats)")
+    parser.add_argument("--repeat", type=int, default=3, help="runs per engine; the median is reported")
+    parser.add_argument("--engines", default=",".join(ENGINES), help=f"comma-separated subset of {', '.join(ENGINES)}")
+    parser.add_argument("--core-lib", help="path to the fsm_core shared library (default: newest under core_engine/)")
+    parser.add_argument("--vars", dest="initial_vars", type=json.loads, help="initial variables as a JSON object")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--idle-fraction", type=float, default=0.1, help="share of event-less steps in a random script")
+    parser.add_argument("--synthetic", type=int, metavar="STATES", help="benchmark a generated model of this size")
+    parser.add_argument("--transitions-per-state", type=int, default=4)
+    parser.add_argument("--synthetic-events", type=int, default=8)
+    parser.add_argument("--guard-density", type=float, default=0.25)
+    parser.add_argument("--memory-steps", type=int, default=1000, help="steps run while measuring Python memory")
+    parser.add_argument("--debug-c", action="store_true", help="build the generated C without optimization")
+    parser.add_argument("--out", help="write the JSON report here instead of stdout")
+    args = parser.parse_args(argv)
+
+    if args.synthetic:
+        diagram_data = make_synthetic_model(args.synthetic, args.transitions_per_state, args.synthetic_events,
+                                            args.guard_density, args.seed)
+        model_name = f"synthetic-{args.synthetic}"
+    elif args.model:
+        with open(args.model, encoding="utf-8") as f:
+            diagram_data = json.load(f)
+        model_name = os.path.basename(args.model)
+    else:
+        parser.error("a model file or --synthetic is required")
+    if not diagram_data.get("states"):
+        parser.error("the model has no states")
+
+    events = model_events(diagram_data)
+    base_script = (load_event_script(args.events) if args.events
+                   else random_event_script(events, min(args.steps, 4096), args.idle_fraction, args.seed))
+    script = expand_script(base_script, args.steps)
+
+    engines = [e.strip() for e in args.engines.split(",") if e.strip()]
+    unknown = set(engines) - set(ENGINES)
+    if unknown:
+        parser.error(f"unknown engine(s): {', '.join(sorted(unknown))}")
+    if any(e.startswith("core") for e in engines) and not args.core_lib:
+        args.core_lib = find_core_library()
+
+    ensure_qt_app()
+    report = {
+        "model": {"name": model_name, "states": len(diagram_data["states"]),
+                  "transitions": len(diagram_data.get("transitions", [])), "events": len(events)},
+        "script": {"steps": len(script), "length": len(base_script),
+                   "idle_steps": sum(1 for e in script if e is None), "source": args.events or f"random(seed={args.seed})"},
+        "platform": {"python": sys.version.split()[0], "system": sys.platform},
+        "engines": {},
+    }
+
+    for engine in engines:
+        try:
+            with quiet_stdout():
+                if engine == "python":
+                    result = bench_python(diagram_data, script, args)
+                elif engine in ("core", "core-cb"):
+                    if not args.core_lib:
+                        raise FileNotFoundError("fsm_core library not found; build core_engine or pass --core-lib")
+                    result = bench_core(diagram_data, script, args, callbacks=engine == "core-cb")
+                    result["library"] = args.core_lib
+                else:
+                    result = bench_generated(diagram_data, script, args)
+        except Exception as e:
+            result = {"error": f"{type(e).__name__}: {e}"}
+        report["engines"][engine] = result
+
+    print_summary(report)
+    text = json.dumps(report, indent=2)
+    if args.out:
+        with open(args.out, "w", encoding="utf-8") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+    return 0 if all("error" not in r for r in report["engines"].values()) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -14,6 +14,7 @@ logger = logging.getLogger(__name__)
 
 class ResourceMonitorWorker(QObject):
     resourceUpdate = pyqtSignal(float, float, float, str)
+    engineLatencyUpdate = pyqtSignal(dict)
     finished_signal = pyqtSignal()
 
     def __init__(self, interval_ms=2000, parent=None):
@@ -29,6 +30,7 @@ class ResourceMonitorWorker(QObject):
         self.NVML_REINIT_BACKOFF_SECONDS = 30
         # --- FIX: Timer will be created in the correct thread ---
         self.monitor_timer: QTimer | None = None
+        self._latency_source = None
 
         if PYNVML_AVAILABLE and pynvml:
             self._attempt_nvml_init()
@@ -83,6 +85,24 @@ class ResourceMonitorWorker(QObject):
             self._nvml_initialized = False
             self._gpu_name_cache = "NVML Unexp. Err"
 
+    def set_latency_source(self, source):
+        """Polls source.get_latency_stats() (e.g. a CFsmSimulator) with every update; None stops polling.
+
+        The native stats are safe to read from this thread, also while the engine's real-time loop runs.
+        Clear the source before the simulator is destroyed.
+        """
+        self._latency_source = source
+
+    def _poll_engine_latency(self):
+        source = self._latency_source
+        if source is None:
+            return
+        try:
+            self.engineLatencyUpdate.emit(source.get_latency_stats())
+        except Exception as e:
+            logger.warning(f"Could not read engine latency, polling stopped: {e}")
+            self._latency_source = None
+
     @pyqtSlot()
     def start_monitoring(self):
         logger.info("ResourceMonitorWorker: start_monitoring called.")
@@ -155,6 +175,7 @@ class ResourceMonitorWorker(QObject):
                 self._attempt_nvml_init(from_worker_loop=True)
 
             self.resourceUpdate.emit(cpu_usage, ram_percent, gpu_util, gpu_name_to_emit)
+            self._poll_engine_latency()
 
         except Exception as e:
             logger.error(f"ResourceMonitorWorker: Error in data collection: {e}", exc_info=False)
@@ -168,6 +189,7 @@ class ResourceMonitorManager(QObject):
         self.settings_manager = settings_manager
         self.worker: ResourceMonitorWorker | None = None
         self.thread: QThread | None = None
+        self._latency_source = None
 
     def setup_and_start_monitor(self):
         if not self.settings_manager.get("resource_monitor_enabled"):
@@ -184,10 +206,13 @@ class ResourceMonitorManager(QObject):
         self.thread = QThread(self.mw) 
         self.thread.setObjectName("ResourceMonitorQThread_Managed")
         self.worker = ResourceMonitorWorker(interval_ms=interval)
+        self.worker.set_latency_source(self._latency_source)
         self.worker.moveToThread(self.thread)
         
         if hasattr(self.mw, '_update_resource_display'):
             self.worker.resourceUpdate.connect(self.mw._update_resource_display)
+        if hasattr(self.mw, '_update_engine_latency_display'):
+            self.worker.engineLatencyUpdate.connect(self.mw._update_engine_latency_display)
         
         self.thread.started.connect(self.worker.start_monitoring)
         self.worker.finished_signal.connect(self.thread.quit)
@@ -196,6 +221,12 @@ class ResourceMonitorManager(QObject):
         self.thread.start()
         logger.info("ResourceMonitorManager: Monitor thread initialized and started.")
     
+    def set_latency_source(self, source):
+        """Reports the step/guard/action latency of a native simulator alongside CPU/RAM/GPU (None to stop)."""
+        self._latency_source = source
+        if self.worker:
+            self.worker.set_latency_source(source)
+
     @pyqtSlot()
     def _handle_worker_thread_finished(self):
         logger.debug("ResourceMonitorManager: Worker's finished_signal received, thread should be quitting.")
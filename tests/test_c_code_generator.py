@@ -4,6 +4,7 @@ import json
 import re
 from pathlib import Path
 from fsm_designer_project.codegen import generate_c_code_content, sanitize_c_identifier
+from fsm_designer_project.codegen.c_code_generator import _id_storage_type
 
 # Define paths relative to the test file for robustness
 TEST_DATA_DIR = Path(__file__).parent / "test_data"
@@ -63,4 +64,26 @@ def test_c_code_generation_matches_golden_file(simple_toggle_fsm_data):
 
 def test_generate_c_code_empty_fsm():
     with pytest.raises(ValueError, match="Cannot generate code: No states defined"):
-        generate_c_code_content({}, "empty_fsm", "Generic C (Header/Source Pair)")
\ No newline at end of file
+        generate_c_code_content({}, "empty_fsm", "Generic C (Header/Source Pair)")
+
+def test_id_storage_type_fits_every_id():
+    # IDs run 0..count-1 and FSM_NO_EVENT is -1, so the type must be signed
+    assert _id_storage_type(1) == "int8_t"
+    assert _id_storage_type(127) == "int8_t"
+    assert _id_storage_type(128) == "int16_t"
+    assert _id_storage_type(32767) == "int16_t"
+    assert _id_storage_type(32768) == "int32_t"
+
+def test_c_code_generation_with_more_than_127_states():
+    states = [{"name": f"S{i}", "is_initial": i == 0} for i in range(200)]
+    transitions = [{"source": f"S{i}", "target": f"S{(i + 1) % 200}", "event": "next"} for i in range(200)]
+    generated_code = generate_c_code_content(
+        diagram_data={"states": states, "transitions": transitions},
+        fsm_name="many_states",
+        target_platform="Generic C (Header/Source Pair)"
+    )
+
+    generated_h = generated_code.get('h', '')
+    assert "typedef int16_t FSM_StateId_t;" in generated_h
+    assert "typedef int8_t FSM_EventId_t;" in generated_h
+    assert "STATE_S199" in generated_h
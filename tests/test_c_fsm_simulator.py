@@ -0,0 +1,242 @@
+# tests/test_c_fsm_simulator.py
+import ctypes
+import os
+import shutil
+import subprocess
+import time
+from pathlib import Path
+
+import pytest
+from fsm_designer_project.core.c_fsm_simulator import (CFsmSimulator, CFsmModel, CSimError, FSM_GUARD_FN, FSM_ACTION_FN,
+                                                       CALLBACK_LOG_LIMIT)
+
+CORE_ENGINE_DIR = Path(__file__).parent.parent / "core_engine"
+
+
+@pytest.fixture(scope="module")
+def core_lib(tmp_path_factory):
+    """Builds fsm_core once per module (or uses FSM_CORE_LIB when set)."""
+    prebuilt = os.environ.get("FSM_CORE_LIB")
+    if prebuilt:
+        return prebuilt
+    cmake = shutil.which("cmake")
+    if not cmake:
+        pytest.skip("cmake is needed to build the fsm_core library")
+    build_dir = tmp_path_factory.mktemp("fsm_core_build")
+    subprocess.run([cmake, "-S", str(CORE_ENGINE_DIR), "-B", str(build_dir), "-DCMAKE_BUILD_TYPE=Release",
+                    "-DFSM_CORE_BUILD_RUNNER=OFF"], check=True, capture_output=True)
+    subprocess.run([cmake, "--build", str(build_dir), "--target", "fsm_core", "-j", str(os.cpu_count() or 2)],
+                   check=True, capture_output=True)
+    for pattern in ("libfsm_core.so", "libfsm_core.dylib", "**/fsm_core.dll"):
+        found = sorted(build_dir.glob(pattern))
+        if found:
+            return str(found[0])
+    pytest.fail("fsm_core was built but the library was not found")
+
+
+@pytest.fixture
+def counter_fsm_data():
+    return {
+        "states": [
+            {"name": "Idle", "is_initial": True, "entry_action": "count = 0"},
+            {"name": "Counting", "entry_action": "count = count + 1"},
+            {"name": "Done"},
+        ],
+        "transitions": [
+            {"source": "Idle", "target": "Counting", "event": "start"},
+            {"source": "Counting", "target": "Counting", "event": "tick", "condition": "count < 3"},
+            {"source": "Counting", "target": "Done", "event": "tick", "condition": "count >= 3"},
+            {"source": "Done", "target": "Idle", "event": "reset"},
+        ],
+    }
+
+
+def wait_for(predicate, timeout=5.0):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if predicate():
+            return True
+        time.sleep(0.005)
+    return predicate()
+
+
+def make_sim(core_lib, diagram_data, native_callbacks=False):
+    sim = CFsmSimulator(core_lib)
+    sim.set_initial_variables({"count": 0})
+    sim.load_fsm(diagram_data)
+    if native_callbacks:
+        sim.enable_native_callbacks()
+    return sim
+
+
+@pytest.mark.parametrize("native_callbacks", [False, True])
+def test_step_runs_actions_and_resolves_guards(core_lib, counter_fsm_data, native_callbacks):
+    sim = make_sim(core_lib, counter_fsm_data, native_callbacks)
+    assert sim.current_state_name == "Idle"
+
+    assert sim.step("start")[0] == "Counting"
+    assert sim._variables["count"] == 1
+    sim.step("tick")
+    sim.step("tick")
+    assert sim._variables["count"] == 3
+    # The first guard is now false, so the second one decides
+    assert sim.step("tick")[0] == "Done"
+    assert sim.step("unknown")[0] == "Done"
+    assert sim.current_tick == 5
+
+
+def test_reset_runs_initial_entry_action(core_lib, counter_fsm_data):
+    sim = make_sim(core_lib, counter_fsm_data)
+    sim.step("start")
+    sim.reset()
+    assert sim.current_state_name == "Idle"
+    assert sim._variables["count"] == 0
+    assert sim.current_tick == 0
+
+
+def test_changed_variables_are_reported_once(core_lib, counter_fsm_data):
+    sim = make_sim(core_lib, counter_fsm_data)
+    sim.get_changed_variables()  # Drain what load and reset touched
+
+    sim.step("start")
+    assert sim.get_changed_variables() == {"count": 1}
+    assert sim.get_changed_variables() == {}
+    sim.step("unknown")
+    assert sim.get_changed_variables() == {}
+
+
+def test_realtime_loop_processes_posted_events(core_lib, counter_fsm_data):
+    sim = make_sim(core_lib, counter_fsm_data, native_callbacks=True)
+    sim.get_changed_variables()
+    assert sim.start_realtime(1000.0)
+    try:
+        assert sim.is_realtime_running()
+        assert not sim.start_realtime(1000.0)  # Already running
+        assert sim.post_event("start")
+        assert wait_for(lambda: sim.get_realtime_status()["state"] == "Counting")
+
+        snapshot = sim.read_snapshot()
+        assert snapshot["state"] == "Counting"
+        assert snapshot["variables"]["count"] == 1
+        # Delta retrieval waits for the loop to stop; step() is ignored meanwhile
+        assert sim.get_changed_variables() == {}
+        sim.lib.step(sim.handle, b"tick")
+        assert sim.get_realtime_status()["state"] == "Counting"
+    finally:
+        sim.stop_realtime()
+
+    assert not sim.is_realtime_running()
+    status = sim.get_realtime_status()
+    assert status["loop_ticks"] > 0 and status["dropped_events"] == 0
+    assert sim.current_state_name == "Counting"
+    assert sim.get_changed_variables() == {"count": 1}
+
+
+def test_stop_from_engine_thread_callback_is_ignored(core_lib, counter_fsm_data):
+    sim = make_sim(core_lib, counter_fsm_data)
+    guard_calls = []
+
+    def guard(_user_data, _condition_id):
+        sim.lib.fsm_stop_realtime(sim.handle)  # Would join its own thread
+        guard_calls.append(sim.lib.fsm_is_realtime_running(sim.handle))
+        return False
+
+    guard_cb = FSM_GUARD_FN(guard)
+    action_cb = FSM_ACTION_FN(lambda _user_data, _kind, _action_id: None)
+    sim.lib.fsm_set_callbacks(sim.handle, guard_cb, action_cb, None)
+    sim.lib.step(sim.handle, b"start")
+
+    assert sim.start_realtime(1000.0)
+    try:
+        assert sim.post_event("tick")
+        assert wait_for(lambda: guard_calls)
+        assert guard_calls[0] is True
+        assert sim.is_realtime_running()
+    finally:
+        sim.stop_realtime()
+    assert not sim.is_realtime_running()
+
+
+def test_in_place_mutation_is_written_back(core_lib):
+    sim = CFsmSimulator(core_lib)
+    sim.set_initial_variables({"items": [], "meta": {"n": 0}})
+    sim.load_fsm({
+        "states": [{"name": "A", "is_initial": True}],
+        "transitions": [{"source": "A", "target": "A", "event": "add",
+                         "action": "items.append(len(items))\nmeta['n'] += 1"}],
+    })
+    sim.get_changed_variables()
+
+    sim.step("add")
+    sim.step("add")
+    assert sim.get_changed_variables() == {"items": [0, 1], "meta": {"n": 2}}
+
+
+def test_callback_log_is_bounded_in_realtime_mode(core_lib):
+    sim = CFsmSimulator(core_lib)
+    sim.set_initial_variables({"n": 0})
+    sim.load_fsm({"states": [{"name": "A", "is_initial": True, "during_action": "n += 1"}], "transitions": []})
+    sim.enable_native_callbacks()
+
+    assert sim.start_realtime(10000.0)
+    try:
+        assert wait_for(lambda: sim.get_realtime_status()["loop_ticks"] > CALLBACK_LOG_LIMIT)
+    finally:
+        sim.stop_realtime()
+    log = sim.take_callback_log()
+    assert len(log) == CALLBACK_LOG_LIMIT
+    assert sim.take_callback_log() == []
+
+
+def test_guards_after_the_first_true_one_are_not_covered(core_lib, counter_fsm_data):
+    sim = make_sim(core_lib, counter_fsm_data)
+    sim.enable_coverage()
+    sim.step("start")
+    sim.step("tick")  # count < 3 is true, so count >= 3 is never evaluated
+
+    coverage = sim.get_coverage()
+    assert coverage["guard_true"][1] == 1 and coverage["guard_false"][1] == 0
+    assert coverage["guard_true"][2] == 0 and coverage["guard_false"][2] == 0
+
+
+def test_trace_write_failure_is_reported(core_lib, counter_fsm_data, tmp_path):
+    sim = make_sim(core_lib, counter_fsm_data)
+    assert sim.start_trace(str(tmp_path / "run.fsmtrace"))
+    sim.step("start")
+    assert sim.stop_trace()
+    assert sim.get_trace_stats()["write_errors"] == 0
+
+    if not os.path.exists("/dev/full"):
+        pytest.skip("needs /dev/full to simulate a full disk")
+    assert sim.start_trace("/dev/full")
+    sim.step("tick")
+    assert not sim.stop_trace()
+    stats = sim.get_trace_stats()
+    assert stats["write_errors"] > 0 and stats["bytes_written"] == 0 and stats["bytes_pending"] == 0
+
+
+def test_repeated_list_key_is_rejected_with_its_offset(core_lib, tmp_path):
+    document = ('{"states": [{"name": "A", "is_initial": true}], "layout": {"states": []},\n'
+                ' "states": [{"name": "B"}], "transitions": []}')
+    path = tmp_path / "duplicate.bsm"
+    path.write_text(document)
+    offset = document.rindex('"states"')
+    with pytest.raises(CSimError, match=rf'duplicate key "states" \(byte {offset}\)'):
+        CFsmModel.compile_file(core_lib, str(path))
+
+
+def test_realtime_guards_without_callback_are_not_covered(core_lib, counter_fsm_data):
+    sim = make_sim(core_lib, counter_fsm_data)  # No native callbacks: guards cannot run in real time
+    sim.step("start")
+    sim.enable_coverage()
+    assert sim.start_realtime(1000.0)
+    try:
+        assert sim.post_event("tick")
+        assert wait_for(lambda: sim.get_realtime_status()["loop_ticks"] > 5)
+    finally:
+        sim.stop_realtime()
+
+    assert sim.current_state_name == "Counting"
+    coverage = sim.get_coverage()
+    assert coverage["guard_true"] == [0, 0, 0, 0]
+    assert coverage["guard_false"] == [0, 0, 0, 0]
@@ -3,12 +3,13 @@ from pyqtgraph.exporters import ImageExporter, CSVExporter
 
 from PyQt6.QtWidgets import (
     QWidget, QVBoxLayout, QListWidget, QHBoxLayout, QPushButton, QListWidgetItem,
-    QLineEdit, QLabel, QCheckBox, QSpinBox, QFileDialog, QColorDialog, QMenu
+    QLineEdit, QLabel, QCheckBox, QSpinBox, QFileDialog, QColorDialog, QMenu, QComboBox
 )
 from PyQt6.QtCore import pyqtSlot, Qt, QTimer, QPoint
 from PyQt6.QtGui import QColor, QCursor
 
 from ...core.simulation_logger import SimulationDataLogger
+from ...core.c_fsm_simulator import CFsmDownsampler
 from ...utils import config
 try:
     from ...utils.theme_config import theme_config
@@ -22,7 +23,8 @@ class SimulationPlotWidget(QWidget):
     - Variable filter + checkable list
     - Legend/grid/antialias toggles
     - Pause updates
-    - Time window (ticks) + downsample control
+    - Time window (ticks) + downsample control (every Nth point, or native
+      min/max / LTTB reduction to the plot's pixel width)
     - Dual Y-axes (left/right) with context menu
     - Export to CSV/PNG
     - Crosshair readout
@@ -40,6 +42,8 @@ class SimulationPlotWidget(QWidget):
         self._paused = False
         self._window_ticks = int(self._cfg_get("window_ticks", 1000))
         self._downsample_step = int(self._cfg_get("downsample_step", 1))
+        self._downsample_mode = str(self._cfg_get("downsample_mode", "step"))
+        self._downsampler = self._load_downsampler()
         self._show_legend = bool(self._cfg_get("legend", True))
         self._show_grid = bool(self._cfg_get("grid", True))
         self._antialias = bool(self._cfg_get("antialias", True))
@@ -122,6 +126,21 @@ class SimulationPlotWidget(QWidget):
         self.downsample_spin.valueChanged.connect(self._on_downsample_changed)
         toolbar.addWidget(self.downsample_spin)
 
+        toolbar.addWidget(QLabel("Reduce:"))
+        self.reduce_combo = QComboBox()
+        self.reduce_combo.addItem("Every Nth", "step")
+        self.reduce_combo.addItem("Min/Max", "minmax")
+        self.reduce_combo.addItem("LTTB", "lttb")
+        if self._downsampler is None:
+            # Native kernels need the compiled core_engine library
+            for index in (1, 2):
+                self.reduce_combo.model().item(index).setEnabled(False)
+            self._downsample_mode = "step"
+        self.reduce_combo.setCurrentIndex(max(0, self.reduce_combo.findData(self._downsample_mode)))
+        self.reduce_combo.setToolTip("Min/Max keeps spikes, LTTB keeps the line shape; both reduce to the plot width")
+        self.reduce_combo.currentIndexChanged.connect(self._on_reduce_mode_changed)
+        toolbar.addWidget(self.reduce_combo)
+
         self.fit_btn = QPushButton("Fit View")
         self.fit_btn.setToolTip("Auto-range both axes to fit data")
         self.fit_btn.clicked.connect(self._fit_view)
@@ -247,6 +266,16 @@ class SimulationPlotWidget(QWidget):
         except Exception:
             pass
 
+    def _load_downsampler(self):
+        path = self._cfg_get("native_library", None)
+        if not path:
+            return None
+        try:
+            return CFsmDownsampler(path)
+        except Exception as e:
+            print(f"Native downsampling unavailable: {e}")
+            return None
+
     def _apply_plot_config(self):
         # Legend visibility
         if self._show_legend and self.legend is None:
@@ -402,13 +431,22 @@ class SimulationPlotWidget(QWidget):
             if (global_max_tick is None) or (max_tick > global_max_tick):
                 global_max_tick = max_tick
 
-            # Downsample
-            if self._downsample_step > 1:
-                data = data[::self._downsample_step]
+            max_points = max(2, self.plot_widget.width())
+            if self._downsample_mode != "step" and self._downsampler is not None and len(data) > max_points:
+                # Reduce to screen resolution so pyqtgraph only gets drawable points
+                ticks, values = zip(*data)
+                if self._downsample_mode == "lttb":
+                    ticks, values = self._downsampler.lttb(ticks, values, max_points)
+                else:
+                    ticks, values = self._downsampler.min_max(ticks, values, max_points // 2)
+            else:
+                # Downsample
+                if self._downsample_step > 1:
+                    data = data[::self._downsample_step]
 
-            ticks, values = zip(*data) if data else ([], [])
-            # Coerce booleans to ints for plotting
-            values = [int(v) if isinstance(v, bool) else v for v in values]
+                ticks, values = zip(*data) if data else ([], [])
+                # Coerce booleans to ints for plotting
+                values = [int(v) if isinstance(v, bool) else v for v in values]
 
             entry["item"].setData(ticks, values)
 
@@ -471,6 +509,11 @@ class SimulationPlotWidget(QWidget):
         self._cfg_set("downsample_step", self._downsample_step)
         self.update_plot_data()
 
+    def _on_reduce_mode_changed(self, index):
+        self._downsample_mode = self.reduce_combo.itemData(index) or "step"
+        self._cfg_set("downsample_mode", self._downsample_mode)
+        self.update_plot_data()
+
     def _fit_view(self):
         # Fit both left and right Y axes
         self.plot_item.getViewBox().autoRange()